@@ -0,0 +1,34 @@
+//
+//  MBSBufferPool.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Internal use only
+///
+/// Fixed set of page-aligned scratch buffers allocated once and reused.
+/// `acquireBuffer` blocks while every buffer is checked out, which bounds the
+/// amount of work in flight. Buffers are zeroed when they are returned.
+@interface MBSBufferPool : NSObject
+
+@property (nonatomic, readonly) NSUInteger bufferSize;
+@property (nonatomic, readonly) NSUInteger count;
+
+- (nullable instancetype)initWithBufferSize:(NSUInteger)bufferSize count:(NSUInteger)count;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Checks out a buffer, waiting until one is free
+- (void *)acquireBuffer;
+
+/// Zeroes and returns a buffer obtained from `acquireBuffer`
+- (void)releaseBuffer:(void *)buffer;
+
+@end
+
+NS_ASSUME_NONNULL_END
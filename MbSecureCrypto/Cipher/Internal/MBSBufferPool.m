@@ -0,0 +1,76 @@
+//
+//  MBSBufferPool.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import "MBSBufferPool.h"
+#import <unistd.h>
+
+@interface MBSBufferPool ()
+@property (nonatomic, strong) dispatch_semaphore_t available;
+@property (nonatomic, strong) NSMutableArray<NSValue *> *freeBuffers;
+@property (nonatomic, strong) NSArray<NSValue *> *allBuffers;
+@end
+
+@implementation MBSBufferPool
+
+- (nullable instancetype)initWithBufferSize:(NSUInteger)bufferSize count:(NSUInteger)count {
+    self = [super init];
+    if (self) {
+        if (bufferSize == 0 || count == 0) {
+            return nil;
+        }
+
+        size_t pageSize = (size_t)getpagesize();
+        size_t alignedSize = (bufferSize + pageSize - 1) / pageSize * pageSize;
+
+        NSMutableArray<NSValue *> *buffers = [NSMutableArray arrayWithCapacity:count];
+        for (NSUInteger i = 0; i < count; i++) {
+            void *buffer = NULL;
+            if (posix_memalign(&buffer, pageSize, alignedSize) != 0) {
+                for (NSValue *value in buffers) {
+                    free(value.pointerValue);
+                }
+                return nil;
+            }
+            memset(buffer, 0, alignedSize);
+            [buffers addObject:[NSValue valueWithPointer:buffer]];
+        }
+
+        _bufferSize = bufferSize;
+        _count = count;
+        _allBuffers = [buffers copy];
+        _freeBuffers = buffers;
+        _available = dispatch_semaphore_create((long)count);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    for (NSValue *value in _allBuffers) {
+        memset_s(value.pointerValue, _bufferSize, 0, _bufferSize);
+        free(value.pointerValue);
+    }
+}
+
+- (void *)acquireBuffer {
+    dispatch_semaphore_wait(self.available, DISPATCH_TIME_FOREVER);
+    @synchronized (self.freeBuffers) {
+        void *buffer = self.freeBuffers.lastObject.pointerValue;
+        [self.freeBuffers removeLastObject];
+        return buffer;
+    }
+}
+
+- (void)releaseBuffer:(void *)buffer {
+    memset_s(buffer, self.bufferSize, 0, self.bufferSize);
+    @synchronized (self.freeBuffers) {
+        [self.freeBuffers addObject:[NSValue valueWithPointer:buffer]];
+    }
+    dispatch_semaphore_signal(self.available);
+}
+
+@end
@@ -0,0 +1,110 @@
+//
+//  MBSChunkedCipher.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import <Foundation/Foundation.h>
+#import "MBSCipherTypes.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class MBSCipherHeader;
+
+/// Size of the record header preceding every sealed chunk
+FOUNDATION_EXPORT const NSUInteger kMBSChunkRecordHeaderSize;
+
+/// Record header bit marking the final chunk; the low 31 bits hold the ciphertext length
+FOUNDATION_EXPORT const uint32_t kMBSChunkRecordFinalFlag;
+
+/// Internal use only
+///
+/// Seals and opens the records of the chunked V1 format:
+///
+///     [V1 HEADER + CHUNKED EXTENSION][RECORD 0]...[RECORD n (final)]
+///     RECORD = [RECORD_HEADER(4)][CIPHERTEXT(len)][TAG(16)]
+///
+/// Record i is sealed with the header nonce XOR i and the associated data
+/// `headerAAD || i(8) || RECORD_HEADER(4)`. The sequential methods track the
+/// record index and must see the records in order.
+///
+/// When the header carries the COMPRESSION extension, each chunk is sealed as
+/// `[ORIGINAL_LENGTH(4)][BODY]`, where BODY is the compressed chunk, or the
+/// chunk itself (bit 31 of ORIGINAL_LENGTH set) when it does not shrink.
+@interface MBSChunkedCipher : NSObject
+
+@property (nonatomic, readonly) MBSCipherHeader *header;
+@property (nonatomic, readonly) NSUInteger chunkSize;
+@property (nonatomic, readonly, getter=isFinished) BOOL finished;
+
+@property (nonatomic, readonly) MBSCompressionCodec compression;
+
+/// YES unless records are compressed; only then does every non-final record have the same size
+@property (nonatomic, readonly) BOOL hasFixedRecordSize;
+
+/// Largest ciphertext length a record header may announce
+@property (nonatomic, readonly) NSUInteger maximumRecordLength;
+
+/// Size of a full (non-final) record on disk when `hasFixedRecordSize`
+@property (nonatomic, readonly) NSUInteger recordSize;
+
+/// Creates an encoder with a fresh random header
++ (nullable instancetype)encoderWithKey:(NSData *)key
+                             chunkSize:(NSUInteger)chunkSize
+                                 error:(NSError **)error;
+
+/// Creates an encoder whose chunks are compressed with `compression` before sealing
++ (nullable instancetype)encoderWithKey:(NSData *)key
+                             chunkSize:(NSUInteger)chunkSize
+                           compression:(MBSCompressionCodec)compression
+                                 error:(NSError **)error;
+
+/// Creates a decoder for a parsed header carrying the chunked extension
++ (nullable instancetype)decoderWithHeader:(MBSCipherHeader *)header
+                                       key:(NSData *)key
+                                     error:(NSError **)error;
+
+/// Seals `length` plaintext bytes (at most `chunkSize`) as the next record
+- (nullable NSData *)sealBytes:(const void *)bytes
+                        length:(NSUInteger)length
+                         final:(BOOL)final
+                         error:(NSError **)error;
+
+/// Opens the next record from its record header and [ciphertext][tag] body
+- (nullable NSData *)openRecord:(uint32_t)recordHeader
+                         sealed:(NSData *)sealed
+                          error:(NSError **)error;
+
+/// Seals the record at `index` without advancing the coder.
+///
+/// Every record but the final one holds exactly `chunkSize` bytes, so record
+/// offsets are fixed and records may be sealed concurrently and out of order.
+- (nullable NSData *)sealBytes:(const void *)bytes
+                        length:(NSUInteger)length
+                       atIndex:(uint64_t)index
+                         final:(BOOL)final
+                         error:(NSError **)error;
+
+/// Opens the record at `index` without advancing the coder; safe to call concurrently
+- (nullable NSData *)openRecord:(uint32_t)recordHeader
+                         sealed:(NSData *)sealed
+                        atIndex:(uint64_t)index
+                          error:(NSError **)error;
+
+/// Opens the fixed-size record at `index` into `plaintext`, which must hold
+/// `chunkSize` bytes and not overlap `sealed`; safe to call concurrently.
+///
+/// Lets callers keep plaintext in memory they wipe themselves. Anything
+/// written to `plaintext` is wiped again when authentication fails.
+- (BOOL)openRecord:(uint32_t)recordHeader
+       sealedBytes:(const void *)sealed
+            length:(NSUInteger)length
+           atIndex:(uint64_t)index
+              into:(void *)plaintext
+             error:(NSError **)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
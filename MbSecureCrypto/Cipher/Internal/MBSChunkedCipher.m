@@ -0,0 +1,349 @@
+//
+//  MBSChunkedCipher.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import "MBSChunkedCipher.h"
+#import "MBSError.h"
+#import "MBSGCMDecryptor.h"
+
+// Handle both framework and static library imports
+#if __has_include(<MbSecureCrypto/MbSecureCrypto-Swift.h>)
+#import <MbSecureCrypto/MbSecureCrypto-Swift.h>
+#else
+#import "MbSecureCrypto-Swift.h"
+#endif
+
+const NSUInteger kMBSChunkRecordHeaderSize = 4;
+const uint32_t kMBSChunkRecordFinalFlag = 0x80000000;
+
+static const NSUInteger kMBSChunkMinSize = 4 * 1024;
+static const NSUInteger kMBSChunkMaxSize = 16 * 1024 * 1024;
+
+// Compressed records seal [ORIGINAL_LENGTH(4)][BODY]; this bit marks a body stored uncompressed
+static const NSUInteger kMBSChunkLengthPrefixSize = 4;
+static const uint32_t kMBSChunkStoredFlag = 0x80000000;
+
+@interface MBSChunkedCipher ()
+@property (nonatomic, strong) MBSCipherHeader *header;
+@property (nonatomic, copy) NSData *key;
+@property (nonatomic, copy) NSData *headerAAD;
+@property (nonatomic, assign) NSUInteger chunkSize;
+@property (nonatomic, assign) MBSCompressionCodec compression;
+@property (nonatomic, assign) uint64_t nextIndex;
+@property (nonatomic, assign, getter=isFinished) BOOL finished;
+@end
+
+@implementation MBSChunkedCipher
+
++ (nullable instancetype)encoderWithKey:(NSData *)key
+                             chunkSize:(NSUInteger)chunkSize
+                                 error:(NSError **)error {
+    return [self encoderWithKey:key chunkSize:chunkSize compression:MBSCompressionCodecNone error:error];
+}
+
++ (nullable instancetype)encoderWithKey:(NSData *)key
+                             chunkSize:(NSUInteger)chunkSize
+                           compression:(MBSCompressionCodec)compression
+                                 error:(NSError **)error {
+    if (compression != MBSCompressionCodecNone && ![MBSCompression isSupportedCodec:compression]) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Unsupported compression codec"}];
+        }
+        return nil;
+    }
+
+    if (chunkSize < kMBSChunkMinSize || chunkSize > kMBSChunkMaxSize) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey:
+                                                    [NSString stringWithFormat:@"Chunk size must be between %lu and %lu bytes",
+                                                     (unsigned long)kMBSChunkMinSize, (unsigned long)kMBSChunkMaxSize]}];
+        }
+        return nil;
+    }
+
+    MBSCipherHeader *header = [MBSCipherHeader randomHeader];
+    uint32_t chunkSizeBE = CFSwapInt32HostToBig((uint32_t)chunkSize);
+    [header setExtensionValue:[NSData dataWithBytes:&chunkSizeBE length:sizeof(chunkSizeBE)]
+                         type:MBSCipherHeader.extensionChunked];
+    if (compression != MBSCompressionCodecNone) {
+        // Streams are sealed before their length is known
+        [header setCompressionWithCodec:compression originalLength:MBSCipherHeader.unknownLength];
+    }
+
+    return [[self alloc] initWithHeader:header key:key chunkSize:chunkSize];
+}
+
++ (nullable instancetype)decoderWithHeader:(MBSCipherHeader *)header
+                                       key:(NSData *)key
+                                     error:(NSError **)error {
+    NSData *value = [header extensionValue:MBSCipherHeader.extensionChunked];
+    uint32_t chunkSizeBE = 0;
+    if (value.length == sizeof(chunkSizeBE)) {
+        [value getBytes:&chunkSizeBE length:sizeof(chunkSizeBE)];
+    }
+
+    NSUInteger chunkSize = CFSwapInt32BigToHost(chunkSizeBE);
+    if (chunkSize < kMBSChunkMinSize || chunkSize > kMBSChunkMaxSize) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Invalid chunked extension in V1 header"}];
+        }
+        return nil;
+    }
+
+    return [[self alloc] initWithHeader:header key:key chunkSize:chunkSize];
+}
+
+- (instancetype)initWithHeader:(MBSCipherHeader *)header
+                           key:(NSData *)key
+                     chunkSize:(NSUInteger)chunkSize {
+    self = [super init];
+    if (self) {
+        _header = header;
+        _key = [key copy];
+        _headerAAD = [header authenticatedData];
+        _chunkSize = chunkSize;
+        _compression = (MBSCompressionCodec)header.compressionCodec;
+    }
+    return self;
+}
+
+- (BOOL)hasFixedRecordSize {
+    return self.compression == MBSCompressionCodecNone;
+}
+
+- (NSUInteger)maximumRecordLength {
+    return self.chunkSize + (self.hasFixedRecordSize ? 0 : kMBSChunkLengthPrefixSize);
+}
+
+- (NSUInteger)recordSize {
+    return kMBSChunkRecordHeaderSize + self.maximumRecordLength + (NSUInteger)MBSCipherHeader.tagSize;
+}
+
+- (NSData *)authenticatedDataForRecord:(uint32_t)recordHeader index:(uint64_t)index {
+    NSMutableData *aad = [NSMutableData dataWithData:self.headerAAD];
+    uint64_t indexBE = CFSwapInt64HostToBig(index);
+    uint32_t recordBE = CFSwapInt32HostToBig(recordHeader);
+    [aad appendBytes:&indexBE length:sizeof(indexBE)];
+    [aad appendBytes:&recordBE length:sizeof(recordBE)];
+    return aad;
+}
+
+- (BOOL)isValidChunkLength:(NSUInteger)length final:(BOOL)final {
+    // Only the final chunk may be short, which keeps every uncompressed record offset fixed
+    return final ? length <= self.chunkSize : length == self.chunkSize;
+}
+
+- (BOOL)isValidRecordLength:(NSUInteger)length final:(BOOL)final {
+    if (self.hasFixedRecordSize) {
+        return [self isValidChunkLength:length final:final];
+    }
+    return length >= kMBSChunkLengthPrefixSize && length <= self.maximumRecordLength;
+}
+
+/// [ORIGINAL_LENGTH(4)][BODY], storing the chunk as-is when it does not compress
+- (NSData *)compressedPayloadForChunk:(NSData *)chunk {
+    NSData *compressed = [MBSCompression compress:chunk codec:self.compression];
+    uint32_t prefix = (uint32_t)chunk.length | (compressed ? 0 : kMBSChunkStoredFlag);
+    uint32_t prefixBE = CFSwapInt32HostToBig(prefix);
+
+    NSData *body = compressed ?: chunk;
+    NSMutableData *payload = [NSMutableData dataWithCapacity:kMBSChunkLengthPrefixSize + body.length];
+    [payload appendBytes:&prefixBE length:sizeof(prefixBE)];
+    [payload appendData:body];
+    return payload;
+}
+
+- (nullable NSData *)chunkFromPayload:(NSData *)payload final:(BOOL)final error:(NSError **)error {
+    uint32_t prefixBE = 0;
+    [payload getBytes:&prefixBE length:sizeof(prefixBE)];
+    uint32_t prefix = CFSwapInt32BigToHost(prefixBE);
+    NSUInteger length = prefix & ~kMBSChunkStoredFlag;
+    NSData *body = [payload subdataWithRange:NSMakeRange(kMBSChunkLengthPrefixSize, payload.length - kMBSChunkLengthPrefixSize)];
+
+    if (![self isValidChunkLength:length final:final] || ((prefix & kMBSChunkStoredFlag) && body.length != length)) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Invalid chunk record"}];
+        }
+        return nil;
+    }
+
+    if (prefix & kMBSChunkStoredFlag) {
+        return body;
+    }
+    return [MBSCompression decompress:body codec:self.compression originalLength:(NSInteger)length error:error];
+}
+
+- (nullable NSData *)sealBytes:(const void *)bytes
+                        length:(NSUInteger)length
+                         final:(BOOL)final
+                         error:(NSError **)error {
+    if (self.finished) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Chunk follows the final chunk"}];
+        }
+        return nil;
+    }
+
+    NSData *record = [self sealBytes:bytes length:length atIndex:self.nextIndex final:final error:error];
+    if (!record) {
+        return nil;
+    }
+
+    self.nextIndex += 1;
+    self.finished = final;
+    return record;
+}
+
+- (nullable NSData *)sealBytes:(const void *)bytes
+                        length:(NSUInteger)length
+                       atIndex:(uint64_t)index
+                         final:(BOOL)final
+                         error:(NSError **)error {
+    if (![self isValidChunkLength:length final:final]) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Only the final chunk may be shorter than the chunk size"}];
+        }
+        return nil;
+    }
+
+    NSData *plaintext = [NSData dataWithBytesNoCopy:(void *)bytes length:length freeWhenDone:NO];
+    if (!self.hasFixedRecordSize) {
+        plaintext = [self compressedPayloadForChunk:plaintext];
+    }
+
+    uint32_t recordHeader = (uint32_t)plaintext.length | (final ? kMBSChunkRecordFinalFlag : 0);
+    NSData *sealed = [MBSCipherBridge sealChunk:plaintext
+                                            key:self.key
+                                          nonce:[self.header nonceForChunk:index]
+                                 authenticating:[self authenticatedDataForRecord:recordHeader index:index]
+                                          error:error];
+    if (!sealed) {
+        return nil;
+    }
+
+    NSMutableData *record = [NSMutableData dataWithCapacity:kMBSChunkRecordHeaderSize + sealed.length];
+    uint32_t recordBE = CFSwapInt32HostToBig(recordHeader);
+    [record appendBytes:&recordBE length:sizeof(recordBE)];
+    [record appendData:sealed];
+    return record;
+}
+
+- (nullable NSData *)openRecord:(uint32_t)recordHeader
+                         sealed:(NSData *)sealed
+                          error:(NSError **)error {
+    if (self.finished) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Invalid chunk record"}];
+        }
+        return nil;
+    }
+
+    NSData *plaintext = [self openRecord:recordHeader sealed:sealed atIndex:self.nextIndex error:error];
+    if (!plaintext) {
+        return nil;
+    }
+
+    self.nextIndex += 1;
+    self.finished = (recordHeader & kMBSChunkRecordFinalFlag) != 0;
+    return plaintext;
+}
+
+- (nullable NSData *)openRecord:(uint32_t)recordHeader
+                         sealed:(NSData *)sealed
+                        atIndex:(uint64_t)index
+                          error:(NSError **)error {
+    NSUInteger length = recordHeader & ~kMBSChunkRecordFinalFlag;
+    BOOL final = (recordHeader & kMBSChunkRecordFinalFlag) != 0;
+    if (![self isValidRecordLength:length final:final] || sealed.length != length + (NSUInteger)MBSCipherHeader.tagSize) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Invalid chunk record"}];
+        }
+        return nil;
+    }
+
+    NSData *plaintext = [MBSCipherBridge openChunk:sealed
+                                               key:self.key
+                                             nonce:[self.header nonceForChunk:index]
+                                    authenticating:[self authenticatedDataForRecord:recordHeader index:index]
+                                             error:error];
+    if (!plaintext || self.hasFixedRecordSize) {
+        return plaintext;
+    }
+    return [self chunkFromPayload:plaintext final:final error:error];
+}
+
+- (BOOL)openRecord:(uint32_t)recordHeader
+       sealedBytes:(const void *)sealed
+            length:(NSUInteger)length
+           atIndex:(uint64_t)index
+              into:(void *)plaintext
+             error:(NSError **)error {
+    NSUInteger recordLength = recordHeader & ~kMBSChunkRecordFinalFlag;
+    BOOL final = (recordHeader & kMBSChunkRecordFinalFlag) != 0;
+    if (!self.hasFixedRecordSize || ![self isValidRecordLength:recordLength final:final] ||
+        length != recordLength + (NSUInteger)MBSCipherHeader.tagSize) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Invalid chunk record"}];
+        }
+        return NO;
+    }
+
+    NSData *nonce = [self.header nonceForChunk:index];
+    NSData *aad = [self authenticatedDataForRecord:recordHeader index:index];
+    MBSGCMDecryptor decryptor;
+    if (self.key.length != 32 || nonce.length != MBS_GCM_NONCE_SIZE ||
+        MBSGCMDecryptorInit(&decryptor, self.key.bytes, nonce.bytes, aad.bytes, aad.length) != kCCSuccess) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorDecryptionFailed
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Failed to initialise AES-GCM decryption"}];
+        }
+        return NO;
+    }
+
+    if (MBSGCMDecryptorUpdate(&decryptor, sealed, plaintext, recordLength) != kCCSuccess) {
+        MBSGCMDecryptorRelease(&decryptor);
+        memset_s(plaintext, recordLength, 0, recordLength);
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorDecryptionFailed
+                                     userInfo:@{NSLocalizedDescriptionKey: @"AES-GCM decryption failed"}];
+        }
+        return NO;
+    }
+
+    if (MBSGCMDecryptorFinal(&decryptor, (const uint8_t *)sealed + recordLength) != 0) {
+        memset_s(plaintext, recordLength, 0, recordLength);
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorAuthenticationFailed
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Authentication tag verification failed"}];
+        }
+        return NO;
+    }
+    return YES;
+}
+
+@end
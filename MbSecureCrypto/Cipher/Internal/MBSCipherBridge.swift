@@ -199,6 +199,17 @@ public class MBSCipherBridge: NSObject {
         // 4. Parse parameters block
         let paramsStart = FormatV1.headerSize
         let paramsEnd = paramsStart + Int(paramsLength)
+        
+        // Parameters beyond IV and tag length carry header extensions
+        if Int(paramsLength) > FormatV1.aesGCMParamsSize {
+            return try decryptExtendedFormatV1(data: data, key: key)
+        }
+        
+        guard data.count >= paramsEnd + 16 else {
+            throw NSError(domain: MBSErrorDomain,
+                          code: 202, // MBSCipherErrorInvalidInput
+                          userInfo: [NSLocalizedDescriptionKey: "V1 format data too short"])
+        }
         let params = data[paramsStart..<paramsEnd]
         
         // 5. Extract nonce and validate tag length
@@ -238,6 +249,231 @@ public class MBSCipherBridge: NSObject {
     }
     
     
+    private static func decryptExtendedFormatV1(data: Data, key: SymmetricKey) throws -> Data {
+        var parseError: NSError?
+        guard let header = MBSCipherHeader.parseHeader(data, error: &parseError) else {
+            throw parseError!
+        }
+        
+        guard header.extensionValue(MBSCipherHeader.extensionChunked) == nil else {
+            throw NSError(domain: MBSErrorDomain,
+                          code: 206, // MBSCipherErrorFormatMismatch
+                          userInfo: [NSLocalizedDescriptionKey: "Chunked V1 data must be decrypted with MBSCipherStream"])
+        }
+        
+        guard header.wrappedKey == nil else {
+            throw NSError(domain: MBSErrorDomain,
+                          code: 206, // MBSCipherErrorFormatMismatch
+                          userInfo: [NSLocalizedDescriptionKey: "Envelope-encrypted V1 data must be decrypted with MBSEnvelopeCipher"])
+        }
+        
+        guard header.extensionValue(MBSCipherHeader.extensionRecipients) == nil else {
+            throw NSError(domain: MBSErrorDomain,
+                          code: 206, // MBSCipherErrorFormatMismatch
+                          userInfo: [NSLocalizedDescriptionKey: "Multi-recipient V1 data must be decrypted with MBSMultiRecipientCipher"])
+        }
+        
+        guard data.count >= header.encodedLength + MBSCipherHeader.tagSize else {
+            throw NSError(domain: MBSErrorDomain,
+                          code: 202, // MBSCipherErrorInvalidInput
+                          userInfo: [NSLocalizedDescriptionKey: "V1 format data too short"])
+        }
+        
+        let start = data.startIndex + header.encodedLength
+        let ciphertext = data[start..<(data.endIndex - MBSCipherHeader.tagSize)]
+        let tag = data.suffix(MBSCipherHeader.tagSize)
+        
+        let sealedBox = try AES.GCM.SealedBox(nonce: AES.GCM.Nonce(data: header.nonce),
+                                              ciphertext: ciphertext,
+                                              tag: tag)
+        let plaintext: Data
+        do {
+            plaintext = try AES.GCM.open(sealedBox, using: key, authenticating: header.authenticatedData())
+        } catch CryptoKitError.authenticationFailure {
+            throw NSError(domain: MBSErrorDomain,
+                          code: 212, // MBSCipherErrorAuthenticationFailed
+                          userInfo: [NSLocalizedDescriptionKey: "Authentication tag verification failed"])
+        }
+        
+        guard header.compressionCodec != 0 else { // MBSCompressionCodecNone
+            return plaintext
+        }
+        
+        // The authenticated original length sizes the output exactly, so it is bounded before allocating
+        let maximumLength = MBSCompression.maximumOriginalLength(forCompressedLength: plaintext.count)
+        guard header.originalLength <= UInt64(maximumLength) else {
+            throw NSError(domain: MBSErrorDomain,
+                          code: 202, // MBSCipherErrorInvalidInput
+                          userInfo: [NSLocalizedDescriptionKey: "Compressed V1 data declares an original length over the size limit"])
+        }
+        var decompressError: NSError?
+        guard let original = MBSCompression.decompress(plaintext,
+                                                       codec: header.compressionCodec,
+                                                       originalLength: Int(header.originalLength),
+                                                       error: &decompressError) else {
+            throw decompressError!
+        }
+        return original
+    }
+    
+    /// V1 with the COMPRESSION extension.
+    ///
+    /// Data that does not shrink is sealed with a plain V1 header instead.
+    private static func encryptCompressedFormatV1(data: Data, key: SymmetricKey, codec: UInt8) throws -> Data {
+        guard let compressed = MBSCompression.compress(data, codec: codec) else {
+            return try encryptFormatV1(data: data, key: key)
+        }
+        
+        let header = MBSCipherHeader.randomHeader()
+        header.setCompression(codec: codec, originalLength: UInt64(data.count))
+        
+        let sealedBox = try AES.GCM.seal(compressed,
+                                         using: key,
+                                         nonce: AES.GCM.Nonce(data: header.nonce),
+                                         authenticating: header.authenticatedData())
+        
+        var result = header.encoded()
+        result.append(sealedBox.ciphertext)
+        result.append(sealedBox.tag)
+        return result
+    }
+    
+    // MARK: - Chunk primitives
+    
+    /// Seals one chunk with an explicit nonce and associated data.
+    ///
+    /// Returns [ciphertext][tag(16)].
+    @objc
+    public static func sealChunk(_ data: Data,
+                                 key: Data,
+                                 nonce: Data,
+                                 authenticating aad: Data,
+                                 error: UnsafeMutablePointer<NSError?>?) -> Data? {
+        guard key.count == 32 else { // AES-256
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 200, // MBSCipherErrorInvalidKey
+                                     userInfo: [NSLocalizedDescriptionKey: "Key must be 32 bytes for AES-256"])
+            return nil
+        }
+        
+        do {
+            let sealedBox = try AES.GCM.seal(data,
+                                             using: SymmetricKey(data: key),
+                                             nonce: AES.GCM.Nonce(data: nonce),
+                                             authenticating: aad)
+            var sealed = Data(capacity: sealedBox.ciphertext.count + MBSCipherHeader.tagSize)
+            sealed.append(sealedBox.ciphertext)
+            sealed.append(sealedBox.tag)
+            return sealed
+        } catch let aError as NSError {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 210, // MBSCipherErrorEncryptionFailed
+                                     userInfo: [NSLocalizedDescriptionKey: "Encryption failed: \(aError.localizedDescription)"])
+            return nil
+        }
+    }
+    
+    /// Opens one [ciphertext][tag(16)] chunk sealed by `sealChunk`.
+    @objc
+    public static func openChunk(_ sealed: Data,
+                                 key: Data,
+                                 nonce: Data,
+                                 authenticating aad: Data,
+                                 error: UnsafeMutablePointer<NSError?>?) -> Data? {
+        guard key.count == 32 else { // AES-256
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 200, // MBSCipherErrorInvalidKey
+                                     userInfo: [NSLocalizedDescriptionKey: "Key must be 32 bytes for AES-256"])
+            return nil
+        }
+        
+        guard sealed.count >= MBSCipherHeader.tagSize else {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 202, // MBSCipherErrorInvalidInput
+                                     userInfo: [NSLocalizedDescriptionKey: "Encrypted chunk too short"])
+            return nil
+        }
+        
+        do {
+            let sealedBox = try AES.GCM.SealedBox(nonce: AES.GCM.Nonce(data: nonce),
+                                                  ciphertext: sealed.dropLast(MBSCipherHeader.tagSize),
+                                                  tag: sealed.suffix(MBSCipherHeader.tagSize))
+            return try AES.GCM.open(sealedBox, using: SymmetricKey(data: key), authenticating: aad)
+        } catch CryptoKitError.authenticationFailure {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 212, // MBSCipherErrorAuthenticationFailed
+                                     userInfo: [NSLocalizedDescriptionKey: "Authentication tag verification failed"])
+            return nil
+        } catch let aError as NSError {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 211, // MBSCipherErrorDecryptionFailed
+                                     userInfo: [NSLocalizedDescriptionKey: "Decryption failed: \(aError.localizedDescription)"])
+            return nil
+        }
+    }
+    
+    // MARK: - Key wrapping
+    
+    /// Wraps a data key under a key-encryption key with AES Key Wrap (RFC 3394).
+    ///
+    /// Returns the wrapped key, 8 bytes longer than `dataKey`.
+    @objc
+    public static func wrapKey(_ dataKey: Data,
+                               keyEncryptionKey: Data,
+                               error: UnsafeMutablePointer<NSError?>?) -> Data? {
+        guard keyEncryptionKey.count == 32, dataKey.count >= 16, dataKey.count % 8 == 0 else {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 200, // MBSCipherErrorInvalidKey
+                                     userInfo: [NSLocalizedDescriptionKey: "Key wrap needs a 32-byte KEK and a data key of at least 16 bytes in 8-byte steps"])
+            return nil
+        }
+        
+        do {
+            return try AES.KeyWrap.wrap(SymmetricKey(data: dataKey), using: SymmetricKey(data: keyEncryptionKey))
+        } catch let aError as NSError {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 210, // MBSCipherErrorEncryptionFailed
+                                     userInfo: [NSLocalizedDescriptionKey: "Key wrap failed: \(aError.localizedDescription)"])
+            return nil
+        }
+    }
+    
+    /// Unwraps a key produced by `wrapKey`. Fails with MBSCipherErrorAuthenticationFailed
+    /// when the KEK is wrong or the wrapped key was modified.
+    @objc
+    public static func unwrapKey(_ wrappedKey: Data,
+                                 keyEncryptionKey: Data,
+                                 error: UnsafeMutablePointer<NSError?>?) -> Data? {
+        guard keyEncryptionKey.count == 32 else { // AES-256
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 200, // MBSCipherErrorInvalidKey
+                                     userInfo: [NSLocalizedDescriptionKey: "Key-encryption key must be 32 bytes for AES-256"])
+            return nil
+        }
+        
+        guard wrappedKey.count >= 24, wrappedKey.count % 8 == 0 else {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 202, // MBSCipherErrorInvalidInput
+                                     userInfo: [NSLocalizedDescriptionKey: "Invalid wrapped key length"])
+            return nil
+        }
+        
+        do {
+            let dataKey = try AES.KeyWrap.unwrap(wrappedKey, using: SymmetricKey(data: keyEncryptionKey))
+            return dataKey.withUnsafeBytes { Data($0) }
+        } catch CryptoKitError.unwrapFailure {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 212, // MBSCipherErrorAuthenticationFailed
+                                     userInfo: [NSLocalizedDescriptionKey: "Wrapped key integrity check failed"])
+            return nil
+        } catch let aError as NSError {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 211, // MBSCipherErrorDecryptionFailed
+                                     userInfo: [NSLocalizedDescriptionKey: "Key unwrap failed: \(aError.localizedDescription)"])
+            return nil
+        }
+    }
+    
     @objc
     public static func encryptString(_ string: String,
                                      key: Data,
@@ -340,6 +576,40 @@ public class MBSCipherBridge: NSObject {
         }
     }
     
+    @objc
+    public static func encryptData(_ data: Data,
+                                   key: Data,
+                                   algorithm: MBSCipherAlgorithm,
+                                   compression: MBSCompressionCodec,
+                                   error: UnsafeMutablePointer<NSError?>?) -> Data? {
+        guard key.count == 32 else { // AES-256
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 200, // MBSCipherErrorInvalidKey
+                                     userInfo: [NSLocalizedDescriptionKey: "Key must be 32 bytes for AES-256"])
+            return nil
+        }
+        
+        guard compression.rawValue == 0 || MBSCompression.isSupportedCodec(compression.rawValue) else {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 202, // MBSCipherErrorInvalidInput
+                                     userInfo: [NSLocalizedDescriptionKey: "Unsupported compression codec"])
+            return nil
+        }
+        
+        do {
+            let symmetricKey = SymmetricKey(data: key)
+            if compression.rawValue == 0 { // MBSCompressionCodecNone
+                return try encryptFormatV1(data: data, key: symmetricKey)
+            }
+            return try encryptCompressedFormatV1(data: data, key: symmetricKey, codec: compression.rawValue)
+        } catch let aError as NSError {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 210, // MBSCipherErrorEncryptionFailed
+                                     userInfo: [NSLocalizedDescriptionKey: "Encryption failed: \(aError.localizedDescription)"])
+            return nil
+        }
+    }
+    
     @objc
     public static func decryptData(_ encryptedData: Data,
                                    key: Data,
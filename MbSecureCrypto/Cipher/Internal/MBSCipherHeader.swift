@@ -0,0 +1,430 @@
+//
+//  MBSCipherHeader.swift
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+import Foundation
+import CryptoKit
+
+/// Internal use only
+///
+/// V1 "SECB" header whose AES-GCM parameter block carries extensions
+/// after the IV and tag length:
+///
+///     PARAMS    = [IV(12)][TAG_LEN(4)][EXTENSION...]
+///     EXTENSION = [TYPE(1)][LENGTH(2)][VALUE(LENGTH)]
+///
+/// A header without extensions encodes exactly like the classic V1 header.
+/// When extensions are present, the fixed header fields, the IV, the tag
+/// length and every extension with a type below 0x80 are authenticated as
+/// AES-GCM associated data. Types 0x80 and above are key slots and are left
+/// out of the associated data so they can be rewritten in place.
+///
+@objcMembers
+public class MBSCipherHeader: NSObject {
+
+    public static let magicBytes = "SECB".data(using: .ascii)!
+    public static let version: UInt8 = 0x01
+    public static let algorithmAESGCM: UInt8 = 0x01
+    public static let fixedSize = 8 // MAGIC(4) + VERSION(1) + ALG(1) + PARAMS_LEN(2)
+    public static let aesGCMParamsSize = 16 // IV(12) + TAG_LENGTH(4)
+    public static let nonceSize = 12
+    public static let tagSize = 16
+    private static let tagLengthBits: UInt32 = 128
+
+    // Extension types
+    /// Payload is a sequence of independently sealed chunks. Value: [CHUNK_SIZE(4)]
+    public static let extensionChunked: UInt8 = 0x01
+    /// Plaintext was compressed before sealing. Value: [CODEC(1)][ORIGINAL_LENGTH(8)]
+    public static let extensionCompression: UInt8 = 0x02
+
+    /// Data key wrapped under a key-encryption key. Value: [KEY_ID_LEN(1)][KEY_ID][WRAPPED_KEY]
+    public static let extensionWrappedKey: UInt8 = 0x81
+    /// Content key wrapped once per recipient. Value: [KEY_ID(8)][WRAPPED_KEY(40)]..., sorted by KEY_ID
+    public static let extensionRecipients: UInt8 = 0x82
+
+    public static let recipientIdentifierSize = 8
+    public static let recipientWrappedKeySize = 40 // AES Key Wrap of a 32-byte key
+    private static let recipientEntrySize = recipientIdentifierSize + recipientWrappedKeySize
+
+    /// ORIGINAL_LENGTH of a stream whose length was not known when the header was written
+    public static let unknownLength: UInt64 = .max
+    private static let compressionValueSize = 9
+
+    /// Extension types a reader understands; anything else is rejected
+    private static let knownExtensions: Set<UInt8> = [extensionChunked, extensionCompression, extensionWrappedKey,
+                                                       extensionRecipients]
+
+    public private(set) var nonce: Data
+    private var extensions: [(type: UInt8, value: Data)] = []
+
+    public init(nonce: Data) {
+        self.nonce = nonce
+        super.init()
+    }
+
+    /// A header with a fresh random nonce and no extensions
+    public static func randomHeader() -> MBSCipherHeader {
+        let nonce = AES.GCM.Nonce()
+        return MBSCipherHeader(nonce: nonce.withUnsafeBytes { Data($0) })
+    }
+
+    public var hasExtensions: Bool {
+        return !extensions.isEmpty
+    }
+
+    /// Size of the encoded header including the parameter block
+    public var encodedLength: Int {
+        return MBSCipherHeader.fixedSize + paramsLength
+    }
+
+    private var paramsLength: Int {
+        return extensions.reduce(MBSCipherHeader.aesGCMParamsSize) { $0 + 3 + $1.value.count }
+    }
+
+    public func extensionValue(_ type: UInt8) -> Data? {
+        return extensions.first(where: { $0.type == type })?.value
+    }
+
+    /// Replaces, appends or (with nil) removes an extension.
+    ///
+    /// Returns false if the parameter block would no longer fit PARAMS_LENGTH.
+    @discardableResult
+    public func setExtensionValue(_ value: Data?, type: UInt8) -> Bool {
+        var updated = extensions
+        if let index = updated.firstIndex(where: { $0.type == type }) {
+            if let value = value {
+                updated[index].value = value
+            } else {
+                updated.remove(at: index)
+            }
+        } else if let value = value {
+            updated.append((type, value))
+        }
+
+        let length = updated.reduce(MBSCipherHeader.aesGCMParamsSize) { $0 + 3 + $1.value.count }
+        guard length <= Int(UInt16.max), (value?.count ?? 0) <= Int(UInt16.max) else {
+            return false
+        }
+        extensions = updated
+        return true
+    }
+
+    /// Records the compression codec and plaintext length in the COMPRESSION extension
+    public func setCompression(codec: UInt8, originalLength: UInt64) {
+        var value = Data([codec])
+        value.append(withUnsafeBytes(of: originalLength.bigEndian) { Data($0) })
+        setExtensionValue(value, type: MBSCipherHeader.extensionCompression)
+    }
+
+    /// Codec from the COMPRESSION extension; 0 (MBSCompressionCodecNone) when absent
+    public var compressionCodec: UInt8 {
+        return extensionValue(MBSCipherHeader.extensionCompression)?.first ?? 0
+    }
+
+    /// Plaintext length from the COMPRESSION extension; `unknownLength` when absent or not recorded
+    public var originalLength: UInt64 {
+        guard let value = extensionValue(MBSCipherHeader.extensionCompression),
+              value.count == MBSCipherHeader.compressionValueSize else {
+            return MBSCipherHeader.unknownLength
+        }
+        return value.dropFirst().reduce(UInt64(0)) { ($0 << 8) | UInt64($1) }
+    }
+
+    /// Stores a wrapped data key and the identifier of the key that wrapped it.
+    ///
+    /// Returns false if the identifier is empty or longer than 255 UTF-8 bytes,
+    /// or the header would grow past PARAMS_LENGTH.
+    @discardableResult
+    public func setWrappedKey(_ wrappedKey: Data, keyIdentifier: String) -> Bool {
+        let identifier = Data(keyIdentifier.utf8)
+        guard !identifier.isEmpty, identifier.count <= Int(UInt8.max), !wrappedKey.isEmpty else {
+            return false
+        }
+
+        var value = Data([UInt8(identifier.count)])
+        value.append(identifier)
+        value.append(wrappedKey)
+        return setExtensionValue(value, type: MBSCipherHeader.extensionWrappedKey)
+    }
+
+    /// Identifier of the key-encryption key from the WRAPPED_KEY slot; nil when absent
+    public var wrappedKeyIdentifier: String? {
+        guard let value = extensionValue(MBSCipherHeader.extensionWrappedKey), let length = value.first else {
+            return nil
+        }
+        return String(data: value.dropFirst().prefix(Int(length)), encoding: .utf8)
+    }
+
+    /// Wrapped data key from the WRAPPED_KEY slot; nil when absent
+    public var wrappedKey: Data? {
+        guard let value = extensionValue(MBSCipherHeader.extensionWrappedKey), let length = value.first else {
+            return nil
+        }
+        return Data(value.dropFirst(1 + Int(length)))
+    }
+
+    /// Stores one wrapped content key per recipient in the RECIPIENTS slot, or removes the slot when empty.
+    ///
+    /// Entries are sorted by identifier so a reader can binary search for its own.
+    /// Returns false if an identifier or wrapped key has the wrong size, or the
+    /// header would grow past PARAMS_LENGTH.
+    @discardableResult
+    public func setWrappedKeys(forRecipients wrappedKeys: [Data: Data]) -> Bool {
+        guard !wrappedKeys.isEmpty else {
+            return setExtensionValue(nil, type: MBSCipherHeader.extensionRecipients)
+        }
+
+        var value = Data(capacity: wrappedKeys.count * MBSCipherHeader.recipientEntrySize)
+        for identifier in wrappedKeys.keys.sorted(by: { $0.lexicographicallyPrecedes($1) }) {
+            let wrappedKey = wrappedKeys[identifier]!
+            guard identifier.count == MBSCipherHeader.recipientIdentifierSize,
+                  wrappedKey.count == MBSCipherHeader.recipientWrappedKeySize else {
+                return false
+            }
+            value.append(identifier)
+            value.append(wrappedKey)
+        }
+        return setExtensionValue(value, type: MBSCipherHeader.extensionRecipients)
+    }
+
+    /// Recipients from the RECIPIENTS slot, keyed by identifier; empty when absent
+    public var recipients: [Data: Data] {
+        guard let value = extensionValue(MBSCipherHeader.extensionRecipients) else {
+            return [:]
+        }
+
+        var recipients: [Data: Data] = [:]
+        let entries = Data(value)
+        for offset in stride(from: 0, to: entries.count, by: MBSCipherHeader.recipientEntrySize) {
+            let keyOffset = offset + MBSCipherHeader.recipientIdentifierSize
+            recipients[entries.subdata(in: offset..<keyOffset)] =
+                entries.subdata(in: keyOffset..<(offset + MBSCipherHeader.recipientEntrySize))
+        }
+        return recipients
+    }
+
+    /// Wrapped content key for one recipient, found by binary search; nil when absent
+    public func wrappedKey(forRecipient identifier: Data) -> Data? {
+        guard let value = extensionValue(MBSCipherHeader.extensionRecipients),
+              identifier.count == MBSCipherHeader.recipientIdentifierSize else {
+            return nil
+        }
+
+        let entries = Data(value)
+        let target = Data(identifier)
+        var low = 0
+        var high = entries.count / MBSCipherHeader.recipientEntrySize
+        while low < high {
+            let middle = (low + high) / 2
+            let offset = middle * MBSCipherHeader.recipientEntrySize
+            let keyOffset = offset + MBSCipherHeader.recipientIdentifierSize
+            let candidate = entries.subdata(in: offset..<keyOffset)
+            if candidate == target {
+                return entries.subdata(in: keyOffset..<(offset + MBSCipherHeader.recipientEntrySize))
+            }
+            if candidate.lexicographicallyPrecedes(target) {
+                low = middle + 1
+            } else {
+                high = middle
+            }
+        }
+        return nil
+    }
+
+    private var fixedParams: Data {
+        var params = Data()
+        params.append(nonce)
+        params.append(withUnsafeBytes(of: MBSCipherHeader.tagLengthBits.bigEndian) { Data($0) })
+        return params
+    }
+
+    private static func encodeExtension(type: UInt8, value: Data) -> Data {
+        var encoded = Data()
+        encoded.append(type)
+        encoded.append(UInt8(value.count >> 8))
+        encoded.append(UInt8(value.count & 0xFF))
+        encoded.append(value)
+        return encoded
+    }
+
+    /// [MAGIC(4)][VERSION(1)][ALG(1)][PARAMS_LEN(2)][PARAMS]
+    public func encoded() -> Data {
+        let length = paramsLength
+        var header = Data()
+        header.append(MBSCipherHeader.magicBytes)
+        header.append(MBSCipherHeader.version)
+        header.append(MBSCipherHeader.algorithmAESGCM)
+        header.append(UInt8(length >> 8))
+        header.append(UInt8(length & 0xFF))
+        header.append(fixedParams)
+        for ext in extensions {
+            header.append(MBSCipherHeader.encodeExtension(type: ext.type, value: ext.value))
+        }
+        return header
+    }
+
+    /// Associated data bound to the payload.
+    ///
+    /// Empty for a header without extensions so the classic V1 layout stays
+    /// byte-compatible with 0.5.x readers.
+    public func authenticatedData() -> Data {
+        guard hasExtensions else {
+            return Data()
+        }
+
+        var aad = Data()
+        aad.append(MBSCipherHeader.magicBytes)
+        aad.append(MBSCipherHeader.version)
+        aad.append(MBSCipherHeader.algorithmAESGCM)
+        aad.append(fixedParams)
+        for ext in extensions where ext.type < 0x80 {
+            aad.append(MBSCipherHeader.encodeExtension(type: ext.type, value: ext.value))
+        }
+        return aad
+    }
+
+    /// Per-chunk nonce: the header nonce with the chunk index XORed into its last 8 bytes
+    public func nonce(forChunk index: UInt64) -> Data {
+        var chunkNonce = nonce
+        let counter = withUnsafeBytes(of: index.bigEndian) { Data($0) }
+        let offset = chunkNonce.startIndex + MBSCipherHeader.nonceSize - 8
+        for i in 0..<8 {
+            chunkNonce[offset + i] ^= counter[counter.startIndex + i]
+        }
+        return chunkNonce
+    }
+
+    /// Parses a complete header (fixed fields and parameter block) from the start of `data`.
+    ///
+    /// Trailing payload bytes after the header are ignored.
+    public static func parseHeader(_ data: Data,
+                                   error: UnsafeMutablePointer<NSError?>?) -> MBSCipherHeader? {
+        let bytes = Data(data) // rebase indices to 0
+
+        guard bytes.count >= fixedSize else {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 202, // MBSCipherErrorInvalidInput
+                                     userInfo: [NSLocalizedDescriptionKey: "Header data too short"])
+            return nil
+        }
+
+        guard bytes.prefix(4) == magicBytes else {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 205, // MBSCipherErrorFormatDetectionFailed
+                                     userInfo: [NSLocalizedDescriptionKey: "Invalid magic bytes"])
+            return nil
+        }
+
+        guard bytes[4] == version else {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 204, // MBSCipherErrorUnsupportedFormat
+                                     userInfo: [NSLocalizedDescriptionKey: "Unsupported format version"])
+            return nil
+        }
+
+        guard bytes[5] == algorithmAESGCM else {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 203, // MBSCipherErrorUnsupportedAlgorithm
+                                     userInfo: [NSLocalizedDescriptionKey: "Unsupported algorithm in V1 format"])
+            return nil
+        }
+
+        let paramsLength = (Int(bytes[6]) << 8) | Int(bytes[7])
+        guard paramsLength >= aesGCMParamsSize, bytes.count >= fixedSize + paramsLength else {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 202, // MBSCipherErrorInvalidInput
+                                     userInfo: [NSLocalizedDescriptionKey: "Invalid parameter length in V1 format"])
+            return nil
+        }
+
+        let nonce = bytes.subdata(in: fixedSize..<(fixedSize + nonceSize))
+        let tagLength = (UInt32(bytes[fixedSize + 12]) << 24) | (UInt32(bytes[fixedSize + 13]) << 16) |
+                        (UInt32(bytes[fixedSize + 14]) << 8) | UInt32(bytes[fixedSize + 15])
+        guard tagLength == tagLengthBits else {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 202, // MBSCipherErrorInvalidInput
+                                     userInfo: [NSLocalizedDescriptionKey: "Invalid tag length in V1 format"])
+            return nil
+        }
+
+        let header = MBSCipherHeader(nonce: nonce)
+
+        var offset = fixedSize + aesGCMParamsSize
+        let end = fixedSize + paramsLength
+        while offset < end {
+            guard end - offset >= 3 else {
+                error?.pointee = NSError(domain: MBSErrorDomain,
+                                         code: 202, // MBSCipherErrorInvalidInput
+                                         userInfo: [NSLocalizedDescriptionKey: "Truncated extension in V1 header"])
+                return nil
+            }
+
+            let type = bytes[offset]
+            let length = (Int(bytes[offset + 1]) << 8) | Int(bytes[offset + 2])
+            offset += 3
+
+            guard end - offset >= length else {
+                error?.pointee = NSError(domain: MBSErrorDomain,
+                                         code: 202, // MBSCipherErrorInvalidInput
+                                         userInfo: [NSLocalizedDescriptionKey: "Truncated extension in V1 header"])
+                return nil
+            }
+
+            guard knownExtensions.contains(type), header.extensionValue(type) == nil else {
+                error?.pointee = NSError(domain: MBSErrorDomain,
+                                         code: 204, // MBSCipherErrorUnsupportedFormat
+                                         userInfo: [NSLocalizedDescriptionKey: "Unsupported or duplicate extension in V1 header"])
+                return nil
+            }
+
+            header.extensions.append((type, bytes.subdata(in: offset..<(offset + length))))
+            offset += length
+        }
+
+        if let compression = header.extensionValue(extensionCompression) {
+            guard compression.count == compressionValueSize,
+                  MBSCompression.isSupportedCodec(compression[compression.startIndex]) else {
+                error?.pointee = NSError(domain: MBSErrorDomain,
+                                         code: 204, // MBSCipherErrorUnsupportedFormat
+                                         userInfo: [NSLocalizedDescriptionKey: "Unsupported compression in V1 header"])
+                return nil
+            }
+        }
+
+        if let wrapped = header.extensionValue(extensionWrappedKey) {
+            let identifierLength = Int(wrapped.first ?? 0)
+            guard identifierLength > 0, wrapped.count > 1 + identifierLength,
+                  header.wrappedKeyIdentifier != nil else {
+                error?.pointee = NSError(domain: MBSErrorDomain,
+                                         code: 202, // MBSCipherErrorInvalidInput
+                                         userInfo: [NSLocalizedDescriptionKey: "Invalid wrapped key in V1 header"])
+                return nil
+            }
+        }
+
+        if let value = header.extensionValue(extensionRecipients) {
+            // Non-empty, whole entries, identifiers strictly ascending
+            let entries = Data(value)
+            var valid = !entries.isEmpty && entries.count % recipientEntrySize == 0
+            var previous: Data?
+            for offset in stride(from: 0, to: valid ? entries.count : 0, by: recipientEntrySize) {
+                let identifier = entries.subdata(in: offset..<(offset + recipientIdentifierSize))
+                if let previous = previous, !previous.lexicographicallyPrecedes(identifier) {
+                    valid = false
+                    break
+                }
+                previous = identifier
+            }
+            guard valid else {
+                error?.pointee = NSError(domain: MBSErrorDomain,
+                                         code: 202, // MBSCipherErrorInvalidInput
+                                         userInfo: [NSLocalizedDescriptionKey: "Invalid recipients in V1 header"])
+                return nil
+            }
+        }
+
+        return header
+    }
+}
@@ -0,0 +1,124 @@
+//
+//  MBSCompression.swift
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+import Foundation
+import Compression
+
+/// Internal use only
+///
+/// Buffer-to-buffer compression for the COMPRESSION header extension, backed
+/// by the Compression framework. Codec identifiers are the raw values of
+/// `MBSCompressionCodec` and are stored on disk, so they must never change.
+@objcMembers
+public class MBSCompression: NSObject {
+
+    private static func algorithm(forCodec codec: UInt8) -> compression_algorithm? {
+        switch codec {
+        case 1:  // MBSCompressionCodecLZ4
+            return COMPRESSION_LZ4_RAW
+        case 2:  // MBSCompressionCodecZlib
+            return COMPRESSION_ZLIB
+        case 3:  // MBSCompressionCodecLZFSE
+            return COMPRESSION_LZFSE
+        default:
+            return nil
+        }
+    }
+
+    /// Largest original length a header may declare for `compressedLength`
+    /// bytes of compressed data: kMBSCipherMaxFileSize, or 1024 times the
+    /// compressed length when that is greater. The length comes from the
+    /// header, so this caps what decompression allocates.
+    public static func maximumOriginalLength(forCompressedLength compressedLength: Int) -> Int {
+        let (scaled, overflow) = compressedLength.multipliedReportingOverflow(by: 1024)
+        return max(Int(kMBSCipherMaxFileSize), overflow ? Int.max - 1 : scaled)
+    }
+
+    /// Whether `codec` names a compression codec this build can decode
+    public static func isSupportedCodec(_ codec: UInt8) -> Bool {
+        return algorithm(forCodec: codec) != nil
+    }
+
+    /// Compresses `data`, or returns nil when the codec is unknown, the
+    /// result would not be smaller than the input, or it shrinks past what
+    /// ``maximumOriginalLength(forCompressedLength:)`` lets a reader accept.
+    public static func compress(_ data: Data, codec: UInt8) -> Data? {
+        guard let algorithm = algorithm(forCodec: codec), !data.isEmpty else {
+            return nil
+        }
+
+        // A destination no larger than the input makes the framework give up on incompressible data
+        var output = Data(count: data.count)
+        let written = output.withUnsafeMutableBytes { (dst: UnsafeMutableRawBufferPointer) -> Int in
+            data.withUnsafeBytes { (src: UnsafeRawBufferPointer) -> Int in
+                compression_encode_buffer(dst.bindMemory(to: UInt8.self).baseAddress!, dst.count,
+                                          src.bindMemory(to: UInt8.self).baseAddress!, src.count,
+                                          nil, algorithm)
+            }
+        }
+
+        guard written > 0, written < data.count,
+              data.count <= maximumOriginalLength(forCompressedLength: written) else {
+            return nil
+        }
+        output.count = written
+        return output
+    }
+
+    /// Decompresses into a buffer of exactly `originalLength` bytes.
+    ///
+    /// Fails unless the compressed data expands to exactly that length, and
+    /// rejects a length over ``maximumOriginalLength(forCompressedLength:)``
+    /// before allocating anything.
+    public static func decompress(_ data: Data,
+                                  codec: UInt8,
+                                  originalLength: Int,
+                                  error: UnsafeMutablePointer<NSError?>?) -> Data? {
+        guard let algorithm = algorithm(forCodec: codec) else {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 204, // MBSCipherErrorUnsupportedFormat
+                                     userInfo: [NSLocalizedDescriptionKey: "Unsupported compression codec"])
+            return nil
+        }
+
+        if originalLength == 0 && data.isEmpty {
+            return Data()
+        }
+
+        guard originalLength > 0, !data.isEmpty else {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 211, // MBSCipherErrorDecryptionFailed
+                                     userInfo: [NSLocalizedDescriptionKey: "Decompressed length does not match header"])
+            return nil
+        }
+
+        guard originalLength <= maximumOriginalLength(forCompressedLength: data.count) else {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 202, // MBSCipherErrorInvalidInput
+                                     userInfo: [NSLocalizedDescriptionKey: "Declared original length exceeds the decompression limit"])
+            return nil
+        }
+
+        // One spare byte tells an exact fit apart from output that was cut short
+        var output = Data(count: originalLength + 1)
+        let written = output.withUnsafeMutableBytes { (dst: UnsafeMutableRawBufferPointer) -> Int in
+            data.withUnsafeBytes { (src: UnsafeRawBufferPointer) -> Int in
+                compression_decode_buffer(dst.bindMemory(to: UInt8.self).baseAddress!, dst.count,
+                                          src.bindMemory(to: UInt8.self).baseAddress!, src.count,
+                                          nil, algorithm)
+            }
+        }
+
+        guard written == originalLength else {
+            error?.pointee = NSError(domain: MBSErrorDomain,
+                                     code: 211, // MBSCipherErrorDecryptionFailed
+                                     userInfo: [NSLocalizedDescriptionKey: "Decompressed length does not match header"])
+            return nil
+        }
+        output.count = originalLength
+        return output
+    }
+}
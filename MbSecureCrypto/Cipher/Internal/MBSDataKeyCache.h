@@ -0,0 +1,53 @@
+//
+//  MBSDataKeyCache.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Internal use only
+///
+/// Immutable key bytes that are wiped when the object is deallocated
+@interface MBSZeroizingData : NSData
+- (nullable instancetype)initWithKeyBytes:(NSData *)data;
+@end
+
+/// Internal use only
+///
+/// Bounded least-recently-used map from a wrapped data key to its unwrapped
+/// bytes, so repeated reads of the same object skip the key provider.
+///
+/// Cached keys are held in buffers that are zeroed when the last reference
+/// goes away: an evicted key stays valid for operations already using it and
+/// is wiped when they finish. Safe to use from multiple threads.
+@interface MBSDataKeyCache : NSObject
+
+@property (nonatomic, readonly) NSUInteger capacity;
+@property (nonatomic, readonly) NSUInteger count;
+
+/// A capacity of 0 disables caching
+- (instancetype)initWithCapacity:(NSUInteger)capacity NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Returns the cached data key and marks it most recently used, or nil on a miss
+- (nullable NSData *)dataKeyForWrappedKey:(NSData *)wrappedKey keyIdentifier:(NSString *)keyIdentifier;
+
+/// Caches a copy of `dataKey`, evicting the least recently used entry when full.
+///
+/// @return The zeroizing copy, which callers should use in place of `dataKey`
+- (NSData *)cacheDataKey:(NSData *)dataKey forWrappedKey:(NSData *)wrappedKey keyIdentifier:(NSString *)keyIdentifier;
+
+/// Drops every entry cached under `keyIdentifier`
+- (void)removeDataKeysForKeyIdentifier:(NSString *)keyIdentifier;
+
+/// Drops every entry
+- (void)removeAllDataKeys;
+
+@end
+
+NS_ASSUME_NONNULL_END
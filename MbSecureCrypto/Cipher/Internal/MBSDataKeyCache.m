@@ -0,0 +1,199 @@
+//
+//  MBSDataKeyCache.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import "MBSDataKeyCache.h"
+#import <string.h>
+
+@implementation MBSZeroizingData {
+    uint8_t *_bytes;
+    NSUInteger _length;
+}
+
+- (nullable instancetype)initWithKeyBytes:(NSData *)data {
+    self = [super init];
+    if (self) {
+        _length = data.length;
+        _bytes = malloc(MAX(_length, (NSUInteger)1));
+        if (!_bytes) {
+            return nil;
+        }
+        memcpy(_bytes, data.bytes, _length);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    memset_s(_bytes, _length, 0, _length);
+    free(_bytes);
+}
+
+- (NSUInteger)length {
+    return _length;
+}
+
+- (const void *)bytes {
+    return _bytes;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+@end
+
+/// Node of the recency list; `previous` is unretained because the dictionary owns every node
+@interface MBSDataKeyCacheEntry : NSObject
+@property (nonatomic, copy) NSData *cacheKey;
+@property (nonatomic, strong) NSData *dataKey;
+@property (nonatomic, unsafe_unretained) MBSDataKeyCacheEntry *previous;
+@property (nonatomic, strong) MBSDataKeyCacheEntry *next;
+@end
+
+@implementation MBSDataKeyCacheEntry
+@end
+
+@interface MBSDataKeyCache ()
+@property (nonatomic, strong) NSMutableDictionary<NSData *, MBSDataKeyCacheEntry *> *entries;
+@property (nonatomic, strong) MBSDataKeyCacheEntry *mostRecent;
+@property (nonatomic, unsafe_unretained) MBSDataKeyCacheEntry *leastRecent;
+@end
+
+@implementation MBSDataKeyCache
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    self = [super init];
+    if (self) {
+        _capacity = capacity;
+        _entries = [NSMutableDictionary dictionaryWithCapacity:MIN(capacity, (NSUInteger)4096)];
+    }
+    return self;
+}
+
+- (NSUInteger)count {
+    @synchronized (self) {
+        return self.entries.count;
+    }
+}
+
+/// [KEY_ID_LEN(2)][KEY_ID][WRAPPED_KEY]; wrapped keys are unique per object, the identifier scopes them per KEK
++ (NSData *)cacheKeyForWrappedKey:(NSData *)wrappedKey keyIdentifier:(NSString *)keyIdentifier {
+    NSData *identifier = [keyIdentifier dataUsingEncoding:NSUTF8StringEncoding];
+    uint16_t lengthBE = CFSwapInt16HostToBig((uint16_t)MIN(identifier.length, (NSUInteger)UINT16_MAX));
+    NSMutableData *cacheKey = [NSMutableData dataWithCapacity:sizeof(lengthBE) + identifier.length + wrappedKey.length];
+    [cacheKey appendBytes:&lengthBE length:sizeof(lengthBE)];
+    [cacheKey appendData:identifier];
+    [cacheKey appendData:wrappedKey];
+    return cacheKey;
+}
+
+- (nullable NSData *)dataKeyForWrappedKey:(NSData *)wrappedKey keyIdentifier:(NSString *)keyIdentifier {
+    NSData *cacheKey = [MBSDataKeyCache cacheKeyForWrappedKey:wrappedKey keyIdentifier:keyIdentifier];
+    @synchronized (self) {
+        MBSDataKeyCacheEntry *entry = self.entries[cacheKey];
+        if (!entry) {
+            return nil;
+        }
+        [self unlinkEntry:entry];
+        [self linkEntryAsMostRecent:entry];
+        return entry.dataKey;
+    }
+}
+
+- (NSData *)cacheDataKey:(NSData *)dataKey forWrappedKey:(NSData *)wrappedKey keyIdentifier:(NSString *)keyIdentifier {
+    NSData *secret = [[MBSZeroizingData alloc] initWithKeyBytes:dataKey] ?: dataKey;
+    if (self.capacity == 0) {
+        return secret;
+    }
+
+    NSData *cacheKey = [MBSDataKeyCache cacheKeyForWrappedKey:wrappedKey keyIdentifier:keyIdentifier];
+    @synchronized (self) {
+        MBSDataKeyCacheEntry *entry = self.entries[cacheKey];
+        if (entry) {
+            [self unlinkEntry:entry];
+        } else {
+            if (self.entries.count >= self.capacity) {
+                MBSDataKeyCacheEntry *evicted = self.leastRecent;
+                [self unlinkEntry:evicted];
+                [self.entries removeObjectForKey:evicted.cacheKey];
+            }
+            entry = [[MBSDataKeyCacheEntry alloc] init];
+            entry.cacheKey = cacheKey;
+            self.entries[cacheKey] = entry;
+        }
+        entry.dataKey = secret;
+        [self linkEntryAsMostRecent:entry];
+    }
+    return secret;
+}
+
+- (void)removeDataKeysForKeyIdentifier:(NSString *)keyIdentifier {
+    NSData *prefix = [MBSDataKeyCache cacheKeyForWrappedKey:[NSData data] keyIdentifier:keyIdentifier];
+    @synchronized (self) {
+        for (NSData *cacheKey in self.entries.allKeys) {
+            if (cacheKey.length >= prefix.length && memcmp(cacheKey.bytes, prefix.bytes, prefix.length) == 0) {
+                [self unlinkEntry:self.entries[cacheKey]];
+                [self.entries removeObjectForKey:cacheKey];
+            }
+        }
+    }
+}
+
+- (void)removeAllDataKeys {
+    @synchronized (self) {
+        // Break the chain iteratively so a long list is not released recursively
+        MBSDataKeyCacheEntry *entry = self.mostRecent;
+        while (entry) {
+            MBSDataKeyCacheEntry *next = entry.next;
+            entry.next = nil;
+            entry = next;
+        }
+        self.mostRecent = nil;
+        self.leastRecent = nil;
+        [self.entries removeAllObjects];
+    }
+}
+
+- (void)dealloc {
+    MBSDataKeyCacheEntry *entry = _mostRecent;
+    while (entry) {
+        MBSDataKeyCacheEntry *next = entry.next;
+        entry.next = nil;
+        entry = next;
+    }
+}
+
+#pragma mark - Recency List
+
+// Callers hold @synchronized (self)
+
+- (void)unlinkEntry:(MBSDataKeyCacheEntry *)entry {
+    MBSDataKeyCacheEntry *next = entry.next;
+    if (entry.previous) {
+        entry.previous.next = next;
+    } else {
+        self.mostRecent = next;
+    }
+    if (next) {
+        next.previous = entry.previous;
+    } else {
+        self.leastRecent = entry.previous;
+    }
+    entry.previous = nil;
+    entry.next = nil;
+}
+
+- (void)linkEntryAsMostRecent:(MBSDataKeyCacheEntry *)entry {
+    entry.next = self.mostRecent;
+    self.mostRecent.previous = entry;
+    self.mostRecent = entry;
+    if (!self.leastRecent) {
+        self.leastRecent = entry;
+    }
+}
+
+@end
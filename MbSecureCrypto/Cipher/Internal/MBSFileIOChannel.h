@@ -0,0 +1,59 @@
+//
+//  MBSFileIOChannel.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Completion for a positional read; `errorCode` is an errno value or 0
+typedef void (^MBSFileIOReadHandler)(size_t bytesRead, int errorCode);
+
+/// Completion for a positional write; `errorCode` is an errno value or 0
+typedef void (^MBSFileIOWriteHandler)(int errorCode);
+
+/// Internal use only
+///
+/// Asynchronous positional I/O on an open file descriptor. Requests are issued
+/// through a random-access dispatch I/O channel so many reads and writes can be
+/// outstanding at once. When no channel can be created, or when asked to, the
+/// requests fall back to pread/pwrite submitted to the concurrent `queue`.
+///
+/// The channel takes ownership of the descriptor and closes it in `close`.
+/// Completion handlers should hand work off rather than block.
+@interface MBSFileIOChannel : NSObject
+
+@property (nonatomic, readonly) int fileDescriptor;
+
+/// YES when requests are served by pread/pwrite rather than dispatch I/O
+@property (nonatomic, readonly, getter=isBlocking) BOOL blocking;
+
+- (instancetype)initWithFileDescriptor:(int)fileDescriptor
+                              blocking:(BOOL)blocking
+                                 queue:(dispatch_queue_t)queue;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Reads up to `length` bytes at `offset` into `buffer`. Fewer bytes are reported at end of file.
+- (void)readLength:(size_t)length
+          atOffset:(off_t)offset
+              into:(void *)buffer
+        completion:(MBSFileIOReadHandler)completion;
+
+/// Writes all of `data` at `offset`. `data` is retained until the write completes.
+- (void)writeData:(NSData *)data
+         atOffset:(off_t)offset
+       completion:(MBSFileIOWriteHandler)completion;
+
+/// Flushes written data to stable storage, using F_FULLFSYNC where supported
+- (BOOL)synchronize;
+
+/// Closes the channel and its descriptor once outstanding requests finish
+- (void)close;
+
+@end
+
+NS_ASSUME_NONNULL_END
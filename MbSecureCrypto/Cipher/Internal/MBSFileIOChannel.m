@@ -0,0 +1,145 @@
+//
+//  MBSFileIOChannel.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import "MBSFileIOChannel.h"
+#import "MBSFileUtilities.h"
+#import <errno.h>
+#import <unistd.h>
+
+@interface MBSFileIOChannel ()
+@property (nonatomic, strong, nullable) dispatch_io_t channel;
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, strong, nullable) dispatch_queue_t handlerQueue;
+@property (nonatomic, assign) BOOL closed;
+@end
+
+@implementation MBSFileIOChannel
+
+- (instancetype)initWithFileDescriptor:(int)fileDescriptor
+                              blocking:(BOOL)blocking
+                                 queue:(dispatch_queue_t)queue {
+    self = [super init];
+    if (self) {
+        _fileDescriptor = fileDescriptor;
+        _queue = queue;
+
+        if (!blocking) {
+            // Partial results of one request must be delivered in order, so handlers run serially
+            _handlerQueue = dispatch_queue_create("com.mbsecurecrypto.fileio", DISPATCH_QUEUE_SERIAL);
+            // The cleanup handler runs once every request has drained, so it owns the close
+            _channel = dispatch_io_create(DISPATCH_IO_RANDOM, fileDescriptor, _handlerQueue, ^(int error) {
+                close(fileDescriptor);
+            });
+        }
+        _blocking = (_channel == nil);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [self close];
+}
+
+- (void)readLength:(size_t)length
+          atOffset:(off_t)offset
+              into:(void *)buffer
+        completion:(MBSFileIOReadHandler)completion {
+    if (self.blocking) {
+        int fd = self.fileDescriptor;
+        dispatch_async(self.queue, ^{
+            size_t total = 0;
+            while (total < length) {
+                ssize_t count = pread(fd, (uint8_t *)buffer + total, length - total, offset + (off_t)total);
+                if (count < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    completion(total, errno);
+                    return;
+                }
+                if (count == 0) {
+                    break;
+                }
+                total += (size_t)count;
+            }
+            completion(total, 0);
+        });
+        return;
+    }
+
+    // Partial results may arrive in several pieces before `done`
+    __block size_t total = 0;
+    dispatch_io_read(self.channel, offset, length, self.handlerQueue, ^(bool done, dispatch_data_t data, int error) {
+        if (data) {
+            dispatch_data_apply(data, ^bool(dispatch_data_t region, size_t regionOffset, const void *bytes, size_t size) {
+                memcpy((uint8_t *)buffer + total, bytes, size);
+                total += size;
+                return true;
+            });
+        }
+        if (done) {
+            completion(total, error);
+        }
+    });
+}
+
+- (void)writeData:(NSData *)data
+         atOffset:(off_t)offset
+       completion:(MBSFileIOWriteHandler)completion {
+    if (self.blocking) {
+        int fd = self.fileDescriptor;
+        dispatch_async(self.queue, ^{
+            const uint8_t *bytes = data.bytes;
+            size_t total = 0;
+            while (total < data.length) {
+                ssize_t count = pwrite(fd, bytes + total, data.length - total, offset + (off_t)total);
+                if (count < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    completion(errno);
+                    return;
+                }
+                total += (size_t)count;
+            }
+            completion(0);
+        });
+        return;
+    }
+
+    // Wrap the bytes without copying; the destructor keeps `data` alive until the write is done
+    dispatch_data_t payload = dispatch_data_create(data.bytes, data.length, self.handlerQueue, ^{
+        (void)data;
+    });
+    dispatch_io_write(self.channel, offset, payload, self.handlerQueue, ^(bool done, dispatch_data_t remaining, int error) {
+        if (done) {
+            completion(error);
+        }
+    });
+}
+
+- (BOOL)synchronize {
+    return MBSFileSynchronize(self.fileDescriptor);
+}
+
+- (void)close {
+    @synchronized (self) {
+        if (self.closed) {
+            return;
+        }
+        self.closed = YES;
+    }
+
+    if (self.channel) {
+        dispatch_io_close(self.channel, 0);
+    } else {
+        close(self.fileDescriptor);
+    }
+}
+
+@end
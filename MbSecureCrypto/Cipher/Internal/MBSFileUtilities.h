@@ -0,0 +1,51 @@
+//
+//  MBSFileUtilities.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Internal use only
+///
+/// Error for a failed system call: MBSCipherErrorFilePermission for EACCES and
+/// EPERM, MBSCipherErrorIOFailure otherwise, with `errorCode` attached as an
+/// NSPOSIXErrorDomain underlying error.
+FOUNDATION_EXPORT NSError *MBSPOSIXError(NSString *description, int errorCode);
+
+/// Reads exactly `length` bytes at `offset`, retrying on EINTR.
+///
+/// Returns NO with errno set on failure; end of file is reported as EIO.
+FOUNDATION_EXPORT BOOL MBSFileReadFully(int fd, void *buffer, size_t length, off_t offset);
+
+/// Writes exactly `length` bytes at `offset`, retrying on EINTR.
+///
+/// Returns NO with errno set on failure.
+FOUNDATION_EXPORT BOOL MBSFileWriteFully(int fd, const void *buffer, size_t length, off_t offset);
+
+/// Flushes `fd` to stable storage with F_FULLFSYNC, falling back to fsync
+/// on file systems that do not support it
+FOUNDATION_EXPORT BOOL MBSFileSynchronize(int fd);
+
+/// Creates `.<name>.<UUID>.tmp` next to `path` for a file that will be renamed
+/// over it, opened write-only, exclusively, close-on-exec and with mode 0600.
+///
+/// Returns the descriptor and stores the path in `temporaryPath`, or returns
+/// -1 with errno set.
+FOUNDATION_EXPORT int MBSFileCreateTemporary(NSString *path, NSString *_Nullable *_Nonnull temporaryPath);
+
+/// Flushes `fd` when `synchronize` is YES, closes it and renames
+/// `temporaryPath` over `path`, so `path` is either the old file or the
+/// complete new one. Pass -1 when the descriptor is already closed.
+///
+/// On failure the temporary file is removed and NO is returned with errno set.
+FOUNDATION_EXPORT BOOL MBSFileCommitTemporary(int fd, NSString *temporaryPath, NSString *path, BOOL synchronize);
+
+/// Closes `fd` (unless it is -1) and removes `temporaryPath`, leaving errno unchanged
+FOUNDATION_EXPORT void MBSFileDiscardTemporary(int fd, NSString *temporaryPath);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,105 @@
+//
+//  MBSFileUtilities.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import "MBSFileUtilities.h"
+#import "MBSError.h"
+#import <errno.h>
+#import <fcntl.h>
+#import <sys/stat.h>
+#import <unistd.h>
+
+NSError *MBSPOSIXError(NSString *description, int errorCode) {
+    NSInteger code = (errorCode == EACCES || errorCode == EPERM) ? MBSCipherErrorFilePermission : MBSCipherErrorIOFailure;
+    NSError *underlying = [NSError errorWithDomain:NSPOSIXErrorDomain code:errorCode userInfo:nil];
+    return [NSError errorWithDomain:MBSErrorDomain
+                               code:code
+                           userInfo:@{NSLocalizedDescriptionKey: description,
+                                      NSUnderlyingErrorKey: underlying}];
+}
+
+BOOL MBSFileReadFully(int fd, void *buffer, size_t length, off_t offset) {
+    size_t total = 0;
+    while (total < length) {
+        ssize_t count = pread(fd, (uint8_t *)buffer + total, length - total, offset + (off_t)total);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            if (count == 0) {
+                errno = EIO;
+            }
+            return NO;
+        }
+        total += (size_t)count;
+    }
+    return YES;
+}
+
+BOOL MBSFileWriteFully(int fd, const void *buffer, size_t length, off_t offset) {
+    size_t total = 0;
+    while (total < length) {
+        ssize_t count = pwrite(fd, (const uint8_t *)buffer + total, length - total, offset + (off_t)total);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            if (count == 0) {
+                errno = EIO;
+            }
+            return NO;
+        }
+        total += (size_t)count;
+    }
+    return YES;
+}
+
+BOOL MBSFileSynchronize(int fd) {
+    if (fcntl(fd, F_FULLFSYNC) == 0) {
+        return YES;
+    }
+    // Not every file system supports F_FULLFSYNC
+    return fsync(fd) == 0;
+}
+
+int MBSFileCreateTemporary(NSString *path, NSString **temporaryPath) {
+    NSString *name = [NSString stringWithFormat:@".%@.%@.tmp", path.lastPathComponent, NSUUID.UUID.UUIDString];
+    NSString *candidate = [path.stringByDeletingLastPathComponent stringByAppendingPathComponent:name];
+    int fd = open(candidate.fileSystemRepresentation, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    *temporaryPath = fd >= 0 ? candidate : nil;
+    return fd;
+}
+
+BOOL MBSFileCommitTemporary(int fd, NSString *temporaryPath, NSString *path, BOOL synchronize) {
+    if (fd >= 0) {
+        BOOL flushed = !synchronize || MBSFileSynchronize(fd);
+        int savedErrno = errno;
+        BOOL closed = close(fd) == 0;
+        if (!flushed) {
+            errno = savedErrno;
+        }
+        if (!flushed || !closed) {
+            MBSFileDiscardTemporary(-1, temporaryPath);
+            return NO;
+        }
+    }
+
+    if (rename(temporaryPath.fileSystemRepresentation, path.fileSystemRepresentation) != 0) {
+        MBSFileDiscardTemporary(-1, temporaryPath);
+        return NO;
+    }
+    return YES;
+}
+
+void MBSFileDiscardTemporary(int fd, NSString *temporaryPath) {
+    int savedErrno = errno;
+    if (fd >= 0) {
+        close(fd);
+    }
+    unlink(temporaryPath.fileSystemRepresentation);
+    errno = savedErrno;
+}
@@ -0,0 +1,241 @@
+//
+//  MBSGCMDecryptor.c
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#define __STDC_WANT_LIB_EXT1__ 1
+
+#include "MBSGCMDecryptor.h"
+#include <string.h>
+
+#pragma mark - GHASH
+
+static inline uint64_t MBSLoad64BE(const uint8_t *bytes) {
+    return ((uint64_t)bytes[0] << 56) | ((uint64_t)bytes[1] << 48) | ((uint64_t)bytes[2] << 40) |
+           ((uint64_t)bytes[3] << 32) | ((uint64_t)bytes[4] << 24) | ((uint64_t)bytes[5] << 16) |
+           ((uint64_t)bytes[6] << 8) | (uint64_t)bytes[7];
+}
+
+static inline void MBSStore64BE(uint8_t *bytes, uint64_t value) {
+    for (int i = 7; i >= 0; i--) {
+        bytes[i] = (uint8_t)value;
+        value >>= 8;
+    }
+}
+
+/// Carry-less 64×64 multiplication, low half only. Integer multiplies on
+/// bit-sliced operands with 3-bit holes keep the carries out of the way, so
+/// timing does not depend on the operands.
+static inline uint64_t MBSCarrylessMultiply(uint64_t x, uint64_t y) {
+    uint64_t x0 = x & 0x1111111111111111ULL;
+    uint64_t x1 = x & 0x2222222222222222ULL;
+    uint64_t x2 = x & 0x4444444444444444ULL;
+    uint64_t x3 = x & 0x8888888888888888ULL;
+    uint64_t y0 = y & 0x1111111111111111ULL;
+    uint64_t y1 = y & 0x2222222222222222ULL;
+    uint64_t y2 = y & 0x4444444444444444ULL;
+    uint64_t y3 = y & 0x8888888888888888ULL;
+
+    uint64_t z0 = (x0 * y0) ^ (x1 * y3) ^ (x2 * y2) ^ (x3 * y1);
+    uint64_t z1 = (x0 * y1) ^ (x1 * y0) ^ (x2 * y3) ^ (x3 * y2);
+    uint64_t z2 = (x0 * y2) ^ (x1 * y1) ^ (x2 * y0) ^ (x3 * y3);
+    uint64_t z3 = (x0 * y3) ^ (x1 * y2) ^ (x2 * y1) ^ (x3 * y0);
+
+    return (z0 & 0x1111111111111111ULL) | (z1 & 0x2222222222222222ULL) |
+           (z2 & 0x4444444444444444ULL) | (z3 & 0x8888888888888888ULL);
+}
+
+static inline uint64_t MBSReverseBits64(uint64_t x) {
+    x = ((x & 0x5555555555555555ULL) << 1) | ((x >> 1) & 0x5555555555555555ULL);
+    x = ((x & 0x3333333333333333ULL) << 2) | ((x >> 2) & 0x3333333333333333ULL);
+    x = ((x & 0x0F0F0F0F0F0F0F0FULL) << 4) | ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL);
+    x = ((x & 0x00FF00FF00FF00FFULL) << 8) | ((x >> 8) & 0x00FF00FF00FF00FFULL);
+    x = ((x & 0x0000FFFF0000FFFFULL) << 16) | ((x >> 16) & 0x0000FFFF0000FFFFULL);
+    return (x << 32) | (x >> 32);
+}
+
+/// Y = (Y xor block) · H in GF(2^128), for whole 16-byte blocks
+static void MBSGHashBlocks(MBSGCMDecryptor *decryptor, const uint8_t *blocks, size_t count) {
+    uint64_t h1 = decryptor->h[0], h0 = decryptor->h[1];
+    uint64_t h1r = decryptor->hReversed[0], h0r = decryptor->hReversed[1];
+    uint64_t h2 = h0 ^ h1, h2r = h0r ^ h1r;
+    uint64_t y1 = decryptor->y[0], y0 = decryptor->y[1];
+
+    for (size_t i = 0; i < count; i++, blocks += 16) {
+        y1 ^= MBSLoad64BE(blocks);
+        y0 ^= MBSLoad64BE(blocks + 8);
+
+        // Karatsuba on the operands and on their bit reversals, which yields the high halves
+        uint64_t y1r = MBSReverseBits64(y1), y0r = MBSReverseBits64(y0);
+        uint64_t y2 = y0 ^ y1, y2r = y0r ^ y1r;
+
+        uint64_t z0 = MBSCarrylessMultiply(y0, h0);
+        uint64_t z1 = MBSCarrylessMultiply(y1, h1);
+        uint64_t z2 = MBSCarrylessMultiply(y2, h2);
+        uint64_t z0h = MBSCarrylessMultiply(y0r, h0r);
+        uint64_t z1h = MBSCarrylessMultiply(y1r, h1r);
+        uint64_t z2h = MBSCarrylessMultiply(y2r, h2r);
+        z2 ^= z0 ^ z1;
+        z2h ^= z0h ^ z1h;
+        z0h = MBSReverseBits64(z0h) >> 1;
+        z1h = MBSReverseBits64(z1h) >> 1;
+        z2h = MBSReverseBits64(z2h) >> 1;
+
+        uint64_t v0 = z0, v1 = z0h ^ z2, v2 = z1 ^ z2h, v3 = z1h;
+
+        // GHASH's reflected bit order leaves the 255-bit product one bit short
+        v3 = (v3 << 1) | (v2 >> 63);
+        v2 = (v2 << 1) | (v1 >> 63);
+        v1 = (v1 << 1) | (v0 >> 63);
+        v0 = (v0 << 1);
+
+        // Reduce modulo x^128 + x^7 + x^2 + x + 1
+        v2 ^= v0 ^ (v0 >> 1) ^ (v0 >> 2) ^ (v0 >> 7);
+        v1 ^= (v0 << 63) ^ (v0 << 62) ^ (v0 << 57);
+        v3 ^= v1 ^ (v1 >> 1) ^ (v1 >> 2) ^ (v1 >> 7);
+        v2 ^= (v1 << 63) ^ (v1 << 62) ^ (v1 << 57);
+
+        y0 = v2;
+        y1 = v3;
+    }
+
+    decryptor->y[0] = y1;
+    decryptor->y[1] = y0;
+}
+
+/// Hashes `length` bytes, carrying an incomplete block over to the next call
+static void MBSGHashUpdate(MBSGCMDecryptor *decryptor, const uint8_t *bytes, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    if (decryptor->partialLength > 0) {
+        size_t take = 16 - decryptor->partialLength;
+        take = take < length ? take : length;
+        memcpy(decryptor->partial + decryptor->partialLength, bytes, take);
+        decryptor->partialLength += take;
+        bytes += take;
+        length -= take;
+        if (decryptor->partialLength < 16) {
+            return;
+        }
+        MBSGHashBlocks(decryptor, decryptor->partial, 1);
+        decryptor->partialLength = 0;
+    }
+
+    MBSGHashBlocks(decryptor, bytes, length / 16);
+    bytes += length / 16 * 16;
+    length %= 16;
+
+    if (length > 0) {
+        memcpy(decryptor->partial, bytes, length);
+        decryptor->partialLength = length;
+    }
+}
+
+/// Zero-pads the pending incomplete block, ending the associated data or ciphertext
+static void MBSGHashPad(MBSGCMDecryptor *decryptor) {
+    if (decryptor->partialLength > 0) {
+        memset(decryptor->partial + decryptor->partialLength, 0, 16 - decryptor->partialLength);
+        MBSGHashBlocks(decryptor, decryptor->partial, 1);
+        decryptor->partialLength = 0;
+    }
+}
+
+#pragma mark - Decryption
+
+static CCCryptorStatus MBSEncryptBlock(const uint8_t *key, const uint8_t *block, uint8_t *output) {
+    size_t moved = 0;
+    return CCCrypt(kCCEncrypt, kCCAlgorithmAES, kCCOptionECBMode, key, kCCKeySizeAES256, NULL,
+                   block, 16, output, 16, &moved);
+}
+
+CCCryptorStatus MBSGCMDecryptorInit(MBSGCMDecryptor *decryptor,
+                                    const uint8_t *key,
+                                    const uint8_t *nonce,
+                                    const uint8_t *associatedData,
+                                    size_t associatedDataLength) {
+    memset(decryptor, 0, sizeof(*decryptor));
+
+    // H = E(K, 0^128); the tag is masked with E(K, J0), where J0 = nonce || 1
+    uint8_t block[16] = {0};
+    uint8_t hash[16];
+    CCCryptorStatus status = MBSEncryptBlock(key, block, hash);
+    if (status != kCCSuccess) {
+        return status;
+    }
+    memcpy(block, nonce, MBS_GCM_NONCE_SIZE);
+    block[15] = 1;
+    status = MBSEncryptBlock(key, block, decryptor->tagMask);
+    if (status != kCCSuccess) {
+        MBSGCMDecryptorRelease(decryptor);
+        return status;
+    }
+
+    decryptor->h[0] = MBSLoad64BE(hash);
+    decryptor->h[1] = MBSLoad64BE(hash + 8);
+    decryptor->hReversed[0] = MBSReverseBits64(decryptor->h[0]);
+    decryptor->hReversed[1] = MBSReverseBits64(decryptor->h[1]);
+    memset_s(hash, sizeof(hash), 0, sizeof(hash));
+
+    // The payload keystream starts at J0 + 1; CommonCrypto's counter is big endian like GCM's
+    block[15] = 2;
+    status = CCCryptorCreateWithMode(kCCEncrypt, kCCModeCTR, kCCAlgorithmAES, ccNoPadding, block,
+                                     key, kCCKeySizeAES256, NULL, 0, 0, 0,
+                                     &decryptor->keystream);
+    if (status != kCCSuccess) {
+        MBSGCMDecryptorRelease(decryptor);
+        return status;
+    }
+
+    MBSGHashUpdate(decryptor, associatedData, associatedDataLength);
+    MBSGHashPad(decryptor);
+    decryptor->associatedDataLength = associatedDataLength;
+    return kCCSuccess;
+}
+
+CCCryptorStatus MBSGCMDecryptorUpdate(MBSGCMDecryptor *decryptor,
+                                      const uint8_t *ciphertext,
+                                      uint8_t *plaintext,
+                                      size_t length) {
+    if (length > MBS_GCM_MAX_CIPHERTEXT - decryptor->ciphertextLength) {
+        return kCCOverflow;
+    }
+
+    MBSGHashUpdate(decryptor, ciphertext, length);
+    decryptor->ciphertextLength += length;
+
+    size_t moved = 0;
+    return CCCryptorUpdate(decryptor->keystream, ciphertext, length, plaintext, length, &moved);
+}
+
+int MBSGCMDecryptorFinal(MBSGCMDecryptor *decryptor, const uint8_t *tag) {
+    MBSGHashPad(decryptor);
+
+    uint8_t lengths[16];
+    MBSStore64BE(lengths, decryptor->associatedDataLength * 8);
+    MBSStore64BE(lengths + 8, decryptor->ciphertextLength * 8);
+    MBSGHashBlocks(decryptor, lengths, 1);
+
+    uint8_t expected[16];
+    MBSStore64BE(expected, decryptor->y[0]);
+    MBSStore64BE(expected + 8, decryptor->y[1]);
+
+    uint8_t difference = 0;
+    for (int i = 0; i < MBS_GCM_TAG_SIZE; i++) {
+        difference |= (uint8_t)(expected[i] ^ decryptor->tagMask[i] ^ tag[i]);
+    }
+
+    memset_s(expected, sizeof(expected), 0, sizeof(expected));
+    MBSGCMDecryptorRelease(decryptor);
+    return difference == 0 ? 0 : -1;
+}
+
+void MBSGCMDecryptorRelease(MBSGCMDecryptor *decryptor) {
+    if (decryptor->keystream) {
+        CCCryptorRelease(decryptor->keystream);
+    }
+    memset_s(decryptor, sizeof(*decryptor), 0, sizeof(*decryptor));
+}
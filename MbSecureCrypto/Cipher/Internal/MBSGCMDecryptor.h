@@ -0,0 +1,66 @@
+//
+//  MBSGCMDecryptor.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#ifndef MBSGCMDecryptor_h
+#define MBSGCMDecryptor_h
+
+#include <CommonCrypto/CommonCryptor.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MBS_GCM_NONCE_SIZE 12
+#define MBS_GCM_TAG_SIZE 16
+
+/// Largest ciphertext a single AES-GCM message may hold (2^32 - 2 blocks)
+#define MBS_GCM_MAX_CIPHERTEXT ((((uint64_t)1 << 32) - 2) * 16)
+
+/// Internal use only
+///
+/// Incremental AES-256-GCM decryption for messages too large to hold twice in
+/// memory. The keystream comes from CommonCrypto's AES-CTR and GHASH is
+/// computed here in constant time.
+///
+/// Plaintext is released before the tag is checked, so callers must treat
+/// everything they produce from it as unauthenticated until
+/// `MBSGCMDecryptorFinal` succeeds, and discard it otherwise.
+typedef struct {
+    CCCryptorRef keystream;
+    uint64_t h[2];
+    uint64_t hReversed[2];
+    uint64_t y[2];
+    uint8_t tagMask[MBS_GCM_TAG_SIZE];
+    uint8_t partial[16];
+    size_t partialLength;
+    uint64_t associatedDataLength;
+    uint64_t ciphertextLength;
+} MBSGCMDecryptor;
+
+/// Starts a decryption with a 32-byte key, 12-byte nonce and optional associated data.
+///
+/// Returns kCCSuccess or the CommonCrypto error that prevented setup.
+CCCryptorStatus MBSGCMDecryptorInit(MBSGCMDecryptor *decryptor,
+                                    const uint8_t *key,
+                                    const uint8_t *nonce,
+                                    const uint8_t *associatedData,
+                                    size_t associatedDataLength);
+
+/// Decrypts the next `length` ciphertext bytes into `plaintext` (which must not overlap `ciphertext`)
+CCCryptorStatus MBSGCMDecryptorUpdate(MBSGCMDecryptor *decryptor,
+                                      const uint8_t *ciphertext,
+                                      uint8_t *plaintext,
+                                      size_t length);
+
+/// Checks the 16-byte tag in constant time and wipes the decryptor.
+///
+/// Returns 0 when the tag matches, -1 otherwise.
+int MBSGCMDecryptorFinal(MBSGCMDecryptor *decryptor, const uint8_t *tag);
+
+/// Wipes a decryptor that will not be finished
+void MBSGCMDecryptorRelease(MBSGCMDecryptor *decryptor);
+
+#endif
@@ -0,0 +1,109 @@
+//
+//  MBSBulkFileCipher.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import <Foundation/Foundation.h>
+#import "MBSCipherTypes.h"
+#import "MBSError.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// How MBSBulkFileCipher issues file reads and writes
+typedef NS_ENUM(NSInteger, MBSFileIOMode) {
+    MBSFileIOModeAutomatic = 0, // Dispatch I/O channels, falling back to pread/pwrite
+    MBSFileIOModeBlocking = 1,  // pread/pwrite on the I/O queue
+};
+
+/// Encrypts and decrypts many files with reads, crypto and writes overlapped.
+///
+/// Files are written in the chunked V1 format produced by ``MBSCipherStream``.
+/// Because every record except the last has the same size, each chunk has a
+/// fixed offset in both the plaintext and the ciphertext. MBSBulkFileCipher
+/// uses that to keep up to `ioDepth` chunk reads and writes in flight across
+/// all files while `workerCount` crypto workers seal or open completed reads.
+///
+/// Chunk buffers are page aligned, allocated once per call, and zeroed when
+/// returned. Fixed-size records are decrypted into the same buffers and
+/// written from them, so plaintext is wiped once its write completes; records
+/// streamed in order (compressed, or larger than this cipher's chunk size)
+/// pass through ordinary heap memory instead. Each output is written to a temporary file next to the
+/// destination, optionally flushed to stable storage, and renamed into place,
+/// so a destination is either complete or untouched.
+///
+/// An instance runs one batch at a time; use separate instances to run batches concurrently.
+///
+/// ```objc
+/// MBSBulkFileCipher *cipher = [[MBSBulkFileCipher alloc] initWithKey:key];
+/// cipher.synchronizeWrites = YES;
+///
+/// NSDictionary<NSURL *, NSError *> *failures = [cipher encryptFiles:sources
+///                                                         toOutputs:destinations
+///                                                             error:&error];
+/// ```
+API_AVAILABLE(macos(12.4), ios(15.6))
+@interface MBSBulkFileCipher : NSObject
+
+/// Number of concurrent crypto workers. Defaults to the active processor count.
+@property (nonatomic, assign) NSUInteger workerCount;
+
+/// Maximum number of chunks in flight across all files. Defaults to 64.
+@property (nonatomic, assign) NSUInteger ioDepth;
+
+/// Plaintext bytes per chunk (4 KiB to 16 MiB). Defaults to `kMBSCipherStreamDefaultChunkSize`.
+@property (nonatomic, assign) NSUInteger chunkSize;
+
+/// Reads and writes bypass the unified buffer cache (F_NOCACHE). Defaults to NO.
+@property (nonatomic, assign) BOOL bypassCache;
+
+/// Outputs are flushed to stable storage before they are renamed into place. Defaults to NO.
+@property (nonatomic, assign) BOOL synchronizeWrites;
+
+/// Defaults to MBSFileIOModeAutomatic
+@property (nonatomic, assign) MBSFileIOMode ioMode;
+
+/// @param key 32-byte key for AES-256-GCM
+- (instancetype)initWithKey:(NSData *)key NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Encrypts each source file to the destination at the same index in chunked V1 format.
+///
+/// @param sourceURLs Plaintext files
+/// @param destinationURLs Where to write each encrypted file
+/// @param error Error object populated when the request itself is invalid:
+///              - MBSCipherErrorInvalidKey (200): Invalid key size
+///              - MBSCipherErrorInvalidInput (202): Mismatched URL lists or invalid chunk size
+///
+/// @return Failed sources mapped to their errors (empty when every file succeeded),
+///         or nil if the request is invalid. Per-file errors use the codes of
+///         ``MBSCipherStream``, plus MBSCipherErrorFilePermission (222).
+- (nullable NSDictionary<NSURL *, NSError *> *)encryptFiles:(NSArray<NSURL *> *)sourceURLs
+                                                  toOutputs:(NSArray<NSURL *> *)destinationURLs
+                                                      error:(NSError **)error;
+
+/// Decrypts each source file to the destination at the same index.
+///
+/// Chunked V1 files are decrypted chunk by chunk at their fixed offsets.
+/// Compressed chunked files, whose records vary in size, and files written with
+/// a larger chunk size than `chunkSize` are decrypted in order with ``MBSCipherStream``. Any other input is passed to
+/// ``MBSCipher/decryptFile:toOutput:withAlgorithm:withFormat:withKey:error:``
+/// with the format detected from its magic bytes.
+///
+/// @param sourceURLs Encrypted files
+/// @param destinationURLs Where to write each decrypted file
+/// @param error Error object populated when the request itself is invalid:
+///              - MBSCipherErrorInvalidKey (200): Invalid key size
+///              - MBSCipherErrorInvalidInput (202): Mismatched URL lists
+///
+/// @return Failed sources mapped to their errors (empty when every file succeeded),
+///         or nil if the request is invalid.
+- (nullable NSDictionary<NSURL *, NSError *> *)decryptFiles:(NSArray<NSURL *> *)sourceURLs
+                                                  toOutputs:(NSArray<NSURL *> *)destinationURLs
+                                                      error:(NSError **)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
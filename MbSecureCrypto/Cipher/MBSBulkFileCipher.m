@@ -0,0 +1,563 @@
+//
+//  MBSBulkFileCipher.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import "MBSBulkFileCipher.h"
+#import "MBSCipher.h"
+#import "MBSCipherStream.h"
+#import "MBSChunkedCipher.h"
+#import "MBSBufferPool.h"
+#import "MBSFileIOChannel.h"
+#import "MBSFileUtilities.h"
+#import <errno.h>
+#import <fcntl.h>
+#import <sys/stat.h>
+#import <unistd.h>
+
+// Handle both framework and static library imports
+#if __has_include(<MbSecureCrypto/MbSecureCrypto-Swift.h>)
+#import <MbSecureCrypto/MbSecureCrypto-Swift.h>
+#else
+#import "MbSecureCrypto-Swift.h"
+#endif
+
+static const NSUInteger kMBSBulkDefaultIODepth = 64;
+
+#pragma mark - Job
+
+/// State for one file while its chunks are in flight
+@interface MBSBulkFileJob : NSObject
+@property (nonatomic, strong) NSURL *sourceURL;
+@property (nonatomic, strong) NSURL *destinationURL;
+@property (nonatomic, copy, nullable) NSString *temporaryPath;
+@property (nonatomic, strong, nullable) MBSFileIOChannel *input;
+@property (nonatomic, strong, nullable) MBSFileIOChannel *output;
+@property (nonatomic, strong, nullable) MBSChunkedCipher *coder;
+@property (nonatomic, strong) dispatch_group_t group;
+@property (nonatomic, assign) off_t recordsOffset;
+@property (nonatomic, assign) uint64_t recordCount;
+@property (nonatomic, assign) NSUInteger finalLength;
+@property (nonatomic, assign) MBSCipherFormat format;
+@property (nonatomic, assign, getter=isStreamed) BOOL streamed;
+@property (nonatomic, strong, nullable) NSError *error;
+@end
+
+@implementation MBSBulkFileJob
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _group = dispatch_group_create();
+    }
+    return self;
+}
+
+- (BOOL)hasFailed {
+    @synchronized (self) {
+        return self.error != nil;
+    }
+}
+
+/// Keeps the first error; later chunks usually fail as a consequence of it
+- (void)failWithError:(NSError *)error {
+    @synchronized (self) {
+        if (!self.error) {
+            self.error = error;
+        }
+    }
+}
+
+@end
+
+#pragma mark - MBSBulkFileCipher
+
+@interface MBSBulkFileCipher ()
+@property (nonatomic, copy) NSData *key;
+@property (nonatomic, strong) dispatch_queue_t ioQueue;
+@property (nonatomic, copy) NSArray<dispatch_queue_t> *workers;
+@property (nonatomic, strong) MBSBufferPool *pool;
+@property (nonatomic, assign) NSUInteger nextWholeFileWorker;
+@end
+
+@implementation MBSBulkFileCipher
+
+- (instancetype)initWithKey:(NSData *)key {
+    self = [super init];
+    if (self) {
+        _key = [key copy];
+        _workerCount = NSProcessInfo.processInfo.activeProcessorCount;
+        _ioDepth = kMBSBulkDefaultIODepth;
+        _chunkSize = kMBSCipherStreamDefaultChunkSize;
+        _ioMode = MBSFileIOModeAutomatic;
+    }
+    return self;
+}
+
+#pragma mark - Setup
+
+- (BOOL)prepareForSources:(NSArray<NSURL *> *)sourceURLs
+             destinations:(NSArray<NSURL *> *)destinationURLs
+                  encrypt:(BOOL)encrypt
+                    error:(NSError **)error {
+    if (!sourceURLs || !destinationURLs || sourceURLs.count != destinationURLs.count) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Each source file needs exactly one destination"}];
+        }
+        return NO;
+    }
+
+    if (self.key.length != 32) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidKey
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Key must be 32 bytes for AES-256"}];
+        }
+        return NO;
+    }
+
+    // Validates the chunk size the same way every job will
+    MBSChunkedCipher *probe = [MBSChunkedCipher encoderWithKey:self.key chunkSize:self.chunkSize error:error];
+    if (!probe) {
+        return NO;
+    }
+
+    // Decryption opens each record into the second half of its buffer, so
+    // plaintext only ever lives in memory the pool wipes
+    NSUInteger bufferSize = encrypt ? probe.recordSize : probe.recordSize + probe.chunkSize;
+    self.pool = [[MBSBufferPool alloc] initWithBufferSize:bufferSize count:MAX(self.ioDepth, (NSUInteger)1)];
+    if (!self.pool) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorIOFailure
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Failed to allocate chunk buffers"}];
+        }
+        return NO;
+    }
+
+    self.ioQueue = dispatch_queue_create("com.mbsecurecrypto.bulk.io", DISPATCH_QUEUE_CONCURRENT);
+
+    // One serial queue per worker; chunks are spread across them by index
+    NSUInteger workerCount = MAX(self.workerCount, (NSUInteger)1);
+    NSMutableArray<dispatch_queue_t> *workers = [NSMutableArray arrayWithCapacity:workerCount];
+    for (NSUInteger i = 0; i < workerCount; i++) {
+        [workers addObject:dispatch_queue_create("com.mbsecurecrypto.bulk.worker", DISPATCH_QUEUE_SERIAL)];
+    }
+    self.workers = workers;
+    return YES;
+}
+
+- (nullable MBSFileIOChannel *)inputChannelForPath:(NSString *)path error:(NSError **)error {
+    int fd = open(path.fileSystemRepresentation, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to open source file", errno);
+        }
+        return nil;
+    }
+    return [self channelForDescriptor:fd];
+}
+
+- (MBSFileIOChannel *)channelForDescriptor:(int)fd {
+    if (self.bypassCache) {
+        fcntl(fd, F_NOCACHE, 1);
+    }
+
+    return [[MBSFileIOChannel alloc] initWithFileDescriptor:fd
+                                                   blocking:self.ioMode == MBSFileIOModeBlocking
+                                                      queue:self.ioQueue];
+}
+
+- (BOOL)openOutputForJob:(MBSBulkFileJob *)job error:(NSError **)error {
+    NSString *temporaryPath = nil;
+    int fd = MBSFileCreateTemporary(job.destinationURL.path, &temporaryPath);
+    if (fd < 0) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to create output file", errno);
+        }
+        return NO;
+    }
+    job.temporaryPath = temporaryPath;
+    job.output = [self channelForDescriptor:fd];
+    return YES;
+}
+
+#pragma mark - Completion
+
+/// Flushes, closes and renames a job's output once all of its chunks are done
+- (void)finishJob:(MBSBulkFileJob *)job {
+    if (job.output && ![job hasFailed] && self.synchronizeWrites && ![job.output synchronize]) {
+        [job failWithError:MBSPOSIXError(@"Failed to flush output file", errno)];
+    }
+
+    [job.input close];
+    [job.output close];
+
+    if (!job.temporaryPath) {
+        return;
+    }
+    if ([job hasFailed]) {
+        MBSFileDiscardTemporary(-1, job.temporaryPath);
+        return;
+    }
+    // The channel has already flushed and closed the descriptor
+    if (!MBSFileCommitTemporary(-1, job.temporaryPath, job.destinationURL.path, NO)) {
+        [job failWithError:MBSPOSIXError(@"Failed to move output file into place", errno)];
+    }
+}
+
+- (nullable NSDictionary<NSURL *, NSError *> *)runJobsForSources:(NSArray<NSURL *> *)sourceURLs
+                                                    destinations:(NSArray<NSURL *> *)destinationURLs
+                                                         encrypt:(BOOL)encrypt {
+    NSMutableDictionary<NSURL *, NSError *> *failures = [NSMutableDictionary dictionary];
+    dispatch_group_t all = dispatch_group_create();
+
+    for (NSUInteger i = 0; i < sourceURLs.count; i++) {
+        @autoreleasepool {
+            MBSBulkFileJob *job = [[MBSBulkFileJob alloc] init];
+            job.sourceURL = sourceURLs[i];
+            job.destinationURL = destinationURLs[i];
+
+            NSError *openError = nil;
+            BOOL opened = encrypt ? [self openEncryptJob:job error:&openError] : [self openDecryptJob:job error:&openError];
+            if (!opened) {
+                [job failWithError:openError];
+                [self finishJob:job];
+                failures[job.sourceURL] = job.error;
+                continue;
+            }
+
+            dispatch_group_enter(all);
+            if (job.coder) {
+                [self submitRecordsOfJob:job encrypt:encrypt];
+            } else {
+                [self submitSingleShotJob:job];
+            }
+            dispatch_group_notify(job.group, self.ioQueue, ^{
+                [self finishJob:job];
+                if (job.error) {
+                    @synchronized (failures) {
+                        failures[job.sourceURL] = job.error;
+                    }
+                }
+                dispatch_group_leave(all);
+            });
+        }
+    }
+
+    dispatch_group_wait(all, DISPATCH_TIME_FOREVER);
+    self.pool = nil;
+    return failures;
+}
+
+#pragma mark - Encryption
+
+- (nullable NSDictionary<NSURL *, NSError *> *)encryptFiles:(NSArray<NSURL *> *)sourceURLs
+                                                  toOutputs:(NSArray<NSURL *> *)destinationURLs
+                                                      error:(NSError **)error {
+    if (![self prepareForSources:sourceURLs destinations:destinationURLs encrypt:YES error:error]) {
+        return nil;
+    }
+    return [self runJobsForSources:sourceURLs destinations:destinationURLs encrypt:YES];
+}
+
+- (BOOL)openEncryptJob:(MBSBulkFileJob *)job error:(NSError **)error {
+    job.input = [self inputChannelForPath:job.sourceURL.path error:error];
+    if (!job.input) {
+        return NO;
+    }
+
+    struct stat info;
+    if (fstat(job.input.fileDescriptor, &info) != 0) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to read source file attributes", errno);
+        }
+        return NO;
+    }
+
+    job.coder = [MBSChunkedCipher encoderWithKey:self.key chunkSize:self.chunkSize error:error];
+    if (!job.coder || ![self openOutputForJob:job error:error]) {
+        return NO;
+    }
+
+    // Full chunks, then a final chunk holding the remainder (possibly empty)
+    uint64_t size = (uint64_t)info.st_size;
+    job.recordCount = size / self.chunkSize + 1;
+    job.finalLength = (NSUInteger)(size % self.chunkSize);
+
+    NSData *header = [job.coder.header encoded];
+    job.recordsOffset = (off_t)header.length;
+    off_t total = job.recordsOffset + (off_t)((job.recordCount - 1) * job.coder.recordSize) +
+                  (off_t)(kMBSChunkRecordHeaderSize + job.finalLength + (NSUInteger)MBSCipherHeader.tagSize);
+
+    // Reserve the full length up front so chunk writes land in allocated space
+    if (ftruncate(job.output.fileDescriptor, total) != 0) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to size output file", errno);
+        }
+        return NO;
+    }
+    if (!MBSFileWriteFully(job.output.fileDescriptor, header.bytes, header.length, 0)) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to write output file", errno);
+        }
+        return NO;
+    }
+    return YES;
+}
+
+#pragma mark - Decryption
+
+- (nullable NSDictionary<NSURL *, NSError *> *)decryptFiles:(NSArray<NSURL *> *)sourceURLs
+                                                  toOutputs:(NSArray<NSURL *> *)destinationURLs
+                                                      error:(NSError **)error {
+    if (![self prepareForSources:sourceURLs destinations:destinationURLs encrypt:NO error:error]) {
+        return nil;
+    }
+    return [self runJobsForSources:sourceURLs destinations:destinationURLs encrypt:NO];
+}
+
+- (BOOL)openDecryptJob:(MBSBulkFileJob *)job error:(NSError **)error {
+    job.input = [self inputChannelForPath:job.sourceURL.path error:error];
+    if (!job.input) {
+        return NO;
+    }
+
+    int fd = job.input.fileDescriptor;
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to read source file attributes", errno);
+        }
+        return NO;
+    }
+
+    // Anything but chunked V1 goes through MBSCipher as a whole file
+    job.format = MBSCipherFormatV0;
+    NSUInteger fixedSize = (NSUInteger)MBSCipherHeader.fixedSize;
+    NSMutableData *prefix = [NSMutableData dataWithLength:fixedSize];
+    if ((uint64_t)info.st_size < fixedSize || !MBSFileReadFully(fd, prefix.mutableBytes, fixedSize, 0) ||
+        memcmp(prefix.bytes, MBSCipherHeader.magicBytes.bytes, 4) != 0) {
+        return YES;
+    }
+    job.format = MBSCipherFormatV1;
+
+    const uint8_t *bytes = prefix.bytes;
+    NSUInteger paramsLength = ((NSUInteger)bytes[6] << 8) | bytes[7];
+    [prefix increaseLengthBy:paramsLength];
+    if ((uint64_t)info.st_size < fixedSize + paramsLength ||
+        !MBSFileReadFully(fd, (uint8_t *)prefix.mutableBytes + fixedSize, paramsLength, (off_t)fixedSize)) {
+        // Let the single-shot path report the malformed header
+        return YES;
+    }
+
+    MBSCipherHeader *header = [MBSCipherHeader parseHeader:prefix error:error];
+    if (!header) {
+        return NO;
+    }
+    if (![header extensionValue:MBSCipherHeader.extensionChunked]) {
+        return YES;
+    }
+
+    job.coder = [MBSChunkedCipher decoderWithHeader:header key:self.key error:error];
+    if (!job.coder) {
+        return NO;
+    }
+
+    // Compressed records vary in size, so they are located by reading them in order.
+    // Records larger than the pool's buffers, written with a bigger chunk size
+    // than this cipher's, are streamed the same way instead of read into them.
+    if (!job.coder.hasFixedRecordSize || job.coder.recordSize + job.coder.chunkSize > self.pool.bufferSize) {
+        job.coder = nil;
+        job.streamed = YES;
+        return [self openOutputForJob:job error:error];
+    }
+
+    // Records sit at fixed offsets; only the final one may be short
+    NSUInteger overhead = kMBSChunkRecordHeaderSize + (NSUInteger)MBSCipherHeader.tagSize;
+    uint64_t body = (uint64_t)info.st_size - prefix.length;
+    uint64_t fullRecords = body / job.coder.recordSize;
+    uint64_t remainder = body % job.coder.recordSize;
+    if (remainder >= overhead) {
+        job.recordCount = fullRecords + 1;
+        job.finalLength = (NSUInteger)(remainder - overhead);
+    } else if (remainder == 0 && fullRecords > 0) {
+        job.recordCount = fullRecords;
+        job.finalLength = job.coder.chunkSize;
+    } else {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorAuthenticationFailed
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Encrypted file is truncated"}];
+        }
+        return NO;
+    }
+    job.recordsOffset = (off_t)prefix.length;
+
+    return [self openOutputForJob:job error:error];
+}
+
+- (void)submitSingleShotJob:(MBSBulkFileJob *)job {
+    [job.input close];
+    job.input = nil;
+
+    // Whole-file jobs take turns across the workers so a mixed batch still overlaps
+    dispatch_queue_t worker = self.workers[self.nextWholeFileWorker++ % self.workers.count];
+
+    if (job.streamed) {
+        dispatch_group_async(job.group, worker, ^{
+            NSInputStream *input = [NSInputStream inputStreamWithURL:job.sourceURL];
+            NSOutputStream *output = [NSOutputStream outputStreamToFileAtPath:job.temporaryPath append:NO];
+            NSError *decryptError = nil;
+            if (![MBSCipherStream decryptStream:input
+                                       toStream:output
+                                  withAlgorithm:MBSCipherAlgorithmAESGCM
+                                     withFormat:@(MBSCipherFormatV1)
+                                        withKey:self.key
+                                          error:&decryptError]) {
+                [job failWithError:decryptError];
+            }
+            [input close];
+            [output close];
+        });
+        return;
+    }
+
+    dispatch_group_async(job.group, worker, ^{
+        NSError *decryptError = nil;
+        if (![MBSCipher decryptFile:job.sourceURL
+                           toOutput:job.destinationURL
+                      withAlgorithm:MBSCipherAlgorithmAESGCM
+                         withFormat:@(job.format)
+                            withKey:self.key
+                              error:&decryptError]) {
+            [job failWithError:decryptError];
+        }
+    });
+}
+
+#pragma mark - Records
+
+/// Issues every chunk of a job: read, then seal or open on a worker, then write.
+///
+/// A chunk's buffer is held until its write completes, since decrypted output
+/// is written straight from it.
+- (void)submitRecordsOfJob:(MBSBulkFileJob *)job encrypt:(BOOL)encrypt {
+    MBSBufferPool *pool = self.pool;
+    NSUInteger chunkSize = job.coder.chunkSize;
+    NSUInteger recordSize = job.coder.recordSize;
+    NSUInteger overhead = kMBSChunkRecordHeaderSize + (NSUInteger)MBSCipherHeader.tagSize;
+
+    for (uint64_t index = 0; index < job.recordCount && ![job hasFailed]; index++) {
+        BOOL final = (index == job.recordCount - 1);
+        NSUInteger plaintextLength = final ? job.finalLength : chunkSize;
+        size_t readLength = encrypt ? plaintextLength : plaintextLength + overhead;
+        off_t readOffset = encrypt ? (off_t)(index * chunkSize) : job.recordsOffset + (off_t)(index * recordSize);
+        off_t writeOffset = encrypt ? job.recordsOffset + (off_t)(index * recordSize) : (off_t)(index * chunkSize);
+        dispatch_queue_t worker = self.workers[index % self.workers.count];
+
+        // Blocks here while `ioDepth` chunks are in flight
+        void *buffer = [pool acquireBuffer];
+        dispatch_group_enter(job.group);
+
+        void (^process)(void) = ^{
+            NSError *chunkError = nil;
+            NSData *output = nil;
+            if (![job hasFailed]) {
+                output = encrypt ? [self sealChunkOfJob:job buffer:buffer length:plaintextLength index:index final:final error:&chunkError]
+                                 : [self openRecordOfJob:job buffer:buffer length:readLength index:index final:final error:&chunkError];
+            }
+
+            if (!output) {
+                if (chunkError) {
+                    [job failWithError:chunkError];
+                }
+                [pool releaseBuffer:buffer];
+                dispatch_group_leave(job.group);
+                return;
+            }
+            if (output.length == 0) {
+                [pool releaseBuffer:buffer];
+                dispatch_group_leave(job.group);
+                return;
+            }
+
+            [job.output writeData:output atOffset:writeOffset completion:^(int errorCode) {
+                if (errorCode != 0) {
+                    [job failWithError:MBSPOSIXError(@"Failed to write output file", errorCode)];
+                }
+                [pool releaseBuffer:buffer];
+                dispatch_group_leave(job.group);
+            }];
+        };
+
+        if (readLength == 0) {
+            dispatch_async(worker, process);
+            continue;
+        }
+
+        [job.input readLength:readLength atOffset:readOffset into:buffer completion:^(size_t bytesRead, int errorCode) {
+            if (errorCode != 0 || bytesRead != readLength) {
+                [job failWithError:MBSPOSIXError(@"Failed to read source file", errorCode ?: EIO)];
+                [pool releaseBuffer:buffer];
+                dispatch_group_leave(job.group);
+                return;
+            }
+            dispatch_async(worker, process);
+        }];
+    }
+}
+
+- (nullable NSData *)sealChunkOfJob:(MBSBulkFileJob *)job
+                             buffer:(const void *)buffer
+                             length:(NSUInteger)length
+                              index:(uint64_t)index
+                              final:(BOOL)final
+                              error:(NSError **)error {
+    return [job.coder sealBytes:buffer length:length atIndex:index final:final error:error];
+}
+
+/// Opens the record at the start of `buffer` into the plaintext region after
+/// it and returns that region without copying it
+- (nullable NSData *)openRecordOfJob:(MBSBulkFileJob *)job
+                              buffer:(void *)buffer
+                              length:(NSUInteger)length
+                               index:(uint64_t)index
+                               final:(BOOL)final
+                               error:(NSError **)error {
+    uint32_t recordBE = 0;
+    memcpy(&recordBE, buffer, sizeof(recordBE));
+    uint32_t recordHeader = CFSwapInt32BigToHost(recordBE);
+
+    // The last record in the file must be the final one, and no other may be
+    BOOL markedFinal = (recordHeader & kMBSChunkRecordFinalFlag) != 0;
+    if (markedFinal != final) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:final ? MBSCipherErrorAuthenticationFailed : MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: final ? @"Encrypted file is truncated"
+                                                                                 : @"Unexpected data after the final chunk"}];
+        }
+        return nil;
+    }
+
+    uint8_t *plaintext = (uint8_t *)buffer + job.coder.recordSize;
+    if (![job.coder openRecord:recordHeader
+                   sealedBytes:(const uint8_t *)buffer + kMBSChunkRecordHeaderSize
+                        length:length - kMBSChunkRecordHeaderSize
+                       atIndex:index
+                          into:plaintext
+                         error:error]) {
+        return nil;
+    }
+    return [NSData dataWithBytesNoCopy:plaintext
+                                length:length - kMBSChunkRecordHeaderSize - (NSUInteger)MBSCipherHeader.tagSize
+                          freeWhenDone:NO];
+}
+
+@end
@@ -230,6 +230,33 @@ API_AVAILABLE(macos(12.4), ios(15.6))
                          withKey:(NSData *)key
                            error:(NSError **)error;
 
+/// Compresses and then encrypts data in V1 format.
+///
+/// The codec and the original length are recorded in the authenticated V1
+/// header, and ``decryptData:withAlgorithm:withFormat:withKey:error:`` restores
+/// the original bytes into a buffer of exactly that length. Data that does not
+/// shrink is sealed uncompressed with a plain V1 header.
+///
+/// @param data The data to encrypt
+/// @param algorithm Currently only supports MBSCipherAlgorithmAESGCM
+/// @param compression Codec to apply before sealing; MBSCompressionCodecNone produces plain V1
+/// @param key 32-byte key for AES-256-GCM
+/// @param error Error object populated on failure with codes:
+///              - MBSCipherErrorInvalidKey (200): Invalid key size
+///              - MBSCipherErrorInvalidInput (202): Invalid input data or unsupported codec
+///              - MBSCipherErrorEncryptionFailed (210): Encryption operation failed
+///
+/// @return NSData in V1 format, or nil on failure
+///
+/// @note Compressing before encrypting reveals how compressible the plaintext is
+///       through the ciphertext length. Avoid it when an attacker can mix their
+///       own input with secrets in the same payload.
++ (nullable NSData *)encryptData:(NSData *)data
+                   withAlgorithm:(MBSCipherAlgorithm)algorithm
+                 withCompression:(MBSCompressionCodec)compression
+                         withKey:(NSData *)key
+                           error:(NSError **)error;
+
 /// Encrypts arbitrary data using authenticated encryption.
 ///
 /// Encrypts the provided data using AES-GCM with a random nonce. The output
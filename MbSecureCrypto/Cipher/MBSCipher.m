@@ -161,6 +161,39 @@
                                   error:error];
 }
 
++ (nullable NSData *)encryptData:(NSData *)data
+                   withAlgorithm:(MBSCipherAlgorithm)algorithm
+                 withCompression:(MBSCompressionCodec)compression
+                         withKey:(NSData *)key
+                           error:(NSError **)error {
+    
+    // Input validation
+    if (!data) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Input data cannot be nil"}];
+        }
+        return nil;
+    }
+    
+    if (!key || key.length == 0) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidKey
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Key cannot be empty"}];
+        }
+        return nil;
+    }
+    
+    // Forward to bridge; compression is only defined for V1
+    return [MBSCipherBridge encryptData:data
+                                    key:key
+                              algorithm:algorithm
+                            compression:compression
+                                  error:error];
+}
+
 + (nullable NSData *)decryptData:(NSData *)encryptedData
                    withAlgorithm:(MBSCipherAlgorithm)algorithm
 
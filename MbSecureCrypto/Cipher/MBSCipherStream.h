@@ -0,0 +1,131 @@
+//
+//  MBSCipherStream.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import <Foundation/Foundation.h>
+#import "MBSCipherTypes.h"
+#import "MBSError.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Default plaintext chunk size for streamed encryption (64 KiB)
+FOUNDATION_EXPORT const NSUInteger kMBSCipherStreamDefaultChunkSize;
+
+/// Streaming authenticated encryption in constant memory.
+///
+/// MBSCipherStream encrypts an input stream into the chunked variant of the V1
+/// "SECB" format: a V1 header carrying the chunked extension, followed by a
+/// sequence of independently sealed AES-GCM chunks. Only one chunk is held in
+/// memory at a time, so payloads are not bound by `kMBSCipherMaxFileSize`.
+///
+/// Each chunk binds its index, its length and whether it is the final chunk, so
+/// reordered, dropped, or truncated chunks fail authentication.
+///
+/// ```objc
+/// NSInputStream *input = [NSInputStream inputStreamWithFileAtPath:@"backup.tar"];
+/// NSOutputStream *output = [NSOutputStream outputStreamToFileAtPath:@"backup.tar.secb" append:NO];
+///
+/// BOOL success = [MBSCipherStream encryptStream:input
+///                                      toStream:output
+///                                 withAlgorithm:MBSCipherAlgorithmAESGCM
+///                                       withKey:key
+///                                         error:&error];
+/// ```
+///
+/// Streams that are not yet open are opened; closing them is left to the caller.
+///
+/// @note Plaintext is written to the output stream chunk by chunk as each chunk
+///       authenticates. If decryption fails part way, discard everything written.
+API_AVAILABLE(macos(12.4), ios(15.6))
+@interface MBSCipherStream : NSObject
+
+/// Encrypts a stream into chunked V1 format.
+///
+/// @param inputStream Plaintext source
+/// @param outputStream Destination for the chunked V1 ciphertext
+/// @param algorithm Currently only supports MBSCipherAlgorithmAESGCM
+/// @param chunkSize Plaintext bytes per chunk (4 KiB to 16 MiB)
+/// @param key 32-byte key for AES-256-GCM
+/// @param error Error object populated on failure with codes:
+///              - MBSCipherErrorInvalidKey (200): Invalid key size
+///              - MBSCipherErrorInvalidInput (202): Invalid stream or chunk size
+///              - MBSCipherErrorUnsupportedAlgorithm (203): Unsupported algorithm
+///              - MBSCipherErrorEncryptionFailed (210): Encryption operation failed
+///              - MBSCipherErrorIOFailure (220): Stream read/write failed
+///
+/// @return YES if successful, NO if an error occurred
++ (BOOL)encryptStream:(NSInputStream *)inputStream
+             toStream:(NSOutputStream *)outputStream
+        withAlgorithm:(MBSCipherAlgorithm)algorithm
+            chunkSize:(NSUInteger)chunkSize
+              withKey:(NSData *)key
+                error:(NSError **)error;
+
+/// Compresses each chunk and then encrypts a stream into chunked V1 format.
+///
+/// The codec is recorded in the authenticated header and every chunk carries
+/// its own original length, so decryption restores each chunk into a buffer of
+/// exactly that size. Chunks that do not shrink are stored uncompressed.
+///
+/// @param compression Codec to apply to each chunk before sealing
+///
+/// Other parameters and error codes are as for
+/// ``encryptStream:toStream:withAlgorithm:chunkSize:withKey:error:``; an
+/// unsupported codec reports MBSCipherErrorInvalidInput (202).
+///
+/// @note See ``MBSCipher/encryptData:withAlgorithm:withCompression:withKey:error:``
+///       for when compressing before encrypting is not appropriate.
++ (BOOL)encryptStream:(NSInputStream *)inputStream
+             toStream:(NSOutputStream *)outputStream
+        withAlgorithm:(MBSCipherAlgorithm)algorithm
+            chunkSize:(NSUInteger)chunkSize
+      withCompression:(MBSCompressionCodec)compression
+              withKey:(NSData *)key
+                error:(NSError **)error;
+
+/// Encrypts a stream into chunked V1 format using `kMBSCipherStreamDefaultChunkSize`.
++ (BOOL)encryptStream:(NSInputStream *)inputStream
+             toStream:(NSOutputStream *)outputStream
+        withAlgorithm:(MBSCipherAlgorithm)algorithm
+              withKey:(NSData *)key
+                error:(NSError **)error;
+
+/// Decrypts a stream, detecting its format.
+///
+/// Chunked V1 input is decrypted in constant memory. Single-shot V0 and V1
+/// input is buffered (up to `kMBSCipherMaxFileSize`) and decrypted as with
+/// ``MBSCipher/decryptData:withAlgorithm:withFormat:withKey:error:``.
+///
+/// @param inputStream Encrypted source
+/// @param outputStream Destination for the plaintext
+/// @param algorithm Must match the algorithm used for encryption
+/// @param format Expected format version:
+///              - MBSCipherFormatV0: Legacy format [nonce][ciphertext][tag]
+///              - MBSCipherFormatV1: Universal format, single-shot or chunked
+///              - nil: Detect the format from the magic bytes
+/// @param key Must be the same 32-byte key used for encryption
+/// @param error Error object populated on failure with codes:
+///              - MBSCipherErrorInvalidKey (200): Invalid key size
+///              - MBSCipherErrorInvalidInput (202): Invalid/corrupted input
+///              - MBSCipherErrorUnsupportedFormat (204): Unknown or unsupported format version
+///              - MBSCipherErrorFormatMismatch (206): Input does not match the requested format
+///              - MBSCipherErrorDecryptionFailed (211): Decryption operation failed
+///              - MBSCipherErrorAuthenticationFailed (212): Tag verification failed or input truncated
+///              - MBSCipherErrorIOFailure (220): Stream read/write failed
+///              - MBSCipherErrorFileTooLarge (221): Single-shot input exceeds 10MB limit
+///
+/// @return YES if successful, NO if an error occurred
++ (BOOL)decryptStream:(NSInputStream *)inputStream
+             toStream:(NSOutputStream *)outputStream
+        withAlgorithm:(MBSCipherAlgorithm)algorithm
+           withFormat:(nullable NSNumber *)format
+              withKey:(NSData *)key
+                error:(NSError **)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,432 @@
+//
+//  MBSCipherStream.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import "MBSCipherStream.h"
+#import "MBSCipher.h"
+#import "MBSError.h"
+#import "MBSChunkedCipher.h"
+
+// Handle both framework and static library imports
+#if __has_include(<MbSecureCrypto/MbSecureCrypto-Swift.h>)
+#import <MbSecureCrypto/MbSecureCrypto-Swift.h>
+#else
+#import "MbSecureCrypto-Swift.h"
+#endif
+
+const NSUInteger kMBSCipherStreamDefaultChunkSize = 64 * 1024;
+
+/// Reads until `length` bytes arrive or the stream ends. Returns the byte count, or -1 on error.
+static NSInteger MBSStreamReadFully(NSInputStream *stream, uint8_t *buffer, NSUInteger length) {
+    NSUInteger total = 0;
+    while (total < length) {
+        NSInteger count = [stream read:buffer + total maxLength:length - total];
+        if (count < 0) {
+            return -1;
+        }
+        if (count == 0) {
+            break;
+        }
+        total += (NSUInteger)count;
+    }
+    return (NSInteger)total;
+}
+
+static BOOL MBSStreamWriteFully(NSOutputStream *stream, NSData *data) {
+    const uint8_t *bytes = data.bytes;
+    NSUInteger total = 0;
+    while (total < data.length) {
+        NSInteger count = [stream write:bytes + total maxLength:data.length - total];
+        if (count <= 0) {
+            return NO;
+        }
+        total += (NSUInteger)count;
+    }
+    return YES;
+}
+
+static NSError *MBSStreamIOError(NSString *description, NSError * _Nullable underlying) {
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithObject:description
+                                                                       forKey:NSLocalizedDescriptionKey];
+    if (underlying) {
+        userInfo[NSUnderlyingErrorKey] = underlying;
+    }
+    return [NSError errorWithDomain:MBSErrorDomain code:MBSCipherErrorIOFailure userInfo:userInfo];
+}
+
+@implementation MBSCipherStream
+
++ (BOOL)validateInput:(NSInputStream *)inputStream
+               output:(NSOutputStream *)outputStream
+            algorithm:(MBSCipherAlgorithm)algorithm
+                  key:(NSData *)key
+                error:(NSError **)error {
+    if (!inputStream || !outputStream) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Input or output stream is nil"}];
+        }
+        return NO;
+    }
+
+    if (algorithm != MBSCipherAlgorithmAESGCM) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorUnsupportedAlgorithm
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Unsupported algorithm"}];
+        }
+        return NO;
+    }
+
+    if (key.length != 32) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidKey
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Key must be 32 bytes for AES-256"}];
+        }
+        return NO;
+    }
+
+    if (inputStream.streamStatus == NSStreamStatusNotOpen) {
+        [inputStream open];
+    }
+    if (outputStream.streamStatus == NSStreamStatusNotOpen) {
+        [outputStream open];
+    }
+
+    if (inputStream.streamStatus == NSStreamStatusError || outputStream.streamStatus == NSStreamStatusError) {
+        if (error) {
+            *error = MBSStreamIOError(@"Failed to open stream",
+                                      inputStream.streamError ?: outputStream.streamError);
+        }
+        return NO;
+    }
+
+    return YES;
+}
+
++ (BOOL)encryptStream:(NSInputStream *)inputStream
+             toStream:(NSOutputStream *)outputStream
+        withAlgorithm:(MBSCipherAlgorithm)algorithm
+              withKey:(NSData *)key
+                error:(NSError **)error {
+    return [self encryptStream:inputStream
+                      toStream:outputStream
+                 withAlgorithm:algorithm
+                     chunkSize:kMBSCipherStreamDefaultChunkSize
+                       withKey:key
+                         error:error];
+}
+
++ (BOOL)encryptStream:(NSInputStream *)inputStream
+             toStream:(NSOutputStream *)outputStream
+        withAlgorithm:(MBSCipherAlgorithm)algorithm
+            chunkSize:(NSUInteger)chunkSize
+              withKey:(NSData *)key
+                error:(NSError **)error {
+    return [self encryptStream:inputStream
+                      toStream:outputStream
+                 withAlgorithm:algorithm
+                     chunkSize:chunkSize
+               withCompression:MBSCompressionCodecNone
+                       withKey:key
+                         error:error];
+}
+
++ (BOOL)encryptStream:(NSInputStream *)inputStream
+             toStream:(NSOutputStream *)outputStream
+        withAlgorithm:(MBSCipherAlgorithm)algorithm
+            chunkSize:(NSUInteger)chunkSize
+      withCompression:(MBSCompressionCodec)compression
+              withKey:(NSData *)key
+                error:(NSError **)error {
+
+    if (![self validateInput:inputStream output:outputStream algorithm:algorithm key:key error:error]) {
+        return NO;
+    }
+
+    MBSChunkedCipher *encoder = [MBSChunkedCipher encoderWithKey:key
+                                                       chunkSize:chunkSize
+                                                     compression:compression
+                                                           error:error];
+    if (!encoder) {
+        return NO;
+    }
+
+    if (!MBSStreamWriteFully(outputStream, [encoder.header encoded])) {
+        if (error) {
+            *error = MBSStreamIOError(@"Failed to write stream header", outputStream.streamError);
+        }
+        return NO;
+    }
+
+    // Single reusable plaintext buffer; cleared before returning
+    NSMutableData *buffer = [NSMutableData dataWithLength:chunkSize];
+    BOOL success = YES;
+
+    @try {
+        while (!encoder.finished) {
+            NSInteger count = MBSStreamReadFully(inputStream, buffer.mutableBytes, chunkSize);
+            if (count < 0) {
+                if (error) {
+                    *error = MBSStreamIOError(@"Failed to read input stream", inputStream.streamError);
+                }
+                success = NO;
+                break;
+            }
+
+            // A short read means the input is exhausted; a full chunk may still be followed by an empty final one
+            BOOL final = (NSUInteger)count < chunkSize;
+            NSData *record = [encoder sealBytes:buffer.bytes length:(NSUInteger)count final:final error:error];
+            if (!record) {
+                success = NO;
+                break;
+            }
+
+            if (!MBSStreamWriteFully(outputStream, record)) {
+                if (error) {
+                    *error = MBSStreamIOError(@"Failed to write output stream", outputStream.streamError);
+                }
+                success = NO;
+                break;
+            }
+        }
+    }
+    @finally {
+        [buffer resetBytesInRange:NSMakeRange(0, buffer.length)];
+    }
+
+    return success;
+}
+
++ (BOOL)decryptStream:(NSInputStream *)inputStream
+             toStream:(NSOutputStream *)outputStream
+        withAlgorithm:(MBSCipherAlgorithm)algorithm
+           withFormat:(nullable NSNumber *)format
+              withKey:(NSData *)key
+                error:(NSError **)error {
+
+    if (![self validateInput:inputStream output:outputStream algorithm:algorithm key:key error:error]) {
+        return NO;
+    }
+
+    // Read the fixed V1 header fields, or the start of a V0 nonce
+    NSUInteger fixedSize = (NSUInteger)MBSCipherHeader.fixedSize;
+    NSMutableData *prefix = [NSMutableData dataWithLength:fixedSize];
+    NSInteger count = MBSStreamReadFully(inputStream, prefix.mutableBytes, fixedSize);
+    if (count < 0) {
+        if (error) {
+            *error = MBSStreamIOError(@"Failed to read input stream", inputStream.streamError);
+        }
+        return NO;
+    }
+    prefix.length = (NSUInteger)count;
+
+    BOOL isV1 = prefix.length >= 4 && memcmp(prefix.bytes, MBSCipherHeader.magicBytes.bytes, 4) == 0;
+    if (format && format.unsignedIntValue != (isV1 ? MBSCipherFormatV1 : MBSCipherFormatV0)) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorFormatMismatch
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Input does not match the requested format"}];
+        }
+        return NO;
+    }
+
+    if (isV1 && prefix.length == fixedSize) {
+        const uint8_t *bytes = prefix.bytes;
+        NSUInteger paramsLength = ((NSUInteger)bytes[6] << 8) | bytes[7];
+
+        [prefix increaseLengthBy:paramsLength];
+        count = MBSStreamReadFully(inputStream, (uint8_t *)prefix.mutableBytes + fixedSize, paramsLength);
+        if (count < 0) {
+            if (error) {
+                *error = MBSStreamIOError(@"Failed to read input stream", inputStream.streamError);
+            }
+            return NO;
+        }
+        prefix.length = fixedSize + (NSUInteger)count;
+
+        MBSCipherHeader *header = [MBSCipherHeader parseHeader:prefix error:error];
+        if (!header) {
+            return NO;
+        }
+
+        if ([header extensionValue:MBSCipherHeader.extensionChunked]) {
+            return [self decryptRecordsFrom:inputStream
+                                   toStream:outputStream
+                                     header:header
+                                        key:key
+                                      error:error];
+        }
+    }
+
+    return [self decryptSingleShotFrom:inputStream
+                              toStream:outputStream
+                                prefix:prefix
+                             algorithm:algorithm
+                                format:isV1 ? MBSCipherFormatV1 : MBSCipherFormatV0
+                                   key:key
+                                 error:error];
+}
+
++ (BOOL)decryptRecordsFrom:(NSInputStream *)inputStream
+                  toStream:(NSOutputStream *)outputStream
+                    header:(MBSCipherHeader *)header
+                       key:(NSData *)key
+                     error:(NSError **)error {
+
+    MBSChunkedCipher *decoder = [MBSChunkedCipher decoderWithHeader:header key:key error:error];
+    if (!decoder) {
+        return NO;
+    }
+
+    NSUInteger tagSize = (NSUInteger)MBSCipherHeader.tagSize;
+    NSMutableData *sealed = [NSMutableData dataWithCapacity:decoder.maximumRecordLength + tagSize];
+    uint64_t written = 0;
+
+    while (!decoder.finished) {
+        uint32_t recordBE = 0;
+        NSInteger count = MBSStreamReadFully(inputStream, (uint8_t *)&recordBE, sizeof(recordBE));
+        if (count < 0) {
+            if (error) {
+                *error = MBSStreamIOError(@"Failed to read input stream", inputStream.streamError);
+            }
+            return NO;
+        }
+        if ((NSUInteger)count < sizeof(recordBE)) {
+            if (error) {
+                *error = [NSError errorWithDomain:MBSErrorDomain
+                                             code:MBSCipherErrorAuthenticationFailed
+                                         userInfo:@{NSLocalizedDescriptionKey: @"Encrypted stream is truncated"}];
+            }
+            return NO;
+        }
+
+        uint32_t recordHeader = CFSwapInt32BigToHost(recordBE);
+        NSUInteger length = recordHeader & ~kMBSChunkRecordFinalFlag;
+        if (length > decoder.maximumRecordLength) {
+            if (error) {
+                *error = [NSError errorWithDomain:MBSErrorDomain
+                                             code:MBSCipherErrorInvalidInput
+                                         userInfo:@{NSLocalizedDescriptionKey: @"Invalid chunk record"}];
+            }
+            return NO;
+        }
+
+        sealed.length = length + tagSize;
+        count = MBSStreamReadFully(inputStream, sealed.mutableBytes, sealed.length);
+        if (count < 0) {
+            if (error) {
+                *error = MBSStreamIOError(@"Failed to read input stream", inputStream.streamError);
+            }
+            return NO;
+        }
+        if ((NSUInteger)count < sealed.length) {
+            if (error) {
+                *error = [NSError errorWithDomain:MBSErrorDomain
+                                             code:MBSCipherErrorAuthenticationFailed
+                                         userInfo:@{NSLocalizedDescriptionKey: @"Encrypted stream is truncated"}];
+            }
+            return NO;
+        }
+
+        NSData *plaintext = [decoder openRecord:recordHeader sealed:sealed error:error];
+        if (!plaintext) {
+            return NO;
+        }
+
+        if (!MBSStreamWriteFully(outputStream, plaintext)) {
+            if (error) {
+                *error = MBSStreamIOError(@"Failed to write output stream", outputStream.streamError);
+            }
+            return NO;
+        }
+        written += plaintext.length;
+    }
+
+    // A compressed header may record the plaintext length up front
+    uint64_t originalLength = header.originalLength;
+    if (originalLength != MBSCipherHeader.unknownLength && originalLength != written) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorDecryptionFailed
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Decompressed length does not match header"}];
+        }
+        return NO;
+    }
+
+    // Anything after the final record was not produced by the encoder
+    uint8_t trailing = 0;
+    if ([inputStream read:&trailing maxLength:1] != 0) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Unexpected data after final chunk"}];
+        }
+        return NO;
+    }
+
+    return YES;
+}
+
++ (BOOL)decryptSingleShotFrom:(NSInputStream *)inputStream
+                     toStream:(NSOutputStream *)outputStream
+                       prefix:(NSData *)prefix
+                    algorithm:(MBSCipherAlgorithm)algorithm
+                       format:(MBSCipherFormat)format
+                          key:(NSData *)key
+                        error:(NSError **)error {
+
+    // Single-shot formats carry one tag over the whole payload, so buffer it
+    NSMutableData *encryptedData = [prefix mutableCopy];
+    uint8_t buffer[16 * 1024];
+    while (YES) {
+        NSInteger count = [inputStream read:buffer maxLength:sizeof(buffer)];
+        if (count < 0) {
+            if (error) {
+                *error = MBSStreamIOError(@"Failed to read input stream", inputStream.streamError);
+            }
+            return NO;
+        }
+        if (count == 0) {
+            break;
+        }
+        [encryptedData appendBytes:buffer length:(NSUInteger)count];
+
+        if (encryptedData.length > kMBSCipherMaxFileSize + 1024) {
+            if (error) {
+                *error = [NSError errorWithDomain:MBSErrorDomain
+                                             code:MBSCipherErrorFileTooLarge
+                                         userInfo:@{NSLocalizedDescriptionKey:
+                                                        [NSString stringWithFormat:@"Single-shot input exceeds maximum allowed size of %lu bytes",
+                                                         (unsigned long)kMBSCipherMaxFileSize]}];
+            }
+            return NO;
+        }
+    }
+
+    NSData *decryptedData = [MBSCipher decryptData:encryptedData
+                                     withAlgorithm:algorithm
+                                        withFormat:@(format)
+                                           withKey:key
+                                             error:error];
+    if (!decryptedData) {
+        return NO;
+    }
+
+    if (!MBSStreamWriteFully(outputStream, decryptedData)) {
+        if (error) {
+            *error = MBSStreamIOError(@"Failed to write output stream", outputStream.streamError);
+        }
+        return NO;
+    }
+
+    return YES;
+}
+
+@end
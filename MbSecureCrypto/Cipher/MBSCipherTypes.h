@@ -42,6 +42,21 @@ typedef NS_ENUM(uint8_t, MBSCipherFormat) {
     MBSCipherFormatV1 = 1
 } API_AVAILABLE(macos(12.4), ios(15.6));
 
+/// Compression applied to the plaintext before it is sealed (V1 format only)
+///
+/// The codec is recorded in the authenticated V1 header, so decryption picks
+/// it up automatically.
+typedef NS_ENUM(uint8_t, MBSCompressionCodec) {
+    /// No compression
+    MBSCompressionCodecNone = 0,
+    /// LZ4 block format: fastest, moderate ratio
+    MBSCompressionCodecLZ4 = 1,
+    /// Raw DEFLATE (RFC 1951): widely interoperable
+    MBSCompressionCodecZlib = 2,
+    /// LZFSE: ratio close to zlib's highest levels at several times the speed
+    MBSCompressionCodecLZFSE = 3
+} API_AVAILABLE(macos(12.4), ios(15.6));
+
 NS_ASSUME_NONNULL_END
 
 #endif
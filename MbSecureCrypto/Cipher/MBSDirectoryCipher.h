@@ -0,0 +1,138 @@
+//
+//  MBSDirectoryCipher.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import <Foundation/Foundation.h>
+#import "MBSCipherTypes.h"
+#import "MBSError.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// File name of the encrypted manifest at the root of an encrypted directory
+FOUNDATION_EXPORT NSString *const kMBSDirectoryManifestName;
+
+/// Outcome of one ``MBSDirectoryCipher`` run
+API_AVAILABLE(macos(12.4), ios(15.6))
+@interface MBSDirectoryCipherReport : NSObject
+
+/// Regular files considered by the run
+@property (nonatomic, readonly) NSUInteger fileCount;
+
+/// Files skipped because their size and modification time matched the manifest
+@property (nonatomic, readonly) NSUInteger unchangedCount;
+
+/// Files whose content was hashed
+@property (nonatomic, readonly) NSUInteger hashedCount;
+
+/// Files encrypted into new objects, or restored by ``MBSDirectoryCipher/decryptDirectory:toDirectory:error:``
+@property (nonatomic, readonly) NSUInteger writtenCount;
+
+/// Manifest entries dropped because their source file no longer exists
+@property (nonatomic, readonly) NSUInteger removedCount;
+
+/// Bytes read for hashing
+@property (nonatomic, readonly) uint64_t bytesHashed;
+
+/// Plaintext bytes encrypted or restored
+@property (nonatomic, readonly) uint64_t bytesWritten;
+
+/// Per-file errors keyed by path relative to the directory root
+@property (nonatomic, readonly, copy) NSDictionary<NSString *, NSError *> *failures;
+
+/// Wall-clock duration of the run in seconds
+@property (nonatomic, readonly) NSTimeInterval elapsedTime;
+
+@end
+
+/// Incremental encryption of a directory tree.
+///
+/// The encrypted directory holds one chunked V1 object per source file and
+/// a manifest, itself sealed with AES-GCM, recording each file's size,
+/// modification time and SHA-256 next to the object that holds it:
+/// ```
+/// <destination>/manifest.secb
+/// <destination>/objects/<xx>/<random name>.secb
+/// ```
+///
+/// A run only reads files whose size or modification time differ from the
+/// manifest. Those candidates are hashed in parallel, and only files whose
+/// hash also changed are encrypted (through ``MBSBulkFileCipher``). The
+/// new manifest is written atomically before replaced objects are removed,
+/// so an interrupted run leaves the previous state readable.
+///
+/// Object names are random and carry no information about the source path
+/// or content. Objects and the manifest use keys derived from the
+/// directory key with HKDF.
+///
+/// ```objc
+/// MBSDirectoryCipher *cipher = [[MBSDirectoryCipher alloc] initWithKey:key];
+/// MBSDirectoryCipherReport *report = [cipher encryptDirectory:documentsURL
+///                                                 toDirectory:backupURL
+///                                                       error:&error];
+/// NSLog(@"%lu of %lu files changed", report.writtenCount, report.fileCount);
+/// ```
+///
+/// An instance runs one job at a time.
+API_AVAILABLE(macos(12.4), ios(15.6))
+@interface MBSDirectoryCipher : NSObject
+
+/// Number of files hashed and encrypted concurrently. Defaults to the active processor count.
+@property (nonatomic, assign) NSUInteger workerCount;
+
+/// Plaintext bytes per object chunk (4 KiB to 16 MiB). Defaults to `kMBSCipherStreamDefaultChunkSize`.
+///
+/// Only affects encryption: objects written with any chunk size can be restored.
+@property (nonatomic, assign) NSUInteger chunkSize;
+
+/// Objects and the manifest are flushed to stable storage before they are renamed into place. Defaults to NO.
+@property (nonatomic, assign) BOOL synchronizeWrites;
+
+/// @param key 32-byte directory key
+- (instancetype)initWithKey:(NSData *)key NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Brings an encrypted directory up to date with a source directory.
+///
+/// Regular files are included at any depth; symbolic links and other special
+/// files are skipped. A file that cannot be read keeps its previous object.
+///
+/// @param sourceURL Plaintext directory
+/// @param destinationURL Encrypted directory; created if needed
+/// @param error Error object populated when the run cannot proceed:
+///              - MBSCipherErrorInvalidKey (200): Invalid key size
+///              - MBSCipherErrorInvalidInput (202): Source is not a directory or is the destination, invalid chunk size,
+///                or malformed manifest
+///              - MBSCipherErrorAuthenticationFailed (212): Manifest does not match the key
+///              - MBSCipherErrorIOFailure (220): Manifest or objects could not be written
+///
+/// @return The report, or nil if the run could not proceed
+- (nullable MBSDirectoryCipherReport *)encryptDirectory:(NSURL *)sourceURL
+                                            toDirectory:(NSURL *)destinationURL
+                                                  error:(NSError **)error;
+
+/// Restores every file in an encrypted directory.
+///
+/// Each file is decrypted to a temporary file beside its destination and
+/// checked against the SHA-256 in the manifest before it is renamed into
+/// place. An object moved to another file's entry is reported with
+/// MBSCipherErrorAuthenticationFailed (212) and discarded, leaving any file
+/// already at the destination untouched.
+///
+/// @param sourceURL Encrypted directory
+/// @param destinationURL Where to restore the tree; created if needed
+/// @param error Error object populated when the run cannot proceed, with the codes of
+///              ``encryptDirectory:toDirectory:error:``, or MBSCipherErrorIOFailure (220)
+///              if there is no manifest
+///
+/// @return The report, or nil if the run could not proceed
+- (nullable MBSDirectoryCipherReport *)decryptDirectory:(NSURL *)sourceURL
+                                            toDirectory:(NSURL *)destinationURL
+                                                  error:(NSError **)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
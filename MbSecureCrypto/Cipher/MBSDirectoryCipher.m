@@ -0,0 +1,673 @@
+//
+//  MBSDirectoryCipher.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import "MBSDirectoryCipher.h"
+#import "MBSBulkFileCipher.h"
+#import "MBSCipher.h"
+#import "MBSCipherStream.h"
+#import "MBSChunkedCipher.h"
+#import "MBSFileUtilities.h"
+#import "MBSKeyDerivation.h"
+#import <CommonCrypto/CommonDigest.h>
+#import <errno.h>
+#import <fcntl.h>
+#import <sys/stat.h>
+#import <time.h>
+#import <unistd.h>
+
+NSString *const kMBSDirectoryManifestName = @"manifest.secb";
+
+static NSString *const kMBSDirectoryObjectsName = @"objects";
+static NSString *const kMBSDirectoryKeyDomain = @"MbSecureCrypto.directory";
+static const NSInteger kMBSManifestVersion = 1;
+static const size_t kMBSDirectoryHashBufferSize = 1024 * 1024;
+
+static uint64_t MBSDirectoryModificationTime(const struct stat *info) {
+    return (uint64_t)info->st_mtimespec.tv_sec * NSEC_PER_SEC + (uint64_t)info->st_mtimespec.tv_nsec;
+}
+
+/// SHA-256 of a file as lowercase hex, or nil with errno set
+static NSString *MBSDirectoryHashFile(const char *path, uint8_t *buffer, uint64_t *bytesRead) {
+    int fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        return nil;
+    }
+
+    CC_SHA256_CTX context;
+    CC_SHA256_Init(&context);
+    uint64_t total = 0;
+    while (YES) {
+        ssize_t count = read(fd, buffer, kMBSDirectoryHashBufferSize);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            int savedErrno = errno;
+            close(fd);
+            errno = savedErrno;
+            return nil;
+        }
+        if (count == 0) {
+            break;
+        }
+        CC_SHA256_Update(&context, buffer, (CC_LONG)count);
+        total += (uint64_t)count;
+    }
+    close(fd);
+
+    uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256_Final(digest, &context);
+    char hex[CC_SHA256_DIGEST_LENGTH * 2 + 1];
+    for (size_t i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) {
+        snprintf(hex + i * 2, 3, "%02x", digest[i]);
+    }
+    *bytesRead = total;
+    return [NSString stringWithUTF8String:hex];
+}
+
+/// A relative path that stays inside the directory it is resolved against
+static BOOL MBSDirectoryIsContainedPath(id path) {
+    if (![path isKindOfClass:[NSString class]] || [path length] == 0 || [path hasPrefix:@"/"]) {
+        return NO;
+    }
+    for (NSString *component in [path componentsSeparatedByString:@"/"]) {
+        if (component.length == 0 || [component isEqualToString:@"."] || [component isEqualToString:@".."]) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+#pragma mark - Report
+
+@interface MBSDirectoryCipherReport ()
+@property (nonatomic, readwrite) NSUInteger fileCount;
+@property (nonatomic, readwrite) NSUInteger unchangedCount;
+@property (nonatomic, readwrite) NSUInteger hashedCount;
+@property (nonatomic, readwrite) NSUInteger writtenCount;
+@property (nonatomic, readwrite) NSUInteger removedCount;
+@property (nonatomic, readwrite) uint64_t bytesHashed;
+@property (nonatomic, readwrite) uint64_t bytesWritten;
+@property (nonatomic, readwrite, copy) NSDictionary<NSString *, NSError *> *failures;
+@property (nonatomic, readwrite) NSTimeInterval elapsedTime;
+@end
+
+@implementation MBSDirectoryCipherReport
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %lu files, %lu unchanged, %lu hashed, %lu written, %lu removed, %lu failed>",
+            NSStringFromClass([self class]), (unsigned long)self.fileCount, (unsigned long)self.unchangedCount,
+            (unsigned long)self.hashedCount, (unsigned long)self.writtenCount, (unsigned long)self.removedCount,
+            (unsigned long)self.failures.count];
+}
+
+@end
+
+#pragma mark - Entry
+
+/// One file of the tree: what the manifest records, and what this run found
+@interface MBSDirectoryEntry : NSObject
+@property (nonatomic, copy) NSString *path;
+@property (nonatomic, assign) uint64_t size;
+@property (nonatomic, assign) uint64_t modificationTime;
+@property (nonatomic, copy, nullable) NSString *digest;
+@property (nonatomic, copy, nullable) NSString *object;
+@property (nonatomic, strong, nullable) NSError *error;
+/// Where a restored file waits, beside its destination, until its digest is checked
+@property (nonatomic, copy, nullable) NSString *stagingPath;
+@end
+
+@implementation MBSDirectoryEntry
+
++ (nullable instancetype)entryWithPath:(NSString *)path propertyList:(NSDictionary *)plist {
+    if (!MBSDirectoryIsContainedPath(path) || ![plist isKindOfClass:[NSDictionary class]] ||
+        ![plist[@"size"] isKindOfClass:[NSNumber class]] || ![plist[@"mtime"] isKindOfClass:[NSNumber class]] ||
+        ![plist[@"sha256"] isKindOfClass:[NSString class]] || !MBSDirectoryIsContainedPath(plist[@"object"])) {
+        return nil;
+    }
+
+    MBSDirectoryEntry *entry = [[MBSDirectoryEntry alloc] init];
+    entry.path = path;
+    entry.size = [plist[@"size"] unsignedLongLongValue];
+    entry.modificationTime = [plist[@"mtime"] unsignedLongLongValue];
+    entry.digest = plist[@"sha256"];
+    entry.object = plist[@"object"];
+    return entry;
+}
+
+- (NSDictionary *)propertyList {
+    return @{@"size": @(self.size),
+             @"mtime": @(self.modificationTime),
+             @"sha256": self.digest,
+             @"object": self.object};
+}
+
+@end
+
+#pragma mark - MBSDirectoryCipher
+
+@interface MBSDirectoryCipher ()
+@property (nonatomic, copy) NSData *key;
+@property (nonatomic, copy, nullable) NSData *manifestKey;
+@property (nonatomic, copy, nullable) NSData *contentKey;
+@property (nonatomic, assign) uint64_t startTime;
+@end
+
+@implementation MBSDirectoryCipher
+
+- (instancetype)initWithKey:(NSData *)key {
+    self = [super init];
+    if (self) {
+        _key = [key copy];
+        _workerCount = NSProcessInfo.processInfo.activeProcessorCount;
+        _chunkSize = kMBSCipherStreamDefaultChunkSize;
+    }
+    return self;
+}
+
+#pragma mark - Setup
+
+- (BOOL)prepareWithError:(NSError **)error {
+    if (self.key.length != 32) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidKey
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Key must be 32 bytes for AES-256"}];
+        }
+        return NO;
+    }
+
+    // Validates the chunk size before any file is touched
+    if (![MBSChunkedCipher encoderWithKey:self.key chunkSize:self.chunkSize error:error]) {
+        return NO;
+    }
+
+    self.manifestKey = [MBSKeyDerivation deriveKey:self.key domain:kMBSDirectoryKeyDomain context:@"manifest" error:error];
+    self.contentKey = [MBSKeyDerivation deriveKey:self.key domain:kMBSDirectoryKeyDomain context:@"content" error:error];
+    if (!self.manifestKey || !self.contentKey) {
+        return NO;
+    }
+
+    self.startTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+    return YES;
+}
+
+- (BOOL)isDirectory:(NSURL *)url {
+    BOOL isDirectory = NO;
+    return [[NSFileManager defaultManager] fileExistsAtPath:url.path isDirectory:&isDirectory] && isDirectory;
+}
+
+- (MBSBulkFileCipher *)bulkCipher {
+    MBSBulkFileCipher *cipher = [[MBSBulkFileCipher alloc] initWithKey:self.contentKey];
+    cipher.workerCount = self.workerCount;
+    cipher.chunkSize = self.chunkSize;
+    cipher.synchronizeWrites = self.synchronizeWrites;
+    return cipher;
+}
+
+#pragma mark - Manifest
+
+/// Reads the manifest; a missing manifest is an empty one unless `required`
+- (nullable NSMutableDictionary<NSString *, MBSDirectoryEntry *> *)loadManifestFromDirectory:(NSURL *)directoryURL
+                                                                                    required:(BOOL)required
+                                                                                       error:(NSError **)error {
+    NSURL *manifestURL = [directoryURL URLByAppendingPathComponent:kMBSDirectoryManifestName];
+    NSMutableDictionary<NSString *, MBSDirectoryEntry *> *entries = [NSMutableDictionary dictionary];
+    NSData *encrypted = [NSData dataWithContentsOfURL:manifestURL];
+    if (!encrypted) {
+        if (required || [[NSFileManager defaultManager] fileExistsAtPath:manifestURL.path]) {
+            if (error) {
+                *error = [NSError errorWithDomain:MBSErrorDomain
+                                             code:MBSCipherErrorIOFailure
+                                         userInfo:@{NSLocalizedDescriptionKey: @"Failed to read directory manifest"}];
+            }
+            return nil;
+        }
+        return entries;
+    }
+
+    NSData *data = [MBSCipher decryptData:encrypted
+                            withAlgorithm:MBSCipherAlgorithmAESGCM
+                               withFormat:@(MBSCipherFormatV1)
+                                  withKey:self.manifestKey
+                                    error:error];
+    if (!data) {
+        return nil;
+    }
+
+    NSDictionary *plist = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+    BOOL valid = [plist isKindOfClass:[NSDictionary class]] && [plist[@"version"] isEqual:@(kMBSManifestVersion)] &&
+                 [plist[@"entries"] isKindOfClass:[NSDictionary class]];
+    NSDictionary *list = valid ? plist[@"entries"] : nil;
+    for (NSString *path in list) {
+        MBSDirectoryEntry *entry = [MBSDirectoryEntry entryWithPath:path propertyList:list[path]];
+        if (!entry) {
+            valid = NO;
+            break;
+        }
+        entries[path] = entry;
+    }
+    if (!valid) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Directory manifest is malformed"}];
+        }
+        return nil;
+    }
+    return entries;
+}
+
+- (BOOL)saveManifest:(NSDictionary<NSString *, MBSDirectoryEntry *> *)entries
+         toDirectory:(NSURL *)directoryURL
+               error:(NSError **)error {
+    NSMutableDictionary *list = [NSMutableDictionary dictionaryWithCapacity:entries.count];
+    [entries enumerateKeysAndObjectsUsingBlock:^(NSString *path, MBSDirectoryEntry *entry, BOOL *stop) {
+        list[path] = [entry propertyList];
+    }];
+    NSData *data = [NSJSONSerialization dataWithJSONObject:@{@"version": @(kMBSManifestVersion), @"entries": list}
+                                                   options:0
+                                                     error:nil];
+    NSData *encrypted = [MBSCipher encryptData:data
+                                 withAlgorithm:MBSCipherAlgorithmAESGCM
+                                    withFormat:@(MBSCipherFormatV1)
+                                       withKey:self.manifestKey
+                                         error:error];
+    if (!encrypted) {
+        return NO;
+    }
+
+    // Written beside the manifest and renamed over it, so readers see the old or the new one
+    NSString *manifestPath = [directoryURL URLByAppendingPathComponent:kMBSDirectoryManifestName].path;
+    NSString *temporaryPath = nil;
+    int fd = MBSFileCreateTemporary(manifestPath, &temporaryPath);
+    BOOL written = fd >= 0 && MBSFileWriteFully(fd, encrypted.bytes, encrypted.length, 0);
+    if (fd >= 0 && !written) {
+        MBSFileDiscardTemporary(fd, temporaryPath);
+    } else if (written) {
+        written = MBSFileCommitTemporary(fd, temporaryPath, manifestPath, self.synchronizeWrites);
+    }
+    if (!written) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to write directory manifest", errno);
+        }
+        return NO;
+    }
+    return YES;
+}
+
+#pragma mark - Parallel Work
+
+/// Runs `block` for every entry on `workerCount` workers, each with its own read buffer
+- (void)performEntries:(NSArray<MBSDirectoryEntry *> *)entries
+                 block:(void (^)(MBSDirectoryEntry *entry, uint8_t *buffer))block {
+    if (entries.count == 0) {
+        return;
+    }
+
+    __block NSUInteger next = 0;
+    dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+    dispatch_apply(MIN(MAX(self.workerCount, (NSUInteger)1), entries.count), queue, ^(size_t worker) {
+        uint8_t *buffer = malloc(kMBSDirectoryHashBufferSize);
+        while (buffer) {
+            NSUInteger index;
+            @synchronized (entries) {
+                index = next++;
+            }
+            if (index >= entries.count) {
+                break;
+            }
+            @autoreleasepool {
+                block(entries[index], buffer);
+            }
+        }
+        if (!buffer) {
+            return;
+        }
+        memset_s(buffer, kMBSDirectoryHashBufferSize, 0, kMBSDirectoryHashBufferSize);
+        free(buffer);
+    });
+}
+
+/// Hashes every entry's file, recording the digest, or the error when the file cannot be read
+- (void)hashEntries:(NSArray<MBSDirectoryEntry *> *)entries
+        inDirectory:(NSString *)directory
+             report:(MBSDirectoryCipherReport *)report {
+    [self performEntries:entries block:^(MBSDirectoryEntry *entry, uint8_t *buffer) {
+        NSString *path = entry.stagingPath ?: [directory stringByAppendingPathComponent:entry.path];
+        uint64_t bytesRead = 0;
+        entry.digest = MBSDirectoryHashFile(path.fileSystemRepresentation, buffer, &bytesRead);
+        if (!entry.digest) {
+            entry.error = MBSPOSIXError(@"Failed to read file", errno);
+        }
+        @synchronized (report) {
+            report.hashedCount += entry.digest ? 1 : 0;
+            report.bytesHashed += bytesRead;
+        }
+    }];
+
+    // Entries left behind by a worker that could not allocate its buffer
+    for (MBSDirectoryEntry *entry in entries) {
+        if (!entry.digest && !entry.error) {
+            entry.error = MBSPOSIXError(@"Failed to allocate read buffer", ENOMEM);
+        }
+    }
+}
+
+- (MBSDirectoryCipherReport *)finishReport:(MBSDirectoryCipherReport *)report
+                                   entries:(NSArray<MBSDirectoryEntry *> *)entries {
+    NSMutableDictionary<NSString *, NSError *> *failures = [NSMutableDictionary dictionary];
+    for (MBSDirectoryEntry *entry in entries) {
+        if (entry.error) {
+            failures[entry.path] = entry.error;
+        }
+    }
+    report.failures = failures;
+    report.elapsedTime = (clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - self.startTime) / 1e9;
+    return report;
+}
+
+#pragma mark - Encryption
+
+- (nullable MBSDirectoryCipherReport *)encryptDirectory:(NSURL *)sourceURL
+                                            toDirectory:(NSURL *)destinationURL
+                                                  error:(NSError **)error {
+    if (![self prepareWithError:error]) {
+        return nil;
+    }
+    NSString *sourcePath = sourceURL.path.stringByStandardizingPath;
+    NSString *destinationPath = destinationURL.path.stringByStandardizingPath;
+    if (![self isDirectory:sourceURL] || [sourcePath isEqualToString:destinationPath]) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Source must be a directory other than the destination"}];
+        }
+        return nil;
+    }
+
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSURL *objectsURL = [destinationURL URLByAppendingPathComponent:kMBSDirectoryObjectsName];
+    NSError *createError = nil;
+    if (![fileManager createDirectoryAtURL:objectsURL withIntermediateDirectories:YES attributes:nil error:&createError]) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorIOFailure
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Failed to create destination directory",
+                                                NSUnderlyingErrorKey: createError}];
+        }
+        return nil;
+    }
+
+    NSMutableDictionary<NSString *, MBSDirectoryEntry *> *manifest = [self loadManifestFromDirectory:destinationURL
+                                                                                             required:NO
+                                                                                                error:error];
+    if (!manifest) {
+        return nil;
+    }
+
+    // Walk the tree. Files whose size and modification time match the manifest
+    // are taken as unchanged without being read.
+    NSString *sourcePrefix = [sourcePath stringByAppendingString:@"/"];
+    NSString *excludedPath = [destinationPath hasPrefix:sourcePrefix] ? [destinationPath substringFromIndex:sourcePrefix.length] : nil;
+
+    MBSDirectoryCipherReport *report = [[MBSDirectoryCipherReport alloc] init];
+    NSMutableDictionary<NSString *, MBSDirectoryEntry *> *updated = [NSMutableDictionary dictionary];
+    NSMutableArray<MBSDirectoryEntry *> *candidates = [NSMutableArray array];
+    NSDirectoryEnumerator<NSString *> *enumerator = [fileManager enumeratorAtPath:sourcePath];
+    for (NSString *path in enumerator) {
+        if (excludedPath && [path isEqualToString:excludedPath]) {
+            // The encrypted directory lives inside the source; never encrypt it into itself
+            [enumerator skipDescendants];
+            continue;
+        }
+
+        struct stat info;
+        NSString *fullPath = [sourcePath stringByAppendingPathComponent:path];
+        if (lstat(fullPath.fileSystemRepresentation, &info) != 0 || !S_ISREG(info.st_mode)) {
+            continue;
+        }
+
+        report.fileCount++;
+        MBSDirectoryEntry *previous = manifest[path];
+        uint64_t modificationTime = MBSDirectoryModificationTime(&info);
+        if (previous && previous.size == (uint64_t)info.st_size && previous.modificationTime == modificationTime &&
+            [fileManager fileExistsAtPath:[objectsURL URLByAppendingPathComponent:previous.object].path]) {
+            updated[path] = previous;
+            report.unchangedCount++;
+            continue;
+        }
+
+        MBSDirectoryEntry *candidate = [[MBSDirectoryEntry alloc] init];
+        candidate.path = path;
+        candidate.size = (uint64_t)info.st_size;
+        candidate.modificationTime = modificationTime;
+        [candidates addObject:candidate];
+    }
+
+    // Hash the candidates; a file whose content is unchanged only needs its metadata updated
+    [self hashEntries:candidates inDirectory:sourcePath report:report];
+
+    NSMutableArray<MBSDirectoryEntry *> *changed = [NSMutableArray array];
+    NSMutableArray<NSURL *> *sources = [NSMutableArray array];
+    NSMutableArray<NSURL *> *objects = [NSMutableArray array];
+    for (MBSDirectoryEntry *candidate in candidates) {
+        MBSDirectoryEntry *previous = manifest[candidate.path];
+        if (candidate.error) {
+            // Keep the last good copy of a file that cannot be read
+            if (previous) {
+                updated[candidate.path] = previous;
+            }
+            continue;
+        }
+        if (previous && [previous.digest isEqualToString:candidate.digest] &&
+            [fileManager fileExistsAtPath:[objectsURL URLByAppendingPathComponent:previous.object].path]) {
+            candidate.object = previous.object;
+            updated[candidate.path] = candidate;
+            continue;
+        }
+
+        NSString *name = NSUUID.UUID.UUIDString.lowercaseString;
+        NSString *shard = [name substringToIndex:2];
+        candidate.object = [NSString stringWithFormat:@"%@/%@.secb", shard, name];
+        NSURL *shardURL = [objectsURL URLByAppendingPathComponent:shard isDirectory:YES];
+        if (![fileManager createDirectoryAtURL:shardURL withIntermediateDirectories:YES attributes:nil error:&createError]) {
+            candidate.error = [NSError errorWithDomain:MBSErrorDomain
+                                                  code:MBSCipherErrorIOFailure
+                                              userInfo:@{NSLocalizedDescriptionKey: @"Failed to create object directory",
+                                                         NSUnderlyingErrorKey: createError}];
+            if (previous) {
+                updated[candidate.path] = previous;
+            }
+            continue;
+        }
+        [changed addObject:candidate];
+        [sources addObject:[NSURL fileURLWithPath:[sourcePath stringByAppendingPathComponent:candidate.path]]];
+        [objects addObject:[objectsURL URLByAppendingPathComponent:candidate.object]];
+    }
+
+    NSDictionary<NSURL *, NSError *> *failures = changed.count > 0 ? [[self bulkCipher] encryptFiles:sources
+                                                                                           toOutputs:objects
+                                                                                               error:error]
+                                                                   : @{};
+    if (!failures) {
+        return nil;
+    }
+
+    for (NSUInteger i = 0; i < changed.count; i++) {
+        MBSDirectoryEntry *entry = changed[i];
+        entry.error = failures[sources[i]];
+
+        // The digest must describe the bytes that were encrypted. A file
+        // written to while it was read is left for the next run.
+        struct stat info;
+        if (!entry.error && (lstat(sources[i].path.fileSystemRepresentation, &info) != 0 ||
+                             (uint64_t)info.st_size != entry.size ||
+                             MBSDirectoryModificationTime(&info) != entry.modificationTime)) {
+            entry.error = [NSError errorWithDomain:MBSErrorDomain
+                                              code:MBSCipherErrorIOFailure
+                                          userInfo:@{NSLocalizedDescriptionKey: @"File changed while it was being encrypted"}];
+        }
+        if (entry.error) {
+            unlink(objects[i].path.fileSystemRepresentation);
+            if (manifest[entry.path]) {
+                updated[entry.path] = manifest[entry.path];
+            }
+            continue;
+        }
+
+        updated[entry.path] = entry;
+        report.writtenCount++;
+        report.bytesWritten += entry.size;
+    }
+
+    for (NSString *path in manifest) {
+        if (!updated[path]) {
+            report.removedCount++;
+        }
+    }
+
+    if (![self saveManifest:updated toDirectory:destinationURL error:error]) {
+        for (NSUInteger i = 0; i < changed.count; i++) {
+            unlink(objects[i].path.fileSystemRepresentation);
+        }
+        return nil;
+    }
+
+    // Only now that the new manifest is in place can objects it no longer
+    // names be removed. This also collects leftovers of interrupted runs.
+    NSMutableSet<NSString *> *referenced = [NSMutableSet setWithCapacity:updated.count];
+    for (MBSDirectoryEntry *entry in updated.allValues) {
+        [referenced addObject:entry.object];
+    }
+    NSString *objectsPath = objectsURL.path;
+    for (NSString *object in [fileManager enumeratorAtPath:objectsPath]) {
+        struct stat info;
+        NSString *fullPath = [objectsPath stringByAppendingPathComponent:object];
+        if (lstat(fullPath.fileSystemRepresentation, &info) == 0 && S_ISREG(info.st_mode) && ![referenced containsObject:object]) {
+            unlink(fullPath.fileSystemRepresentation);
+        }
+    }
+
+    return [self finishReport:report entries:candidates];
+}
+
+#pragma mark - Decryption
+
+- (nullable MBSDirectoryCipherReport *)decryptDirectory:(NSURL *)sourceURL
+                                            toDirectory:(NSURL *)destinationURL
+                                                  error:(NSError **)error {
+    if (![self prepareWithError:error]) {
+        return nil;
+    }
+    if (![self isDirectory:sourceURL]) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Source is not a directory"}];
+        }
+        return nil;
+    }
+
+    NSDictionary<NSString *, MBSDirectoryEntry *> *manifest = [self loadManifestFromDirectory:sourceURL required:YES error:error];
+    if (!manifest) {
+        return nil;
+    }
+
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSURL *objectsURL = [sourceURL URLByAppendingPathComponent:kMBSDirectoryObjectsName];
+    MBSDirectoryCipherReport *report = [[MBSDirectoryCipherReport alloc] init];
+    NSMutableArray<MBSDirectoryEntry *> *entries = [NSMutableArray arrayWithCapacity:manifest.count];
+    NSMutableArray<MBSDirectoryEntry *> *pending = [NSMutableArray arrayWithCapacity:manifest.count];
+    NSMutableArray<NSURL *> *objects = [NSMutableArray arrayWithCapacity:manifest.count];
+    NSMutableArray<NSURL *> *outputs = [NSMutableArray arrayWithCapacity:manifest.count];
+    for (NSString *path in [manifest.allKeys sortedArrayUsingSelector:@selector(compare:)]) {
+        MBSDirectoryEntry *entry = manifest[path];
+        [entries addObject:entry];
+        report.fileCount++;
+
+        NSURL *outputURL = [destinationURL URLByAppendingPathComponent:path];
+        NSError *createError = nil;
+        if (![fileManager createDirectoryAtURL:outputURL.URLByDeletingLastPathComponent
+                   withIntermediateDirectories:YES
+                                    attributes:nil
+                                         error:&createError]) {
+            entry.error = [NSError errorWithDomain:MBSErrorDomain
+                                              code:MBSCipherErrorIOFailure
+                                          userInfo:@{NSLocalizedDescriptionKey: @"Failed to create output directory",
+                                                     NSUnderlyingErrorKey: createError}];
+            continue;
+        }
+
+        // Restored beside the destination and renamed over it only once it matches the manifest
+        NSString *stagingPath = nil;
+        int fd = MBSFileCreateTemporary(outputURL.path, &stagingPath);
+        if (fd < 0) {
+            entry.error = MBSPOSIXError(@"Failed to create output file", errno);
+            continue;
+        }
+        close(fd);
+        entry.stagingPath = stagingPath;
+        [pending addObject:entry];
+        [objects addObject:[objectsURL URLByAppendingPathComponent:entry.object]];
+        [outputs addObject:[NSURL fileURLWithPath:stagingPath]];
+    }
+
+    // Objects keep the chunk size they were written with; the bulk cipher streams any larger than its buffers
+    NSDictionary<NSURL *, NSError *> *failures = pending.count > 0 ? [[self bulkCipher] decryptFiles:objects
+                                                                                           toOutputs:outputs
+                                                                                               error:error]
+                                                                   : @{};
+    if (!failures) {
+        for (MBSDirectoryEntry *entry in pending) {
+            MBSFileDiscardTemporary(-1, entry.stagingPath);
+        }
+        return nil;
+    }
+
+    // Each object authenticates itself, but not which file it belongs to;
+    // the manifest digest ties the restored content to its path.
+    NSMutableArray<MBSDirectoryEntry *> *restored = [NSMutableArray arrayWithCapacity:pending.count];
+    NSMutableDictionary<NSString *, NSString *> *expected = [NSMutableDictionary dictionaryWithCapacity:pending.count];
+    for (NSUInteger i = 0; i < pending.count; i++) {
+        MBSDirectoryEntry *entry = pending[i];
+        entry.error = failures[objects[i]];
+        if (entry.error) {
+            MBSFileDiscardTemporary(-1, entry.stagingPath);
+            continue;
+        }
+        expected[entry.path] = entry.digest;
+        [restored addObject:entry];
+    }
+
+    NSString *destinationPath = destinationURL.path;
+    [self hashEntries:restored inDirectory:destinationPath report:report];
+    for (MBSDirectoryEntry *entry in restored) {
+        NSString *outputPath = [destinationPath stringByAppendingPathComponent:entry.path];
+        if (!entry.error && ![entry.digest isEqualToString:expected[entry.path]]) {
+            entry.error = [NSError errorWithDomain:MBSErrorDomain
+                                              code:MBSCipherErrorAuthenticationFailed
+                                          userInfo:@{NSLocalizedDescriptionKey: @"Restored file does not match the manifest"}];
+        }
+        if (entry.error) {
+            MBSFileDiscardTemporary(-1, entry.stagingPath);
+            continue;
+        }
+        // The bulk cipher has already flushed the staged file when asked to
+        if (!MBSFileCommitTemporary(-1, entry.stagingPath, outputPath, NO)) {
+            entry.error = MBSPOSIXError(@"Failed to move restored file into place", errno);
+            continue;
+        }
+        report.writtenCount++;
+        report.bytesWritten += entry.size;
+    }
+
+    return [self finishReport:report entries:entries];
+}
+
+@end
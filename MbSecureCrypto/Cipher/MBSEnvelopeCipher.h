@@ -0,0 +1,111 @@
+//
+//  MBSEnvelopeCipher.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import <Foundation/Foundation.h>
+#import "MBSCipherTypes.h"
+#import "MBSError.h"
+#import "MBSKeyProvider.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Default number of unwrapped data keys an MBSEnvelopeCipher keeps in memory
+FOUNDATION_EXPORT const NSUInteger kMBSEnvelopeDefaultCacheCapacity;
+
+/// Envelope encryption: each payload is sealed under its own random data key,
+/// and only that data key is encrypted under a key-encryption key (KEK).
+///
+/// The output is V1 "SECB" data whose header carries the wrapped data key and
+/// the identifier of the KEK in a key slot. Key slots are not part of the
+/// associated data, so rotating the KEK only rewrites the wrapped key in the
+/// header (see `rewrapData:error:`); the payload is never re-encrypted.
+///
+/// Unwrapped data keys are kept in a bounded least-recently-used cache, so
+/// repeated reads of the same object cost a single AES-GCM open. Cached keys
+/// are zeroed when they are evicted and no longer in use.
+///
+/// ```objc
+/// MBSFileKeyProvider *provider = [[MBSFileKeyProvider alloc] initWithDirectoryURL:keysURL
+///                                                            currentKeyIdentifier:@"kek-2026-10"];
+/// MBSEnvelopeCipher *cipher = [[MBSEnvelopeCipher alloc] initWithKeyProvider:provider];
+///
+/// NSData *encrypted = [cipher encryptData:data error:&error];
+/// NSData *decrypted = [cipher decryptData:encrypted error:&error];
+/// ```
+///
+/// Instances are safe to use from multiple threads.
+API_AVAILABLE(macos(12.4), ios(15.6))
+@interface MBSEnvelopeCipher : NSObject
+
+@property (nonatomic, readonly, strong) id<MBSKeyProvider> keyProvider;
+
+/// Maximum number of cached data keys; 0 disables the cache
+@property (nonatomic, readonly) NSUInteger dataKeyCacheCapacity;
+
+/// Creates a cipher with a cache of `kMBSEnvelopeDefaultCacheCapacity` data keys
+- (instancetype)initWithKeyProvider:(id<MBSKeyProvider>)keyProvider;
+
+- (instancetype)initWithKeyProvider:(id<MBSKeyProvider>)keyProvider
+               dataKeyCacheCapacity:(NSUInteger)capacity NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Encrypts data under a fresh data key wrapped with the provider's current KEK.
+///
+/// @param data Data to encrypt
+/// @param error Error object populated on failure with codes:
+///              - MBSCipherErrorInvalidInput (202): Invalid input data or KEK identifier
+///              - MBSCipherErrorEncryptionFailed (210): Encryption operation failed
+///              - Any error returned by the key provider
+///
+/// @return Envelope-encrypted V1 data, or nil if an error occurred
+- (nullable NSData *)encryptData:(NSData *)data error:(NSError **)error;
+
+/// Decrypts data produced by `encryptData:error:`.
+///
+/// @param data Envelope-encrypted V1 data
+/// @param error Error object populated on failure with codes:
+///              - MBSCipherErrorInvalidInput (202): Data too short or malformed header
+///              - MBSCipherErrorFormatDetectionFailed (205): Not V1 data
+///              - MBSCipherErrorFormatMismatch (206): V1 data without a wrapped data key
+///              - MBSCipherErrorAuthenticationFailed (212): Wrong KEK or modified data
+///              - Any error returned by the key provider
+///
+/// @return The decrypted data, or nil if an error occurred
+- (nullable NSData *)decryptData:(NSData *)data error:(NSError **)error;
+
+/// Re-wraps the data key under the provider's current KEK.
+///
+/// Only the header changes; the payload bytes are copied unmodified.
+///
+/// @return The data with its new header, or nil with the errors of `decryptData:error:`
+- (nullable NSData *)rewrapData:(NSData *)data error:(NSError **)error;
+
+/// Re-wraps the data key of an encrypted file under the provider's current KEK.
+///
+/// The new header and the existing payload are written to a temporary file,
+/// flushed, and renamed over the original, so an interrupted rotation leaves
+/// the old file intact rather than a torn header. The payload is copied, not
+/// re-encrypted.
+///
+/// @param fileURL Envelope-encrypted file
+/// @param error Error object populated on failure with the codes of
+///              `decryptData:error:`, plus MBSCipherErrorIOFailure (220) and
+///              MBSCipherErrorFilePermission (222)
+///
+/// @return YES if successful, NO if an error occurred
+- (BOOL)rewrapFile:(NSURL *)fileURL error:(NSError **)error;
+
+/// Identifier of the KEK that wraps the data key of envelope-encrypted data,
+/// read from the header without unwrapping anything.
++ (nullable NSString *)keyIdentifierForData:(NSData *)data error:(NSError **)error;
+
+/// Drops and zeroes every cached data key
+- (void)removeCachedDataKeys;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,344 @@
+//
+//  MBSEnvelopeCipher.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import "MBSEnvelopeCipher.h"
+#import "MBSDataKeyCache.h"
+#import "MBSFileUtilities.h"
+#import <Security/Security.h>
+#import <errno.h>
+#import <fcntl.h>
+#import <sys/stat.h>
+#import <unistd.h>
+
+// Handle both framework and static library imports
+#if __has_include(<MbSecureCrypto/MbSecureCrypto-Swift.h>)
+#import <MbSecureCrypto/MbSecureCrypto-Swift.h>
+#else
+#import "MbSecureCrypto-Swift.h"
+#endif
+
+const NSUInteger kMBSEnvelopeDefaultCacheCapacity = 1024;
+
+static const NSUInteger kMBSEnvelopeDataKeySize = 32;
+static const NSUInteger kMBSEnvelopeCopyBufferSize = 64 * 1024;
+
+@interface MBSEnvelopeCipher ()
+@property (nonatomic, strong) MBSDataKeyCache *cache;
+@end
+
+@implementation MBSEnvelopeCipher
+
+- (instancetype)initWithKeyProvider:(id<MBSKeyProvider>)keyProvider {
+    return [self initWithKeyProvider:keyProvider dataKeyCacheCapacity:kMBSEnvelopeDefaultCacheCapacity];
+}
+
+- (instancetype)initWithKeyProvider:(id<MBSKeyProvider>)keyProvider dataKeyCacheCapacity:(NSUInteger)capacity {
+    self = [super init];
+    if (self) {
+        _keyProvider = keyProvider;
+        _cache = [[MBSDataKeyCache alloc] initWithCapacity:capacity];
+    }
+    return self;
+}
+
+- (NSUInteger)dataKeyCacheCapacity {
+    return self.cache.capacity;
+}
+
+- (void)removeCachedDataKeys {
+    [self.cache removeAllDataKeys];
+}
+
+#pragma mark - Headers
+
+/// Parses the header of envelope-encrypted data, rejecting V1 data that has no wrapped key
++ (nullable MBSCipherHeader *)envelopeHeaderFromData:(NSData *)data error:(NSError **)error {
+    MBSCipherHeader *header = [MBSCipherHeader parseHeader:data error:error];
+    if (!header) {
+        return nil;
+    }
+
+    if (!header.wrappedKey) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorFormatMismatch
+                                     userInfo:@{NSLocalizedDescriptionKey: @"V1 data has no wrapped data key"}];
+        }
+        return nil;
+    }
+
+    // Envelopes are single-shot; streams and compression are not combined with key slots yet
+    if ([header extensionValue:MBSCipherHeader.extensionChunked] ||
+        [header extensionValue:MBSCipherHeader.extensionCompression]) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorUnsupportedFormat
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Unsupported extension in envelope header"}];
+        }
+        return nil;
+    }
+
+    return header;
+}
+
++ (nullable NSString *)keyIdentifierForData:(NSData *)data error:(NSError **)error {
+    return [self envelopeHeaderFromData:data error:error].wrappedKeyIdentifier;
+}
+
+#pragma mark - Data Keys
+
+- (nullable NSData *)dataKeyForHeader:(MBSCipherHeader *)header error:(NSError **)error {
+    NSString *keyIdentifier = header.wrappedKeyIdentifier;
+    NSData *wrappedKey = header.wrappedKey;
+
+    NSData *dataKey = [self.cache dataKeyForWrappedKey:wrappedKey keyIdentifier:keyIdentifier];
+    if (dataKey) {
+        return dataKey;
+    }
+
+    NSError *providerError = nil;
+    NSData *unwrapped = [self.keyProvider unwrapDataKey:wrappedKey withKeyIdentifier:keyIdentifier error:&providerError];
+    if (unwrapped.length != kMBSEnvelopeDataKeySize) {
+        if (error) {
+            *error = providerError ?: [NSError errorWithDomain:MBSErrorDomain
+                                                          code:MBSCipherErrorDecryptionFailed
+                                                      userInfo:@{NSLocalizedDescriptionKey: @"Key provider failed to unwrap the data key"}];
+        }
+        return nil;
+    }
+
+    return [self.cache cacheDataKey:unwrapped forWrappedKey:wrappedKey keyIdentifier:keyIdentifier];
+}
+
+/// Wraps `dataKey` under the provider's current KEK and stores it in `header`
+- (BOOL)wrapDataKey:(NSData *)dataKey intoHeader:(MBSCipherHeader *)header error:(NSError **)error {
+    NSString *keyIdentifier = self.keyProvider.currentKeyIdentifier;
+    NSError *providerError = nil;
+    NSData *wrappedKey = [self.keyProvider wrapDataKey:dataKey withKeyIdentifier:keyIdentifier error:&providerError];
+    if (!wrappedKey) {
+        if (error) {
+            *error = providerError ?: [NSError errorWithDomain:MBSErrorDomain
+                                                          code:MBSCipherErrorEncryptionFailed
+                                                      userInfo:@{NSLocalizedDescriptionKey: @"Key provider failed to wrap the data key"}];
+        }
+        return NO;
+    }
+
+    if (![header setWrappedKey:wrappedKey keyIdentifier:keyIdentifier]) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Key identifier must be 1 to 255 UTF-8 bytes"}];
+        }
+        return NO;
+    }
+    return YES;
+}
+
+#pragma mark - Encryption
+
+- (nullable NSData *)encryptData:(NSData *)data error:(NSError **)error {
+    if (!data) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Input data is nil"}];
+        }
+        return nil;
+    }
+
+    NSMutableData *dataKey = [NSMutableData dataWithLength:kMBSEnvelopeDataKeySize];
+    if (SecRandomCopyBytes(kSecRandomDefault, kMBSEnvelopeDataKeySize, dataKey.mutableBytes) != errSecSuccess) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorEncryptionFailed
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Failed to generate data key"}];
+        }
+        return nil;
+    }
+
+    NSData *result = nil;
+    MBSCipherHeader *header = [MBSCipherHeader randomHeader];
+    if ([self wrapDataKey:dataKey intoHeader:header error:error]) {
+        // Objects are often read back soon after they are written
+        NSData *cachedKey = [self.cache cacheDataKey:dataKey
+                                       forWrappedKey:header.wrappedKey
+                                       keyIdentifier:header.wrappedKeyIdentifier];
+        NSData *sealed = [MBSCipherBridge sealChunk:data
+                                                key:cachedKey
+                                              nonce:header.nonce
+                                     authenticating:[header authenticatedData]
+                                              error:error];
+        if (sealed) {
+            NSMutableData *output = [NSMutableData dataWithData:[header encoded]];
+            [output appendData:sealed];
+            result = output;
+        }
+    }
+
+    memset_s(dataKey.mutableBytes, dataKey.length, 0, dataKey.length);
+    return result;
+}
+
+- (nullable NSData *)decryptData:(NSData *)data error:(NSError **)error {
+    MBSCipherHeader *header = [MBSEnvelopeCipher envelopeHeaderFromData:data error:error];
+    if (!header) {
+        return nil;
+    }
+
+    NSUInteger headerLength = (NSUInteger)header.encodedLength;
+    if (data.length < headerLength + (NSUInteger)MBSCipherHeader.tagSize) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Envelope data too short"}];
+        }
+        return nil;
+    }
+
+    NSData *dataKey = [self dataKeyForHeader:header error:error];
+    if (!dataKey) {
+        return nil;
+    }
+
+    NSData *sealed = [data subdataWithRange:NSMakeRange(headerLength, data.length - headerLength)];
+    return [MBSCipherBridge openChunk:sealed
+                                  key:dataKey
+                                nonce:header.nonce
+                       authenticating:[header authenticatedData]
+                                error:error];
+}
+
+#pragma mark - Rewrapping
+
+/// Header re-wrapped under the current KEK; the associated data is unchanged
+- (nullable MBSCipherHeader *)rewrappedHeader:(MBSCipherHeader *)header error:(NSError **)error {
+    NSData *dataKey = [self dataKeyForHeader:header error:error];
+    if (!dataKey || ![self wrapDataKey:dataKey intoHeader:header error:error]) {
+        return nil;
+    }
+    [self.cache cacheDataKey:dataKey forWrappedKey:header.wrappedKey keyIdentifier:header.wrappedKeyIdentifier];
+    return header;
+}
+
+- (nullable NSData *)rewrapData:(NSData *)data error:(NSError **)error {
+    MBSCipherHeader *header = [MBSEnvelopeCipher envelopeHeaderFromData:data error:error];
+    if (!header) {
+        return nil;
+    }
+
+    NSUInteger oldLength = (NSUInteger)header.encodedLength;
+    if (![self rewrappedHeader:header error:error]) {
+        return nil;
+    }
+
+    NSMutableData *output = [NSMutableData dataWithData:[header encoded]];
+    [output appendData:[data subdataWithRange:NSMakeRange(oldLength, data.length - oldLength)]];
+    return output;
+}
+
+- (BOOL)rewrapFile:(NSURL *)fileURL error:(NSError **)error {
+    int fd = open(fileURL.fileSystemRepresentation, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to open file", errno);
+        }
+        return NO;
+    }
+
+    // Fixed header first, then the parameter block it announces
+    uint8_t fixed[8];
+    NSMutableData *headerData = nil;
+    if (MBSFileReadFully(fd, fixed, sizeof(fixed), 0)) {
+        size_t length = sizeof(fixed) + (((size_t)fixed[6] << 8) | fixed[7]);
+        headerData = [NSMutableData dataWithLength:length];
+        if (!MBSFileReadFully(fd, headerData.mutableBytes, length, 0)) {
+            headerData = nil;
+        }
+    }
+    if (!headerData) {
+        close(fd);
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"File too short for a V1 header"}];
+        }
+        return NO;
+    }
+
+    MBSCipherHeader *header = [MBSEnvelopeCipher envelopeHeaderFromData:headerData error:error];
+    if (!header || ![self rewrappedHeader:header error:error]) {
+        close(fd);
+        return NO;
+    }
+
+    // Never overwritten in place: a torn header write would lose the only wrapped data key
+    NSData *encoded = [header encoded];
+    BOOL success = [self copyPayloadOfDescriptor:fd
+                                      fromOffset:(off_t)headerData.length
+                                      withHeader:encoded
+                                           toURL:fileURL
+                                           error:error];
+    close(fd);
+    return success;
+}
+
+/// Writes `header` plus everything after `offset` to a temporary file and renames it over `fileURL`
+- (BOOL)copyPayloadOfDescriptor:(int)fd
+                     fromOffset:(off_t)offset
+                     withHeader:(NSData *)header
+                          toURL:(NSURL *)fileURL
+                          error:(NSError **)error {
+    NSString *temporaryPath = nil;
+    int output = MBSFileCreateTemporary(fileURL.path, &temporaryPath);
+    if (output < 0) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to create temporary file", errno);
+        }
+        return NO;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) == 0) {
+        fchmod(output, status.st_mode & 07777);
+    }
+
+    BOOL success = MBSFileWriteFully(output, header.bytes, header.length, 0);
+    off_t written = (off_t)header.length;
+    uint8_t *buffer = malloc(kMBSEnvelopeCopyBufferSize);
+    while (success && buffer) {
+        ssize_t count = pread(fd, buffer, kMBSEnvelopeCopyBufferSize, offset);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            success = (count == 0);
+            break;
+        }
+        success = MBSFileWriteFully(output, buffer, (size_t)count, written);
+        offset += count;
+        written += count;
+    }
+    if (!buffer) {
+        errno = ENOMEM;
+        success = NO;
+    }
+    free(buffer);
+
+    if (success) {
+        success = MBSFileCommitTemporary(output, temporaryPath, fileURL.path, YES);
+    } else {
+        MBSFileDiscardTemporary(output, temporaryPath);
+    }
+    if (!success && error) {
+        *error = MBSPOSIXError(@"Failed to rewrite file", errno);
+    }
+    return success;
+}
+
+@end
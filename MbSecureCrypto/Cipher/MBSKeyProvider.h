@@ -0,0 +1,91 @@
+//
+//  MBSKeyProvider.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import <Foundation/Foundation.h>
+#import "MBSError.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Source of key-encryption keys (KEKs) for ``MBSEnvelopeCipher``.
+///
+/// A provider wraps and unwraps data keys on behalf of the cipher, so the KEK
+/// itself never has to leave the provider: a KMS or HSM client can implement
+/// this protocol by forwarding both calls. Each KEK is named by an identifier
+/// of 1 to 255 UTF-8 bytes that is stored in the ciphertext header.
+///
+/// Implementations must be safe to call from multiple threads.
+API_AVAILABLE(macos(12.4), ios(15.6))
+@protocol MBSKeyProvider <NSObject>
+
+/// Identifier of the KEK that wraps newly generated data keys
+@property (nonatomic, readonly, copy) NSString *currentKeyIdentifier;
+
+/// Wraps a data key under the named KEK.
+///
+/// @return The wrapped key, or nil with an MBSCipherError on failure
+- (nullable NSData *)wrapDataKey:(NSData *)dataKey
+               withKeyIdentifier:(NSString *)keyIdentifier
+                           error:(NSError **)error;
+
+/// Unwraps a data key previously returned by `wrapDataKey:withKeyIdentifier:error:`.
+///
+/// @return The data key, or nil with an MBSCipherError on failure. A wrong KEK or
+///         modified wrapped key should fail with MBSCipherErrorAuthenticationFailed (212).
+- (nullable NSData *)unwrapDataKey:(NSData *)wrappedKey
+                 withKeyIdentifier:(NSString *)keyIdentifier
+                             error:(NSError **)error;
+
+@end
+
+/// Local key provider that keeps one 32-byte KEK per file in a directory.
+///
+/// The KEK named `identifier` is read from `<directory>/<identifier>.key`,
+/// which holds the raw key bytes or their hex encoding (the output of
+/// `mbscrypt keygen`). Data keys are wrapped with AES Key Wrap (RFC 3394).
+/// Keys are loaded on first use and kept in memory for the provider's lifetime.
+///
+/// Identifiers may contain letters, digits, `.`, `_` and `-`, and must not start with `.`.
+///
+/// Intended for development, tests and single-host deployments; production
+/// KEKs normally live in a KMS or HSM behind a custom ``MBSKeyProvider``.
+API_AVAILABLE(macos(12.4), ios(15.6))
+@interface MBSFileKeyProvider : NSObject <MBSKeyProvider>
+
+@property (nonatomic, readonly, copy) NSURL *directoryURL;
+
+/// Identifier of the KEK used for new data keys; set it to rotate
+@property (nonatomic, copy) NSString *currentKeyIdentifier;
+
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL
+                currentKeyIdentifier:(NSString *)keyIdentifier NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Reads a key file in the format this provider uses.
+///
+/// Exactly 64 hex characters, ignoring surrounding whitespace, are decoded to
+/// 32 bytes; any other contents are returned as raw key bytes. Callers check
+/// the length they need.
+///
+/// @param error MBSCipherErrorIOFailure (220) if the file could not be read
+///
+/// @return The key bytes, or nil if the file could not be read
++ (nullable NSData *)keyFromFileAtURL:(NSURL *)fileURL error:(NSError **)error;
+
+/// Creates a new random KEK file readable only by the owner.
+///
+/// @param keyIdentifier Name for the new key; must not already exist
+/// @param error Error object populated on failure with codes:
+///              - MBSCipherErrorInvalidInput (202): Invalid identifier
+///              - MBSCipherErrorIOFailure (220): The key file exists or could not be written
+///
+/// @return YES if the key was created
+- (BOOL)generateKeyWithIdentifier:(NSString *)keyIdentifier error:(NSError **)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
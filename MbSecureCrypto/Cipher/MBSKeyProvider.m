@@ -0,0 +1,207 @@
+//
+//  MBSKeyProvider.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import "MBSKeyProvider.h"
+#import "MBSRandom.h"
+#import <fcntl.h>
+#import <unistd.h>
+
+// Handle both framework and static library imports
+#if __has_include(<MbSecureCrypto/MbSecureCrypto-Swift.h>)
+#import <MbSecureCrypto/MbSecureCrypto-Swift.h>
+#else
+#import "MbSecureCrypto-Swift.h"
+#endif
+
+static const NSUInteger kMBSKeyEncryptionKeySize = 32;
+static const NSUInteger kMBSKeyIdentifierMaxLength = 255;
+
+@interface MBSFileKeyProvider ()
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSData *> *keys;
+@end
+
+@implementation MBSFileKeyProvider {
+    NSString *_currentKeyIdentifier;
+}
+
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL currentKeyIdentifier:(NSString *)keyIdentifier {
+    self = [super init];
+    if (self) {
+        _directoryURL = [directoryURL copy];
+        _currentKeyIdentifier = [keyIdentifier copy];
+        _keys = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (NSString *)currentKeyIdentifier {
+    @synchronized (self) {
+        return _currentKeyIdentifier;
+    }
+}
+
+- (void)setCurrentKeyIdentifier:(NSString *)currentKeyIdentifier {
+    @synchronized (self) {
+        _currentKeyIdentifier = [currentKeyIdentifier copy];
+    }
+}
+
+#pragma mark - Key Files
+
++ (BOOL)isValidIdentifier:(NSString *)keyIdentifier {
+    NSUInteger length = [keyIdentifier lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    if (length == 0 || length > kMBSKeyIdentifierMaxLength || [keyIdentifier hasPrefix:@"."]) {
+        return NO;
+    }
+
+    NSCharacterSet *allowed = [NSCharacterSet characterSetWithCharactersInString:
+                               @"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789._-"];
+    return [keyIdentifier rangeOfCharacterFromSet:allowed.invertedSet].location == NSNotFound;
+}
+
+/// Key file contents as raw bytes, or decoded when they are hex text
++ (NSData *)keyFromFileContents:(NSData *)contents {
+    NSString *text = [[NSString alloc] initWithData:contents encoding:NSASCIIStringEncoding];
+    text = [text stringByTrimmingCharactersInSet:NSCharacterSet.whitespaceAndNewlineCharacterSet];
+    NSCharacterSet *nonHex = [[NSCharacterSet characterSetWithCharactersInString:@"0123456789abcdefABCDEF"] invertedSet];
+    if (text.length != kMBSKeyEncryptionKeySize * 2 || [text rangeOfCharacterFromSet:nonHex].location != NSNotFound) {
+        return contents;
+    }
+
+    NSMutableData *decoded = [NSMutableData dataWithCapacity:kMBSKeyEncryptionKeySize];
+    for (NSUInteger i = 0; i < text.length; i += 2) {
+        unsigned int byte = 0;
+        [[NSScanner scannerWithString:[text substringWithRange:NSMakeRange(i, 2)]] scanHexInt:&byte];
+        uint8_t value = (uint8_t)byte;
+        [decoded appendBytes:&value length:1];
+    }
+    return decoded;
+}
+
++ (nullable NSData *)keyFromFileAtURL:(NSURL *)fileURL error:(NSError **)error {
+    NSError *readError = nil;
+    NSData *contents = [NSData dataWithContentsOfURL:fileURL options:0 error:&readError];
+    if (!contents) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorIOFailure
+                                     userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:
+                                                    @"Failed to read key file %@", fileURL.path],
+                                                NSUnderlyingErrorKey: readError}];
+        }
+        return nil;
+    }
+    return [self keyFromFileContents:contents];
+}
+
+- (NSURL *)fileURLForIdentifier:(NSString *)keyIdentifier {
+    return [self.directoryURL URLByAppendingPathComponent:[keyIdentifier stringByAppendingPathExtension:@"key"]];
+}
+
+- (nullable NSData *)keyForIdentifier:(NSString *)keyIdentifier error:(NSError **)error {
+    if (![MBSFileKeyProvider isValidIdentifier:keyIdentifier]) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Invalid key identifier"}];
+        }
+        return nil;
+    }
+
+    @synchronized (self.keys) {
+        NSData *key = self.keys[keyIdentifier];
+        if (key) {
+            return key;
+        }
+
+        NSError *readError = nil;
+        key = [MBSFileKeyProvider keyFromFileAtURL:[self fileURLForIdentifier:keyIdentifier] error:&readError];
+        if (key.length != kMBSKeyEncryptionKeySize) {
+            if (error) {
+                NSMutableDictionary *userInfo = [NSMutableDictionary dictionary];
+                userInfo[NSLocalizedDescriptionKey] = [NSString stringWithFormat:
+                                                       @"No 32-byte key-encryption key named '%@'", keyIdentifier];
+                userInfo[NSUnderlyingErrorKey] = readError;
+                *error = [NSError errorWithDomain:MBSErrorDomain
+                                             code:MBSCipherErrorInvalidKey
+                                         userInfo:userInfo];
+            }
+            return nil;
+        }
+
+        self.keys[keyIdentifier] = key;
+        return key;
+    }
+}
+
+- (BOOL)generateKeyWithIdentifier:(NSString *)keyIdentifier error:(NSError **)error {
+    if (![MBSFileKeyProvider isValidIdentifier:keyIdentifier]) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Invalid key identifier"}];
+        }
+        return NO;
+    }
+
+    NSString *hex = [MBSRandom generateBytesAsHex:kMBSKeyEncryptionKeySize error:error];
+    if (!hex) {
+        return NO;
+    }
+    NSData *contents = [[hex stringByAppendingString:@"\n"] dataUsingEncoding:NSASCIIStringEncoding];
+
+    // O_EXCL so an existing KEK is never overwritten
+    const char *path = [self fileURLForIdentifier:keyIdentifier].fileSystemRepresentation;
+    int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    BOOL written = fd >= 0 && write(fd, contents.bytes, contents.length) == (ssize_t)contents.length;
+    int errorCode = errno;
+    if (fd >= 0) {
+        written = (close(fd) == 0) && written;
+        if (!written) {
+            unlink(path);
+        }
+    }
+
+    if (!written) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorIOFailure
+                                     userInfo:@{NSLocalizedDescriptionKey:
+                                                    [NSString stringWithFormat:@"Failed to create key file for '%@'", keyIdentifier],
+                                                NSUnderlyingErrorKey: [NSError errorWithDomain:NSPOSIXErrorDomain
+                                                                                          code:errorCode
+                                                                                      userInfo:nil]}];
+        }
+        return NO;
+    }
+    return YES;
+}
+
+#pragma mark - MBSKeyProvider
+
+- (nullable NSData *)wrapDataKey:(NSData *)dataKey
+               withKeyIdentifier:(NSString *)keyIdentifier
+                           error:(NSError **)error {
+    NSData *key = [self keyForIdentifier:keyIdentifier error:error];
+    if (!key) {
+        return nil;
+    }
+    return [MBSCipherBridge wrapKey:dataKey keyEncryptionKey:key error:error];
+}
+
+- (nullable NSData *)unwrapDataKey:(NSData *)wrappedKey
+                 withKeyIdentifier:(NSString *)keyIdentifier
+                             error:(NSError **)error {
+    NSData *key = [self keyForIdentifier:keyIdentifier error:error];
+    if (!key) {
+        return nil;
+    }
+    return [MBSCipherBridge unwrapKey:wrappedKey keyEncryptionKey:key error:error];
+}
+
+@end
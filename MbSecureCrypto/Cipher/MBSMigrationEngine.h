@@ -0,0 +1,157 @@
+//
+//  MBSMigrationEngine.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import <Foundation/Foundation.h>
+#import "MBSCipherTypes.h"
+#import "MBSError.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Default number of blobs processed between checkpoints
+FOUNDATION_EXPORT const NSUInteger kMBSMigrationDefaultBatchSize;
+
+/// Set in a packed store entry's length field when the blob could not be migrated.
+/// The entry's payload is zero filled; the original blob is the entry at the
+/// same index in the source store.
+FOUNDATION_EXPORT const uint64_t kMBSPackedStoreFailedEntryFlag;
+
+/// Outcome of a migration run, also delivered after every batch
+API_AVAILABLE(macos(12.4), ios(15.6))
+@interface MBSMigrationReport : NSObject
+
+/// Number of blobs in the job
+@property (nonatomic, readonly) uint64_t totalCount;
+
+/// Blobs below this index are done, including those finished by earlier runs
+@property (nonatomic, readonly) uint64_t completedCount;
+
+/// Blobs migrated successfully, including earlier runs
+@property (nonatomic, readonly) uint64_t migratedCount;
+
+/// Blobs that failed, including earlier runs
+@property (nonatomic, readonly) uint64_t failedCount;
+
+/// Failure counts keyed by `MBSCipherError` code, including earlier runs
+@property (nonatomic, readonly, copy) NSDictionary<NSNumber *, NSNumber *> *failureCounts;
+
+/// Errors of this run keyed by blob index, limited to the first 1000
+@property (nonatomic, readonly, copy) NSDictionary<NSNumber *, NSError *> *failures;
+
+/// Source bytes read by this run
+@property (nonatomic, readonly) uint64_t bytesRead;
+
+/// Destination bytes written by this run
+@property (nonatomic, readonly) uint64_t bytesWritten;
+
+/// Wall-clock duration of this run in seconds
+@property (nonatomic, readonly) NSTimeInterval elapsedTime;
+
+/// Source bytes per second for this run
+@property (nonatomic, readonly) double throughput;
+
+/// YES once every blob has been attempted
+@property (nonatomic, readonly, getter=isFinished) BOOL finished;
+
+@end
+
+/// Moves legacy blobs to the chunked V1 format, optionally under a new key.
+///
+/// Sources may be V0 (`[nonce][ciphertext][tag]`) or single-shot V1 blobs.
+/// Each blob is streamed: ciphertext is read one chunk at a time into a pooled
+/// scratch buffer, decrypted with AES-CTR next to it while GHASH runs over the
+/// ciphertext, and resealed as a chunked V1 record. Plaintext never leaves
+/// the scratch buffers, which are zeroed when they are returned. The source
+/// tag is checked once the last chunk has been read; output produced from a
+/// blob that fails it is discarded (files) or zeroed (packed stores).
+///
+/// Blobs are processed in batches of `batchSize`, spread over `workerCount`
+/// workers. After each batch the engine writes a checkpoint (when
+/// `checkpointURL` is set) recording the watermark below which every blob is
+/// done; running the same job again resumes from it. A checkpoint is bound to
+/// the ordered source and destination paths and to both keys, so any other
+/// job rejects it.
+///
+/// Packed stores are files of length-prefixed blobs:
+/// ```
+/// ENTRY = [LENGTH(8, big endian)][BLOB(LENGTH)]
+/// ```
+/// The destination store has one entry per source entry, in the same order.
+///
+/// ```objc
+/// MBSMigrationEngine *engine = [[MBSMigrationEngine alloc] initWithSourceKey:oldKey destinationKey:newKey];
+/// engine.checkpointURL = checkpointURL;
+/// engine.progressHandler = ^(MBSMigrationReport *report) {
+///     NSLog(@"%llu / %llu, %.0f MB/s", report.completedCount, report.totalCount, report.throughput / 1e6);
+/// };
+///
+/// MBSMigrationReport *report = [engine migratePackedStore:legacyURL toPackedStore:migratedURL error:&error];
+/// ```
+///
+/// An instance runs one job at a time.
+API_AVAILABLE(macos(12.4), ios(15.6))
+@interface MBSMigrationEngine : NSObject
+
+/// Number of blobs migrated concurrently. Defaults to the active processor count.
+@property (nonatomic, assign) NSUInteger workerCount;
+
+/// Plaintext bytes per output chunk (4 KiB to 16 MiB). Defaults to `kMBSCipherStreamDefaultChunkSize`.
+@property (nonatomic, assign) NSUInteger chunkSize;
+
+/// Blobs per batch, and so between checkpoints. Defaults to `kMBSMigrationDefaultBatchSize`.
+@property (nonatomic, assign) NSUInteger batchSize;
+
+/// Where the resume watermark is kept; nil disables checkpointing
+@property (nonatomic, strong, nullable) NSURL *checkpointURL;
+
+/// Outputs are flushed to stable storage before each checkpoint. Defaults to NO.
+@property (nonatomic, assign) BOOL synchronizeWrites;
+
+/// Called on the migrating thread after every batch
+@property (nonatomic, copy, nullable) void (^progressHandler)(MBSMigrationReport *report);
+
+/// @param sourceKey 32-byte key the legacy blobs are encrypted with
+/// @param destinationKey 32-byte key for the V1 output; may equal `sourceKey`
+- (instancetype)initWithSourceKey:(NSData *)sourceKey
+                   destinationKey:(NSData *)destinationKey NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Migrates each source file to the destination at the same index.
+///
+/// Every output is written to a temporary file and renamed into place, so
+/// a destination is either complete or untouched.
+///
+/// @param error Error object populated when the job cannot run:
+///              - MBSCipherErrorInvalidKey (200): Invalid key size
+///              - MBSCipherErrorInvalidInput (202): Mismatched URL lists, invalid chunk size,
+///                or a checkpoint that belongs to different files, keys or chunk size
+///              - MBSCipherErrorIOFailure (220): Checkpoint could not be written
+///
+/// @return The report, or nil if the job could not run. Per-blob failures are
+///         listed in the report, not returned as errors.
+- (nullable MBSMigrationReport *)migrateFiles:(NSArray<NSURL *> *)sourceURLs
+                                    toOutputs:(NSArray<NSURL *> *)destinationURLs
+                                        error:(NSError **)error;
+
+/// Migrates a packed store entry by entry into a new packed store.
+///
+/// @param error Error object populated when the job cannot run, with the codes of
+///              ``migrateFiles:toOutputs:error:``, plus:
+///              - MBSCipherErrorInvalidInput (202): An entry runs past the end of the store
+///              - MBSCipherErrorIOFailure (220) / MBSCipherErrorFilePermission (222): A store could not be opened
+///
+/// @return The report, or nil if the job could not run
+- (nullable MBSMigrationReport *)migratePackedStore:(NSURL *)sourceURL
+                                      toPackedStore:(NSURL *)destinationURL
+                                              error:(NSError **)error;
+
+/// Stops the running job after the current batch and its checkpoint
+- (void)cancel;
+
+@end
+
+NS_ASSUME_NONNULL_END
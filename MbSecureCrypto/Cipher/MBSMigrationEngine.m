@@ -0,0 +1,819 @@
+//
+//  MBSMigrationEngine.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import "MBSMigrationEngine.h"
+#import "MBSCipherStream.h"
+#import "MBSChunkedCipher.h"
+#import "MBSBufferPool.h"
+#import "MBSFileUtilities.h"
+#import "MBSGCMDecryptor.h"
+#import <CommonCrypto/CommonHMAC.h>
+#import <errno.h>
+#import <fcntl.h>
+#import <sys/stat.h>
+#import <time.h>
+#import <unistd.h>
+
+// Handle both framework and static library imports
+#if __has_include(<MbSecureCrypto/MbSecureCrypto-Swift.h>)
+#import <MbSecureCrypto/MbSecureCrypto-Swift.h>
+#else
+#import "MbSecureCrypto-Swift.h"
+#endif
+
+const NSUInteger kMBSMigrationDefaultBatchSize = 1024;
+const uint64_t kMBSPackedStoreFailedEntryFlag = 1ULL << 63;
+
+static const NSUInteger kMBSMigrationMaxRecordedFailures = 1000;
+static const NSUInteger kMBSPackedEntryHeaderSize = 8;
+static const NSUInteger kMBSV0NonceSize = 12;
+static const NSInteger kMBSCheckpointVersion = 1;
+
+#pragma mark - Report
+
+@interface MBSMigrationReport ()
+@property (nonatomic, readwrite) uint64_t totalCount;
+@property (nonatomic, readwrite) uint64_t completedCount;
+@property (nonatomic, readwrite) uint64_t migratedCount;
+@property (nonatomic, readwrite) uint64_t failedCount;
+@property (nonatomic, readwrite, copy) NSDictionary<NSNumber *, NSNumber *> *failureCounts;
+@property (nonatomic, readwrite, copy) NSDictionary<NSNumber *, NSError *> *failures;
+@property (nonatomic, readwrite) uint64_t bytesRead;
+@property (nonatomic, readwrite) uint64_t bytesWritten;
+@property (nonatomic, readwrite) NSTimeInterval elapsedTime;
+@property (nonatomic, readwrite, getter=isFinished) BOOL finished;
+@end
+
+@implementation MBSMigrationReport
+
+- (double)throughput {
+    return self.elapsedTime > 0 ? self.bytesRead / self.elapsedTime : 0;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %llu/%llu done, %llu migrated, %llu failed %@, %.1f MB/s>",
+            NSStringFromClass([self class]), self.completedCount, self.totalCount, self.migratedCount,
+            self.failedCount, self.failureCounts, self.throughput / 1e6];
+}
+
+@end
+
+#pragma mark - Blob
+
+/// Where one blob lives in its source and where its V1 output goes
+@interface MBSMigrationBlob : NSObject
+@property (nonatomic, assign) uint64_t index;
+@property (nonatomic, strong, nullable) NSURL *sourceURL;
+@property (nonatomic, strong, nullable) NSURL *destinationURL;
+@property (nonatomic, assign) off_t sourceOffset;
+@property (nonatomic, assign) uint64_t sourceLength;
+@property (nonatomic, assign) off_t payloadOffset;
+@property (nonatomic, assign) uint64_t plaintextLength;
+@property (nonatomic, copy, nullable) NSData *nonce;
+@property (nonatomic, copy, nullable) NSData *associatedData;
+@property (nonatomic, assign) off_t destinationOffset;
+@property (nonatomic, assign) uint64_t outputLength;
+@property (nonatomic, strong, nullable) NSError *error;
+@end
+
+@implementation MBSMigrationBlob
+@end
+
+#pragma mark - Checkpoint
+
+/// Progress that survives between runs
+@interface MBSMigrationState : NSObject
+@property (nonatomic, copy) NSDictionary<NSString *, id> *job;
+@property (nonatomic, assign) uint64_t watermark;
+@property (nonatomic, assign) uint64_t sourceOffset;
+@property (nonatomic, assign) uint64_t destinationOffset;
+@property (nonatomic, assign) uint64_t migratedCount;
+@property (nonatomic, assign) uint64_t failedCount;
+@property (nonatomic, strong) NSMutableDictionary<NSNumber *, NSNumber *> *failureCounts;
+@end
+
+@implementation MBSMigrationState
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _failureCounts = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (NSDictionary *)propertyList {
+    NSMutableDictionary<NSString *, NSNumber *> *counts = [NSMutableDictionary dictionary];
+    [self.failureCounts enumerateKeysAndObjectsUsingBlock:^(NSNumber *code, NSNumber *count, BOOL *stop) {
+        counts[code.stringValue] = count;
+    }];
+    return @{@"version": @(kMBSCheckpointVersion),
+             @"job": self.job,
+             @"watermark": @(self.watermark),
+             @"sourceOffset": @(self.sourceOffset),
+             @"destinationOffset": @(self.destinationOffset),
+             @"migrated": @(self.migratedCount),
+             @"failed": @(self.failedCount),
+             @"failureCounts": counts};
+}
+
+- (BOOL)restoreFromPropertyList:(NSDictionary *)plist {
+    if (![plist isKindOfClass:[NSDictionary class]] || ![plist[@"version"] isEqual:@(kMBSCheckpointVersion)] ||
+        ![plist[@"job"] isEqual:self.job]) {
+        return NO;
+    }
+
+    for (NSString *key in @[@"watermark", @"sourceOffset", @"destinationOffset", @"migrated", @"failed"]) {
+        if (![plist[key] isKindOfClass:[NSNumber class]]) {
+            return NO;
+        }
+    }
+    NSDictionary *counts = plist[@"failureCounts"];
+    if (![counts isKindOfClass:[NSDictionary class]]) {
+        return NO;
+    }
+
+    self.watermark = [plist[@"watermark"] unsignedLongLongValue];
+    self.sourceOffset = [plist[@"sourceOffset"] unsignedLongLongValue];
+    self.destinationOffset = [plist[@"destinationOffset"] unsignedLongLongValue];
+    self.migratedCount = [plist[@"migrated"] unsignedLongLongValue];
+    self.failedCount = [plist[@"failed"] unsignedLongLongValue];
+    for (NSString *code in counts) {
+        if (![counts[code] isKindOfClass:[NSNumber class]]) {
+            return NO;
+        }
+        self.failureCounts[@(code.integerValue)] = counts[code];
+    }
+    return YES;
+}
+
+@end
+
+#pragma mark - MBSMigrationEngine
+
+@interface MBSMigrationEngine ()
+@property (nonatomic, copy) NSData *sourceKey;
+@property (nonatomic, copy) NSData *destinationKey;
+@property (nonatomic, strong, nullable) MBSBufferPool *pool;
+@property (nonatomic, assign) NSUInteger headerLength;
+@property (nonatomic, assign) NSUInteger recordSize;
+@property (atomic, assign, getter=isCancelled) BOOL cancelled;
+
+// Per-run totals, updated by the workers
+@property (nonatomic, assign) uint64_t bytesRead;
+@property (nonatomic, assign) uint64_t bytesWritten;
+@property (nonatomic, strong) NSMutableDictionary<NSNumber *, NSError *> *failures;
+@property (nonatomic, assign) uint64_t startTime;
+@end
+
+@implementation MBSMigrationEngine
+
+- (instancetype)initWithSourceKey:(NSData *)sourceKey destinationKey:(NSData *)destinationKey {
+    self = [super init];
+    if (self) {
+        _sourceKey = [sourceKey copy];
+        _destinationKey = [destinationKey copy];
+        _workerCount = NSProcessInfo.processInfo.activeProcessorCount;
+        _chunkSize = kMBSCipherStreamDefaultChunkSize;
+        _batchSize = kMBSMigrationDefaultBatchSize;
+    }
+    return self;
+}
+
+- (void)cancel {
+    self.cancelled = YES;
+}
+
+#pragma mark - Setup
+
+- (BOOL)prepareWithError:(NSError **)error {
+    if (self.sourceKey.length != 32 || self.destinationKey.length != 32) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidKey
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Keys must be 32 bytes for AES-256"}];
+        }
+        return NO;
+    }
+
+    // Validates the chunk size and fixes the output layout for every blob
+    MBSChunkedCipher *probe = [MBSChunkedCipher encoderWithKey:self.destinationKey chunkSize:self.chunkSize error:error];
+    if (!probe) {
+        return NO;
+    }
+    self.headerLength = [probe.header encoded].length;
+    self.recordSize = probe.recordSize;
+
+    // Each worker holds one ciphertext chunk and the plaintext decrypted from it
+    self.pool = [[MBSBufferPool alloc] initWithBufferSize:self.chunkSize * 2 count:MAX(self.workerCount, (NSUInteger)1)];
+    if (!self.pool) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorIOFailure
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Failed to allocate scratch buffers"}];
+        }
+        return NO;
+    }
+
+    self.cancelled = NO;
+    self.bytesRead = 0;
+    self.bytesWritten = 0;
+    self.failures = [NSMutableDictionary dictionary];
+    self.startTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+    return YES;
+}
+
+/// HMAC-SHA256 under both keys over the ordered paths, so a checkpoint resumes
+/// only the same files under the same keys and never records key material
+- (NSString *)identityOfSources:(NSArray<NSURL *> *)sourceURLs destinations:(NSArray<NSURL *> *)destinationURLs {
+    NSMutableData *key = [self.sourceKey mutableCopy];
+    [key appendData:self.destinationKey];
+    CCHmacContext context;
+    CCHmacInit(&context, kCCHmacAlgSHA256, key.bytes, key.length);
+    [key resetBytesInRange:NSMakeRange(0, key.length)];
+
+    for (NSArray<NSURL *> *urls in @[sourceURLs, destinationURLs]) {
+        uint64_t count = CFSwapInt64HostToBig(urls.count);
+        CCHmacUpdate(&context, &count, sizeof(count));
+        for (NSURL *url in urls) {
+            // NUL-terminated, since paths cannot contain NUL
+            const char *path = (url.path ?: @"").UTF8String;
+            CCHmacUpdate(&context, path, strlen(path) + 1);
+        }
+    }
+
+    uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+    CCHmacFinal(&context, digest);
+    NSMutableString *identity = [NSMutableString stringWithCapacity:sizeof(digest) * 2];
+    for (size_t i = 0; i < sizeof(digest); i++) {
+        [identity appendFormat:@"%02x", digest[i]];
+    }
+    return identity;
+}
+
+- (nullable MBSMigrationState *)loadStateForJob:(NSDictionary<NSString *, id> *)job error:(NSError **)error {
+    MBSMigrationState *state = [[MBSMigrationState alloc] init];
+    state.job = job;
+    if (!self.checkpointURL || ![[NSFileManager defaultManager] fileExistsAtPath:self.checkpointURL.path]) {
+        return state;
+    }
+
+    NSData *data = [NSData dataWithContentsOfURL:self.checkpointURL];
+    id plist = data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+    if (![state restoreFromPropertyList:plist]) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Checkpoint is unreadable or belongs to a different migration"}];
+        }
+        return nil;
+    }
+    return state;
+}
+
+- (BOOL)saveState:(MBSMigrationState *)state error:(NSError **)error {
+    if (!self.checkpointURL) {
+        return YES;
+    }
+
+    NSData *data = [NSJSONSerialization dataWithJSONObject:[state propertyList] options:0 error:nil];
+    NSError *writeError = nil;
+    if (![data writeToURL:self.checkpointURL options:NSDataWritingAtomic error:&writeError]) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorIOFailure
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Failed to write migration checkpoint",
+                                                NSUnderlyingErrorKey: writeError}];
+        }
+        return NO;
+    }
+    return YES;
+}
+
+- (MBSMigrationReport *)reportForState:(MBSMigrationState *)state totalCount:(uint64_t)totalCount {
+    MBSMigrationReport *report = [[MBSMigrationReport alloc] init];
+    report.totalCount = totalCount;
+    report.completedCount = state.watermark;
+    report.migratedCount = state.migratedCount;
+    report.failedCount = state.failedCount;
+    report.failureCounts = state.failureCounts;
+    report.finished = state.watermark >= totalCount;
+    @synchronized (self) {
+        report.failures = self.failures;
+        report.bytesRead = self.bytesRead;
+        report.bytesWritten = self.bytesWritten;
+    }
+    report.elapsedTime = (clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - self.startTime) / 1e9;
+    return report;
+}
+
+#pragma mark - Batches
+
+/// Runs `block` for every blob on `workerCount` workers and folds the outcomes into `state`
+- (void)performBlobs:(NSArray<MBSMigrationBlob *> *)blobs
+               state:(MBSMigrationState *)state
+               block:(void (^)(MBSMigrationBlob *blob))block {
+    __block NSUInteger next = 0;
+    dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+    dispatch_apply(MIN(MAX(self.workerCount, (NSUInteger)1), blobs.count), queue, ^(size_t worker) {
+        while (YES) {
+            NSUInteger index;
+            @synchronized (blobs) {
+                index = next++;
+            }
+            if (index >= blobs.count) {
+                return;
+            }
+            @autoreleasepool {
+                block(blobs[index]);
+            }
+        }
+    });
+
+    for (MBSMigrationBlob *blob in blobs) {
+        if (!blob.error) {
+            state.migratedCount++;
+            continue;
+        }
+
+        state.failedCount++;
+        NSNumber *code = @(blob.error.code);
+        state.failureCounts[code] = @(state.failureCounts[code].unsignedLongLongValue + 1);
+        if (self.failures.count < kMBSMigrationMaxRecordedFailures) {
+            @synchronized (self) {
+                self.failures[@(blob.index)] = blob.error;
+            }
+        }
+    }
+}
+
+/// Checkpoints and reports a finished batch; NO stops the job
+- (BOOL)finishBatchWithState:(MBSMigrationState *)state totalCount:(uint64_t)totalCount error:(NSError **)error {
+    if (![self saveState:state error:error]) {
+        return NO;
+    }
+    if (self.progressHandler) {
+        self.progressHandler([self reportForState:state totalCount:totalCount]);
+    }
+    return YES;
+}
+
+#pragma mark - Transcoding
+
+/// Size of the chunked V1 output for `plaintextLength` bytes: full records, then a final one holding the remainder
+- (uint64_t)outputLengthForPlaintextLength:(uint64_t)plaintextLength {
+    return self.headerLength + (plaintextLength / self.chunkSize) * self.recordSize +
+           kMBSChunkRecordHeaderSize + plaintextLength % self.chunkSize + (NSUInteger)MBSCipherHeader.tagSize;
+}
+
+/// Reads the blob's header and fills in where its ciphertext is and how large its output will be
+- (BOOL)describeBlob:(MBSMigrationBlob *)blob descriptor:(int)fd error:(NSError **)error {
+    NSUInteger fixedSize = (NSUInteger)MBSCipherHeader.fixedSize;
+    NSUInteger tagSize = (NSUInteger)MBSCipherHeader.tagSize;
+    uint8_t prefix[12] = {0};
+    if (blob.sourceLength < kMBSV0NonceSize + tagSize) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Encrypted data too short"}];
+        }
+        return NO;
+    }
+    if (!MBSFileReadFully(fd, prefix, sizeof(prefix), blob.sourceOffset)) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to read source", errno);
+        }
+        return NO;
+    }
+
+    if (memcmp(prefix, MBSCipherHeader.magicBytes.bytes, 4) != 0) {
+        // V0: [nonce(12)][ciphertext][tag(16)]
+        blob.nonce = [NSData dataWithBytes:prefix length:kMBSV0NonceSize];
+        blob.associatedData = [NSData data];
+        blob.payloadOffset = blob.sourceOffset + (off_t)kMBSV0NonceSize;
+        blob.plaintextLength = blob.sourceLength - kMBSV0NonceSize - tagSize;
+    } else {
+        NSUInteger headerLength = fixedSize + (((NSUInteger)prefix[6] << 8) | prefix[7]);
+        NSMutableData *headerData = [NSMutableData dataWithLength:headerLength];
+        if (blob.sourceLength < headerLength + tagSize) {
+            if (error) {
+                *error = [NSError errorWithDomain:MBSErrorDomain
+                                             code:MBSCipherErrorInvalidInput
+                                         userInfo:@{NSLocalizedDescriptionKey: @"V1 format data too short"}];
+            }
+            return NO;
+        }
+        if (!MBSFileReadFully(fd, headerData.mutableBytes, headerLength, blob.sourceOffset)) {
+            if (error) {
+                *error = MBSPOSIXError(@"Failed to read source", errno);
+            }
+            return NO;
+        }
+
+        MBSCipherHeader *header = [MBSCipherHeader parseHeader:headerData error:error];
+        if (!header) {
+            return NO;
+        }
+
+        // Only single-shot payloads are decrypted as one GCM message
+        if ([header extensionValue:MBSCipherHeader.extensionChunked] || header.compressionCodec != MBSCompressionCodecNone ||
+            header.wrappedKey || [header extensionValue:MBSCipherHeader.extensionRecipients]) {
+            if (error) {
+                *error = [NSError errorWithDomain:MBSErrorDomain
+                                             code:MBSCipherErrorUnsupportedFormat
+                                         userInfo:@{NSLocalizedDescriptionKey: @"Only V0 and single-shot, uncompressed V1 data can be migrated"}];
+            }
+            return NO;
+        }
+
+        blob.nonce = header.nonce;
+        blob.associatedData = [header authenticatedData];
+        blob.payloadOffset = blob.sourceOffset + (off_t)headerLength;
+        blob.plaintextLength = blob.sourceLength - headerLength - tagSize;
+    }
+
+    if (blob.plaintextLength > MBS_GCM_MAX_CIPHERTEXT) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorFileTooLarge
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Blob exceeds the AES-GCM message size limit"}];
+        }
+        return NO;
+    }
+
+    blob.outputLength = [self outputLengthForPlaintextLength:blob.plaintextLength];
+    return YES;
+}
+
+/// Streams a described blob into chunked V1 at `blob.destinationOffset`.
+///
+/// Output written before a failure may hold data resealed from unauthenticated
+/// plaintext; the caller must discard it.
+- (BOOL)transcodeBlob:(MBSMigrationBlob *)blob from:(int)input to:(int)output error:(NSError **)error {
+    MBSChunkedCipher *encoder = [MBSChunkedCipher encoderWithKey:self.destinationKey chunkSize:self.chunkSize error:error];
+    if (!encoder) {
+        return NO;
+    }
+
+    NSData *header = [encoder.header encoded];
+    if (!MBSFileWriteFully(output, header.bytes, header.length, blob.destinationOffset)) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to write output", errno);
+        }
+        return NO;
+    }
+
+    MBSGCMDecryptor decryptor;
+    if (MBSGCMDecryptorInit(&decryptor, self.sourceKey.bytes, blob.nonce.bytes,
+                            blob.associatedData.bytes, blob.associatedData.length) != kCCSuccess) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorDecryptionFailed
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Failed to initialise AES-GCM decryption"}];
+        }
+        return NO;
+    }
+
+    NSUInteger chunkSize = self.chunkSize;
+    uint8_t *ciphertext = [self.pool acquireBuffer];
+    uint8_t *plaintext = ciphertext + chunkSize;
+    uint64_t remaining = blob.plaintextLength;
+    off_t readOffset = blob.payloadOffset;
+    off_t writeOffset = blob.destinationOffset + (off_t)header.length;
+    NSError *chunkError = nil;
+    BOOL final = NO;
+
+    while (!final && !chunkError) {
+        final = remaining < chunkSize;
+        NSUInteger length = final ? (NSUInteger)remaining : chunkSize;
+
+        if (length > 0 && !MBSFileReadFully(input, ciphertext, length, readOffset)) {
+            chunkError = MBSPOSIXError(@"Failed to read source", errno);
+            break;
+        }
+        if (MBSGCMDecryptorUpdate(&decryptor, ciphertext, plaintext, length) != kCCSuccess) {
+            chunkError = [NSError errorWithDomain:MBSErrorDomain
+                                             code:MBSCipherErrorDecryptionFailed
+                                         userInfo:@{NSLocalizedDescriptionKey: @"AES-GCM decryption failed"}];
+            break;
+        }
+
+        NSData *record = [encoder sealBytes:plaintext length:length final:final error:&chunkError];
+        if (record && !MBSFileWriteFully(output, record.bytes, record.length, writeOffset)) {
+            chunkError = MBSPOSIXError(@"Failed to write output", errno);
+        }
+        remaining -= length;
+        readOffset += (off_t)length;
+        writeOffset += (off_t)record.length;
+    }
+
+    uint8_t tag[16];
+    if (!chunkError && !MBSFileReadFully(input, tag, sizeof(tag), readOffset)) {
+        chunkError = MBSPOSIXError(@"Failed to read source", errno);
+    }
+    if (chunkError) {
+        MBSGCMDecryptorRelease(&decryptor);
+    } else if (MBSGCMDecryptorFinal(&decryptor, tag) != 0) {
+        chunkError = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorAuthenticationFailed
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Authentication tag verification failed"}];
+    }
+    [self.pool releaseBuffer:ciphertext];
+
+    if (chunkError) {
+        if (error) {
+            *error = chunkError;
+        }
+        return NO;
+    }
+    return YES;
+}
+
+- (void)countBlob:(MBSMigrationBlob *)blob written:(uint64_t)written {
+    @synchronized (self) {
+        self.bytesRead += blob.sourceLength;
+        self.bytesWritten += written;
+    }
+}
+
+#pragma mark - Files
+
+- (nullable MBSMigrationReport *)migrateFiles:(NSArray<NSURL *> *)sourceURLs
+                                    toOutputs:(NSArray<NSURL *> *)destinationURLs
+                                        error:(NSError **)error {
+    if (!sourceURLs || !destinationURLs || sourceURLs.count != destinationURLs.count) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Each source file needs exactly one destination"}];
+        }
+        return nil;
+    }
+    if (![self prepareWithError:error]) {
+        return nil;
+    }
+
+    uint64_t total = sourceURLs.count;
+    NSDictionary *job = @{@"files": @(total),
+                          @"chunkSize": @(self.chunkSize),
+                          @"identity": [self identityOfSources:sourceURLs destinations:destinationURLs]};
+    MBSMigrationState *state = [self loadStateForJob:job error:error];
+    if (!state) {
+        return nil;
+    }
+
+    while (state.watermark < total && !self.isCancelled) {
+        @autoreleasepool {
+            NSUInteger count = (NSUInteger)MIN((uint64_t)MAX(self.batchSize, (NSUInteger)1), total - state.watermark);
+            NSMutableArray<MBSMigrationBlob *> *blobs = [NSMutableArray arrayWithCapacity:count];
+            for (NSUInteger i = 0; i < count; i++) {
+                MBSMigrationBlob *blob = [[MBSMigrationBlob alloc] init];
+                blob.index = state.watermark + i;
+                blob.sourceURL = sourceURLs[(NSUInteger)blob.index];
+                blob.destinationURL = destinationURLs[(NSUInteger)blob.index];
+                [blobs addObject:blob];
+            }
+
+            [self performBlobs:blobs state:state block:^(MBSMigrationBlob *blob) {
+                [self migrateFileBlob:blob];
+            }];
+
+            state.watermark += count;
+            if (![self finishBatchWithState:state totalCount:total error:error]) {
+                return nil;
+            }
+        }
+    }
+
+    self.pool = nil;
+    return [self reportForState:state totalCount:total];
+}
+
+- (void)migrateFileBlob:(MBSMigrationBlob *)blob {
+    int input = open(blob.sourceURL.path.fileSystemRepresentation, O_RDONLY | O_CLOEXEC);
+    if (input < 0) {
+        blob.error = MBSPOSIXError(@"Failed to open source file", errno);
+        return;
+    }
+
+    struct stat info;
+    NSError *blobError = nil;
+    if (fstat(input, &info) != 0) {
+        blobError = MBSPOSIXError(@"Failed to read source file attributes", errno);
+    } else {
+        blob.sourceLength = (uint64_t)info.st_size;
+        [self describeBlob:blob descriptor:input error:&blobError];
+    }
+    if (blobError) {
+        close(input);
+        blob.error = blobError;
+        return;
+    }
+
+    NSString *temporaryPath = nil;
+    int output = MBSFileCreateTemporary(blob.destinationURL.path, &temporaryPath);
+    if (output < 0) {
+        blob.error = MBSPOSIXError(@"Failed to create output file", errno);
+        close(input);
+        return;
+    }
+
+    BOOL success = [self transcodeBlob:blob from:input to:output error:&blobError];
+    close(input);
+    if (!success) {
+        MBSFileDiscardTemporary(output, temporaryPath);
+        blob.error = blobError;
+        return;
+    }
+    if (!MBSFileCommitTemporary(output, temporaryPath, blob.destinationURL.path, self.synchronizeWrites)) {
+        blob.error = MBSPOSIXError(@"Failed to flush or move output file into place", errno);
+        return;
+    }
+    [self countBlob:blob written:blob.outputLength];
+}
+
+#pragma mark - Packed Stores
+
+/// Entry count of a packed store, checking that every entry fits in the file
+- (BOOL)countEntriesOfStore:(int)fd size:(uint64_t)size count:(uint64_t *)count error:(NSError **)error {
+    uint64_t entries = 0;
+    uint64_t offset = 0;
+    while (offset < size) {
+        uint64_t available = size - offset;
+        uint8_t lengthBE[sizeof(uint64_t)];
+        uint64_t length = UINT64_MAX;
+        if (available >= kMBSPackedEntryHeaderSize && MBSFileReadFully(fd, lengthBE, sizeof(lengthBE), (off_t)offset)) {
+            length = 0;
+            for (NSUInteger i = 0; i < kMBSPackedEntryHeaderSize; i++) {
+                length = (length << 8) | lengthBE[i];
+            }
+        }
+        if (length > available - MIN(available, (uint64_t)kMBSPackedEntryHeaderSize)) {
+            if (error) {
+                *error = [NSError errorWithDomain:MBSErrorDomain
+                                             code:MBSCipherErrorInvalidInput
+                                         userInfo:@{NSLocalizedDescriptionKey:
+                                                        [NSString stringWithFormat:@"Packed store entry %llu runs past the end of the store", entries]}];
+            }
+            return NO;
+        }
+        offset += kMBSPackedEntryHeaderSize + length;
+        entries++;
+    }
+    *count = entries;
+    return YES;
+}
+
+- (nullable MBSMigrationReport *)migratePackedStore:(NSURL *)sourceURL
+                                      toPackedStore:(NSURL *)destinationURL
+                                              error:(NSError **)error {
+    if (![self prepareWithError:error]) {
+        return nil;
+    }
+
+    int input = open(sourceURL.path.fileSystemRepresentation, O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    if (input < 0 || fstat(input, &info) != 0) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to open source store", errno);
+        }
+        if (input >= 0) {
+            close(input);
+        }
+        return nil;
+    }
+
+    uint64_t total = 0;
+    uint64_t size = (uint64_t)info.st_size;
+    MBSMigrationState *state = nil;
+    if ([self countEntriesOfStore:input size:size count:&total error:error]) {
+        state = [self loadStateForJob:@{@"storeSize": @(size),
+                                        @"entries": @(total),
+                                        @"chunkSize": @(self.chunkSize),
+                                        @"identity": [self identityOfSources:@[sourceURL] destinations:@[destinationURL]]}
+                                error:error];
+    }
+    if (!state) {
+        close(input);
+        return nil;
+    }
+
+    // A resumed job keeps what earlier runs wrote below the watermark
+    int flags = O_RDWR | O_CREAT | O_CLOEXEC | (state.watermark == 0 ? O_TRUNC : 0);
+    int output = open(destinationURL.path.fileSystemRepresentation, flags, S_IRUSR | S_IWUSR);
+    if (output < 0) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to open destination store", errno);
+        }
+        close(input);
+        return nil;
+    }
+
+    BOOL success = YES;
+    while (success && state.watermark < total && !self.isCancelled) {
+        @autoreleasepool {
+            NSArray<MBSMigrationBlob *> *blobs = [self nextEntriesOfStore:input state:state totalCount:total];
+            [self performBlobs:blobs state:state block:^(MBSMigrationBlob *blob) {
+                [self migratePackedBlob:blob from:input to:output];
+            }];
+
+            MBSMigrationBlob *last = blobs.lastObject;
+            state.watermark += blobs.count;
+            state.sourceOffset = (uint64_t)last.sourceOffset + last.sourceLength;
+            state.destinationOffset = (uint64_t)last.destinationOffset + last.outputLength;
+
+            if (self.synchronizeWrites && !MBSFileSynchronize(output)) {
+                if (error) {
+                    *error = MBSPOSIXError(@"Failed to flush destination store", errno);
+                }
+                success = NO;
+                break;
+            }
+            success = [self finishBatchWithState:state totalCount:total error:error];
+        }
+    }
+
+    if (success && state.watermark >= total && ftruncate(output, (off_t)state.destinationOffset) != 0) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to write destination store", errno);
+        }
+        success = NO;
+    }
+    close(input);
+    close(output);
+    self.pool = nil;
+    return success ? [self reportForState:state totalCount:total] : nil;
+}
+
+/// Locates the next batch of entries and lays out their output slots back to back
+- (NSArray<MBSMigrationBlob *> *)nextEntriesOfStore:(int)fd state:(MBSMigrationState *)state totalCount:(uint64_t)total {
+    NSUInteger count = (NSUInteger)MIN((uint64_t)MAX(self.batchSize, (NSUInteger)1), total - state.watermark);
+    NSMutableArray<MBSMigrationBlob *> *blobs = [NSMutableArray arrayWithCapacity:count];
+    uint64_t sourceOffset = state.sourceOffset;
+    uint64_t destinationOffset = state.destinationOffset;
+
+    for (NSUInteger i = 0; i < count; i++) {
+        // Entry lengths were validated when the store was counted
+        uint8_t lengthBE[sizeof(uint64_t)] = {0};
+        MBSFileReadFully(fd, lengthBE, sizeof(lengthBE), (off_t)sourceOffset);
+        uint64_t length = 0;
+        for (NSUInteger j = 0; j < kMBSPackedEntryHeaderSize; j++) {
+            length = (length << 8) | lengthBE[j];
+        }
+
+        MBSMigrationBlob *blob = [[MBSMigrationBlob alloc] init];
+        blob.index = state.watermark + i;
+        blob.sourceOffset = (off_t)(sourceOffset + kMBSPackedEntryHeaderSize);
+        blob.sourceLength = length;
+        blob.destinationOffset = (off_t)(destinationOffset + kMBSPackedEntryHeaderSize);
+
+        // A blob whose header cannot be read gets an empty failed entry
+        NSError *describeError = nil;
+        if (![self describeBlob:blob descriptor:fd error:&describeError]) {
+            blob.error = describeError;
+            blob.outputLength = 0;
+        }
+
+        [blobs addObject:blob];
+        sourceOffset = (uint64_t)blob.sourceOffset + length;
+        destinationOffset = (uint64_t)blob.destinationOffset + blob.outputLength;
+    }
+    return blobs;
+}
+
+- (void)migratePackedBlob:(MBSMigrationBlob *)blob from:(int)input to:(int)output {
+    NSError *blobError = blob.error;
+    if (!blobError) {
+        [self transcodeBlob:blob from:input to:output error:&blobError];
+    }
+
+    // Nothing resealed from a blob that failed authentication may stay behind
+    if (blobError && blob.outputLength > 0) {
+        static const uint8_t zeros[16384] = {0};
+        for (uint64_t done = 0; done < blob.outputLength; done += sizeof(zeros)) {
+            size_t length = (size_t)MIN((uint64_t)sizeof(zeros), blob.outputLength - done);
+            MBSFileWriteFully(output, zeros, length, blob.destinationOffset + (off_t)done);
+        }
+    }
+
+    uint64_t length = blob.outputLength | (blobError ? kMBSPackedStoreFailedEntryFlag : 0);
+    uint8_t lengthBE[sizeof(uint64_t)];
+    for (NSInteger i = kMBSPackedEntryHeaderSize - 1; i >= 0; i--) {
+        lengthBE[i] = (uint8_t)length;
+        length >>= 8;
+    }
+    if (!MBSFileWriteFully(output, lengthBE, sizeof(lengthBE), blob.destinationOffset - (off_t)kMBSPackedEntryHeaderSize) &&
+        !blobError) {
+        blobError = MBSPOSIXError(@"Failed to write destination store", errno);
+    }
+
+    blob.error = blobError;
+    [self countBlob:blob written:blobError ? 0 : kMBSPackedEntryHeaderSize + blob.outputLength];
+}
+
+@end
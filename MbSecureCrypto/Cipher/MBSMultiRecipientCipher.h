@@ -0,0 +1,165 @@
+//
+//  MBSMultiRecipientCipher.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import <Foundation/Foundation.h>
+#import "MBSCipherTypes.h"
+#import "MBSError.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Encrypts a payload once for several recipients, each holding its own key.
+///
+/// The payload is sealed with AES-256-GCM under a random content key. The V1
+/// header carries a RECIPIENTS key slot with one entry per recipient:
+/// ```
+/// ENTRY = [KEY_ID(8)][WRAPPED_CONTENT_KEY(40)]
+/// ```
+/// KEY_ID is derived from the recipient's key (see
+/// ``recipientIdentifierForKey:error:``), and the content key is wrapped with
+/// AES Key Wrap (RFC 3394). Each use has its own HKDF subkey of the recipient
+/// key (``MBSKeyDerivation`` domain `MbSecureCrypto.recipient`, contexts
+/// `identifier` and `wrap`), so the key itself is never used directly. Entries are sorted by KEY_ID, so a reader
+/// finds its own entry without trying every wrapped key, and unwraps exactly one.
+///
+/// Key slots are not part of the associated data. Adding or removing a
+/// recipient rewrites the header only; the payload is carried over without
+/// being decrypted or re-encrypted.
+///
+/// ```objc
+/// NSData *encrypted = [MBSMultiRecipientCipher encryptData:data
+///                                            forRecipients:@[billingKey, auditKey, searchKey]
+///                                                    error:&error];
+///
+/// // Each service opens it with its own key
+/// NSData *decrypted = [MBSMultiRecipientCipher decryptData:encrypted withRecipientKey:auditKey error:&error];
+///
+/// // Revoke one service without touching the payload
+/// NSData *identifier = [MBSMultiRecipientCipher recipientIdentifierForKey:searchKey error:&error];
+/// encrypted = [MBSMultiRecipientCipher removeRecipient:identifier fromData:encrypted error:&error];
+/// ```
+///
+/// @note Removing a recipient stops it from opening the new copy. It does not
+///       help against a recipient that kept the content key or an older copy;
+///       re-encrypt the payload when that matters.
+API_AVAILABLE(macos(12.4), ios(15.6))
+@interface MBSMultiRecipientCipher : NSObject
+
+/// Short identifier under which a recipient's entry is stored.
+///
+/// @param key 32-byte recipient key
+/// @param error MBSCipherErrorInvalidKey (200) if the key is not 32 bytes
+///
+/// @return 8-byte identifier, or nil if an error occurred
++ (nullable NSData *)recipientIdentifierForKey:(NSData *)key error:(NSError **)error;
+
+/// Encrypts data once for every recipient.
+///
+/// @param data Data to encrypt
+/// @param recipientKeys 32-byte recipient keys
+/// @param error Error object populated on failure with codes:
+///              - MBSCipherErrorInvalidKey (200): A recipient key is not 32 bytes
+///              - MBSCipherErrorInvalidInput (202): Invalid input data, no recipients,
+///                a repeated recipient, or too many recipients for one header
+///              - MBSCipherErrorEncryptionFailed (210): Encryption operation failed
+///
+/// @return Multi-recipient V1 data, or nil if an error occurred
++ (nullable NSData *)encryptData:(NSData *)data
+                   forRecipients:(NSArray<NSData *> *)recipientKeys
+                           error:(NSError **)error;
+
+/// Decrypts multi-recipient data with one recipient's key.
+///
+/// @param data Multi-recipient V1 data
+/// @param recipientKey 32-byte key of any recipient
+/// @param error Error object populated on failure with codes:
+///              - MBSCipherErrorInvalidKey (200): Key is not 32 bytes or is not a recipient
+///              - MBSCipherErrorInvalidInput (202): Data too short or malformed header
+///              - MBSCipherErrorFormatDetectionFailed (205): Not V1 data
+///              - MBSCipherErrorFormatMismatch (206): V1 data without recipients
+///              - MBSCipherErrorAuthenticationFailed (212): Modified data or wrapped key
+///
+/// @return The decrypted data, or nil if an error occurred
++ (nullable NSData *)decryptData:(NSData *)data
+                withRecipientKey:(NSData *)recipientKey
+                           error:(NSError **)error;
+
+/// Identifiers of every recipient, in header order, read without unwrapping anything
++ (nullable NSArray<NSData *> *)recipientIdentifiersForData:(NSData *)data error:(NSError **)error;
+
+/// Grants another recipient access.
+///
+/// @param newRecipientKey 32-byte key of the recipient to add
+/// @param data Multi-recipient V1 data
+/// @param recipientKey Key of an existing recipient, used to recover the content key
+/// @param error Error object populated on failure with the codes of
+///              ``decryptData:withRecipientKey:error:``, or MBSCipherErrorInvalidInput (202)
+///              if the recipient is already present or the header is full
+///
+/// @return The data with its new header, or nil if an error occurred
++ (nullable NSData *)addRecipient:(NSData *)newRecipientKey
+                           toData:(NSData *)data
+                 withRecipientKey:(NSData *)recipientKey
+                            error:(NSError **)error;
+
+/// Revokes a recipient. No key is needed.
+///
+/// @param recipientIdentifier Identifier from ``recipientIdentifierForKey:error:``
+/// @param data Multi-recipient V1 data
+/// @param error Error object populated on failure with the header codes of
+///              ``decryptData:withRecipientKey:error:``, or MBSCipherErrorInvalidInput (202)
+///              if the recipient is not present or is the last one
+///
+/// @return The data with its new header, or nil if an error occurred
++ (nullable NSData *)removeRecipient:(NSData *)recipientIdentifier
+                            fromData:(NSData *)data
+                               error:(NSError **)error;
+
+/// Encrypts a file once for every recipient, in the chunked V1 format of ``MBSCipherStream``.
+///
+/// The output is written to a temporary file and renamed into place.
+///
+/// @param error Error object populated on failure with the codes of
+///              ``encryptData:forRecipients:error:``, plus MBSCipherErrorIOFailure (220)
+///              and MBSCipherErrorFilePermission (222)
+///
+/// @return YES if successful, NO if an error occurred
++ (BOOL)encryptFile:(NSURL *)inputURL
+           toOutput:(NSURL *)outputURL
+      forRecipients:(NSArray<NSData *> *)recipientKeys
+              error:(NSError **)error;
+
+/// Decrypts a multi-recipient file with one recipient's key.
+///
+/// @param error Error object populated on failure with the codes of
+///              ``decryptData:withRecipientKey:error:``, plus MBSCipherErrorIOFailure (220)
+///              and MBSCipherErrorFilePermission (222)
+///
+/// @return YES if successful, NO if an error occurred
++ (BOOL)decryptFile:(NSURL *)inputURL
+           toOutput:(NSURL *)outputURL
+   withRecipientKey:(NSData *)recipientKey
+              error:(NSError **)error;
+
+/// File counterpart of ``addRecipient:toData:withRecipientKey:error:``.
+///
+/// The header changes size, so the file is copied to a temporary file with the
+/// new header, flushed, and renamed into place. Payload bytes are copied as is.
++ (BOOL)addRecipient:(NSData *)newRecipientKey
+              toFile:(NSURL *)fileURL
+    withRecipientKey:(NSData *)recipientKey
+               error:(NSError **)error;
+
+/// File counterpart of ``removeRecipient:fromData:error:``, rewriting the file as
+/// ``addRecipient:toFile:withRecipientKey:error:`` does
++ (BOOL)removeRecipient:(NSData *)recipientIdentifier
+               fromFile:(NSURL *)fileURL
+                  error:(NSError **)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,642 @@
+//
+//  MBSMultiRecipientCipher.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import "MBSMultiRecipientCipher.h"
+#import "MBSBulkFileCipher.h"
+#import "MBSCipherStream.h"
+#import "MBSChunkedCipher.h"
+#import "MBSFileUtilities.h"
+#import "MBSKeyDerivation.h"
+#import <CommonCrypto/CommonHMAC.h>
+#import <Security/Security.h>
+#import <errno.h>
+#import <fcntl.h>
+#import <sys/stat.h>
+#import <unistd.h>
+
+// Handle both framework and static library imports
+#if __has_include(<MbSecureCrypto/MbSecureCrypto-Swift.h>)
+#import <MbSecureCrypto/MbSecureCrypto-Swift.h>
+#else
+#import "MbSecureCrypto-Swift.h"
+#endif
+
+static const NSUInteger kMBSRecipientKeySize = 32;
+static const NSUInteger kMBSRecipientCopyBufferSize = 64 * 1024;
+static const char kMBSRecipientIdentifierLabel[] = "MbSecureCrypto.recipient";
+static NSString *const kMBSRecipientKeyDomain = @"MbSecureCrypto.recipient";
+
+@implementation MBSMultiRecipientCipher
+
+#pragma mark - Recipients
+
+/// Subkey of a recipient key; KEY_ID and key wrapping each get their own, so neither use exposes the other
++ (nullable NSData *)subkeyOfRecipientKey:(NSData *)key context:(NSString *)context error:(NSError **)error {
+    if (key.length != kMBSRecipientKeySize) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidKey
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Recipient keys must be 32 bytes for AES-256"}];
+        }
+        return nil;
+    }
+    return [MBSKeyDerivation deriveKey:key domain:kMBSRecipientKeyDomain context:context error:error];
+}
+
++ (nullable NSData *)recipientIdentifierForKey:(NSData *)key error:(NSError **)error {
+    NSData *identifierKey = [self subkeyOfRecipientKey:key context:@"identifier" error:error];
+    if (!identifierKey) {
+        return nil;
+    }
+
+    // A PRF of the key: stable for its holder, meaningless to everyone else
+    uint8_t mac[CC_SHA256_DIGEST_LENGTH];
+    CCHmac(kCCHmacAlgSHA256, identifierKey.bytes, identifierKey.length,
+           kMBSRecipientIdentifierLabel, sizeof(kMBSRecipientIdentifierLabel) - 1, mac);
+    return [NSData dataWithBytes:mac length:(NSUInteger)MBSCipherHeader.recipientIdentifierSize];
+}
+
+/// Wraps `contentKey` under the key-wrapping subkey of `recipientKey`
++ (nullable NSData *)wrapContentKey:(NSData *)contentKey forRecipientKey:(NSData *)recipientKey error:(NSError **)error {
+    NSData *keyEncryptionKey = [self subkeyOfRecipientKey:recipientKey context:@"wrap" error:error];
+    if (!keyEncryptionKey) {
+        return nil;
+    }
+    return [MBSCipherBridge wrapKey:contentKey keyEncryptionKey:keyEncryptionKey error:error];
+}
+
+/// Wraps `contentKey` for each recipient key, rejecting repeated recipients
++ (nullable NSMutableDictionary<NSData *, NSData *> *)wrapContentKey:(NSData *)contentKey
+                                                     forRecipients:(NSArray<NSData *> *)recipientKeys
+                                                             error:(NSError **)error {
+    NSMutableDictionary<NSData *, NSData *> *recipients = [NSMutableDictionary dictionaryWithCapacity:recipientKeys.count];
+    for (NSData *recipientKey in recipientKeys) {
+        NSData *identifier = [self recipientIdentifierForKey:recipientKey error:error];
+        if (!identifier) {
+            return nil;
+        }
+        if (recipients[identifier]) {
+            if (error) {
+                *error = [NSError errorWithDomain:MBSErrorDomain
+                                             code:MBSCipherErrorInvalidInput
+                                         userInfo:@{NSLocalizedDescriptionKey: @"Recipient is listed more than once"}];
+            }
+            return nil;
+        }
+
+        NSData *wrappedKey = [self wrapContentKey:contentKey forRecipientKey:recipientKey error:error];
+        if (!wrappedKey) {
+            return nil;
+        }
+        recipients[identifier] = wrappedKey;
+    }
+    return recipients;
+}
+
+/// Stores `recipients` in `header`, which must keep at least one
++ (BOOL)setRecipients:(NSDictionary<NSData *, NSData *> *)recipients
+             onHeader:(MBSCipherHeader *)header
+                error:(NSError **)error {
+    // An empty slot would also change the associated data of a header with no other extensions
+    if (recipients.count == 0 || ![header setWrappedKeysForRecipients:recipients]) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey:
+                                                    recipients.count == 0 ? @"At least one recipient is required"
+                                                                          : @"Too many recipients for one header"}];
+        }
+        return NO;
+    }
+    return YES;
+}
+
++ (nullable NSMutableData *)generateContentKeyWithError:(NSError **)error {
+    NSMutableData *contentKey = [NSMutableData dataWithLength:kMBSRecipientKeySize];
+    if (SecRandomCopyBytes(kSecRandomDefault, kMBSRecipientKeySize, contentKey.mutableBytes) != errSecSuccess) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorEncryptionFailed
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Failed to generate content key"}];
+        }
+        return nil;
+    }
+    return contentKey;
+}
+
+#pragma mark - Headers
+
+/// Parses the header of multi-recipient data, rejecting V1 data that has no recipients
++ (nullable MBSCipherHeader *)recipientHeaderFromData:(NSData *)data error:(NSError **)error {
+    MBSCipherHeader *header = [MBSCipherHeader parseHeader:data error:error];
+    if (!header) {
+        return nil;
+    }
+
+    if (![header extensionValue:MBSCipherHeader.extensionRecipients]) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorFormatMismatch
+                                     userInfo:@{NSLocalizedDescriptionKey: @"V1 data has no recipients"}];
+        }
+        return nil;
+    }
+
+    if ([header extensionValue:MBSCipherHeader.extensionCompression] || header.wrappedKey) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorUnsupportedFormat
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Unsupported extension in multi-recipient header"}];
+        }
+        return nil;
+    }
+
+    return header;
+}
+
+/// Reads the complete V1 header at the start of an open file
++ (nullable NSData *)headerDataOfDescriptor:(int)fd error:(NSError **)error {
+    // Fixed header first, then the parameter block it announces
+    uint8_t fixed[8];
+    NSMutableData *headerData = nil;
+    if (MBSFileReadFully(fd, fixed, sizeof(fixed), 0)) {
+        size_t length = sizeof(fixed) + (((size_t)fixed[6] << 8) | fixed[7]);
+        headerData = [NSMutableData dataWithLength:length];
+        if (!MBSFileReadFully(fd, headerData.mutableBytes, length, 0)) {
+            headerData = nil;
+        }
+    }
+    if (!headerData && error) {
+        *error = [NSError errorWithDomain:MBSErrorDomain
+                                     code:MBSCipherErrorInvalidInput
+                                 userInfo:@{NSLocalizedDescriptionKey: @"File too short for a V1 header"}];
+    }
+    return headerData;
+}
+
+/// Finds the recipient's entry and unwraps the content key from it
++ (nullable NSData *)contentKeyForHeader:(MBSCipherHeader *)header
+                            recipientKey:(NSData *)recipientKey
+                                   error:(NSError **)error {
+    NSData *identifier = [self recipientIdentifierForKey:recipientKey error:error];
+    if (!identifier) {
+        return nil;
+    }
+
+    NSData *wrappedKey = [header wrappedKeyForRecipient:identifier];
+    if (!wrappedKey) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidKey
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Key is not a recipient of this data"}];
+        }
+        return nil;
+    }
+
+    NSData *keyEncryptionKey = [self subkeyOfRecipientKey:recipientKey context:@"wrap" error:error];
+    if (!keyEncryptionKey) {
+        return nil;
+    }
+    return [MBSCipherBridge unwrapKey:wrappedKey keyEncryptionKey:keyEncryptionKey error:error];
+}
+
++ (nullable NSArray<NSData *> *)recipientIdentifiersForData:(NSData *)data error:(NSError **)error {
+    MBSCipherHeader *header = [self recipientHeaderFromData:data error:error];
+    if (!header) {
+        return nil;
+    }
+    return [header.recipients.allKeys sortedArrayUsingComparator:^NSComparisonResult(NSData *a, NSData *b) {
+        int order = memcmp(a.bytes, b.bytes, a.length);
+        return order < 0 ? NSOrderedAscending : (order > 0 ? NSOrderedDescending : NSOrderedSame);
+    }];
+}
+
+#pragma mark - Data
+
++ (nullable NSData *)encryptData:(NSData *)data
+                   forRecipients:(NSArray<NSData *> *)recipientKeys
+                           error:(NSError **)error {
+    if (!data) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Input data is nil"}];
+        }
+        return nil;
+    }
+
+    NSMutableData *contentKey = [self generateContentKeyWithError:error];
+    if (!contentKey) {
+        return nil;
+    }
+
+    NSData *result = nil;
+    MBSCipherHeader *header = [MBSCipherHeader randomHeader];
+    NSDictionary<NSData *, NSData *> *recipients = [self wrapContentKey:contentKey forRecipients:recipientKeys error:error];
+    if (recipients && [self setRecipients:recipients onHeader:header error:error]) {
+        NSData *sealed = [MBSCipherBridge sealChunk:data
+                                                key:contentKey
+                                              nonce:header.nonce
+                                     authenticating:[header authenticatedData]
+                                              error:error];
+        if (sealed) {
+            NSMutableData *output = [NSMutableData dataWithData:[header encoded]];
+            [output appendData:sealed];
+            result = output;
+        }
+    }
+
+    memset_s(contentKey.mutableBytes, contentKey.length, 0, contentKey.length);
+    return result;
+}
+
++ (nullable NSData *)decryptData:(NSData *)data
+                withRecipientKey:(NSData *)recipientKey
+                           error:(NSError **)error {
+    MBSCipherHeader *header = [self recipientHeaderFromData:data error:error];
+    if (!header) {
+        return nil;
+    }
+
+    NSUInteger headerLength = (NSUInteger)header.encodedLength;
+    if (data.length < headerLength + (NSUInteger)MBSCipherHeader.tagSize) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Multi-recipient data too short"}];
+        }
+        return nil;
+    }
+
+    NSData *contentKey = [self contentKeyForHeader:header recipientKey:recipientKey error:error];
+    if (!contentKey) {
+        return nil;
+    }
+
+    if ([header extensionValue:MBSCipherHeader.extensionChunked]) {
+        // Produced by encryptFile:, then read into memory
+        NSInputStream *input = [NSInputStream inputStreamWithData:data];
+        NSOutputStream *output = [NSOutputStream outputStreamToMemory];
+        BOOL success = [MBSCipherStream decryptStream:input
+                                             toStream:output
+                                        withAlgorithm:MBSCipherAlgorithmAESGCM
+                                           withFormat:@(MBSCipherFormatV1)
+                                              withKey:contentKey
+                                                error:error];
+        [input close];
+        [output close];
+        return success ? [output propertyForKey:NSStreamDataWrittenToMemoryStreamKey] : nil;
+    }
+
+    NSData *sealed = [data subdataWithRange:NSMakeRange(headerLength, data.length - headerLength)];
+    return [MBSCipherBridge openChunk:sealed
+                                  key:contentKey
+                                nonce:header.nonce
+                       authenticating:[header authenticatedData]
+                                error:error];
+}
+
+#pragma mark - Recipient Changes
+
+/// Header with `newRecipientKey` added; the associated data is unchanged
++ (nullable MBSCipherHeader *)header:(MBSCipherHeader *)header
+                        addingRecipient:(NSData *)newRecipientKey
+                       withRecipientKey:(NSData *)recipientKey
+                                  error:(NSError **)error {
+    NSData *identifier = [self recipientIdentifierForKey:newRecipientKey error:error];
+    NSData *contentKey = identifier ? [self contentKeyForHeader:header recipientKey:recipientKey error:error] : nil;
+    if (!contentKey) {
+        return nil;
+    }
+
+    NSMutableDictionary<NSData *, NSData *> *recipients = [header.recipients mutableCopy];
+    if (recipients[identifier]) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Key is already a recipient"}];
+        }
+        return nil;
+    }
+
+    NSData *wrappedKey = [self wrapContentKey:contentKey forRecipientKey:newRecipientKey error:error];
+    if (!wrappedKey) {
+        return nil;
+    }
+    recipients[identifier] = wrappedKey;
+    return [self setRecipients:recipients onHeader:header error:error] ? header : nil;
+}
+
+/// Header with one recipient removed; the associated data is unchanged
++ (nullable MBSCipherHeader *)header:(MBSCipherHeader *)header
+                     removingRecipient:(NSData *)recipientIdentifier
+                                 error:(NSError **)error {
+    NSMutableDictionary<NSData *, NSData *> *recipients = [header.recipients mutableCopy];
+    if (!recipients[recipientIdentifier]) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Identifier is not a recipient"}];
+        }
+        return nil;
+    }
+
+    [recipients removeObjectForKey:recipientIdentifier];
+    return [self setRecipients:recipients onHeader:header error:error] ? header : nil;
+}
+
++ (NSData *)data:(NSData *)data withHeader:(MBSCipherHeader *)header replacingLength:(NSUInteger)oldLength {
+    NSMutableData *output = [NSMutableData dataWithData:[header encoded]];
+    [output appendData:[data subdataWithRange:NSMakeRange(oldLength, data.length - oldLength)]];
+    return output;
+}
+
++ (nullable NSData *)addRecipient:(NSData *)newRecipientKey
+                           toData:(NSData *)data
+                 withRecipientKey:(NSData *)recipientKey
+                            error:(NSError **)error {
+    MBSCipherHeader *header = [self recipientHeaderFromData:data error:error];
+    NSUInteger oldLength = (NSUInteger)header.encodedLength;
+    if (!header || ![self header:header addingRecipient:newRecipientKey withRecipientKey:recipientKey error:error]) {
+        return nil;
+    }
+    return [self data:data withHeader:header replacingLength:oldLength];
+}
+
++ (nullable NSData *)removeRecipient:(NSData *)recipientIdentifier
+                            fromData:(NSData *)data
+                               error:(NSError **)error {
+    MBSCipherHeader *header = [self recipientHeaderFromData:data error:error];
+    NSUInteger oldLength = (NSUInteger)header.encodedLength;
+    if (!header || ![self header:header removingRecipient:recipientIdentifier error:error]) {
+        return nil;
+    }
+    return [self data:data withHeader:header replacingLength:oldLength];
+}
+
+#pragma mark - Files
+
++ (BOOL)encryptFile:(NSURL *)inputURL
+           toOutput:(NSURL *)outputURL
+      forRecipients:(NSArray<NSData *> *)recipientKeys
+              error:(NSError **)error {
+    NSMutableData *contentKey = [self generateContentKeyWithError:error];
+    if (!contentKey) {
+        return NO;
+    }
+
+    NSUInteger chunkSize = kMBSCipherStreamDefaultChunkSize;
+    MBSChunkedCipher *encoder = [MBSChunkedCipher encoderWithKey:contentKey chunkSize:chunkSize error:error];
+    NSDictionary<NSData *, NSData *> *recipients = encoder ? [self wrapContentKey:contentKey
+                                                                    forRecipients:recipientKeys
+                                                                            error:error] : nil;
+    // The encoder has captured the associated data; the slot is outside it
+    BOOL ready = recipients && [self setRecipients:recipients onHeader:encoder.header error:error];
+    memset_s(contentKey.mutableBytes, contentKey.length, 0, contentKey.length);
+    if (!ready) {
+        return NO;
+    }
+
+    int input = open(inputURL.fileSystemRepresentation, O_RDONLY | O_CLOEXEC);
+    if (input < 0) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to open input file", errno);
+        }
+        return NO;
+    }
+    struct stat status;
+    if (fstat(input, &status) != 0) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to read input file", errno);
+        }
+        close(input);
+        return NO;
+    }
+
+    NSString *temporaryPath = nil;
+    int output = MBSFileCreateTemporary(outputURL.path, &temporaryPath);
+    if (output < 0) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to create output file", errno);
+        }
+        close(input);
+        return NO;
+    }
+
+    NSData *header = [encoder.header encoded];
+    BOOL success = MBSFileWriteFully(output, header.bytes, header.length, 0);
+    int errorCode = success ? 0 : errno;
+    off_t readOffset = 0;
+    off_t writeOffset = (off_t)header.length;
+    uint64_t remaining = (uint64_t)status.st_size;
+    uint8_t *buffer = malloc(chunkSize);
+    success = success && buffer;
+
+    // Every record but the last holds a full chunk; the last may be empty
+    while (success && !encoder.finished) {
+        BOOL final = remaining < chunkSize;
+        NSUInteger length = final ? (NSUInteger)remaining : chunkSize;
+        if (length > 0 && !MBSFileReadFully(input, buffer, length, readOffset)) {
+            errorCode = errno;
+            success = NO;
+            break;
+        }
+
+        NSData *record = [encoder sealBytes:buffer length:length final:final error:error];
+        if (!record) {
+            success = NO;
+            break;
+        }
+        if (!MBSFileWriteFully(output, record.bytes, record.length, writeOffset)) {
+            errorCode = errno;
+            success = NO;
+            break;
+        }
+        readOffset += (off_t)length;
+        writeOffset += (off_t)record.length;
+        remaining -= length;
+    }
+
+    if (buffer) {
+        memset_s(buffer, chunkSize, 0, chunkSize);
+        free(buffer);
+    } else {
+        errorCode = ENOMEM;
+    }
+    close(input);
+
+    if (!success) {
+        MBSFileDiscardTemporary(output, temporaryPath);
+        // A zero code means the error came from sealing and is already set
+        if (error && errorCode != 0) {
+            *error = MBSPOSIXError(@"Failed to write file", errorCode);
+        }
+        return NO;
+    }
+
+    // Flushed before the rename so a crash cannot leave a truncated file under the output name
+    if (!MBSFileCommitTemporary(output, temporaryPath, outputURL.path, YES)) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to write file", errno);
+        }
+        return NO;
+    }
+    return YES;
+}
+
++ (BOOL)decryptFile:(NSURL *)inputURL
+           toOutput:(NSURL *)outputURL
+   withRecipientKey:(NSData *)recipientKey
+              error:(NSError **)error {
+    int fd = open(inputURL.fileSystemRepresentation, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to open input file", errno);
+        }
+        return NO;
+    }
+    NSData *headerData = [self headerDataOfDescriptor:fd error:error];
+    close(fd);
+
+    MBSCipherHeader *header = headerData ? [self recipientHeaderFromData:headerData error:error] : nil;
+    if (!header) {
+        return NO;
+    }
+
+    if (![header extensionValue:MBSCipherHeader.extensionChunked]) {
+        // Produced by encryptData: and written out
+        NSData *data = [NSData dataWithContentsOfURL:inputURL options:0 error:nil];
+        NSData *plaintext = data ? [self decryptData:data withRecipientKey:recipientKey error:error] : nil;
+        if (!plaintext) {
+            if (!data && error) {
+                *error = MBSPOSIXError(@"Failed to read input file", EIO);
+            }
+            return NO;
+        }
+        NSError *writeError = nil;
+        if (![plaintext writeToURL:outputURL options:NSDataWritingAtomic error:&writeError]) {
+            if (error) {
+                *error = [NSError errorWithDomain:MBSErrorDomain
+                                             code:MBSCipherErrorIOFailure
+                                         userInfo:@{NSLocalizedDescriptionKey: @"Failed to write output file",
+                                                    NSUnderlyingErrorKey: writeError}];
+            }
+            return NO;
+        }
+        return YES;
+    }
+
+    NSData *contentKey = [self contentKeyForHeader:header recipientKey:recipientKey error:error];
+    if (!contentKey) {
+        return NO;
+    }
+
+    // Chunked records sit at fixed offsets, so the bulk cipher reads and opens them overlapped
+    MBSBulkFileCipher *cipher = [[MBSBulkFileCipher alloc] initWithKey:contentKey];
+    NSDictionary<NSURL *, NSError *> *failures = [cipher decryptFiles:@[inputURL] toOutputs:@[outputURL] error:error];
+    if (!failures) {
+        return NO;
+    }
+    if (failures.count > 0) {
+        if (error) {
+            *error = failures.allValues.firstObject;
+        }
+        return NO;
+    }
+    return YES;
+}
+
+/// Replaces the header of `fileURL` with the one `update` produces from it
++ (BOOL)rewriteHeaderOfFile:(NSURL *)fileURL
+                      error:(NSError **)error
+                     update:(MBSCipherHeader * _Nullable (^)(MBSCipherHeader *header, NSError **error))update {
+    int fd = open(fileURL.fileSystemRepresentation, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to open file", errno);
+        }
+        return NO;
+    }
+
+    NSData *headerData = [self headerDataOfDescriptor:fd error:error];
+    MBSCipherHeader *header = headerData ? [self recipientHeaderFromData:headerData error:error] : nil;
+    if (!header || !update(header, error)) {
+        close(fd);
+        return NO;
+    }
+
+    NSString *temporaryPath = nil;
+    int output = MBSFileCreateTemporary(fileURL.path, &temporaryPath);
+    if (output < 0) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to create temporary file", errno);
+        }
+        close(fd);
+        return NO;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) == 0) {
+        fchmod(output, status.st_mode & 07777);
+    }
+
+    // New header, then the payload bytes as they are
+    NSData *encoded = [header encoded];
+    BOOL success = MBSFileWriteFully(output, encoded.bytes, encoded.length, 0);
+    off_t offset = (off_t)headerData.length;
+    off_t written = (off_t)encoded.length;
+    uint8_t *buffer = malloc(kMBSRecipientCopyBufferSize);
+    while (success && buffer) {
+        ssize_t count = pread(fd, buffer, kMBSRecipientCopyBufferSize, offset);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            success = (count == 0);
+            break;
+        }
+        success = MBSFileWriteFully(output, buffer, (size_t)count, written);
+        offset += count;
+        written += count;
+    }
+    if (!buffer) {
+        errno = ENOMEM;
+        success = NO;
+    }
+    free(buffer);
+    close(fd);
+
+    if (success) {
+        success = MBSFileCommitTemporary(output, temporaryPath, fileURL.path, YES);
+    } else {
+        MBSFileDiscardTemporary(output, temporaryPath);
+    }
+    if (!success && error) {
+        *error = MBSPOSIXError(@"Failed to write file", errno);
+    }
+    return success;
+}
+
++ (BOOL)addRecipient:(NSData *)newRecipientKey
+              toFile:(NSURL *)fileURL
+    withRecipientKey:(NSData *)recipientKey
+               error:(NSError **)error {
+    return [self rewriteHeaderOfFile:fileURL error:error update:^MBSCipherHeader *(MBSCipherHeader *header, NSError **updateError) {
+        return [self header:header addingRecipient:newRecipientKey withRecipientKey:recipientKey error:updateError];
+    }];
+}
+
++ (BOOL)removeRecipient:(NSData *)recipientIdentifier
+               fromFile:(NSURL *)fileURL
+                  error:(NSError **)error {
+    return [self rewriteHeaderOfFile:fileURL error:error update:^MBSCipherHeader *(MBSCipherHeader *header, NSError **updateError) {
+        return [self header:header removingRecipient:recipientIdentifier error:updateError];
+    }];
+}
+
+@end
@@ -0,0 +1,391 @@
+//
+//  MBSArgon2.c
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#include "MBSArgon2.h"
+#include "MBSBlake2b.h"
+#include <dispatch/dispatch.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MBS_ARGON2_BLOCK_SIZE 1024
+#define MBS_ARGON2_QWORDS_IN_BLOCK (MBS_ARGON2_BLOCK_SIZE / 8)
+#define MBS_ARGON2_ADDRESSES_IN_BLOCK 128
+#define MBS_ARGON2_PREHASH_DIGEST_LENGTH 64
+#define MBS_ARGON2_PREHASH_SEED_LENGTH (MBS_ARGON2_PREHASH_DIGEST_LENGTH + 8)
+#define MBS_ARGON2_TYPE_ID 2
+
+typedef struct {
+    uint64_t v[MBS_ARGON2_QWORDS_IN_BLOCK];
+} __attribute__((aligned(16))) MBSArgon2Block;
+
+typedef struct {
+    MBSArgon2Block *memory;
+    uint32_t memoryBlocks;
+    uint32_t passes;
+    uint32_t lanes;
+    uint32_t laneLength;
+    uint32_t segmentLength;
+    uint32_t workers;
+} MBSArgon2Instance;
+
+typedef struct {
+    const MBSArgon2Instance *instance;
+    uint32_t pass;
+    uint32_t slice;
+} MBSArgon2SliceJob;
+
+#pragma mark - Compression Function
+
+// Two 64-bit lanes per vector, the width of a NEON or SSE register. Each G call
+// below runs two of the BLAKE2b quarter-rounds at once.
+typedef uint64_t MBSArgon2Vector __attribute__((vector_size(16)));
+typedef uint32_t MBSArgon2Words __attribute__((vector_size(16)));
+typedef uint8_t MBSArgon2Bytes __attribute__((vector_size(16)));
+
+// Rotations by 32, 24 and 16 move whole bytes, so they are lane shuffles rather than shifts
+static inline __attribute__((always_inline)) MBSArgon2Vector MBSArgon2Rotr32(MBSArgon2Vector x) {
+    MBSArgon2Words w = (MBSArgon2Words)x;
+    return (MBSArgon2Vector)__builtin_shufflevector(w, w, 1, 0, 3, 2);
+}
+
+static inline __attribute__((always_inline)) MBSArgon2Vector MBSArgon2Rotr24(MBSArgon2Vector x) {
+    MBSArgon2Bytes b = (MBSArgon2Bytes)x;
+    return (MBSArgon2Vector)__builtin_shufflevector(b, b, 3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+}
+
+static inline __attribute__((always_inline)) MBSArgon2Vector MBSArgon2Rotr16(MBSArgon2Vector x) {
+    MBSArgon2Bytes b = (MBSArgon2Bytes)x;
+    return (MBSArgon2Vector)__builtin_shufflevector(b, b, 2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+}
+
+static inline __attribute__((always_inline)) MBSArgon2Vector MBSArgon2Rotr63(MBSArgon2Vector x) {
+    return (x >> 63) | (x + x);
+}
+
+/// BlaMka: a + b + 2 * lo32(a) * lo32(b), lane-wise
+static inline __attribute__((always_inline)) MBSArgon2Vector MBSArgon2BlaMka(MBSArgon2Vector a, MBSArgon2Vector b) {
+    const MBSArgon2Vector low = {0xFFFFFFFFULL, 0xFFFFFFFFULL};
+    MBSArgon2Vector product = (a & low) * (b & low);
+    return a + b + (product << 1);
+}
+
+static inline __attribute__((always_inline)) void MBSArgon2G(MBSArgon2Vector *a, MBSArgon2Vector *b,
+                                                             MBSArgon2Vector *c, MBSArgon2Vector *d) {
+    *a = MBSArgon2BlaMka(*a, *b);
+    *d = MBSArgon2Rotr32(*d ^ *a);
+    *c = MBSArgon2BlaMka(*c, *d);
+    *b = MBSArgon2Rotr24(*b ^ *c);
+    *a = MBSArgon2BlaMka(*a, *b);
+    *d = MBSArgon2Rotr16(*d ^ *a);
+    *c = MBSArgon2BlaMka(*c, *d);
+    *b = MBSArgon2Rotr63(*b ^ *c);
+}
+
+/// BLAKE2b round without message words over v0..v15: columns, then diagonals.
+/// `v` holds eight vectors: a = v[0..1], b = v[2..3], c = v[4..5], d = v[6..7].
+static inline __attribute__((always_inline)) void MBSArgon2Round(MBSArgon2Vector v[8]) {
+    MBSArgon2Vector a0 = v[0], a1 = v[1], b0 = v[2], b1 = v[3];
+    MBSArgon2Vector c0 = v[4], c1 = v[5], d0 = v[6], d1 = v[7];
+    MBSArgon2Vector t0, t1;
+
+    MBSArgon2G(&a0, &b0, &c0, &d0);
+    MBSArgon2G(&a1, &b1, &c1, &d1);
+
+    // Diagonalise: rotate row b left by one word, c by two, d by three
+    t0 = __builtin_shufflevector(b0, b1, 1, 2);
+    t1 = __builtin_shufflevector(b1, b0, 1, 2);
+    b0 = t0; b1 = t1;
+    t0 = c0; c0 = c1; c1 = t0;
+    t0 = __builtin_shufflevector(d1, d0, 1, 2);
+    t1 = __builtin_shufflevector(d0, d1, 1, 2);
+    d0 = t0; d1 = t1;
+
+    MBSArgon2G(&a0, &b0, &c0, &d0);
+    MBSArgon2G(&a1, &b1, &c1, &d1);
+
+    t0 = __builtin_shufflevector(b1, b0, 1, 2);
+    t1 = __builtin_shufflevector(b0, b1, 1, 2);
+    b0 = t0; b1 = t1;
+    t0 = c0; c0 = c1; c1 = t0;
+    t0 = __builtin_shufflevector(d0, d1, 1, 2);
+    t1 = __builtin_shufflevector(d1, d0, 1, 2);
+    d0 = t0; d1 = t1;
+
+    v[0] = a0; v[1] = a1; v[2] = b0; v[3] = b1;
+    v[4] = c0; v[5] = c1; v[6] = d0; v[7] = d1;
+}
+
+/// next = G(prev, ref), XORed into the existing contents of `next` when `withXor` is set
+static void MBSArgon2FillBlock(const MBSArgon2Block *prev, const MBSArgon2Block *ref,
+                               MBSArgon2Block *next, int withXor) {
+    MBSArgon2Block r;
+    MBSArgon2Block tmp;
+
+    for (int i = 0; i < MBS_ARGON2_QWORDS_IN_BLOCK; i++) {
+        r.v[i] = ref->v[i] ^ prev->v[i];
+    }
+    tmp = r;
+    if (withXor) {
+        for (int i = 0; i < MBS_ARGON2_QWORDS_IN_BLOCK; i++) {
+            tmp.v[i] ^= next->v[i];
+        }
+    }
+
+    // Rows: eight runs of 16 consecutive words
+    MBSArgon2Vector *vectors = (MBSArgon2Vector *)r.v;
+    for (int i = 0; i < 8; i++) {
+        MBSArgon2Round(vectors + 8 * i);
+    }
+
+    // Columns: word pairs (2i, 2i+1) taken from each of the eight rows
+    for (int i = 0; i < 8; i++) {
+        MBSArgon2Vector column[8];
+        for (int j = 0; j < 8; j++) {
+            column[j] = vectors[i + 8 * j];
+        }
+        MBSArgon2Round(column);
+        for (int j = 0; j < 8; j++) {
+            vectors[i + 8 * j] = column[j];
+        }
+    }
+
+    for (int i = 0; i < MBS_ARGON2_QWORDS_IN_BLOCK; i++) {
+        next->v[i] = tmp.v[i] ^ r.v[i];
+    }
+}
+
+#pragma mark - Indexing
+
+static void MBSArgon2NextAddresses(MBSArgon2Block *addresses, MBSArgon2Block *input, const MBSArgon2Block *zero) {
+    input->v[6]++;
+    MBSArgon2FillBlock(zero, input, addresses, 0);
+    MBSArgon2FillBlock(zero, addresses, addresses, 0);
+}
+
+static uint32_t MBSArgon2IndexAlpha(const MBSArgon2Instance *instance, uint32_t pass, uint32_t slice,
+                                    uint32_t index, uint32_t pseudoRandom, int sameLane) {
+    uint32_t referenceAreaSize;
+    if (pass == 0) {
+        if (slice == 0) {
+            referenceAreaSize = index - 1;
+        } else if (sameLane) {
+            referenceAreaSize = slice * instance->segmentLength + index - 1;
+        } else {
+            referenceAreaSize = slice * instance->segmentLength - (index == 0 ? 1 : 0);
+        }
+    } else {
+        if (sameLane) {
+            referenceAreaSize = instance->laneLength - instance->segmentLength + index - 1;
+        } else {
+            referenceAreaSize = instance->laneLength - instance->segmentLength - (index == 0 ? 1 : 0);
+        }
+    }
+
+    uint64_t relative = pseudoRandom;
+    relative = (relative * relative) >> 32;
+    relative = referenceAreaSize - 1 - (((uint64_t)referenceAreaSize * relative) >> 32);
+
+    uint32_t start = 0;
+    if (pass != 0 && slice != MBS_ARGON2_SYNC_POINTS - 1) {
+        start = (slice + 1) * instance->segmentLength;
+    }
+    return (uint32_t)((start + relative) % instance->laneLength);
+}
+
+static void MBSArgon2FillSegment(const MBSArgon2Instance *instance, uint32_t pass, uint32_t lane, uint32_t slice) {
+    // Argon2id: data-independent addressing for the first half of the first pass
+    int dataIndependent = (pass == 0 && slice < MBS_ARGON2_SYNC_POINTS / 2);
+
+    MBSArgon2Block zero, input, addresses;
+    if (dataIndependent) {
+        memset(&zero, 0, sizeof(zero));
+        memset(&input, 0, sizeof(input));
+        input.v[0] = pass;
+        input.v[1] = lane;
+        input.v[2] = slice;
+        input.v[3] = instance->memoryBlocks;
+        input.v[4] = instance->passes;
+        input.v[5] = MBS_ARGON2_TYPE_ID;
+    }
+
+    uint32_t startIndex = 0;
+    if (pass == 0 && slice == 0) {
+        // The first two blocks of each lane come from the initial hash
+        startIndex = 2;
+        if (dataIndependent) {
+            MBSArgon2NextAddresses(&addresses, &input, &zero);
+        }
+    }
+
+    uint32_t current = lane * instance->laneLength + slice * instance->segmentLength + startIndex;
+    uint32_t previous = (current % instance->laneLength == 0) ? current + instance->laneLength - 1 : current - 1;
+
+    for (uint32_t i = startIndex; i < instance->segmentLength; i++, current++, previous++) {
+        if (current % instance->laneLength == 1) {
+            previous = current - 1;
+        }
+
+        uint64_t pseudoRandom;
+        if (dataIndependent) {
+            if (i % MBS_ARGON2_ADDRESSES_IN_BLOCK == 0) {
+                MBSArgon2NextAddresses(&addresses, &input, &zero);
+            }
+            pseudoRandom = addresses.v[i % MBS_ARGON2_ADDRESSES_IN_BLOCK];
+        } else {
+            pseudoRandom = instance->memory[previous].v[0];
+        }
+
+        uint32_t referenceLane = (uint32_t)((pseudoRandom >> 32) % instance->lanes);
+        if (pass == 0 && slice == 0) {
+            referenceLane = lane;
+        }
+
+        uint32_t referenceIndex = MBSArgon2IndexAlpha(instance, pass, slice, i,
+                                                      (uint32_t)pseudoRandom, referenceLane == lane);
+        const MBSArgon2Block *reference = instance->memory + (size_t)instance->laneLength * referenceLane + referenceIndex;
+        MBSArgon2FillBlock(instance->memory + previous, reference, instance->memory + current, pass != 0);
+    }
+
+    if (dataIndependent) {
+        MBSSecureZero(&addresses, sizeof(addresses));
+    }
+}
+
+/// dispatch_apply worker: fills the segments of every `workers`-th lane
+static void MBSArgon2FillSlice(void *context, size_t worker) {
+    const MBSArgon2SliceJob *job = context;
+    const MBSArgon2Instance *instance = job->instance;
+    for (uint32_t lane = (uint32_t)worker; lane < instance->lanes; lane += instance->workers) {
+        MBSArgon2FillSegment(instance, job->pass, lane, job->slice);
+    }
+}
+
+#pragma mark - Hash
+
+static void MBSStore32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void MBSArgon2UpdateWithLength(MBSBlake2bState *state, const uint8_t *bytes, size_t length) {
+    uint8_t lengthLE[4];
+    MBSStore32(lengthLE, (uint32_t)length);
+    MBSBlake2bUpdate(state, lengthLE, sizeof(lengthLE));
+    if (length > 0) {
+        MBSBlake2bUpdate(state, bytes, length);
+    }
+}
+
+static void MBSArgon2InitialHash(const MBSArgon2Context *context, uint32_t outputLength, uint8_t *digest) {
+    MBSBlake2bState state;
+    uint8_t value[4];
+
+    MBSBlake2bInit(&state, MBS_ARGON2_PREHASH_DIGEST_LENGTH);
+    const uint32_t fields[6] = {
+        context->lanes, outputLength, context->memoryKiB, context->iterations, MBS_ARGON2_VERSION, MBS_ARGON2_TYPE_ID,
+    };
+    for (int i = 0; i < 6; i++) {
+        MBSStore32(value, fields[i]);
+        MBSBlake2bUpdate(&state, value, sizeof(value));
+    }
+    MBSArgon2UpdateWithLength(&state, context->password, context->passwordLength);
+    MBSArgon2UpdateWithLength(&state, context->salt, context->saltLength);
+    MBSArgon2UpdateWithLength(&state, context->secret, context->secretLength);
+    MBSArgon2UpdateWithLength(&state, context->associatedData, context->associatedDataLength);
+    MBSBlake2bFinal(&state, digest);
+}
+
+static void MBSArgon2LoadBlock(MBSArgon2Block *block, const uint8_t *bytes) {
+    for (int i = 0; i < MBS_ARGON2_QWORDS_IN_BLOCK; i++) {
+        uint64_t word = 0;
+        for (int j = 7; j >= 0; j--) {
+            word = (word << 8) | bytes[8 * i + j];
+        }
+        block->v[i] = word;
+    }
+}
+
+static void MBSArgon2StoreBlock(uint8_t *bytes, const MBSArgon2Block *block) {
+    for (int i = 0; i < MBS_ARGON2_QWORDS_IN_BLOCK; i++) {
+        for (int j = 0; j < 8; j++) {
+            bytes[8 * i + j] = (uint8_t)(block->v[i] >> (8 * j));
+        }
+    }
+}
+
+MBSArgon2Result MBSArgon2idHash(const MBSArgon2Context *context, uint8_t *output, uint32_t outputLength) {
+    if (!context || !output || outputLength < MBS_ARGON2_MIN_OUTPUT ||
+        context->iterations == 0 || context->lanes == 0 || context->lanes > MBS_ARGON2_MAX_LANES ||
+        context->memoryKiB < 2 * MBS_ARGON2_SYNC_POINTS * context->lanes ||
+        (context->passwordLength > 0 && !context->password) || (context->saltLength > 0 && !context->salt) ||
+        (context->secretLength > 0 && !context->secret) ||
+        (context->associatedDataLength > 0 && !context->associatedData)) {
+        return MBSArgon2InvalidParameters;
+    }
+
+    MBSArgon2Instance instance;
+    instance.lanes = context->lanes;
+    instance.passes = context->iterations;
+    instance.segmentLength = context->memoryKiB / (context->lanes * MBS_ARGON2_SYNC_POINTS);
+    instance.laneLength = instance.segmentLength * MBS_ARGON2_SYNC_POINTS;
+    instance.memoryBlocks = instance.laneLength * context->lanes;
+    instance.workers = context->threads == 0 ? 1 : (context->threads < context->lanes ? context->threads : context->lanes);
+
+    size_t memorySize = (size_t)instance.memoryBlocks * sizeof(MBSArgon2Block);
+    void *memory = NULL;
+    if (posix_memalign(&memory, 64, memorySize) != 0) {
+        return MBSArgon2MemoryAllocationFailed;
+    }
+    instance.memory = memory;
+
+    // H0, then the first two blocks of each lane
+    uint8_t seed[MBS_ARGON2_PREHASH_SEED_LENGTH];
+    uint8_t blockBytes[MBS_ARGON2_BLOCK_SIZE];
+    MBSArgon2InitialHash(context, outputLength, seed);
+    for (uint32_t lane = 0; lane < instance.lanes; lane++) {
+        MBSStore32(seed + MBS_ARGON2_PREHASH_DIGEST_LENGTH + 4, lane);
+        for (uint32_t j = 0; j < 2; j++) {
+            MBSStore32(seed + MBS_ARGON2_PREHASH_DIGEST_LENGTH, j);
+            MBSBlake2bLong(blockBytes, MBS_ARGON2_BLOCK_SIZE, seed, sizeof(seed));
+            MBSArgon2LoadBlock(instance.memory + (size_t)lane * instance.laneLength + j, blockBytes);
+        }
+    }
+    MBSSecureZero(seed, sizeof(seed));
+
+    // Lanes are independent within a slice; slices are synchronisation points
+    dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+    for (uint32_t pass = 0; pass < instance.passes; pass++) {
+        for (uint32_t slice = 0; slice < MBS_ARGON2_SYNC_POINTS; slice++) {
+            MBSArgon2SliceJob job = {&instance, pass, slice};
+            if (instance.workers == 1) {
+                MBSArgon2FillSlice(&job, 0);
+            } else {
+                dispatch_apply_f(instance.workers, queue, &job, MBSArgon2FillSlice);
+            }
+        }
+    }
+
+    // XOR of the last block of every lane
+    MBSArgon2Block final = instance.memory[instance.laneLength - 1];
+    for (uint32_t lane = 1; lane < instance.lanes; lane++) {
+        const MBSArgon2Block *last = instance.memory + (size_t)lane * instance.laneLength + instance.laneLength - 1;
+        for (int i = 0; i < MBS_ARGON2_QWORDS_IN_BLOCK; i++) {
+            final.v[i] ^= last->v[i];
+        }
+    }
+    MBSArgon2StoreBlock(blockBytes, &final);
+    MBSBlake2bLong(output, outputLength, blockBytes, sizeof(blockBytes));
+
+    MBSSecureZero(blockBytes, sizeof(blockBytes));
+    MBSSecureZero(&final, sizeof(final));
+    MBSSecureZero(memory, memorySize);
+    free(memory);
+    return MBSArgon2Ok;
+}
@@ -0,0 +1,51 @@
+//
+//  MBSArgon2.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#ifndef MBSArgon2_h
+#define MBSArgon2_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MBS_ARGON2_VERSION 0x13
+#define MBS_ARGON2_SYNC_POINTS 4
+#define MBS_ARGON2_MIN_OUTPUT 4
+#define MBS_ARGON2_MAX_LANES 0xFFFFFF
+
+typedef enum {
+    MBSArgon2Ok = 0,
+    MBSArgon2InvalidParameters = -1,
+    MBSArgon2MemoryAllocationFailed = -2,
+} MBSArgon2Result;
+
+/// Internal use only
+///
+/// Argon2id (RFC 9106, version 0x13). `memoryKiB` is the memory cost in 1 KiB
+/// blocks and must be at least 8 × `lanes`. Lanes in the same slice are filled
+/// concurrently on `threads` workers (1 runs everything on the caller's thread).
+typedef struct {
+    const uint8_t *password;
+    size_t passwordLength;
+    const uint8_t *salt;
+    size_t saltLength;
+    const uint8_t *secret;
+    size_t secretLength;
+    const uint8_t *associatedData;
+    size_t associatedDataLength;
+    uint32_t iterations;
+    uint32_t memoryKiB;
+    uint32_t lanes;
+    uint32_t threads;
+} MBSArgon2Context;
+
+/// Computes an Argon2id tag of `outputLength` bytes (at least 4).
+///
+/// The working memory is wiped before it is freed.
+MBSArgon2Result MBSArgon2idHash(const MBSArgon2Context *context, uint8_t *output, uint32_t outputLength);
+
+#endif
@@ -0,0 +1,204 @@
+//
+//  MBSBlake2b.c
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#define __STDC_WANT_LIB_EXT1__ 1
+#include "MBSBlake2b.h"
+#include <string.h>
+
+static const uint64_t kMBSBlake2bIV[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+};
+
+static const uint8_t kMBSBlake2bSigma[12][16] = {
+    { 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15},
+    {14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3},
+    {11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4},
+    { 7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8},
+    { 9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13},
+    { 2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9},
+    {12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11},
+    {13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10},
+    { 6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5},
+    {10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0},
+    { 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15},
+    {14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3},
+};
+
+void MBSSecureZero(void *buffer, size_t length) {
+    if (length > 0) {
+        memset_s(buffer, length, 0, length);
+    }
+}
+
+static inline uint64_t MBSLoad64(const uint8_t *p) {
+    return (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+           ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+static inline void MBSStore64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static inline uint64_t MBSRotr64(uint64_t x, unsigned n) {
+    return (x >> n) | (x << (64 - n));
+}
+
+#define MBS_B2B_G(a, b, c, d, x, y)        \
+    do {                                   \
+        a = a + b + (x);                   \
+        d = MBSRotr64(d ^ a, 32);          \
+        c = c + d;                         \
+        b = MBSRotr64(b ^ c, 24);          \
+        a = a + b + (y);                   \
+        d = MBSRotr64(d ^ a, 16);          \
+        c = c + d;                         \
+        b = MBSRotr64(b ^ c, 63);          \
+    } while (0)
+
+static void MBSBlake2bCompress(MBSBlake2bState *state, const uint8_t *block, int last) {
+    uint64_t m[16];
+    uint64_t v[16];
+
+    for (int i = 0; i < 16; i++) {
+        m[i] = MBSLoad64(block + 8 * i);
+    }
+    for (int i = 0; i < 8; i++) {
+        v[i] = state->h[i];
+        v[i + 8] = kMBSBlake2bIV[i];
+    }
+    v[12] ^= state->t[0];
+    v[13] ^= state->t[1];
+    if (last) {
+        v[14] = ~v[14];
+    }
+
+    for (int r = 0; r < 12; r++) {
+        const uint8_t *s = kMBSBlake2bSigma[r];
+        MBS_B2B_G(v[0], v[4], v[8],  v[12], m[s[0]],  m[s[1]]);
+        MBS_B2B_G(v[1], v[5], v[9],  v[13], m[s[2]],  m[s[3]]);
+        MBS_B2B_G(v[2], v[6], v[10], v[14], m[s[4]],  m[s[5]]);
+        MBS_B2B_G(v[3], v[7], v[11], v[15], m[s[6]],  m[s[7]]);
+        MBS_B2B_G(v[0], v[5], v[10], v[15], m[s[8]],  m[s[9]]);
+        MBS_B2B_G(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+        MBS_B2B_G(v[2], v[7], v[8],  v[13], m[s[12]], m[s[13]]);
+        MBS_B2B_G(v[3], v[4], v[9],  v[14], m[s[14]], m[s[15]]);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        state->h[i] ^= v[i] ^ v[i + 8];
+    }
+    MBSSecureZero(m, sizeof(m));
+    MBSSecureZero(v, sizeof(v));
+}
+
+static void MBSBlake2bIncrement(MBSBlake2bState *state, uint64_t increment) {
+    state->t[0] += increment;
+    state->t[1] += (state->t[0] < increment);
+}
+
+int MBSBlake2bInit(MBSBlake2bState *state, size_t outputLength) {
+    if (outputLength == 0 || outputLength > MBS_BLAKE2B_MAX_OUTPUT) {
+        return -1;
+    }
+
+    memset(state, 0, sizeof(*state));
+    for (int i = 0; i < 8; i++) {
+        state->h[i] = kMBSBlake2bIV[i];
+    }
+    // Parameter block: digest length, no key, fanout 1, depth 1
+    state->h[0] ^= 0x01010000ULL ^ (uint64_t)outputLength;
+    state->outputLength = outputLength;
+    return 0;
+}
+
+void MBSBlake2bUpdate(MBSBlake2bState *state, const void *input, size_t length) {
+    const uint8_t *in = input;
+
+    // The final block is compressed in MBSBlake2bFinal, so always keep one buffered
+    while (length > 0) {
+        if (state->bufferLength == MBS_BLAKE2B_BLOCK_SIZE) {
+            MBSBlake2bIncrement(state, MBS_BLAKE2B_BLOCK_SIZE);
+            MBSBlake2bCompress(state, state->buffer, 0);
+            state->bufferLength = 0;
+        }
+
+        size_t take = MBS_BLAKE2B_BLOCK_SIZE - state->bufferLength;
+        if (take > length) {
+            take = length;
+        }
+        memcpy(state->buffer + state->bufferLength, in, take);
+        state->bufferLength += take;
+        in += take;
+        length -= take;
+    }
+}
+
+void MBSBlake2bFinal(MBSBlake2bState *state, uint8_t *output) {
+    uint8_t digest[MBS_BLAKE2B_MAX_OUTPUT];
+
+    MBSBlake2bIncrement(state, state->bufferLength);
+    memset(state->buffer + state->bufferLength, 0, MBS_BLAKE2B_BLOCK_SIZE - state->bufferLength);
+    MBSBlake2bCompress(state, state->buffer, 1);
+
+    for (int i = 0; i < 8; i++) {
+        MBSStore64(digest + 8 * i, state->h[i]);
+    }
+    memcpy(output, digest, state->outputLength);
+
+    MBSSecureZero(digest, sizeof(digest));
+    MBSSecureZero(state, sizeof(*state));
+}
+
+void MBSBlake2bLong(uint8_t *output, uint32_t outputLength, const void *input, size_t inputLength) {
+    MBSBlake2bState state;
+    uint8_t lengthLE[4] = {
+        (uint8_t)outputLength, (uint8_t)(outputLength >> 8),
+        (uint8_t)(outputLength >> 16), (uint8_t)(outputLength >> 24),
+    };
+
+    if (outputLength <= MBS_BLAKE2B_MAX_OUTPUT) {
+        MBSBlake2bInit(&state, outputLength);
+        MBSBlake2bUpdate(&state, lengthLE, sizeof(lengthLE));
+        MBSBlake2bUpdate(&state, input, inputLength);
+        MBSBlake2bFinal(&state, output);
+        return;
+    }
+
+    // V1 = H(LE32(T) || X), Vi = H(Vi-1); emit the first 32 bytes of each, then the whole last one
+    uint8_t v[MBS_BLAKE2B_MAX_OUTPUT];
+    MBSBlake2bInit(&state, MBS_BLAKE2B_MAX_OUTPUT);
+    MBSBlake2bUpdate(&state, lengthLE, sizeof(lengthLE));
+    MBSBlake2bUpdate(&state, input, inputLength);
+    MBSBlake2bFinal(&state, v);
+
+    uint32_t remaining = outputLength;
+    while (remaining > MBS_BLAKE2B_MAX_OUTPUT) {
+        memcpy(output, v, MBS_BLAKE2B_MAX_OUTPUT / 2);
+        output += MBS_BLAKE2B_MAX_OUTPUT / 2;
+        remaining -= MBS_BLAKE2B_MAX_OUTPUT / 2;
+
+        uint8_t next[MBS_BLAKE2B_MAX_OUTPUT];
+        size_t nextLength = remaining > MBS_BLAKE2B_MAX_OUTPUT ? MBS_BLAKE2B_MAX_OUTPUT : remaining;
+        MBSBlake2bInit(&state, nextLength);
+        MBSBlake2bUpdate(&state, v, MBS_BLAKE2B_MAX_OUTPUT);
+        MBSBlake2bFinal(&state, next);
+        memcpy(v, next, nextLength);
+        MBSSecureZero(next, sizeof(next));
+
+        if (nextLength < MBS_BLAKE2B_MAX_OUTPUT) {
+            memcpy(output, v, nextLength);
+            MBSSecureZero(v, sizeof(v));
+            return;
+        }
+    }
+    memcpy(output, v, remaining);
+    MBSSecureZero(v, sizeof(v));
+}
@@ -0,0 +1,41 @@
+//
+//  MBSBlake2b.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#ifndef MBSBlake2b_h
+#define MBSBlake2b_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MBS_BLAKE2B_BLOCK_SIZE 128
+#define MBS_BLAKE2B_MAX_OUTPUT 64
+
+/// Internal use only
+///
+/// Unkeyed BLAKE2b (RFC 7693) as used by Argon2.
+typedef struct {
+    uint64_t h[8];
+    uint64_t t[2];
+    uint8_t buffer[MBS_BLAKE2B_BLOCK_SIZE];
+    size_t bufferLength;
+    size_t outputLength;
+} MBSBlake2bState;
+
+/// Starts a hash with a digest of 1 to 64 bytes; returns -1 for an invalid length
+int MBSBlake2bInit(MBSBlake2bState *state, size_t outputLength);
+void MBSBlake2bUpdate(MBSBlake2bState *state, const void *input, size_t length);
+/// Writes `outputLength` bytes and wipes the state
+void MBSBlake2bFinal(MBSBlake2bState *state, uint8_t *output);
+
+/// Argon2's variable-length hash H' (RFC 9106, section 3.3)
+void MBSBlake2bLong(uint8_t *output, uint32_t outputLength, const void *input, size_t inputLength);
+
+/// Clears memory in a way the compiler will not elide
+void MBSSecureZero(void *buffer, size_t length);
+
+#endif
@@ -0,0 +1,21 @@
+//
+//  MBSPHCEncoding.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Internal use only
+///
+/// Standard base64 without `=` padding, as used by PHC strings
+FOUNDATION_EXPORT NSString *MBSPHCBase64Encode(NSData *data);
+
+/// Decodes unpadded base64; nil if the text is not valid base64
+FOUNDATION_EXPORT NSData * _Nullable MBSPHCBase64Decode(NSString *text);
+
+NS_ASSUME_NONNULL_END
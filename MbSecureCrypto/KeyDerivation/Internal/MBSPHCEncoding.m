@@ -0,0 +1,25 @@
+//
+//  MBSPHCEncoding.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import "MBSPHCEncoding.h"
+
+NSString *MBSPHCBase64Encode(NSData *data) {
+    NSString *encoded = [data base64EncodedStringWithOptions:0];
+    return [encoded stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"="]];
+}
+
+NSData *MBSPHCBase64Decode(NSString *text) {
+    // Padded input, or a length no base64 encoding can have, is not canonical
+    if ([text containsString:@"="] || text.length % 4 == 1) {
+        return nil;
+    }
+
+    NSUInteger padding = (4 - text.length % 4) % 4;
+    NSString *padded = [text stringByPaddingToLength:text.length + padding withString:@"=" startingAtIndex:0];
+    return [[NSData alloc] initWithBase64EncodedString:padded options:0];
+}
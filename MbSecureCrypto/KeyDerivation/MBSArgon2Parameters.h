@@ -0,0 +1,86 @@
+//
+//  MBSArgon2Parameters.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Largest accepted memory cost in KiB (2 GiB, RFC 9106's first recommended option)
+FOUNDATION_EXPORT const uint32_t kMBSArgon2MaxMemoryKiB;
+
+/// Largest accepted number of passes (1024), far above what calibration
+/// chooses; bounds the CPU time a stored hash can demand
+FOUNDATION_EXPORT const uint32_t kMBSArgon2MaxIterations;
+
+/// Largest accepted number of lanes
+FOUNDATION_EXPORT const uint32_t kMBSArgon2MaxParallelism;
+
+/// Cost parameters and salt for Argon2id password-based key derivation.
+///
+/// Parameters serialise to the PHC string format used by the Argon2 reference
+/// implementation, so everything needed to derive the same key again travels
+/// with the salt:
+/// ```
+/// $argon2id$v=19$m=65536,t=3,p=4$<salt, base64 without padding>
+/// ```
+///
+/// Obtain parameters for the current machine with
+/// ``MBSKeyDerivation/calibrateForTargetLatency:memoryBudget:error:``, or use
+/// ``defaultParameters`` (RFC 9106's second recommended option).
+///
+/// @see MBSKeyDerivation
+@interface MBSArgon2Parameters : NSObject <NSCopying>
+
+/// Memory cost in KiB. 8 × `parallelism` to `kMBSArgon2MaxMemoryKiB`.
+@property (nonatomic, readonly) uint32_t memoryKiB;
+
+/// Number of passes over memory. 1 to `kMBSArgon2MaxIterations`.
+@property (nonatomic, readonly) uint32_t iterations;
+
+/// Number of lanes, filled concurrently on up to this many threads. 1 to `kMBSArgon2MaxParallelism`.
+@property (nonatomic, readonly) uint32_t parallelism;
+
+/// Salt of at least 8 bytes
+@property (nonatomic, readonly, copy) NSData *salt;
+
+/// PHC string without a hash: `$argon2id$v=19$m=...,t=...,p=...$<salt>`
+@property (nonatomic, readonly, copy) NSString *encodedString;
+
+/// 64 MiB, 3 passes, 4 lanes, and a fresh 16-byte salt
++ (instancetype)defaultParameters;
+
+/// Parameters with a fresh random 16-byte salt.
+///
+/// @return nil if the costs are out of range
++ (nullable instancetype)parametersWithMemoryKiB:(uint32_t)memoryKiB
+                                      iterations:(uint32_t)iterations
+                                     parallelism:(uint32_t)parallelism;
+
+/// @return nil if the costs are out of range or the salt is shorter than 8 bytes
+- (nullable instancetype)initWithMemoryKiB:(uint32_t)memoryKiB
+                                iterations:(uint32_t)iterations
+                               parallelism:(uint32_t)parallelism
+                                      salt:(NSData *)salt NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Parses a PHC string, with or without a trailing `$<hash>`.
+///
+/// @param error Error object populated on failure with codes:
+///              - MBSCipherErrorUnsupportedAlgorithm (203): Not Argon2id
+///              - MBSCipherErrorUnsupportedFormat (204): Not version 19
+///              - MBSCipherErrorInvalidInput (202): Malformed string or out-of-range parameters
++ (nullable instancetype)parametersFromEncodedString:(NSString *)encodedString error:(NSError **)error;
+
+/// The same costs with a fresh random salt
+///
+/// @return nil if no random salt could be generated
+- (nullable instancetype)parametersWithNewSalt;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,165 @@
+//
+//  MBSArgon2Parameters.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import "MBSArgon2Parameters.h"
+#import "MBSError.h"
+#import "MBSPHCEncoding.h"
+#import "MBSRandom.h"
+
+static NSString *const kMBSArgon2Prefix = @"$argon2id$";
+static const NSUInteger kMBSArgon2SaltSize = 16;
+static const NSUInteger kMBSArgon2MinSaltSize = 8;
+
+const uint32_t kMBSArgon2MaxMemoryKiB = 2 * 1024 * 1024;
+const uint32_t kMBSArgon2MaxIterations = 1024;
+const uint32_t kMBSArgon2MaxParallelism = 255;
+
+@implementation MBSArgon2Parameters
+
++ (instancetype)defaultParameters {
+    return [self parametersWithMemoryKiB:64 * 1024 iterations:3 parallelism:4];
+}
+
++ (nullable instancetype)parametersWithMemoryKiB:(uint32_t)memoryKiB
+                                      iterations:(uint32_t)iterations
+                                     parallelism:(uint32_t)parallelism {
+    NSData *salt = [MBSRandom generateBytes:kMBSArgon2SaltSize error:nil];
+    if (!salt) {
+        return nil;
+    }
+    return [[self alloc] initWithMemoryKiB:memoryKiB iterations:iterations parallelism:parallelism salt:salt];
+}
+
+- (nullable instancetype)initWithMemoryKiB:(uint32_t)memoryKiB
+                                iterations:(uint32_t)iterations
+                               parallelism:(uint32_t)parallelism
+                                      salt:(NSData *)salt {
+    self = [super init];
+    if (self) {
+        if (iterations == 0 || iterations > kMBSArgon2MaxIterations || parallelism == 0 || parallelism > kMBSArgon2MaxParallelism ||
+            memoryKiB < 8 * parallelism || memoryKiB > kMBSArgon2MaxMemoryKiB || salt.length < kMBSArgon2MinSaltSize) {
+            return nil;
+        }
+        _memoryKiB = memoryKiB;
+        _iterations = iterations;
+        _parallelism = parallelism;
+        _salt = [salt copy];
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+- (nullable instancetype)parametersWithNewSalt {
+    return [MBSArgon2Parameters parametersWithMemoryKiB:self.memoryKiB
+                                             iterations:self.iterations
+                                            parallelism:self.parallelism];
+}
+
+- (NSString *)encodedString {
+    return [NSString stringWithFormat:@"%@v=19$m=%u,t=%u,p=%u$%@", kMBSArgon2Prefix,
+            self.memoryKiB, self.iterations, self.parallelism, MBSPHCBase64Encode(self.salt)];
+}
+
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[MBSArgon2Parameters class]]) {
+        return NO;
+    }
+    MBSArgon2Parameters *other = object;
+    return self.memoryKiB == other.memoryKiB && self.iterations == other.iterations &&
+           self.parallelism == other.parallelism && [self.salt isEqualToData:other.salt];
+}
+
+- (NSUInteger)hash {
+    return self.salt.hash ^ self.memoryKiB ^ ((NSUInteger)self.iterations << 8) ^ ((NSUInteger)self.parallelism << 16);
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %@>", NSStringFromClass([self class]), self.encodedString];
+}
+
+#pragma mark - Parsing
+
++ (NSError *)invalidEncodingError {
+    return [NSError errorWithDomain:MBSErrorDomain
+                               code:MBSCipherErrorInvalidInput
+                           userInfo:@{NSLocalizedDescriptionKey: @"Malformed Argon2id parameter string"}];
+}
+
+/// Reads "<name>=<decimal>" into a uint32; only ASCII digits are accepted
++ (BOOL)scanValue:(uint32_t *)value named:(NSString *)name from:(NSString *)field {
+    NSString *prefix = [name stringByAppendingString:@"="];
+    if (![field hasPrefix:prefix] || field.length == prefix.length || field.length > prefix.length + 10) {
+        return NO;
+    }
+
+    // decimalDigitCharacterSet would also admit other scripts' digits, which strtoull stops at
+    NSCharacterSet *asciiDigits = [NSCharacterSet characterSetWithCharactersInString:@"0123456789"];
+    NSString *digits = [field substringFromIndex:prefix.length];
+    if ([digits rangeOfCharacterFromSet:asciiDigits.invertedSet].location != NSNotFound ||
+        ([digits hasPrefix:@"0"] && digits.length > 1)) {
+        return NO;
+    }
+
+    unsigned long long parsed = strtoull(digits.UTF8String, NULL, 10);
+    if (parsed > UINT32_MAX) {
+        return NO;
+    }
+    *value = (uint32_t)parsed;
+    return YES;
+}
+
++ (nullable instancetype)parametersFromEncodedString:(NSString *)encodedString error:(NSError **)error {
+    if (![encodedString hasPrefix:kMBSArgon2Prefix]) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorUnsupportedAlgorithm
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Only Argon2id parameter strings are supported"}];
+        }
+        return nil;
+    }
+
+    // "", "argon2id", "v=19", "m=..,t=..,p=..", salt [, hash]
+    NSArray<NSString *> *fields = [encodedString componentsSeparatedByString:@"$"];
+    if (fields.count < 5 || fields.count > 6) {
+        if (error) {
+            *error = [self invalidEncodingError];
+        }
+        return nil;
+    }
+
+    if (![fields[2] isEqualToString:@"v=19"]) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorUnsupportedFormat
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Only Argon2 version 19 (0x13) is supported"}];
+        }
+        return nil;
+    }
+
+    NSArray<NSString *> *costs = [fields[3] componentsSeparatedByString:@","];
+    uint32_t memoryKiB = 0, iterations = 0, parallelism = 0;
+    NSData *salt = MBSPHCBase64Decode(fields[4]);
+    MBSArgon2Parameters *parameters = nil;
+    if (costs.count == 3 &&
+        [self scanValue:&memoryKiB named:@"m" from:costs[0]] &&
+        [self scanValue:&iterations named:@"t" from:costs[1]] &&
+        [self scanValue:&parallelism named:@"p" from:costs[2]] &&
+        salt) {
+        parameters = [[self alloc] initWithMemoryKiB:memoryKiB iterations:iterations parallelism:parallelism salt:salt];
+    }
+
+    if (!parameters && error) {
+        *error = [self invalidEncodingError];
+    }
+    return parameters;
+}
+
+@end
@@ -7,6 +7,7 @@
 
 
 #import <Foundation/Foundation.h>
+#import "MBSArgon2Parameters.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -83,6 +84,12 @@ typedef NS_ENUM(NSInteger, MBSHkdfAlgorithm) {
 ///   - SHA-512 provides 256-bit security for high-security needs
 ///   - SHA-1 provided only for legacy compatibility
 ///
+/// - Passwords:
+///   - HKDF is only suitable for keys that are already uniformly random
+///   - Derive keys from passwords with Argon2id
+///     (``deriveKeyFromPassword:parameters:keySize:error:``), and choose its
+///     costs with ``calibrateForTargetLatency:memoryBudget:error:``
+///
 /// @see MBSRandom
 /// @see MBSHkdfAlgorithm
 @interface MBSKeyDerivation : NSObject
@@ -146,6 +153,82 @@ typedef NS_ENUM(NSInteger, MBSHkdfAlgorithm) {
                        context:(NSString *)context
                          error:(NSError **)error;
 
+// MARK: - Argon2id
+
+/// Derives a key from a password with Argon2id (RFC 9106).
+///
+/// Argon2id is memory hard: every derivation fills `parameters.memoryKiB` of
+/// memory `parameters.iterations` times, which makes guessing passwords on
+/// GPUs and ASICs expensive. Lanes are filled concurrently on up to
+/// `parameters.parallelism` threads, and the working memory is wiped before
+/// it is released.
+///
+/// ```objc
+/// MBSArgon2Parameters *parameters = [MBSArgon2Parameters defaultParameters];
+/// NSData *key = [MBSKeyDerivation deriveKeyFromPassword:password
+///                                            parameters:parameters
+///                                               keySize:32
+///                                                 error:&error];
+/// // Store parameters.encodedString to derive the same key later
+/// ```
+///
+/// - Parameters:
+///   - password: Password bytes, typically UTF-8
+///   - parameters: Costs and salt
+///   - keySize: Size of the derived key in bytes (minimum 4)
+///   - error: Error object populated on failure with codes:
+///            - MBSCipherErrorInvalidInput (202): Key size too small
+///            - MBSCipherErrorKeyDerivationFailed (213): Working memory could not be allocated
+/// - Returns: Derived key as NSData, or nil on error
++ (nullable NSData *)deriveKeyFromPassword:(NSData *)password
+                                parameters:(MBSArgon2Parameters *)parameters
+                                   keySize:(NSInteger)keySize
+                                     error:(NSError **)error;
+
+/// Hashes a password for storage.
+///
+/// - Returns: A PHC string, `$argon2id$v=19$m=...,t=...,p=...$<salt>$<hash>`,
+///   with a 32-byte hash, or nil on error
++ (nullable NSString *)hashPassword:(NSData *)password
+                         parameters:(MBSArgon2Parameters *)parameters
+                              error:(NSError **)error;
+
+/// Checks a password against a string produced by ``hashPassword:parameters:error:``.
+///
+/// The hash is recomputed with the stored costs and compared in constant time.
+/// Costs above `kMBSArgon2MaxMemoryKiB`, `kMBSArgon2MaxIterations` or
+/// `kMBSArgon2MaxParallelism` are rejected before any memory is allocated.
+///
+/// - Parameters:
+///   - password: Candidate password
+///   - encodedHash: Stored PHC string
+///   - error: Error object populated on failure with codes:
+///            - MBSCipherErrorAuthenticationFailed (212): Password does not match
+///            - MBSCipherErrorInvalidInput (202): Malformed string or missing hash
+///            - Codes of ``MBSArgon2Parameters/parametersFromEncodedString:error:``
+/// - Returns: YES if the password matches
++ (BOOL)verifyPassword:(NSData *)password
+           againstHash:(NSString *)encodedHash
+                 error:(NSError **)error;
+
+/// Chooses Argon2id costs for this machine.
+///
+/// Uses one lane per core (up to 8) and as much of `memoryBudget` as fits in
+/// `targetLatency` with a single pass, then adds passes while a derivation
+/// stays within the target. Call this once, on the class of device that will
+/// derive keys, and store the result's ``MBSArgon2Parameters/encodedString``.
+///
+/// - Parameters:
+///   - targetLatency: Wall-clock time one derivation should take, in seconds
+///   - memoryBudget: Maximum working memory in bytes, capped at `kMBSArgon2MaxMemoryKiB`
+///   - error: Error object populated on failure with codes:
+///            - MBSCipherErrorInvalidInput (202): Non-positive latency or a budget below 8 KiB per lane
+///            - MBSCipherErrorKeyDerivationFailed (213): Working memory or a salt could not be obtained
+/// - Returns: Parameters with a fresh salt, or nil on error
++ (nullable MBSArgon2Parameters *)calibrateForTargetLatency:(NSTimeInterval)targetLatency
+                                               memoryBudget:(NSUInteger)memoryBudget
+                                                      error:(NSError **)error;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -8,7 +8,14 @@
 
 #import "MBSKeyDerivation.h"
 #import "MBSError.h"
+#import "MBSArgon2.h"
+#import "MBSPHCEncoding.h"
 #import <CommonCrypto/CommonHMAC.h>
+#import <errno.h>
+#import <time.h>
+
+static const NSInteger kMBSPasswordHashSize = 32;
+static const NSUInteger kMBSCalibrationMaxLanes = 8;
 
 @implementation MBSKeyDerivation
 
@@ -203,4 +210,192 @@
                      error:error];
 }
 
+// MARK: - Argon2id
+
+/**
+ * Runs Argon2id into `output`, describing any MBSArgon2Result other than MBSArgon2Ok in `error`.
+ */
++ (BOOL)argon2idWithPassword:(NSData *)password
+                  parameters:(MBSArgon2Parameters *)parameters
+                      output:(uint8_t *)output
+                      length:(uint32_t)length
+                       error:(NSError **)error {
+    MBSArgon2Context context = {
+        .password = password.bytes,
+        .passwordLength = password.length,
+        .salt = parameters.salt.bytes,
+        .saltLength = parameters.salt.length,
+        .iterations = parameters.iterations,
+        .memoryKiB = parameters.memoryKiB,
+        .lanes = parameters.parallelism,
+        .threads = (uint32_t)MIN((NSUInteger)parameters.parallelism, NSProcessInfo.processInfo.activeProcessorCount),
+    };
+    MBSArgon2Result result = MBSArgon2idHash(&context, output, length);
+    if (result == MBSArgon2Ok) {
+        return YES;
+    }
+
+    if (error) {
+        if (result == MBSArgon2MemoryAllocationFailed) {
+            NSString *description = [NSString stringWithFormat:@"Could not allocate %u KiB of Argon2 working memory", parameters.memoryKiB];
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorKeyDerivationFailed
+                                     userInfo:@{NSLocalizedDescriptionKey: description,
+                                                NSUnderlyingErrorKey: [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil]}];
+        } else if (result == MBSArgon2InvalidParameters) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Invalid Argon2id parameters"}];
+        } else {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorKeyDerivationFailed
+                                     userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Argon2id failed (%d)", (int)result]}];
+        }
+    }
+    return NO;
+}
+
++ (nullable NSData *)deriveKeyFromPassword:(NSData *)password
+                                parameters:(MBSArgon2Parameters *)parameters
+                                   keySize:(NSInteger)keySize
+                                     error:(NSError **)error {
+    if (keySize < MBS_ARGON2_MIN_OUTPUT || keySize > UINT32_MAX) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Key size must be at least 4 bytes"}];
+        }
+        return nil;
+    }
+
+    NSMutableData *key = [NSMutableData dataWithLength:keySize];
+    if (![self argon2idWithPassword:password parameters:parameters output:key.mutableBytes length:(uint32_t)keySize error:error]) {
+        return nil;
+    }
+    return key;
+}
+
++ (nullable NSString *)hashPassword:(NSData *)password
+                         parameters:(MBSArgon2Parameters *)parameters
+                              error:(NSError **)error {
+    NSData *hash = [self deriveKeyFromPassword:password parameters:parameters keySize:kMBSPasswordHashSize error:error];
+    if (!hash) {
+        return nil;
+    }
+    return [NSString stringWithFormat:@"%@$%@", parameters.encodedString, MBSPHCBase64Encode(hash)];
+}
+
++ (BOOL)verifyPassword:(NSData *)password
+           againstHash:(NSString *)encodedHash
+                 error:(NSError **)error {
+    // Stored costs are untrusted: parsing rejects memory and lanes past the limits hashing accepts
+    MBSArgon2Parameters *parameters = [MBSArgon2Parameters parametersFromEncodedString:encodedHash error:error];
+    if (!parameters) {
+        return NO;
+    }
+
+    // "", "argon2id", "v=19", costs, salt, hash
+    NSArray<NSString *> *fields = [encodedHash componentsSeparatedByString:@"$"];
+    NSData *expected = fields.count == 6 ? MBSPHCBase64Decode(fields[5]) : nil;
+    if (expected.length < MBS_ARGON2_MIN_OUTPUT) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Password hash string has no valid hash"}];
+        }
+        return NO;
+    }
+
+    NSData *actual = [self deriveKeyFromPassword:password parameters:parameters keySize:expected.length error:error];
+    if (!actual) {
+        return NO;
+    }
+
+    const uint8_t *a = actual.bytes;
+    const uint8_t *b = expected.bytes;
+    uint8_t difference = 0;
+    for (NSUInteger i = 0; i < expected.length; i++) {
+        difference |= a[i] ^ b[i];
+    }
+    if (difference != 0) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorAuthenticationFailed
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Password does not match"}];
+        }
+        return NO;
+    }
+    return YES;
+}
+
+/**
+ * Wall-clock seconds for one derivation, or a negative value if memory could not be allocated.
+ */
++ (NSTimeInterval)measureParameters:(MBSArgon2Parameters *)parameters error:(NSError **)error {
+    static const uint8_t password[] = "mbsecurecrypto-calibration";
+    NSData *passwordData = [NSData dataWithBytesNoCopy:(void *)password length:sizeof(password) - 1 freeWhenDone:NO];
+    uint8_t output[32];
+
+    uint64_t start = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+    BOOL success = [self argon2idWithPassword:passwordData parameters:parameters output:output length:sizeof(output) error:error];
+    uint64_t end = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+    return success ? (end - start) / 1e9 : -1;
+}
+
++ (nullable MBSArgon2Parameters *)calibrateForTargetLatency:(NSTimeInterval)targetLatency
+                                               memoryBudget:(NSUInteger)memoryBudget
+                                                      error:(NSError **)error {
+    uint32_t lanes = (uint32_t)MAX(1, MIN(NSProcessInfo.processInfo.activeProcessorCount, kMBSCalibrationMaxLanes));
+
+    // Argon2 rounds memory down to whole segments (4 per lane) anyway
+    uint64_t memoryKiB = MIN(memoryBudget / 1024, (NSUInteger)kMBSArgon2MaxMemoryKiB);
+    memoryKiB -= memoryKiB % (4 * lanes);
+    if (!(targetLatency > 0) || memoryKiB < 8 * lanes) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Calibration needs a positive latency and at least 8 KiB per lane"}];
+        }
+        return nil;
+    }
+
+    // Largest memory cost that fits the target with one pass
+    MBSArgon2Parameters *parameters = nil;
+    NSTimeInterval elapsed = 0;
+    while (YES) {
+        parameters = [MBSArgon2Parameters parametersWithMemoryKiB:(uint32_t)memoryKiB iterations:1 parallelism:lanes];
+        if (!parameters) {
+            if (error) {
+                *error = [NSError errorWithDomain:MBSErrorDomain
+                                             code:MBSCipherErrorKeyDerivationFailed
+                                         userInfo:@{NSLocalizedDescriptionKey: @"Could not generate a salt for calibration"}];
+            }
+            return nil;
+        }
+        elapsed = [self measureParameters:parameters error:error];
+        if (elapsed < 0) {
+            return nil;
+        }
+
+        uint64_t halved = (memoryKiB / 2) - (memoryKiB / 2) % (4 * lanes);
+        if (elapsed <= targetLatency || halved < 8 * lanes) {
+            break;
+        }
+        memoryKiB = halved;
+    }
+
+    // Spend the remaining time on passes, which cost roughly the same each
+    uint32_t iterations = (uint32_t)MAX(1.0, MIN(floor(targetLatency / MAX(elapsed, 1e-6)), 64.0));
+    while (iterations > 1) {
+        parameters = [MBSArgon2Parameters parametersWithMemoryKiB:(uint32_t)memoryKiB iterations:iterations parallelism:lanes];
+        elapsed = parameters ? [self measureParameters:parameters error:nil] : -1;
+        if (elapsed >= 0 && elapsed <= targetLatency * 1.1) {
+            break;
+        }
+        iterations--;
+    }
+
+    return [MBSArgon2Parameters parametersWithMemoryKiB:(uint32_t)memoryKiB iterations:iterations parallelism:lanes];
+}
+
 @end
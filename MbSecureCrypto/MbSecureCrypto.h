@@ -27,7 +27,18 @@ FOUNDATION_EXPORT const unsigned char MbSecureCryptoVersionString[];
 
 #import "MBSCipherTypes.h"
 #import "MBSCipher.h"
-
+#import "MBSCipherStream.h"
+#import "MBSBulkFileCipher.h"
+#import "MBSKeyProvider.h"
+#import "MBSEnvelopeCipher.h"
+#import "MBSMultiRecipientCipher.h"
+#import "MBSMigrationEngine.h"
+#import "MBSDirectoryCipher.h"
+
+#import "MBSArgon2Parameters.h"
 #import "MBSKeyDerivation.h"
 
+#import "MBSCryptoServiceClient.h"
+#import "MBSCryptoService.h"
+
 #import "MBSError.h"
@@ -0,0 +1,64 @@
+//
+//  MBSServiceProtocol.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import <Foundation/Foundation.h>
+#import "MBSCryptoServiceClient.h"
+#import <sys/un.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Internal use only: framing shared by MBSCryptoService and MBSCryptoServiceClient.
+// The frame layout is documented in MBSCryptoService.h.
+
+static const uint8_t kMBSServiceProtocolVersion = 1;
+
+/// Largest request frame, not counting its LENGTH field
+static const uint32_t kMBSServiceMaximumFrameLength = 64 * 1024 * 1024;
+
+/// Largest response frame. A result can outgrow its request by the V1 overhead
+/// or an error description, so responses get a per-entry allowance on top.
+static const uint32_t kMBSServiceMaximumResponseLength = kMBSServiceMaximumFrameLength + UINT16_MAX * 256;
+
+/// Longest key identifier or context, in UTF-8 bytes
+static const NSUInteger kMBSServiceMaximumFieldLength = 255;
+
+/// Longest error description sent back, in UTF-8 bytes
+static const NSUInteger kMBSServiceMaximumMessageLength = 200;
+
+@interface MBSCryptoServiceResult (Internal)
+- (instancetype)initWithData:(nullable NSData *)data error:(nullable NSError *)error;
+@end
+
+/// Fills a Unix socket address for `socketURL`; NO if the path does not fit in `sun_path`
+FOUNDATION_EXPORT BOOL MBSServiceSocketAddress(NSURL *socketURL, struct sockaddr_un *address);
+
+/// Reads one frame and returns it without its LENGTH field.
+///
+/// Returns nil with `*errorCode` set to 0 when the peer closed the connection
+/// between frames, EPROTO for a frame shorter than its fixed fields or longer
+/// than `maximumLength`, or the errno of a failed read.
+FOUNDATION_EXPORT NSData *_Nullable MBSServiceReadFrame(int fd, uint32_t maximumLength, int *errorCode);
+
+/// Writes a frame produced by one of the encoders; returns NO with errno set on failure
+FOUNDATION_EXPORT BOOL MBSServiceWriteFrame(int fd, NSData *frame);
+
+/// YES if the request's key identifier and context fit their length fields
+FOUNDATION_EXPORT BOOL MBSServiceRequestIsEncodable(MBSCryptoServiceRequest *request);
+
+/// Encodes a request batch, or returns nil if it exceeds kMBSServiceMaximumFrameLength
+FOUNDATION_EXPORT NSData *_Nullable MBSServiceEncodeRequests(uint32_t batchID, NSArray<MBSCryptoServiceRequest *> *requests);
+
+/// Decodes a frame from MBSServiceReadFrame, or returns nil if it is malformed
+FOUNDATION_EXPORT NSArray<MBSCryptoServiceRequest *> *_Nullable MBSServiceDecodeRequests(NSData *frame, uint32_t *batchID);
+
+FOUNDATION_EXPORT NSData *MBSServiceEncodeResults(uint32_t batchID, NSArray<MBSCryptoServiceResult *> *results);
+
+/// Decodes a frame from MBSServiceReadFrame, or returns nil if it is malformed
+FOUNDATION_EXPORT NSArray<MBSCryptoServiceResult *> *_Nullable MBSServiceDecodeResults(NSData *frame, uint32_t *batchID);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,319 @@
+//
+//  MBSServiceProtocol.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import "MBSServiceProtocol.h"
+#import <errno.h>
+#import <string.h>
+#import <sys/socket.h>
+#import <unistd.h>
+
+/// VERSION(1) + BATCH_ID(4) + COUNT(2)
+static const NSUInteger kMBSServiceFrameHeaderSize = 7;
+
+BOOL MBSServiceSocketAddress(NSURL *socketURL, struct sockaddr_un *address) {
+    const char *path = socketURL.fileSystemRepresentation;
+    if (!path || strlen(path) == 0 || strlen(path) >= sizeof(address->sun_path)) {
+        return NO;
+    }
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    strlcpy(address->sun_path, path, sizeof(address->sun_path));
+    return YES;
+}
+
+#pragma mark - Frames
+
+static BOOL MBSServiceReadFully(int fd, void *buffer, size_t length, BOOL *closed) {
+    size_t total = 0;
+    while (total < length) {
+        ssize_t count = read(fd, (uint8_t *)buffer + total, length - total);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count == 0) {
+            *closed = YES;
+            return NO;
+        }
+        if (count < 0) {
+            return NO;
+        }
+        total += (size_t)count;
+    }
+    return YES;
+}
+
+NSData *MBSServiceReadFrame(int fd, uint32_t maximumLength, int *errorCode) {
+    uint32_t lengthBE = 0;
+    BOOL closed = NO;
+    if (!MBSServiceReadFully(fd, &lengthBE, sizeof(lengthBE), &closed)) {
+        *errorCode = closed ? 0 : errno;
+        return nil;
+    }
+
+    uint32_t length = CFSwapInt32BigToHost(lengthBE);
+    if (length < kMBSServiceFrameHeaderSize || length > maximumLength) {
+        *errorCode = EPROTO;
+        return nil;
+    }
+
+    NSMutableData *frame = [NSMutableData dataWithLength:length];
+    if (!frame) {
+        *errorCode = ENOMEM;
+        return nil;
+    }
+    if (!MBSServiceReadFully(fd, frame.mutableBytes, length, &closed)) {
+        // A frame cut short is a protocol error, not a clean close
+        *errorCode = closed ? EPROTO : errno;
+        return nil;
+    }
+    return frame;
+}
+
+BOOL MBSServiceWriteFrame(int fd, NSData *frame) {
+    const uint8_t *bytes = frame.bytes;
+    size_t total = 0;
+    while (total < frame.length) {
+        ssize_t count = write(fd, bytes + total, frame.length - total);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return NO;
+        }
+        total += (size_t)count;
+    }
+    return YES;
+}
+
+#pragma mark - Encoding
+
+static void MBSServiceAppendUInt16(NSMutableData *data, uint16_t value) {
+    uint16_t valueBE = CFSwapInt16HostToBig(value);
+    [data appendBytes:&valueBE length:sizeof(valueBE)];
+}
+
+static void MBSServiceAppendUInt32(NSMutableData *data, uint32_t value) {
+    uint32_t valueBE = CFSwapInt32HostToBig(value);
+    [data appendBytes:&valueBE length:sizeof(valueBE)];
+}
+
+static void MBSServiceAppendField(NSMutableData *data, NSData *field) {
+    uint8_t length = (uint8_t)field.length;
+    [data appendBytes:&length length:1];
+    [data appendData:field];
+}
+
+/// [LENGTH placeholder][VERSION][BATCH_ID][COUNT]; the encoder patches LENGTH when done
+static NSMutableData *MBSServiceFrameHeader(uint32_t batchID, NSUInteger count, NSUInteger capacity) {
+    NSMutableData *frame = [NSMutableData dataWithCapacity:capacity];
+    MBSServiceAppendUInt32(frame, 0);
+    [frame appendBytes:&kMBSServiceProtocolVersion length:1];
+    MBSServiceAppendUInt32(frame, batchID);
+    MBSServiceAppendUInt16(frame, (uint16_t)count);
+    return frame;
+}
+
+static void MBSServiceFinishFrame(NSMutableData *frame) {
+    uint32_t lengthBE = CFSwapInt32HostToBig((uint32_t)(frame.length - sizeof(uint32_t)));
+    [frame replaceBytesInRange:NSMakeRange(0, sizeof(lengthBE)) withBytes:&lengthBE];
+}
+
+BOOL MBSServiceRequestIsEncodable(MBSCryptoServiceRequest *request) {
+    NSUInteger identifierLength = [request.keyIdentifier lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    NSUInteger contextLength = [request.context lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    return identifierLength > 0 && identifierLength <= kMBSServiceMaximumFieldLength &&
+           contextLength <= kMBSServiceMaximumFieldLength;
+}
+
+NSData *MBSServiceEncodeRequests(uint32_t batchID, NSArray<MBSCryptoServiceRequest *> *requests) {
+    NSUInteger length = kMBSServiceFrameHeaderSize;
+    for (MBSCryptoServiceRequest *request in requests) {
+        length += 7 + [request.keyIdentifier lengthOfBytesUsingEncoding:NSUTF8StringEncoding] +
+                  [request.context lengthOfBytesUsingEncoding:NSUTF8StringEncoding] + request.data.length;
+    }
+    if (length > kMBSServiceMaximumFrameLength) {
+        return nil;
+    }
+
+    NSMutableData *frame = MBSServiceFrameHeader(batchID, requests.count, sizeof(uint32_t) + length);
+    for (MBSCryptoServiceRequest *request in requests) {
+        uint8_t operation = request.operation;
+        [frame appendBytes:&operation length:1];
+        MBSServiceAppendField(frame, [request.keyIdentifier dataUsingEncoding:NSUTF8StringEncoding]);
+        MBSServiceAppendField(frame, [request.context dataUsingEncoding:NSUTF8StringEncoding]);
+        MBSServiceAppendUInt32(frame, (uint32_t)request.data.length);
+        [frame appendData:request.data];
+    }
+    MBSServiceFinishFrame(frame);
+    return frame;
+}
+
+/// Error descriptions are cut to kMBSServiceMaximumMessageLength bytes on a character boundary
+static NSData *MBSServiceMessageData(NSError *error) {
+    NSString *message = error.localizedDescription ?: @"";
+    while ([message lengthOfBytesUsingEncoding:NSUTF8StringEncoding] > kMBSServiceMaximumMessageLength) {
+        NSRange last = [message rangeOfComposedCharacterSequenceAtIndex:message.length - 1];
+        message = [message substringToIndex:last.location];
+    }
+    return [message dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+NSData *MBSServiceEncodeResults(uint32_t batchID, NSArray<MBSCryptoServiceResult *> *results) {
+    NSUInteger capacity = sizeof(uint32_t) + kMBSServiceFrameHeaderSize;
+    for (MBSCryptoServiceResult *result in results) {
+        capacity += 6 + (result.error ? kMBSServiceMaximumMessageLength : result.data.length);
+    }
+
+    NSMutableData *frame = MBSServiceFrameHeader(batchID, results.count, capacity);
+    for (MBSCryptoServiceResult *result in results) {
+        NSData *payload = result.data ?: [NSData data];
+        uint16_t status = 0;
+        if (result.error) {
+            // Codes outside the MBSCipherError range are reported as I/O failures
+            NSInteger code = result.error.code;
+            BOOL representable = [result.error.domain isEqualToString:MBSErrorDomain] && code > 0 && code <= UINT16_MAX;
+            status = representable ? (uint16_t)code : (uint16_t)MBSCipherErrorIOFailure;
+            payload = MBSServiceMessageData(result.error);
+        }
+        MBSServiceAppendUInt16(frame, status);
+        MBSServiceAppendUInt32(frame, (uint32_t)payload.length);
+        [frame appendData:payload];
+    }
+    MBSServiceFinishFrame(frame);
+    return frame;
+}
+
+#pragma mark - Decoding
+
+/// Bounds-checked reader over a received frame
+typedef struct {
+    const uint8_t *bytes;
+    size_t length;
+    size_t offset;
+} MBSServiceCursor;
+
+static BOOL MBSServiceReadBytes(MBSServiceCursor *cursor, size_t length, const uint8_t **bytes) {
+    if (cursor->length - cursor->offset < length) {
+        return NO;
+    }
+    *bytes = cursor->bytes + cursor->offset;
+    cursor->offset += length;
+    return YES;
+}
+
+static BOOL MBSServiceReadUInt8(MBSServiceCursor *cursor, uint8_t *value) {
+    const uint8_t *bytes = NULL;
+    if (!MBSServiceReadBytes(cursor, 1, &bytes)) {
+        return NO;
+    }
+    *value = bytes[0];
+    return YES;
+}
+
+static BOOL MBSServiceReadUInt16(MBSServiceCursor *cursor, uint16_t *value) {
+    const uint8_t *bytes = NULL;
+    if (!MBSServiceReadBytes(cursor, 2, &bytes)) {
+        return NO;
+    }
+    *value = (uint16_t)((bytes[0] << 8) | bytes[1]);
+    return YES;
+}
+
+static BOOL MBSServiceReadUInt32(MBSServiceCursor *cursor, uint32_t *value) {
+    const uint8_t *bytes = NULL;
+    if (!MBSServiceReadBytes(cursor, 4, &bytes)) {
+        return NO;
+    }
+    *value = ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+    return YES;
+}
+
+/// Reads a length-prefixed UTF-8 field; nil if truncated or not UTF-8
+static NSString *MBSServiceReadString(MBSServiceCursor *cursor) {
+    uint8_t length = 0;
+    const uint8_t *bytes = NULL;
+    if (!MBSServiceReadUInt8(cursor, &length) || !MBSServiceReadBytes(cursor, length, &bytes)) {
+        return nil;
+    }
+    return [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+}
+
+static NSData *MBSServiceReadPayload(MBSServiceCursor *cursor) {
+    uint32_t length = 0;
+    const uint8_t *bytes = NULL;
+    if (!MBSServiceReadUInt32(cursor, &length) || !MBSServiceReadBytes(cursor, length, &bytes)) {
+        return nil;
+    }
+    return [NSData dataWithBytes:bytes length:length];
+}
+
+/// Checks VERSION and reads BATCH_ID and COUNT
+static BOOL MBSServiceReadFrameHeader(MBSServiceCursor *cursor, uint32_t *batchID, uint16_t *count) {
+    uint8_t version = 0;
+    return MBSServiceReadUInt8(cursor, &version) && version == kMBSServiceProtocolVersion &&
+           MBSServiceReadUInt32(cursor, batchID) && MBSServiceReadUInt16(cursor, count);
+}
+
+NSArray<MBSCryptoServiceRequest *> *MBSServiceDecodeRequests(NSData *frame, uint32_t *batchID) {
+    MBSServiceCursor cursor = {frame.bytes, frame.length, 0};
+    uint16_t count = 0;
+    if (!MBSServiceReadFrameHeader(&cursor, batchID, &count)) {
+        return nil;
+    }
+
+    NSMutableArray<MBSCryptoServiceRequest *> *requests = [NSMutableArray arrayWithCapacity:count];
+    for (uint16_t i = 0; i < count; i++) {
+        uint8_t operation = 0;
+        if (!MBSServiceReadUInt8(&cursor, &operation) ||
+            operation < MBSCryptoServiceOperationSeal || operation > MBSCryptoServiceOperationDerive) {
+            return nil;
+        }
+        NSString *keyIdentifier = MBSServiceReadString(&cursor);
+        NSString *context = MBSServiceReadString(&cursor);
+        NSData *data = MBSServiceReadPayload(&cursor);
+        if (keyIdentifier.length == 0 || !context || !data) {
+            return nil;
+        }
+        [requests addObject:[[MBSCryptoServiceRequest alloc] initWithOperation:operation
+                                                                 keyIdentifier:keyIdentifier
+                                                                       context:context
+                                                                          data:data]];
+    }
+    return cursor.offset == cursor.length ? requests : nil;
+}
+
+NSArray<MBSCryptoServiceResult *> *MBSServiceDecodeResults(NSData *frame, uint32_t *batchID) {
+    MBSServiceCursor cursor = {frame.bytes, frame.length, 0};
+    uint16_t count = 0;
+    if (!MBSServiceReadFrameHeader(&cursor, batchID, &count)) {
+        return nil;
+    }
+
+    NSMutableArray<MBSCryptoServiceResult *> *results = [NSMutableArray arrayWithCapacity:count];
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t status = 0;
+        if (!MBSServiceReadUInt16(&cursor, &status)) {
+            return nil;
+        }
+        NSData *payload = MBSServiceReadPayload(&cursor);
+        if (!payload) {
+            return nil;
+        }
+
+        if (status == 0) {
+            [results addObject:[[MBSCryptoServiceResult alloc] initWithData:payload error:nil]];
+        } else {
+            NSString *message = [[NSString alloc] initWithData:payload encoding:NSUTF8StringEncoding] ?: @"Request failed";
+            NSError *error = [NSError errorWithDomain:MBSErrorDomain
+                                                 code:status
+                                             userInfo:@{NSLocalizedDescriptionKey: message}];
+            [results addObject:[[MBSCryptoServiceResult alloc] initWithData:nil error:error]];
+        }
+    }
+    return cursor.offset == cursor.length ? results : nil;
+}
@@ -0,0 +1,125 @@
+//
+//  MBSCryptoService.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import <Foundation/Foundation.h>
+#import "MBSError.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// HKDF domain under which the service derives per-context keys for seal and open requests
+FOUNDATION_EXPORT NSString *const kMBSCryptoServiceKeyDomain;
+
+/// HKDF domain under which the service derives the keys it returns to derive requests
+FOUNDATION_EXPORT NSString *const kMBSCryptoServiceDeriveDomain;
+
+/// Performs seal, open and derive requests for local clients that name keys by identifier.
+///
+/// Processes that share keys can hand them to one service instead of each
+/// loading and deriving its own copy. The service holds the registered keys
+/// and a cache of derived keys; ``MBSCryptoServiceClient`` connects over a
+/// Unix socket and sends batches of requests. Batches that arrive while a round
+/// is running are collected and performed together on `workerCount` workers,
+/// and each batch is answered in one frame once its requests finish.
+///
+/// A request with a non-empty context uses the key
+/// ```objc
+/// [MBSKeyDerivation deriveKey:registeredKey domain:kMBSCryptoServiceKeyDomain context:context error:&error]
+/// ```
+/// so data sealed by the service can be opened without it by a holder of the
+/// registered key. An empty context uses the registered key directly.
+///
+/// Derive requests return a key derived the same way under
+/// `kMBSCryptoServiceDeriveDomain` instead. A client can use it for its own
+/// encryption, but it does not open data sealed by the service, so handing a
+/// derived key out never exposes what other clients seal under that context.
+///
+/// The socket is created with mode 0600, and connections from other users are
+/// refused. Frames are big-endian:
+/// ```
+/// FRAME    = [LENGTH(4)][VERSION(1)][BATCH_ID(4)][COUNT(2)][ENTRY...]
+/// REQUEST  = [OPERATION(1)][KEY_ID_LEN(1)][KEY_ID][CONTEXT_LEN(1)][CONTEXT][DATA_LEN(4)][DATA]
+/// RESULT   = [STATUS(2)][DATA_LEN(4)][DATA]
+/// ```
+/// STATUS is 0 on success, or an MBSCipherError code with a UTF-8 description as DATA.
+/// A malformed frame or one over 64 MiB closes the connection.
+///
+/// ```objc
+/// MBSCryptoService *service = [[MBSCryptoService alloc] initWithSocketURL:socketURL];
+/// [service registerKey:ordersKey withIdentifier:@"orders" error:&error];
+/// [service startWithError:&error];
+/// ```
+///
+/// Each connection is served by its own reader thread, so at most
+/// `maximumConnectionCount` clients are connected at once; further connections
+/// are closed as soon as they are accepted.
+///
+/// @note Derive requests return key material to the client. Neither the
+///       registered key nor the keys used for sealing are ever returned:
+///       deriving requires a non-empty context and uses its own domain.
+API_AVAILABLE(macos(12.4), ios(15.6))
+@interface MBSCryptoService : NSObject
+
+@property (nonatomic, readonly, copy) NSURL *socketURL;
+
+/// Number of concurrent crypto workers. Defaults to the active processor count.
+@property (nonatomic, assign) NSUInteger workerCount;
+
+/// Maximum number of derived keys kept, least recently used first out. Defaults to 1024; 0 disables caching.
+/// Takes effect at the next ``startWithError:``.
+@property (nonatomic, assign) NSUInteger derivedKeyCacheCapacity;
+
+/// Maximum number of clients connected at once. Defaults to 64.
+@property (nonatomic, assign) NSUInteger maximumConnectionCount;
+
+/// Identifiers of the registered keys
+@property (nonatomic, readonly) NSArray<NSString *> *keyIdentifiers;
+
+@property (nonatomic, readonly, getter=isRunning) BOOL running;
+
+- (instancetype)initWithSocketURL:(NSURL *)socketURL NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Makes a key available to clients, replacing any key with the same identifier.
+///
+/// Keys may be registered and removed while the service is running. The
+/// service keeps its own copy and wipes it when the key is removed or replaced
+/// and no request is still using it.
+///
+/// @param key 32-byte key
+/// @param identifier 1 to 255 bytes of UTF-8
+/// @param error Error object populated on failure with codes:
+///              - MBSCipherErrorInvalidKey (200): Key is not 32 bytes
+///              - MBSCipherErrorInvalidInput (202): Empty or oversized identifier
+///
+/// @return YES if registered, NO if an error occurred
+- (BOOL)registerKey:(NSData *)key withIdentifier:(NSString *)identifier error:(NSError **)error;
+
+/// Removes a key and the keys derived from it; later requests naming it fail with MBSCipherErrorInvalidKey (200)
+- (void)removeKeyWithIdentifier:(NSString *)identifier;
+
+/// Creates the socket and starts accepting clients.
+///
+/// A stale socket left by a service that exited is replaced; a socket another
+/// service is listening on is not.
+///
+/// @param error Error object populated on failure with codes:
+///              - MBSCipherErrorInvalidInput (202): Already running, socket path too long,
+///                or another service or a non-socket file at the path
+///              - MBSCipherErrorIOFailure (220): Socket could not be created
+///              - MBSCipherErrorFilePermission (222): Socket directory not writable
+///
+/// @return YES if started, NO if an error occurred
+- (BOOL)startWithError:(NSError **)error;
+
+/// Stops accepting clients, closes every connection and removes the socket.
+/// Batches already being performed finish, but their results are not delivered.
+- (void)stop;
+
+@end
+
+NS_ASSUME_NONNULL_END
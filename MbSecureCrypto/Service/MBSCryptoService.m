@@ -0,0 +1,587 @@
+//
+//  MBSCryptoService.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import "MBSCryptoService.h"
+#import "MBSCryptoServiceClient.h"
+#import "MBSCipher.h"
+#import "MBSKeyDerivation.h"
+#import "MBSDataKeyCache.h"
+#import "MBSFileUtilities.h"
+#import "MBSServiceProtocol.h"
+#import <errno.h>
+#import <fcntl.h>
+#import <sys/socket.h>
+#import <sys/stat.h>
+#import <unistd.h>
+
+NSString *const kMBSCryptoServiceKeyDomain = @"MbSecureCrypto.service";
+NSString *const kMBSCryptoServiceDeriveDomain = @"MbSecureCrypto.service.derive";
+
+static const NSUInteger kMBSServiceDefaultCacheCapacity = 1024;
+static const NSUInteger kMBSServiceDefaultMaximumConnectionCount = 64;
+
+/// Frames a connection may have waiting for results before the service stops reading from it
+static const long kMBSServiceMaximumBatchesInFlight = 4;
+
+static NSError *MBSServiceInvalidInputError(NSString *description) {
+    return [NSError errorWithDomain:MBSErrorDomain
+                               code:MBSCipherErrorInvalidInput
+                           userInfo:@{NSLocalizedDescriptionKey: description}];
+}
+
+#pragma mark - Connection
+
+/// One accepted client. Responses and the final close go through `writeQueue`
+/// so a slow reader never holds up a round, and the descriptor is never used
+/// after it is closed.
+@interface MBSServiceConnection : NSObject
+@property (nonatomic, readonly) int socket;
+@property (nonatomic, strong, readonly) dispatch_queue_t writeQueue;
+@property (nonatomic, strong, readonly) dispatch_semaphore_t batchesInFlight;
+/// Weak, so a reader blocked on the socket never keeps the service alive
+@property (nonatomic, weak) MBSCryptoService *service;
+@end
+
+@implementation MBSServiceConnection {
+    BOOL _closed;
+}
+
+- (instancetype)initWithSocket:(int)socket {
+    self = [super init];
+    if (self) {
+        _socket = socket;
+        _writeQueue = dispatch_queue_create("com.mbsecurecrypto.service.connection", DISPATCH_QUEUE_SERIAL);
+        _batchesInFlight = dispatch_semaphore_create(kMBSServiceMaximumBatchesInFlight);
+    }
+    return self;
+}
+
+- (void)sendFrame:(NSData *)frame {
+    dispatch_async(self.writeQueue, ^{
+        // Only the write queue closes the descriptor, so it stays valid for the whole write
+        if (!self->_closed && !MBSServiceWriteFrame(self.socket, frame)) {
+            // The reader sees the same failure and ends the connection
+            [self shutdown];
+        }
+        dispatch_semaphore_signal(self.batchesInFlight);
+    });
+}
+
+/// Unblocks the reader and any write in progress; the descriptor stays open until ``closeAfterPendingWrites``
+- (void)shutdown {
+    @synchronized (self) {
+        if (!_closed) {
+            shutdown(self.socket, SHUT_RDWR);
+        }
+    }
+}
+
+- (void)closeAfterPendingWrites {
+    dispatch_async(self.writeQueue, ^{
+        @synchronized (self) {
+            self->_closed = YES;
+            close(self.socket);
+        }
+    });
+}
+
+@end
+
+#pragma mark - Batch
+
+/// Requests from one frame, performed in the next round
+@interface MBSServiceBatch : NSObject
+@property (nonatomic, strong) MBSServiceConnection *connection;
+@property (nonatomic, assign) uint32_t batchID;
+@property (nonatomic, copy) NSArray<MBSCryptoServiceRequest *> *requests;
+@property (nonatomic, strong) NSMutableArray<MBSCryptoServiceResult *> *results;
+@end
+
+@implementation MBSServiceBatch
+@end
+
+#pragma mark - MBSCryptoService
+
+@interface MBSCryptoService ()
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSData *> *keys;
+@property (nonatomic, strong, nullable) MBSDataKeyCache *derivedKeys;
+@property (nonatomic, strong, nullable) dispatch_source_t acceptSource;
+@property (nonatomic, strong) dispatch_queue_t acceptQueue;
+@property (nonatomic, strong) dispatch_queue_t roundQueue;
+@property (nonatomic, strong) NSMutableSet<MBSServiceConnection *> *connections;
+@property (nonatomic, strong) NSMutableArray<MBSServiceBatch *> *pendingBatches;
+@property (nonatomic, assign) BOOL roundScheduled;
+@property (nonatomic, assign) dev_t socketDevice;
+@property (nonatomic, assign) ino_t socketInode;
+@end
+
+@implementation MBSCryptoService
+
+- (instancetype)initWithSocketURL:(NSURL *)socketURL {
+    self = [super init];
+    if (self) {
+        _socketURL = [socketURL copy];
+        _workerCount = NSProcessInfo.processInfo.activeProcessorCount;
+        _derivedKeyCacheCapacity = kMBSServiceDefaultCacheCapacity;
+        _maximumConnectionCount = kMBSServiceDefaultMaximumConnectionCount;
+        _keys = [NSMutableDictionary dictionary];
+        _connections = [NSMutableSet set];
+        _pendingBatches = [NSMutableArray array];
+        _acceptQueue = dispatch_queue_create("com.mbsecurecrypto.service.accept", DISPATCH_QUEUE_SERIAL);
+        _roundQueue = dispatch_queue_create("com.mbsecurecrypto.service.round", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [self stop];
+}
+
+#pragma mark - Keys
+
+- (NSArray<NSString *> *)keyIdentifiers {
+    @synchronized (self.keys) {
+        return [self.keys.allKeys sortedArrayUsingSelector:@selector(compare:)];
+    }
+}
+
+- (BOOL)registerKey:(NSData *)key withIdentifier:(NSString *)identifier error:(NSError **)error {
+    if (key.length != 32) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidKey
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Invalid key size"}];
+        }
+        return NO;
+    }
+
+    NSUInteger identifierLength = [identifier lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    if (identifierLength == 0 || identifierLength > kMBSServiceMaximumFieldLength) {
+        if (error) {
+            *error = MBSServiceInvalidInputError(@"Key identifier must be 1 to 255 bytes");
+        }
+        return NO;
+    }
+
+    NSData *copy = [[MBSZeroizingData alloc] initWithKeyBytes:key] ?: [key copy];
+    @synchronized (self.keys) {
+        self.keys[identifier] = copy;
+        [self.derivedKeys removeDataKeysForKeyIdentifier:identifier];
+    }
+    return YES;
+}
+
+- (void)removeKeyWithIdentifier:(NSString *)identifier {
+    @synchronized (self.keys) {
+        [self.keys removeObjectForKey:identifier];
+        [self.derivedKeys removeDataKeysForKeyIdentifier:identifier];
+    }
+}
+
+/// The registered key for an empty context, otherwise the key derived for the context under `domain`
+- (nullable NSData *)keyForIdentifier:(NSString *)identifier
+                              context:(NSString *)context
+                               domain:(NSString *)domain
+                                error:(NSError **)error {
+    NSData *registered = nil;
+    MBSDataKeyCache *cache = nil;
+    @synchronized (self.keys) {
+        registered = self.keys[identifier];
+        cache = self.derivedKeys;
+    }
+    if (!registered) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidKey
+                                     userInfo:@{NSLocalizedDescriptionKey: @"No key is registered under this identifier"}];
+        }
+        return nil;
+    }
+    if (context.length == 0) {
+        return registered;
+    }
+
+    // The cache maps (identifier, domain, context) to the derived key; domains contain no newline
+    NSData *cacheKey = [[NSString stringWithFormat:@"%@\n%@", domain, context] dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *derived = [cache dataKeyForWrappedKey:cacheKey keyIdentifier:identifier];
+    if (derived) {
+        return derived;
+    }
+
+    derived = [MBSKeyDerivation deriveKey:registered domain:domain context:context error:error];
+    if (!derived) {
+        return nil;
+    }
+    @synchronized (self.keys) {
+        // A key replaced or removed meanwhile must not leave its derived keys behind
+        if (self.keys[identifier] == registered) {
+            derived = [cache cacheDataKey:derived forWrappedKey:cacheKey keyIdentifier:identifier];
+        }
+    }
+    return derived;
+}
+
+#pragma mark - Requests
+
+- (MBSCryptoServiceResult *)resultForRequest:(MBSCryptoServiceRequest *)request {
+    NSError *error = nil;
+    NSData *data = nil;
+
+    if (request.operation == MBSCryptoServiceOperationDerive && request.context.length == 0) {
+        error = MBSServiceInvalidInputError(@"Derive requests need a context");
+        return [[MBSCryptoServiceResult alloc] initWithData:nil error:error];
+    }
+
+    // Keys handed to clients come from their own domain, so they cannot open what the service seals
+    NSString *domain = request.operation == MBSCryptoServiceOperationDerive ? kMBSCryptoServiceDeriveDomain
+                                                                              : kMBSCryptoServiceKeyDomain;
+    NSData *key = [self keyForIdentifier:request.keyIdentifier context:request.context domain:domain error:&error];
+    if (key) {
+        switch (request.operation) {
+            case MBSCryptoServiceOperationSeal:
+                data = [MBSCipher encryptData:request.data
+                                withAlgorithm:MBSCipherAlgorithmAESGCM
+                                   withFormat:@(MBSCipherFormatV1)
+                                      withKey:key
+                                        error:&error];
+                break;
+            case MBSCryptoServiceOperationOpen:
+                data = [MBSCipher decryptData:request.data
+                                withAlgorithm:MBSCipherAlgorithmAESGCM
+                                   withFormat:@(MBSCipherFormatV1)
+                                      withKey:key
+                                        error:&error];
+                break;
+            case MBSCryptoServiceOperationDerive:
+                data = key;
+                break;
+        }
+    }
+
+    return [[MBSCryptoServiceResult alloc] initWithData:data error:data ? nil : error];
+}
+
+/// Queues a batch for the next round, starting one if none is running
+- (void)enqueueBatch:(MBSServiceBatch *)batch {
+    BOOL schedule = NO;
+    @synchronized (self.pendingBatches) {
+        [self.pendingBatches addObject:batch];
+        if (!self.roundScheduled) {
+            self.roundScheduled = YES;
+            schedule = YES;
+        }
+    }
+    if (schedule) {
+        dispatch_async(self.roundQueue, ^{
+            [self runRounds];
+        });
+    }
+}
+
+/// Performs everything that arrived while the previous round ran, until nothing is left
+- (void)runRounds {
+    while (YES) {
+        NSArray<MBSServiceBatch *> *batches = nil;
+        @synchronized (self.pendingBatches) {
+            if (self.pendingBatches.count == 0) {
+                self.roundScheduled = NO;
+                return;
+            }
+            batches = [self.pendingBatches copy];
+            [self.pendingBatches removeAllObjects];
+        }
+        @autoreleasepool {
+            [self performBatches:batches];
+        }
+    }
+}
+
+/// Spreads the requests of every batch in the round over the workers, then answers each batch
+- (void)performBatches:(NSArray<MBSServiceBatch *> *)batches {
+    NSMutableArray<MBSServiceBatch *> *owners = [NSMutableArray array];
+    NSMutableArray<NSNumber *> *indexes = [NSMutableArray array];
+    for (MBSServiceBatch *batch in batches) {
+        batch.results = [NSMutableArray arrayWithCapacity:batch.requests.count];
+        for (NSUInteger i = 0; i < batch.requests.count; i++) {
+            [batch.results addObject:(MBSCryptoServiceResult *)[NSNull null]];
+            [owners addObject:batch];
+            [indexes addObject:@(i)];
+        }
+    }
+
+    if (owners.count > 0) {
+        __block NSUInteger next = 0;
+        dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+        dispatch_apply(MIN(MAX(self.workerCount, (NSUInteger)1), owners.count), queue, ^(size_t worker) {
+            while (YES) {
+                NSUInteger index;
+                @synchronized (owners) {
+                    index = next++;
+                }
+                if (index >= owners.count) {
+                    break;
+                }
+                @autoreleasepool {
+                    MBSServiceBatch *batch = owners[index];
+                    NSUInteger position = indexes[index].unsignedIntegerValue;
+                    MBSCryptoServiceResult *result = [self resultForRequest:batch.requests[position]];
+                    @synchronized (batch) {
+                        batch.results[position] = result;
+                    }
+                }
+            }
+        });
+    }
+
+    for (MBSServiceBatch *batch in batches) {
+        [batch.connection sendFrame:MBSServiceEncodeResults(batch.batchID, batch.results)];
+    }
+}
+
+#pragma mark - Connections
+
+/// Reads frames until the connection ends.
+///
+/// Runs on the connection's own thread and holds the service only while
+/// handing over a batch, so releasing the service stops it and ends the reader.
++ (void)readFramesFromConnection:(MBSServiceConnection *)connection {
+    while (YES) {
+        @autoreleasepool {
+            int readError = 0;
+            NSData *frame = MBSServiceReadFrame(connection.socket, kMBSServiceMaximumFrameLength, &readError);
+            uint32_t batchID = 0;
+            NSArray<MBSCryptoServiceRequest *> *requests = frame ? MBSServiceDecodeRequests(frame, &batchID) : nil;
+            if (!requests) {
+                break;
+            }
+
+            MBSServiceBatch *batch = [[MBSServiceBatch alloc] init];
+            batch.connection = connection;
+            batch.batchID = batchID;
+            batch.requests = requests;
+            dispatch_semaphore_wait(connection.batchesInFlight, DISPATCH_TIME_FOREVER);
+
+            MBSCryptoService *service = connection.service;
+            if (!service) {
+                break;
+            }
+            [service enqueueBatch:batch];
+        }
+    }
+
+    MBSCryptoService *service = connection.service;
+    if (service) {
+        @synchronized (service) {
+            [service.connections removeObject:connection];
+        }
+    }
+    [connection closeAfterPendingWrites];
+}
+
+- (void)acceptConnectionsOnSocket:(int)listener {
+    while (YES) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // EAGAIN: every pending connection has been accepted
+            return;
+        }
+
+        // Accepted sockets inherit O_NONBLOCK from the listener; readers block
+        int flags = fcntl(fd, F_GETFL);
+        fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+
+        uid_t uid = 0;
+        gid_t gid = 0;
+        if (getpeereid(fd, &uid, &gid) != 0 || uid != geteuid()) {
+            close(fd);
+            continue;
+        }
+
+        int enabled = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+
+        MBSServiceConnection *connection = [[MBSServiceConnection alloc] initWithSocket:fd];
+        connection.service = self;
+        @synchronized (self) {
+            if (!self.acceptSource) {
+                close(fd);
+                return;
+            }
+            // Each connection has a reader thread; past the limit clients see the connection closed
+            if (self.connections.count >= MAX(self.maximumConnectionCount, (NSUInteger)1)) {
+                close(fd);
+                continue;
+            }
+            [self.connections addObject:connection];
+        }
+
+        NSThread *reader = [[NSThread alloc] initWithBlock:^{
+            [MBSCryptoService readFramesFromConnection:connection];
+        }];
+        reader.name = @"com.mbsecurecrypto.service.reader";
+        [reader start];
+    }
+}
+
+#pragma mark - Lifecycle
+
+- (BOOL)isRunning {
+    @synchronized (self) {
+        return self.acceptSource != nil;
+    }
+}
+
+/// Removes a socket left by a service that exited; refuses one that is still in use
+- (BOOL)removeStaleSocketAtAddress:(const struct sockaddr_un *)address error:(NSError **)error {
+    struct stat status;
+    if (lstat(address->sun_path, &status) != 0) {
+        if (errno == ENOENT) {
+            return YES;
+        }
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to inspect socket path", errno);
+        }
+        return NO;
+    }
+
+    if (!S_ISSOCK(status.st_mode)) {
+        if (error) {
+            *error = MBSServiceInvalidInputError(@"A file that is not a socket exists at the socket path");
+        }
+        return NO;
+    }
+
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to create socket", errno);
+        }
+        return NO;
+    }
+    int result = connect(probe, (const struct sockaddr *)address, sizeof(*address));
+    int connectError = errno;
+    close(probe);
+
+    if (result == 0) {
+        if (error) {
+            *error = MBSServiceInvalidInputError(@"Another service is listening on the socket");
+        }
+        return NO;
+    }
+    if (connectError != ECONNREFUSED) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to inspect existing socket", connectError);
+        }
+        return NO;
+    }
+    if (unlink(address->sun_path) != 0 && errno != ENOENT) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to remove stale socket", errno);
+        }
+        return NO;
+    }
+    return YES;
+}
+
+- (BOOL)startWithError:(NSError **)error {
+    @synchronized (self) {
+        if (self.acceptSource) {
+            if (error) {
+                *error = MBSServiceInvalidInputError(@"Service is already running");
+            }
+            return NO;
+        }
+
+        struct sockaddr_un address;
+        if (!MBSServiceSocketAddress(self.socketURL, &address)) {
+            if (error) {
+                *error = MBSServiceInvalidInputError(@"Socket path is empty or too long");
+            }
+            return NO;
+        }
+        if (![self removeStaleSocketAtAddress:&address error:error]) {
+            return NO;
+        }
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            if (error) {
+                *error = MBSPOSIXError(@"Failed to create socket", errno);
+            }
+            return NO;
+        }
+
+        // Clients of other users are also refused at accept, which covers the
+        // moment between bind and chmod
+        struct stat status;
+        if (bind(fd, (const struct sockaddr *)&address, sizeof(address)) != 0 ||
+            chmod(address.sun_path, S_IRUSR | S_IWUSR) != 0 ||
+            listen(fd, SOMAXCONN) != 0 ||
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == -1 ||
+            stat(address.sun_path, &status) != 0) {
+            int socketError = errno;
+            close(fd);
+            unlink(address.sun_path);
+            if (error) {
+                *error = MBSPOSIXError(@"Failed to listen on socket", socketError);
+            }
+            return NO;
+        }
+        self.socketDevice = status.st_dev;
+        self.socketInode = status.st_ino;
+
+        @synchronized (self.keys) {
+            self.derivedKeys = [[MBSDataKeyCache alloc] initWithCapacity:self.derivedKeyCacheCapacity];
+        }
+
+        __weak MBSCryptoService *weakSelf = self;
+        dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, (uintptr_t)fd, 0, self.acceptQueue);
+        dispatch_source_set_event_handler(source, ^{
+            [weakSelf acceptConnectionsOnSocket:fd];
+        });
+        dispatch_source_set_cancel_handler(source, ^{
+            close(fd);
+        });
+        self.acceptSource = source;
+        dispatch_resume(source);
+        return YES;
+    }
+}
+
+- (void)stop {
+    NSArray<MBSServiceConnection *> *connections = nil;
+    @synchronized (self) {
+        if (!self.acceptSource) {
+            return;
+        }
+        dispatch_source_cancel(self.acceptSource);
+        self.acceptSource = nil;
+        connections = self.connections.allObjects;
+        [self.connections removeAllObjects];
+
+        // Leave the path alone if another service has taken it over since
+        struct stat status;
+        const char *path = self.socketURL.fileSystemRepresentation;
+        if (lstat(path, &status) == 0 && status.st_dev == self.socketDevice && status.st_ino == self.socketInode) {
+            unlink(path);
+        }
+    }
+
+    for (MBSServiceConnection *connection in connections) {
+        [connection shutdown];
+    }
+
+    @synchronized (self.keys) {
+        [self.derivedKeys removeAllDataKeys];
+    }
+}
+
+@end
@@ -0,0 +1,150 @@
+//
+//  MBSCryptoServiceClient.h
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import <Foundation/Foundation.h>
+#import "MBSError.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Operations a ``MBSCryptoService`` performs for its clients
+typedef NS_ENUM(uint8_t, MBSCryptoServiceOperation) {
+    /// Encrypts the request data to MBSCipherFormatV1 with AES-256-GCM
+    MBSCryptoServiceOperationSeal = 1,
+    /// Decrypts V1 data produced by a seal request
+    MBSCryptoServiceOperationOpen = 2,
+    /// Returns a 32-byte key derived for the request context. It is derived under
+    /// `kMBSCryptoServiceDeriveDomain`, so it does not open data sealed by the service.
+    MBSCryptoServiceOperationDerive = 3
+};
+
+/// One operation in a batch sent to ``MBSCryptoService``.
+///
+/// Keys are named by the identifier they were registered under in the service.
+/// A non-empty context selects the key derived from it, as described in
+/// ``MBSCryptoService``; an empty context uses the registered key itself.
+API_AVAILABLE(macos(12.4), ios(15.6))
+@interface MBSCryptoServiceRequest : NSObject
+
+@property (nonatomic, readonly) MBSCryptoServiceOperation operation;
+@property (nonatomic, readonly, copy) NSString *keyIdentifier;
+@property (nonatomic, readonly, copy) NSString *context;
+@property (nonatomic, readonly, copy) NSData *data;
+
++ (instancetype)sealRequestWithData:(NSData *)data keyIdentifier:(NSString *)keyIdentifier context:(NSString *)context;
++ (instancetype)openRequestWithData:(NSData *)data keyIdentifier:(NSString *)keyIdentifier context:(NSString *)context;
++ (instancetype)deriveRequestWithKeyIdentifier:(NSString *)keyIdentifier context:(NSString *)context;
+
+- (instancetype)initWithOperation:(MBSCryptoServiceOperation)operation
+                    keyIdentifier:(NSString *)keyIdentifier
+                          context:(NSString *)context
+                             data:(NSData *)data NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+/// Outcome of one ``MBSCryptoServiceRequest``: exactly one of `data` and `error` is set
+API_AVAILABLE(macos(12.4), ios(15.6))
+@interface MBSCryptoServiceResult : NSObject
+
+@property (nonatomic, readonly, copy, nullable) NSData *data;
+@property (nonatomic, readonly, strong, nullable) NSError *error;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+/// Sends seal, open and derive requests to a ``MBSCryptoService`` over its Unix socket.
+///
+/// The client never sees the registered keys; it names them by identifier.
+/// Requests passed together to ``performRequests:error:`` travel in one frame
+/// and are answered in one frame, so a process with many small payloads pays
+/// one round trip per batch rather than per payload.
+///
+/// The connection is opened on first use and kept until ``close`` is called.
+/// If the service closed it in the meantime, e.g. because it was restarted,
+/// the next batch reconnects and is sent once more; every operation can be
+/// repeated safely.
+///
+/// A batch whose response does not arrive within `timeout` fails with
+/// MBSCipherErrorIOFailure and closes the connection; it is not sent again,
+/// since the service may still be performing it.
+///
+/// A client is safe to use from multiple threads; batches from one client are
+/// sent one at a time, so use a client per thread for concurrent batches.
+///
+/// ```objc
+/// MBSCryptoServiceClient *client = [[MBSCryptoServiceClient alloc] initWithSocketURL:socketURL];
+/// NSData *sealed = [client sealData:record withKeyIdentifier:@"orders" context:@"tenant-42" error:&error];
+/// NSData *opened = [client openData:sealed withKeyIdentifier:@"orders" context:@"tenant-42" error:&error];
+/// ```
+API_AVAILABLE(macos(12.4), ios(15.6))
+@interface MBSCryptoServiceClient : NSObject
+
+@property (nonatomic, readonly, copy) NSURL *socketURL;
+
+/// YES while a connection to the service is open
+@property (nonatomic, readonly, getter=isConnected) BOOL connected;
+
+/// Seconds to wait for the service to accept a frame or send a response; 0 waits indefinitely.
+/// Defaults to 30. Takes effect when the next connection is opened.
+@property (nonatomic, assign) NSTimeInterval timeout;
+
+- (instancetype)initWithSocketURL:(NSURL *)socketURL NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Connects to the service. Does nothing if already connected.
+///
+/// @param error Error object populated on failure with codes:
+///              - MBSCipherErrorInvalidInput (202): Socket path too long
+///              - MBSCipherErrorIOFailure (220): No service listening on the socket
+///              - MBSCipherErrorFilePermission (222): Socket not accessible
+///
+/// @return YES if connected, NO if an error occurred
+- (BOOL)connectWithError:(NSError **)error;
+
+/// Closes the connection; the next request reconnects
+- (void)close;
+
+/// Sends requests as one batch and waits for their results.
+///
+/// @param requests Requests to perform, at most 65535
+/// @param error Error object populated when the batch could not be exchanged:
+///              - MBSCipherErrorInvalidInput (202): No requests, too many requests, an empty
+///                or oversized key identifier or context, or a batch over the frame limit
+///              - MBSCipherErrorIOFailure (220): Connection failed, was closed by the
+///                service, timed out, or returned a malformed response
+///
+/// @return One result per request in the same order, or nil if the batch failed.
+///         A failed request sets its result's `error` with the code the service
+///         reported, e.g. MBSCipherErrorInvalidKey (200) for an unknown key identifier
+///         or MBSCipherErrorAuthenticationFailed (212) for data that does not open.
+- (nullable NSArray<MBSCryptoServiceResult *> *)performRequests:(NSArray<MBSCryptoServiceRequest *> *)requests
+                                                          error:(NSError **)error;
+
+/// Seals one payload, returning V1 data or nil with the request or batch error
+- (nullable NSData *)sealData:(NSData *)data
+            withKeyIdentifier:(NSString *)keyIdentifier
+                      context:(NSString *)context
+                        error:(NSError **)error;
+
+/// Opens one sealed payload, returning the plaintext or nil with the request or batch error
+- (nullable NSData *)openData:(NSData *)data
+            withKeyIdentifier:(NSString *)keyIdentifier
+                      context:(NSString *)context
+                        error:(NSError **)error;
+
+/// Fetches the 32-byte key derived for a non-empty context, or nil with the request or batch error.
+///
+/// The key is derived under `kMBSCryptoServiceDeriveDomain`: it cannot open data the service sealed.
+- (nullable NSData *)deriveKeyWithIdentifier:(NSString *)keyIdentifier
+                                     context:(NSString *)context
+                                       error:(NSError **)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,320 @@
+//
+//  MBSCryptoServiceClient.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+
+#import "MBSCryptoServiceClient.h"
+#import "MBSFileUtilities.h"
+#import "MBSServiceProtocol.h"
+#import <errno.h>
+#import <sys/socket.h>
+#import <sys/time.h>
+#import <unistd.h>
+
+static const NSTimeInterval kMBSServiceClientDefaultTimeout = 30;
+
+/// SO_RCVTIMEO and SO_SNDTIMEO expiring surface as EAGAIN
+static BOOL MBSServiceClientTimedOut(int errorCode) {
+    return errorCode == EAGAIN || errorCode == EWOULDBLOCK;
+}
+
+#pragma mark - MBSCryptoServiceRequest
+
+@implementation MBSCryptoServiceRequest
+
++ (instancetype)sealRequestWithData:(NSData *)data keyIdentifier:(NSString *)keyIdentifier context:(NSString *)context {
+    return [[self alloc] initWithOperation:MBSCryptoServiceOperationSeal keyIdentifier:keyIdentifier context:context data:data];
+}
+
++ (instancetype)openRequestWithData:(NSData *)data keyIdentifier:(NSString *)keyIdentifier context:(NSString *)context {
+    return [[self alloc] initWithOperation:MBSCryptoServiceOperationOpen keyIdentifier:keyIdentifier context:context data:data];
+}
+
++ (instancetype)deriveRequestWithKeyIdentifier:(NSString *)keyIdentifier context:(NSString *)context {
+    return [[self alloc] initWithOperation:MBSCryptoServiceOperationDerive
+                             keyIdentifier:keyIdentifier
+                                   context:context
+                                      data:[NSData data]];
+}
+
+- (instancetype)initWithOperation:(MBSCryptoServiceOperation)operation
+                    keyIdentifier:(NSString *)keyIdentifier
+                          context:(NSString *)context
+                             data:(NSData *)data {
+    self = [super init];
+    if (self) {
+        _operation = operation;
+        _keyIdentifier = [keyIdentifier copy];
+        _context = [context copy];
+        _data = [data copy];
+    }
+    return self;
+}
+
+@end
+
+#pragma mark - MBSCryptoServiceResult
+
+@implementation MBSCryptoServiceResult
+
+- (instancetype)initWithData:(NSData *)data error:(NSError *)error {
+    self = [super init];
+    if (self) {
+        _data = [data copy];
+        _error = error;
+    }
+    return self;
+}
+
+@end
+
+#pragma mark - MBSCryptoServiceClient
+
+@implementation MBSCryptoServiceClient {
+    int _socket;
+    uint32_t _lastBatchID;
+}
+
+- (instancetype)initWithSocketURL:(NSURL *)socketURL {
+    self = [super init];
+    if (self) {
+        _socketURL = [socketURL copy];
+        _socket = -1;
+        _timeout = kMBSServiceClientDefaultTimeout;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_socket >= 0) {
+        close(_socket);
+    }
+}
+
+- (BOOL)isConnected {
+    @synchronized (self) {
+        return _socket >= 0;
+    }
+}
+
+- (BOOL)connectWithError:(NSError **)error {
+    @synchronized (self) {
+        return [self openConnectionWithError:error];
+    }
+}
+
+- (void)close {
+    @synchronized (self) {
+        [self closeConnection];
+    }
+}
+
+#pragma mark - Connection
+
+// Callers hold @synchronized (self)
+
+- (BOOL)openConnectionWithError:(NSError **)error {
+    if (_socket >= 0) {
+        return YES;
+    }
+
+    struct sockaddr_un address;
+    if (!MBSServiceSocketAddress(self.socketURL, &address)) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Socket path is empty or too long"}];
+        }
+        return NO;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to create socket", errno);
+        }
+        return NO;
+    }
+
+    // A service that goes away surfaces as EPIPE instead of killing the client
+    int enabled = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+
+    // A stalled service fails the batch with EAGAIN instead of blocking the client forever
+    if (self.timeout > 0) {
+        struct timeval timeout = {
+            .tv_sec = (time_t)self.timeout,
+            .tv_usec = (suseconds_t)((self.timeout - floor(self.timeout)) * 1e6),
+        };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    }
+
+    int result;
+    do {
+        result = connect(fd, (const struct sockaddr *)&address, sizeof(address));
+    } while (result < 0 && errno == EINTR);
+    if (result < 0) {
+        int connectError = errno;
+        close(fd);
+        if (error) {
+            *error = MBSPOSIXError(@"Failed to connect to crypto service", connectError);
+        }
+        return NO;
+    }
+
+    _socket = fd;
+    return YES;
+}
+
+- (void)closeConnection {
+    if (_socket >= 0) {
+        close(_socket);
+        _socket = -1;
+    }
+}
+
+/// Sends one frame and reads its response.
+///
+/// Sets `*retryable` when the service closed a connection that was already
+/// open before this call: it may have been restarted since, and every
+/// operation can safely be performed again. A timeout is never retried.
+- (nullable NSArray<MBSCryptoServiceResult *> *)exchangeFrame:(NSData *)frame
+                                                      batchID:(uint32_t)batchID
+                                                        count:(NSUInteger)count
+                                                    retryable:(BOOL *)retryable
+                                                        error:(NSError **)error {
+    BOOL reused = _socket >= 0;
+    *retryable = NO;
+    if (![self openConnectionWithError:error]) {
+        return nil;
+    }
+
+    if (!MBSServiceWriteFrame(_socket, frame)) {
+        int writeError = errno;
+        [self closeConnection];
+        *retryable = reused && (writeError == EPIPE || writeError == ECONNRESET);
+        if (error) {
+            *error = MBSPOSIXError(MBSServiceClientTimedOut(writeError) ? @"Timed out sending requests to crypto service"
+                                                                                : @"Failed to send requests to crypto service",
+                                           writeError);
+        }
+        return nil;
+    }
+
+    int readError = 0;
+    NSData *response = MBSServiceReadFrame(_socket, kMBSServiceMaximumResponseLength, &readError);
+    if (!response) {
+        [self closeConnection];
+        *retryable = reused && (readError == 0 || readError == ECONNRESET);
+        if (error) {
+            NSString *description = readError == 0 ? @"Crypto service closed the connection"
+                                  : MBSServiceClientTimedOut(readError) ? @"Timed out waiting for crypto service"
+                                  : @"Failed to read response from crypto service";
+            *error = MBSPOSIXError(description, readError ?: ECONNRESET);
+        }
+        return nil;
+    }
+
+    uint32_t responseID = 0;
+    NSArray<MBSCryptoServiceResult *> *results = MBSServiceDecodeResults(response, &responseID);
+    if (!results || responseID != batchID || results.count != count) {
+        [self closeConnection];
+        if (error) {
+            *error = MBSPOSIXError(@"Malformed response from crypto service", EPROTO);
+        }
+        return nil;
+    }
+    return results;
+}
+
+#pragma mark - Requests
+
+- (nullable NSArray<MBSCryptoServiceResult *> *)performRequests:(NSArray<MBSCryptoServiceRequest *> *)requests
+                                                          error:(NSError **)error {
+    if (requests.count == 0 || requests.count > UINT16_MAX) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorInvalidInput
+                                     userInfo:@{NSLocalizedDescriptionKey: @"A batch holds 1 to 65535 requests"}];
+        }
+        return nil;
+    }
+
+    for (MBSCryptoServiceRequest *request in requests) {
+        if (!MBSServiceRequestIsEncodable(request)) {
+            if (error) {
+                *error = [NSError errorWithDomain:MBSErrorDomain
+                                             code:MBSCipherErrorInvalidInput
+                                         userInfo:@{NSLocalizedDescriptionKey: @"Key identifier must be 1 to 255 bytes and context at most 255 bytes"}];
+            }
+            return nil;
+        }
+    }
+
+    @synchronized (self) {
+        uint32_t batchID = ++_lastBatchID;
+        NSData *frame = MBSServiceEncodeRequests(batchID, requests);
+        if (!frame) {
+            if (error) {
+                *error = [NSError errorWithDomain:MBSErrorDomain
+                                             code:MBSCipherErrorInvalidInput
+                                         userInfo:@{NSLocalizedDescriptionKey: @"Batch exceeds the 64 MiB frame limit"}];
+            }
+            return nil;
+        }
+
+        BOOL retryable = NO;
+        NSArray<MBSCryptoServiceResult *> *results = [self exchangeFrame:frame
+                                                                 batchID:batchID
+                                                                   count:requests.count
+                                                               retryable:&retryable
+                                                                   error:error];
+        if (!results && retryable) {
+            results = [self exchangeFrame:frame batchID:batchID count:requests.count retryable:&retryable error:error];
+        }
+        return results;
+    }
+}
+
+- (nullable NSData *)performRequest:(MBSCryptoServiceRequest *)request error:(NSError **)error {
+    MBSCryptoServiceResult *result = [self performRequests:@[request] error:error].firstObject;
+    if (!result) {
+        return nil;
+    }
+    if (result.error) {
+        if (error) {
+            *error = result.error;
+        }
+        return nil;
+    }
+    return result.data;
+}
+
+- (nullable NSData *)sealData:(NSData *)data
+            withKeyIdentifier:(NSString *)keyIdentifier
+                      context:(NSString *)context
+                        error:(NSError **)error {
+    return [self performRequest:[MBSCryptoServiceRequest sealRequestWithData:data keyIdentifier:keyIdentifier context:context]
+                          error:error];
+}
+
+- (nullable NSData *)openData:(NSData *)data
+            withKeyIdentifier:(NSString *)keyIdentifier
+                      context:(NSString *)context
+                        error:(NSError **)error {
+    return [self performRequest:[MBSCryptoServiceRequest openRequestWithData:data keyIdentifier:keyIdentifier context:context]
+                          error:error];
+}
+
+- (nullable NSData *)deriveKeyWithIdentifier:(NSString *)keyIdentifier
+                                     context:(NSString *)context
+                                       error:(NSError **)error {
+    return [self performRequest:[MBSCryptoServiceRequest deriveRequestWithKeyIdentifier:keyIdentifier context:context]
+                          error:error];
+}
+
+@end
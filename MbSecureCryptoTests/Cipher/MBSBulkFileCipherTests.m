@@ -0,0 +1,209 @@
+//
+//  MBSBulkFileCipherTests.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+#import <XCTest/XCTest.h>
+#import "MbSecureCrypto.h"
+
+@interface MBSBulkFileCipherTests : XCTestCase
+@property (nonatomic, strong) NSURL *directory;
+@property (nonatomic, strong) NSData *key;
+@end
+
+@implementation MBSBulkFileCipherTests
+
+- (void)setUp {
+    [super setUp];
+    self.directory = [[NSURL fileURLWithPath:NSTemporaryDirectory()]
+                      URLByAppendingPathComponent:[NSString stringWithFormat:@"bulk-%@", NSUUID.UUID.UUIDString]];
+    [[NSFileManager defaultManager] createDirectoryAtURL:self.directory withIntermediateDirectories:YES attributes:nil error:nil];
+    self.key = [MBSRandom generateBytes:32 error:nil];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtURL:self.directory error:nil];
+    [super tearDown];
+}
+
+#pragma mark - Helpers
+
+- (NSURL *)fileNamed:(NSString *)name {
+    return [self.directory URLByAppendingPathComponent:name];
+}
+
+- (NSData *)patternOfLength:(NSUInteger)length seed:(uint8_t)seed {
+    NSMutableData *data = [NSMutableData dataWithLength:length];
+    for (NSUInteger i = 0; i < length; i++) {
+        ((uint8_t *)data.mutableBytes)[i] = (uint8_t)(i * 31 + seed);
+    }
+    return data;
+}
+
+#pragma mark - Round Trip Tests
+
+- (void)testBulkRoundTripInBothIOModes {
+    // Empty, short, exact chunk multiple, and several chunks with a partial tail
+    NSArray<NSNumber *> *sizes = @[@0, @100, @(4096 * 2), @(4096 * 5 + 17)];
+
+    for (NSNumber *mode in @[@(MBSFileIOModeAutomatic), @(MBSFileIOModeBlocking)]) {
+        NSMutableArray<NSURL *> *sources = [NSMutableArray array];
+        NSMutableArray<NSURL *> *encrypted = [NSMutableArray array];
+        NSMutableArray<NSURL *> *decrypted = [NSMutableArray array];
+        for (NSUInteger i = 0; i < sizes.count; i++) {
+            NSURL *source = [self fileNamed:[NSString stringWithFormat:@"plain-%@-%lu", mode, (unsigned long)i]];
+            XCTAssertTrue([[self patternOfLength:sizes[i].unsignedIntegerValue seed:(uint8_t)i] writeToURL:source atomically:NO]);
+            [sources addObject:source];
+            [encrypted addObject:[source URLByAppendingPathExtension:@"secb"]];
+            [decrypted addObject:[source URLByAppendingPathExtension:@"out"]];
+        }
+
+        MBSBulkFileCipher *cipher = [[MBSBulkFileCipher alloc] initWithKey:self.key];
+        cipher.chunkSize = 4096;
+        cipher.ioDepth = 3;
+        cipher.workerCount = 2;
+        cipher.synchronizeWrites = YES;
+        cipher.ioMode = mode.integerValue;
+
+        NSError *error = nil;
+        NSDictionary *failures = [cipher encryptFiles:sources toOutputs:encrypted error:&error];
+        XCTAssertNotNil(failures);
+        XCTAssertEqual(failures.count, 0, @"%@", failures);
+
+        failures = [cipher decryptFiles:encrypted toOutputs:decrypted error:&error];
+        XCTAssertEqual(failures.count, 0, @"%@", failures);
+
+        for (NSUInteger i = 0; i < sizes.count; i++) {
+            XCTAssertEqualObjects([NSData dataWithContentsOfURL:decrypted[i]],
+                                  [NSData dataWithContentsOfURL:sources[i]], @"size %@", sizes[i]);
+        }
+    }
+}
+
+- (void)testBulkOutputMatchesStreamFormat {
+    NSURL *source = [self fileNamed:@"plain"];
+    NSURL *destination = [self fileNamed:@"plain.secb"];
+    NSData *plaintext = [self patternOfLength:4096 * 3 + 5 seed:7];
+    XCTAssertTrue([plaintext writeToURL:source atomically:NO]);
+
+    MBSBulkFileCipher *cipher = [[MBSBulkFileCipher alloc] initWithKey:self.key];
+    cipher.chunkSize = 4096;
+    NSError *error = nil;
+    XCTAssertEqual([cipher encryptFiles:@[source] toOutputs:@[destination] error:&error].count, 0);
+
+    // Bulk output is ordinary chunked V1 and decrypts as a stream
+    NSInputStream *input = [NSInputStream inputStreamWithURL:destination];
+    NSOutputStream *output = [NSOutputStream outputStreamToMemory];
+    XCTAssertTrue([MBSCipherStream decryptStream:input
+                                        toStream:output
+                                   withAlgorithm:MBSCipherAlgorithmAESGCM
+                                      withFormat:@(MBSCipherFormatV1)
+                                         withKey:self.key
+                                           error:&error]);
+    [input close];
+    [output close];
+    XCTAssertEqualObjects([output propertyForKey:NSStreamDataWrittenToMemoryStreamKey], plaintext);
+}
+
+- (void)testBulkDecryptFallsBackForSingleShotFormats {
+    NSData *plaintext = [@"Single-shot payload" dataUsingEncoding:NSUTF8StringEncoding];
+    NSMutableArray<NSURL *> *sources = [NSMutableArray array];
+    NSMutableArray<NSURL *> *outputs = [NSMutableArray array];
+
+    for (NSNumber *format in @[@(MBSCipherFormatV0), @(MBSCipherFormatV1)]) {
+        NSData *encrypted = [MBSCipher encryptData:plaintext
+                                     withAlgorithm:MBSCipherAlgorithmAESGCM
+                                        withFormat:format
+                                           withKey:self.key
+                                             error:nil];
+        NSURL *source = [self fileNamed:[NSString stringWithFormat:@"single-%@", format]];
+        XCTAssertTrue([encrypted writeToURL:source atomically:NO]);
+        [sources addObject:source];
+        [outputs addObject:[source URLByAppendingPathExtension:@"out"]];
+    }
+
+    MBSBulkFileCipher *cipher = [[MBSBulkFileCipher alloc] initWithKey:self.key];
+    NSError *error = nil;
+    XCTAssertEqual([cipher decryptFiles:sources toOutputs:outputs error:&error].count, 0);
+    for (NSURL *output in outputs) {
+        XCTAssertEqualObjects([NSData dataWithContentsOfURL:output], plaintext);
+    }
+}
+
+- (void)testBulkDecryptOfLargerChunksThanConfigured {
+    NSURL *source = [self fileNamed:@"large-chunks"];
+    NSURL *encrypted = [self fileNamed:@"large-chunks.secb"];
+    NSURL *decrypted = [self fileNamed:@"large-chunks.out"];
+    NSData *plaintext = [self patternOfLength:1024 * 1024 * 2 + 123 seed:3];
+    XCTAssertTrue([plaintext writeToURL:source atomically:NO]);
+
+    NSError *error = nil;
+    MBSBulkFileCipher *encryptor = [[MBSBulkFileCipher alloc] initWithKey:self.key];
+    encryptor.chunkSize = 1024 * 1024;
+    XCTAssertEqual([encryptor encryptFiles:@[source] toOutputs:@[encrypted] error:&error].count, 0);
+
+    // Records are bigger than the 64 KiB default buffers
+    MBSBulkFileCipher *decryptor = [[MBSBulkFileCipher alloc] initWithKey:self.key];
+    XCTAssertEqual(decryptor.chunkSize, kMBSCipherStreamDefaultChunkSize);
+    NSDictionary *failures = [decryptor decryptFiles:@[encrypted] toOutputs:@[decrypted] error:&error];
+    XCTAssertEqual(failures.count, 0, @"%@", failures);
+    XCTAssertEqualObjects([NSData dataWithContentsOfURL:decrypted], plaintext);
+}
+
+#pragma mark - Failure Tests
+
+- (void)testBulkReportsPerFileFailures {
+    NSURL *good = [self fileNamed:@"good"];
+    NSURL *missing = [self fileNamed:@"missing"];
+    XCTAssertTrue([[self patternOfLength:4096 * 2 + 1 seed:1] writeToURL:good atomically:NO]);
+
+    MBSBulkFileCipher *cipher = [[MBSBulkFileCipher alloc] initWithKey:self.key];
+    cipher.chunkSize = 4096;
+    NSURL *goodOut = [self fileNamed:@"good.secb"];
+    NSError *error = nil;
+    NSDictionary<NSURL *, NSError *> *failures = [cipher encryptFiles:@[good, missing]
+                                                            toOutputs:@[goodOut, [self fileNamed:@"missing.secb"]]
+                                                                error:&error];
+    XCTAssertEqual(failures.count, 1);
+    XCTAssertEqual(failures[missing].code, MBSCipherErrorIOFailure);
+
+    // Tampered and truncated files fail authentication and leave no output behind
+    NSData *encrypted = [NSData dataWithContentsOfURL:goodOut];
+    NSMutableData *tampered = [encrypted mutableCopy];
+    ((uint8_t *)tampered.mutableBytes)[8 + 23 + 4096 + 20 + 4 + 1] ^= 0x01;
+    NSURL *tamperedURL = [self fileNamed:@"tampered.secb"];
+    XCTAssertTrue([tampered writeToURL:tamperedURL atomically:NO]);
+
+    NSData *truncated = [encrypted subdataWithRange:NSMakeRange(0, 8 + 23 + (4096 + 20) * 2)];
+    NSURL *truncatedURL = [self fileNamed:@"truncated.secb"];
+    XCTAssertTrue([truncated writeToURL:truncatedURL atomically:NO]);
+
+    NSURL *tamperedOut = [self fileNamed:@"tampered.out"];
+    NSURL *truncatedOut = [self fileNamed:@"truncated.out"];
+    failures = [cipher decryptFiles:@[tamperedURL, truncatedURL] toOutputs:@[tamperedOut, truncatedOut] error:&error];
+    XCTAssertEqual(failures[tamperedURL].code, MBSCipherErrorAuthenticationFailed);
+    XCTAssertEqual(failures[truncatedURL].code, MBSCipherErrorAuthenticationFailed);
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:tamperedOut.path]);
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:truncatedOut.path]);
+}
+
+- (void)testBulkInvalidParameters {
+    NSError *error = nil;
+    MBSBulkFileCipher *cipher = [[MBSBulkFileCipher alloc] initWithKey:self.key];
+    XCTAssertNil([cipher encryptFiles:@[[self fileNamed:@"a"]] toOutputs:@[] error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+
+    error = nil;
+    cipher.chunkSize = 16;
+    XCTAssertNil([cipher encryptFiles:@[] toOutputs:@[] error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+
+    error = nil;
+    cipher = [[MBSBulkFileCipher alloc] initWithKey:[NSData dataWithBytes:"short" length:5]];
+    XCTAssertNil([cipher decryptFiles:@[] toOutputs:@[] error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidKey);
+}
+
+@end
@@ -0,0 +1,229 @@
+//
+//  MBSCipherCompressionTests.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+#import <XCTest/XCTest.h>
+#import "MbSecureCrypto.h"
+
+@interface MBSCipherCompressionTests : XCTestCase
+@property (nonatomic, strong) NSData *key;
+@end
+
+@implementation MBSCipherCompressionTests
+
+- (void)setUp {
+    [super setUp];
+    self.key = [MBSRandom generateBytes:32 error:nil];
+}
+
+#pragma mark - Helpers
+
+- (NSData *)logLinesOfLength:(NSUInteger)length {
+    NSMutableData *data = [NSMutableData dataWithCapacity:length];
+    for (NSUInteger i = 0; data.length < length; i++) {
+        NSString *line = [NSString stringWithFormat:@"{\"seq\":%lu,\"level\":\"info\",\"msg\":\"request served\"}\n",
+                          (unsigned long)i];
+        [data appendData:[line dataUsingEncoding:NSUTF8StringEncoding]];
+    }
+    data.length = length;
+    return data;
+}
+
+- (nullable NSData *)encryptStream:(NSData *)plaintext
+                         chunkSize:(NSUInteger)chunkSize
+                             codec:(MBSCompressionCodec)codec
+                             error:(NSError **)error {
+    NSInputStream *input = [NSInputStream inputStreamWithData:plaintext];
+    NSOutputStream *output = [NSOutputStream outputStreamToMemory];
+    BOOL success = [MBSCipherStream encryptStream:input
+                                         toStream:output
+                                    withAlgorithm:MBSCipherAlgorithmAESGCM
+                                        chunkSize:chunkSize
+                                  withCompression:codec
+                                          withKey:self.key
+                                            error:error];
+    [input close];
+    [output close];
+    return success ? [output propertyForKey:NSStreamDataWrittenToMemoryStreamKey] : nil;
+}
+
+- (nullable NSData *)decryptStream:(NSData *)ciphertext error:(NSError **)error {
+    NSInputStream *input = [NSInputStream inputStreamWithData:ciphertext];
+    NSOutputStream *output = [NSOutputStream outputStreamToMemory];
+    BOOL success = [MBSCipherStream decryptStream:input
+                                         toStream:output
+                                    withAlgorithm:MBSCipherAlgorithmAESGCM
+                                       withFormat:nil
+                                          withKey:self.key
+                                            error:error];
+    [input close];
+    [output close];
+    return success ? [output propertyForKey:NSStreamDataWrittenToMemoryStreamKey] : nil;
+}
+
+#pragma mark - Single-Shot Tests
+
+- (void)testCompressedRoundTripForEachCodec {
+    NSData *plaintext = [self logLinesOfLength:64 * 1024];
+
+    for (NSNumber *codec in @[@(MBSCompressionCodecLZ4), @(MBSCompressionCodecZlib), @(MBSCompressionCodecLZFSE)]) {
+        NSError *error = nil;
+        NSData *encrypted = [MBSCipher encryptData:plaintext
+                                     withAlgorithm:MBSCipherAlgorithmAESGCM
+                                   withCompression:codec.unsignedCharValue
+                                           withKey:self.key
+                                             error:&error];
+        XCTAssertNotNil(encrypted, @"codec %@: %@", codec, error);
+        XCTAssertLessThan(encrypted.length, plaintext.length / 2, @"codec %@", codec);
+
+        // [header(8)][IV(12)][TAG_LEN(4)][0x02][0x0009][CODEC(1)][ORIGINAL_LENGTH(8)]
+        const uint8_t *bytes = encrypted.bytes;
+        XCTAssertEqual((bytes[6] << 8) | bytes[7], 16 + 3 + 9);
+        XCTAssertEqual(bytes[24], 0x02);
+        XCTAssertEqual(bytes[27], codec.unsignedCharValue);
+        uint64_t originalLength = 0;
+        for (NSUInteger i = 28; i < 36; i++) {
+            originalLength = (originalLength << 8) | bytes[i];
+        }
+        XCTAssertEqual(originalLength, plaintext.length);
+
+        NSData *decrypted = [MBSCipher decryptData:encrypted
+                                     withAlgorithm:MBSCipherAlgorithmAESGCM
+                                        withFormat:nil
+                                           withKey:self.key
+                                             error:&error];
+        XCTAssertEqualObjects(decrypted, plaintext, @"codec %@: %@", codec, error);
+    }
+}
+
+- (void)testIncompressibleDataIsStoredAsPlainV1 {
+    NSData *plaintext = [MBSRandom generateBytes:4096 error:nil];
+
+    NSError *error = nil;
+    NSData *encrypted = [MBSCipher encryptData:plaintext
+                                 withAlgorithm:MBSCipherAlgorithmAESGCM
+                               withCompression:MBSCompressionCodecLZFSE
+                                       withKey:self.key
+                                         error:&error];
+    XCTAssertNotNil(encrypted);
+
+    // No extensions: the classic V1 parameter block
+    const uint8_t *bytes = encrypted.bytes;
+    XCTAssertEqual((bytes[6] << 8) | bytes[7], 16);
+    XCTAssertEqual(encrypted.length, 8 + 16 + plaintext.length + 16);
+
+    NSData *decrypted = [MBSCipher decryptData:encrypted
+                                 withAlgorithm:MBSCipherAlgorithmAESGCM
+                                    withFormat:@(MBSCipherFormatV1)
+                                       withKey:self.key
+                                         error:&error];
+    XCTAssertEqualObjects(decrypted, plaintext);
+}
+
+- (void)testCompressionHeaderIsAuthenticated {
+    NSData *encrypted = [MBSCipher encryptData:[self logLinesOfLength:8192]
+                                 withAlgorithm:MBSCipherAlgorithmAESGCM
+                               withCompression:MBSCompressionCodecZlib
+                                       withKey:self.key
+                                         error:nil];
+
+    // Swapping in another supported codec or a different length must fail authentication
+    for (NSNumber *offset in @[@27, @35]) {
+        NSMutableData *tampered = [encrypted mutableCopy];
+        ((uint8_t *)tampered.mutableBytes)[offset.unsignedIntegerValue] ^= 0x01;
+
+        NSError *error = nil;
+        XCTAssertNil([MBSCipher decryptData:tampered
+                              withAlgorithm:MBSCipherAlgorithmAESGCM
+                                 withFormat:nil
+                                    withKey:self.key
+                                      error:&error]);
+        XCTAssertEqual(error.code, MBSCipherErrorAuthenticationFailed, @"offset %@", offset);
+    }
+}
+
+- (void)testUnsupportedCodecIsRejected {
+    NSData *plaintext = [self logLinesOfLength:1024];
+
+    NSError *error = nil;
+    XCTAssertNil([MBSCipher encryptData:plaintext
+                          withAlgorithm:MBSCipherAlgorithmAESGCM
+                        withCompression:(MBSCompressionCodec)0x7F
+                                withKey:self.key
+                                  error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+
+    // A header naming a codec this build cannot decode is an unsupported format
+    NSMutableData *encrypted = [[MBSCipher encryptData:plaintext
+                                         withAlgorithm:MBSCipherAlgorithmAESGCM
+                                       withCompression:MBSCompressionCodecLZ4
+                                               withKey:self.key
+                                                 error:nil] mutableCopy];
+    ((uint8_t *)encrypted.mutableBytes)[27] = 0x7F;
+    error = nil;
+    XCTAssertNil([MBSCipher decryptData:encrypted
+                          withAlgorithm:MBSCipherAlgorithmAESGCM
+                             withFormat:nil
+                                withKey:self.key
+                                  error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorUnsupportedFormat);
+}
+
+#pragma mark - Chunked Tests
+
+- (void)testCompressedStreamRoundTrip {
+    // Empty, short, exact chunk multiple, mixed compressible and random chunks
+    NSMutableData *mixed = [[self logLinesOfLength:4096 * 2] mutableCopy];
+    [mixed appendData:[MBSRandom generateBytes:4096 + 17 error:nil]];
+    NSArray<NSData *> *inputs = @[[NSData data], [self logLinesOfLength:100], [self logLinesOfLength:4096 * 3], mixed];
+
+    for (NSData *plaintext in inputs) {
+        NSError *error = nil;
+        NSData *encrypted = [self encryptStream:plaintext chunkSize:4096 codec:MBSCompressionCodecLZ4 error:&error];
+        XCTAssertNotNil(encrypted, @"length %lu: %@", (unsigned long)plaintext.length, error);
+
+        NSData *decrypted = [self decryptStream:encrypted error:&error];
+        XCTAssertEqualObjects(decrypted, plaintext, @"length %lu: %@", (unsigned long)plaintext.length, error);
+    }
+}
+
+- (void)testCompressedStreamDetectsTampering {
+    NSData *encrypted = [self encryptStream:[self logLinesOfLength:4096 * 2]
+                                  chunkSize:4096
+                                      codec:MBSCompressionCodecLZFSE
+                                      error:nil];
+    XCTAssertNotNil(encrypted);
+
+    // Header is 8 + 16 + CHUNKED(7) + COMPRESSION(12); flip a byte in the first record body
+    NSMutableData *tampered = [encrypted mutableCopy];
+    ((uint8_t *)tampered.mutableBytes)[43 + 4 + 6] ^= 0x01;
+
+    NSError *error = nil;
+    XCTAssertNil([self decryptStream:tampered error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorAuthenticationFailed);
+}
+
+- (void)testBulkDecryptsCompressedStream {
+    NSURL *directory = [[NSURL fileURLWithPath:NSTemporaryDirectory()]
+                        URLByAppendingPathComponent:[NSString stringWithFormat:@"compression-%@", NSUUID.UUID.UUIDString]];
+    [[NSFileManager defaultManager] createDirectoryAtURL:directory withIntermediateDirectories:YES attributes:nil error:nil];
+
+    NSData *plaintext = [self logLinesOfLength:4096 * 4 + 9];
+    NSData *encrypted = [self encryptStream:plaintext chunkSize:4096 codec:MBSCompressionCodecZlib error:nil];
+    NSURL *source = [directory URLByAppendingPathComponent:@"logs.secb"];
+    NSURL *destination = [directory URLByAppendingPathComponent:@"logs.out"];
+    XCTAssertTrue([encrypted writeToURL:source atomically:NO]);
+
+    MBSBulkFileCipher *cipher = [[MBSBulkFileCipher alloc] initWithKey:self.key];
+    NSError *error = nil;
+    NSDictionary *failures = [cipher decryptFiles:@[source] toOutputs:@[destination] error:&error];
+    XCTAssertEqual(failures.count, 0, @"%@", failures);
+    XCTAssertEqualObjects([NSData dataWithContentsOfURL:destination], plaintext);
+
+    [[NSFileManager defaultManager] removeItemAtURL:directory error:nil];
+}
+
+@end
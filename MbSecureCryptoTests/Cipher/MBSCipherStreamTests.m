@@ -0,0 +1,165 @@
+//
+//  MBSCipherStreamTests.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+#import <XCTest/XCTest.h>
+#import "MbSecureCrypto.h"
+
+@interface MBSCipherStreamTests : XCTestCase
+@end
+
+@implementation MBSCipherStreamTests
+
+#pragma mark - Helpers
+
+- (nullable NSData *)encrypt:(NSData *)plaintext chunkSize:(NSUInteger)chunkSize key:(NSData *)key error:(NSError **)error {
+    NSInputStream *input = [NSInputStream inputStreamWithData:plaintext];
+    NSOutputStream *output = [NSOutputStream outputStreamToMemory];
+    BOOL success = [MBSCipherStream encryptStream:input
+                                         toStream:output
+                                    withAlgorithm:MBSCipherAlgorithmAESGCM
+                                        chunkSize:chunkSize
+                                          withKey:key
+                                            error:error];
+    [input close];
+    [output close];
+    return success ? [output propertyForKey:NSStreamDataWrittenToMemoryStreamKey] : nil;
+}
+
+- (nullable NSData *)decrypt:(NSData *)ciphertext format:(nullable NSNumber *)format key:(NSData *)key error:(NSError **)error {
+    NSInputStream *input = [NSInputStream inputStreamWithData:ciphertext];
+    NSOutputStream *output = [NSOutputStream outputStreamToMemory];
+    BOOL success = [MBSCipherStream decryptStream:input
+                                         toStream:output
+                                    withAlgorithm:MBSCipherAlgorithmAESGCM
+                                       withFormat:format
+                                          withKey:key
+                                            error:error];
+    [input close];
+    [output close];
+    return success ? [output propertyForKey:NSStreamDataWrittenToMemoryStreamKey] : nil;
+}
+
+#pragma mark - Round Trip Tests
+
+- (void)testStreamRoundTripAcrossChunkBoundaries {
+    NSError *error = nil;
+    NSData *key = [MBSRandom generateBytes:32 error:&error];
+    XCTAssertNotNil(key);
+
+    // Empty, short, exactly one chunk, and several chunks with a partial tail
+    NSArray<NSNumber *> *sizes = @[@0, @100, @4096, @(4096 * 3 + 17)];
+    for (NSNumber *size in sizes) {
+        NSMutableData *plaintext = [NSMutableData dataWithLength:size.unsignedIntegerValue];
+        for (NSUInteger i = 0; i < plaintext.length; i++) {
+            ((uint8_t *)plaintext.mutableBytes)[i] = (uint8_t)(i * 31);
+        }
+
+        error = nil;
+        NSData *encrypted = [self encrypt:plaintext chunkSize:4096 key:key error:&error];
+        XCTAssertNotNil(encrypted, @"size %@", size);
+        XCTAssertNil(error);
+
+        NSData *decrypted = [self decrypt:encrypted format:nil key:key error:&error];
+        XCTAssertNil(error);
+        XCTAssertEqualObjects(decrypted, plaintext, @"size %@", size);
+    }
+}
+
+- (void)testStreamHeaderIsChunkedV1 {
+    NSError *error = nil;
+    NSData *key = [MBSRandom generateBytes:32 error:&error];
+    NSData *encrypted = [self encrypt:[@"Streamed" dataUsingEncoding:NSUTF8StringEncoding]
+                            chunkSize:kMBSCipherStreamDefaultChunkSize
+                                  key:key
+                                error:&error];
+    XCTAssertNotNil(encrypted);
+
+    const uint8_t *bytes = encrypted.bytes;
+    XCTAssertEqual(bytes[0], 'S');
+    XCTAssertEqual(bytes[3], 'B');
+    XCTAssertEqual(bytes[4], MBSCipherFormatV1);
+    XCTAssertEqual(bytes[5], 0x01);
+    uint16_t paramsLength = (bytes[6] << 8) | bytes[7];
+    XCTAssertEqual(paramsLength, 16 + 3 + 4); // IV + TAG_LEN + chunked extension
+    XCTAssertEqual(bytes[8 + 16], 0x01);      // Chunked extension type
+
+    // Single-shot API refuses chunked data rather than misreading it
+    error = nil;
+    XCTAssertNil([MBSCipher decryptData:encrypted
+                          withAlgorithm:MBSCipherAlgorithmAESGCM
+                             withFormat:@(MBSCipherFormatV1)
+                                withKey:key
+                                  error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorFormatMismatch);
+}
+
+- (void)testStreamDecryptDetectsSingleShotFormats {
+    NSError *error = nil;
+    NSData *key = [MBSRandom generateBytes:32 error:&error];
+    NSData *plaintext = [@"Single-shot payload" dataUsingEncoding:NSUTF8StringEncoding];
+
+    for (NSNumber *format in @[@(MBSCipherFormatV0), @(MBSCipherFormatV1)]) {
+        NSData *encrypted = [MBSCipher encryptData:plaintext
+                                     withAlgorithm:MBSCipherAlgorithmAESGCM
+                                        withFormat:format
+                                           withKey:key
+                                             error:&error];
+        XCTAssertNotNil(encrypted);
+
+        error = nil;
+        XCTAssertEqualObjects([self decrypt:encrypted format:nil key:key error:&error], plaintext);
+        XCTAssertNil(error);
+
+        error = nil;
+        XCTAssertEqualObjects([self decrypt:encrypted format:format key:key error:&error], plaintext);
+        XCTAssertNil(error);
+    }
+}
+
+#pragma mark - Tamper Tests
+
+- (void)testStreamRejectsTruncationAndTampering {
+    NSError *error = nil;
+    NSData *key = [MBSRandom generateBytes:32 error:&error];
+    NSData *plaintext = [NSMutableData dataWithLength:4096 * 2 + 10];
+    NSData *encrypted = [self encrypt:plaintext chunkSize:4096 key:key error:&error];
+    XCTAssertNotNil(encrypted);
+
+    // Dropping the final record
+    NSUInteger finalRecordSize = 4 + 10 + 16;
+    NSData *truncated = [encrypted subdataWithRange:NSMakeRange(0, encrypted.length - finalRecordSize)];
+    error = nil;
+    XCTAssertNil([self decrypt:truncated format:nil key:key error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorAuthenticationFailed);
+
+    // Flipping a ciphertext bit in the first record
+    NSMutableData *tampered = [encrypted mutableCopy];
+    ((uint8_t *)tampered.mutableBytes)[8 + 23 + 4 + 1] ^= 0x01;
+    error = nil;
+    XCTAssertNil([self decrypt:tampered format:nil key:key error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorAuthenticationFailed);
+
+    // Wrong requested format
+    error = nil;
+    XCTAssertNil([self decrypt:encrypted format:@(MBSCipherFormatV0) key:key error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorFormatMismatch);
+}
+
+- (void)testStreamInvalidParameters {
+    NSError *error = nil;
+    NSData *key = [MBSRandom generateBytes:32 error:&error];
+    NSData *plaintext = [@"data" dataUsingEncoding:NSUTF8StringEncoding];
+
+    XCTAssertNil([self encrypt:plaintext chunkSize:16 key:key error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+
+    error = nil;
+    XCTAssertNil([self encrypt:plaintext chunkSize:4096 key:[NSData dataWithBytes:"short" length:5] error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidKey);
+}
+
+@end
@@ -0,0 +1,279 @@
+//
+//  MBSDirectoryCipherTests.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+#import <XCTest/XCTest.h>
+#import "MbSecureCrypto.h"
+
+@interface MBSDirectoryCipherTests : XCTestCase
+@property (nonatomic, strong) NSURL *directory;
+@property (nonatomic, strong) NSURL *sourceURL;
+@property (nonatomic, strong) NSURL *encryptedURL;
+@property (nonatomic, strong) NSURL *restoredURL;
+@property (nonatomic, strong) NSData *key;
+@end
+
+@implementation MBSDirectoryCipherTests
+
+- (void)setUp {
+    [super setUp];
+    self.directory = [[NSURL fileURLWithPath:NSTemporaryDirectory()]
+                      URLByAppendingPathComponent:[NSString stringWithFormat:@"directory-%@", NSUUID.UUID.UUIDString]];
+    self.sourceURL = [self.directory URLByAppendingPathComponent:@"source"];
+    self.encryptedURL = [self.directory URLByAppendingPathComponent:@"encrypted"];
+    self.restoredURL = [self.directory URLByAppendingPathComponent:@"restored"];
+    [[NSFileManager defaultManager] createDirectoryAtURL:[self.sourceURL URLByAppendingPathComponent:@"nested/deeper"]
+                             withIntermediateDirectories:YES
+                                              attributes:nil
+                                                   error:nil];
+    self.key = [MBSRandom generateBytes:32 error:nil];
+
+    [self writeFile:@"a.txt" data:[@"alpha" dataUsingEncoding:NSUTF8StringEncoding]];
+    [self writeFile:@"empty" data:[NSData data]];
+    [self writeFile:@"nested/b.bin" data:[MBSRandom generateBytes:300 * 1024 error:nil]];
+    [self writeFile:@"nested/deeper/c.txt" data:[@"gamma" dataUsingEncoding:NSUTF8StringEncoding]];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtURL:self.directory error:nil];
+    [super tearDown];
+}
+
+#pragma mark - Helpers
+
+- (void)writeFile:(NSString *)path data:(NSData *)data {
+    XCTAssertTrue([data writeToURL:[self.sourceURL URLByAppendingPathComponent:path] atomically:NO]);
+}
+
+- (void)touchFile:(NSString *)path {
+    NSDate *date = [NSDate dateWithTimeIntervalSinceNow:60];
+    XCTAssertTrue([[NSFileManager defaultManager] setAttributes:@{NSFileModificationDate: date}
+                                                   ofItemAtPath:[self.sourceURL URLByAppendingPathComponent:path].path
+                                                          error:nil]);
+}
+
+- (MBSDirectoryCipherReport *)encrypt {
+    return [self encryptWithChunkSize:64 * 1024];
+}
+
+- (MBSDirectoryCipherReport *)encryptWithChunkSize:(NSUInteger)chunkSize {
+    NSError *error = nil;
+    MBSDirectoryCipher *cipher = [[MBSDirectoryCipher alloc] initWithKey:self.key];
+    cipher.chunkSize = chunkSize;
+    MBSDirectoryCipherReport *report = [cipher encryptDirectory:self.sourceURL toDirectory:self.encryptedURL error:&error];
+    XCTAssertNotNil(report, @"%@", error);
+    XCTAssertEqual(report.failures.count, 0, @"%@", report.failures);
+    return report;
+}
+
+- (NSArray<NSString *> *)objectPaths {
+    NSString *objectsPath = [self.encryptedURL URLByAppendingPathComponent:@"objects"].path;
+    NSMutableArray<NSString *> *paths = [NSMutableArray array];
+    for (NSString *path in [[NSFileManager defaultManager] enumeratorAtPath:objectsPath]) {
+        if ([path.pathExtension isEqualToString:@"secb"]) {
+            [paths addObject:[objectsPath stringByAppendingPathComponent:path]];
+        }
+    }
+    return paths;
+}
+
+- (void)assertRestoredTreeMatchesSource {
+    [self assertRestoredTreeMatchesSourceWithChunkSize:kMBSCipherStreamDefaultChunkSize];
+}
+
+- (void)assertRestoredTreeMatchesSourceWithChunkSize:(NSUInteger)chunkSize {
+    NSError *error = nil;
+    MBSDirectoryCipher *cipher = [[MBSDirectoryCipher alloc] initWithKey:self.key];
+    cipher.chunkSize = chunkSize;
+    MBSDirectoryCipherReport *report = [cipher decryptDirectory:self.encryptedURL toDirectory:self.restoredURL error:&error];
+    XCTAssertNotNil(report, @"%@", error);
+    XCTAssertEqual(report.failures.count, 0, @"%@", report.failures);
+
+    NSArray<NSString *> *sourceFiles = [[NSFileManager defaultManager] subpathsAtPath:self.sourceURL.path];
+    NSUInteger fileCount = 0;
+    for (NSString *path in sourceFiles) {
+        BOOL isDirectory = NO;
+        [[NSFileManager defaultManager] fileExistsAtPath:[self.sourceURL URLByAppendingPathComponent:path].path
+                                             isDirectory:&isDirectory];
+        if (isDirectory) {
+            continue;
+        }
+        fileCount++;
+        XCTAssertEqualObjects([NSData dataWithContentsOfURL:[self.restoredURL URLByAppendingPathComponent:path]],
+                              [NSData dataWithContentsOfURL:[self.sourceURL URLByAppendingPathComponent:path]], @"%@", path);
+    }
+    XCTAssertEqual(report.writtenCount, fileCount);
+}
+
+#pragma mark - Incremental Tests
+
+- (void)testInitialRunEncryptsEveryFile {
+    MBSDirectoryCipherReport *report = [self encrypt];
+    XCTAssertEqual(report.fileCount, 4);
+    XCTAssertEqual(report.hashedCount, 4);
+    XCTAssertEqual(report.writtenCount, 4);
+    XCTAssertEqual(report.bytesWritten, 5 + 300 * 1024 + 5);
+    XCTAssertEqual([self objectPaths].count, 4);
+    XCTAssertTrue([[NSFileManager defaultManager] fileExistsAtPath:
+                   [self.encryptedURL URLByAppendingPathComponent:kMBSDirectoryManifestName].path]);
+
+    [self assertRestoredTreeMatchesSource];
+}
+
+- (void)testUnchangedTreeIsNotRead {
+    [self encrypt];
+    NSArray<NSString *> *objects = [self objectPaths];
+
+    MBSDirectoryCipherReport *report = [self encrypt];
+    XCTAssertEqual(report.fileCount, 4);
+    XCTAssertEqual(report.unchangedCount, 4);
+    XCTAssertEqual(report.hashedCount, 0);
+    XCTAssertEqual(report.bytesHashed, 0);
+    XCTAssertEqual(report.writtenCount, 0);
+    XCTAssertEqualObjects([NSSet setWithArray:[self objectPaths]], [NSSet setWithArray:objects]);
+}
+
+- (void)testOnlyChangedFilesAreEncrypted {
+    [self encrypt];
+
+    // Touched but identical: hashed, not encrypted
+    [self touchFile:@"a.txt"];
+    // Same size, new content
+    [self writeFile:@"nested/deeper/c.txt" data:[@"GAMMA" dataUsingEncoding:NSUTF8StringEncoding]];
+    [self touchFile:@"nested/deeper/c.txt"];
+    // Added and removed
+    [self writeFile:@"nested/d.txt" data:[@"delta" dataUsingEncoding:NSUTF8StringEncoding]];
+    XCTAssertTrue([[NSFileManager defaultManager] removeItemAtURL:[self.sourceURL URLByAppendingPathComponent:@"empty"] error:nil]);
+
+    MBSDirectoryCipherReport *report = [self encrypt];
+    XCTAssertEqual(report.fileCount, 4);
+    XCTAssertEqual(report.unchangedCount, 1);
+    XCTAssertEqual(report.hashedCount, 3);
+    XCTAssertEqual(report.writtenCount, 2);
+    XCTAssertEqual(report.removedCount, 1);
+
+    // Replaced and removed objects are gone
+    XCTAssertEqual([self objectPaths].count, 4);
+    [self assertRestoredTreeMatchesSource];
+
+    // The touched file's new timestamp was recorded
+    report = [self encrypt];
+    XCTAssertEqual(report.unchangedCount, 4);
+}
+
+- (void)testRestoreWithDifferentChunkSize {
+    // Objects with chunks larger than the restoring cipher's buffers
+    [self writeFile:@"nested/large.bin" data:[MBSRandom generateBytes:2 * 1024 * 1024 + 5 error:nil]];
+    [self encryptWithChunkSize:1024 * 1024];
+    [self assertRestoredTreeMatchesSourceWithChunkSize:4 * 1024];
+
+    // And smaller
+    [[NSFileManager defaultManager] removeItemAtURL:self.encryptedURL error:nil];
+    [[NSFileManager defaultManager] removeItemAtURL:self.restoredURL error:nil];
+    [self encryptWithChunkSize:4 * 1024];
+    [self assertRestoredTreeMatchesSourceWithChunkSize:1024 * 1024];
+}
+
+#pragma mark - Failure Tests
+
+- (void)testTamperedManifestIsRejected {
+    [self encrypt];
+
+    // The wrong key cannot read an intact manifest
+    NSError *error = nil;
+    MBSDirectoryCipher *other = [[MBSDirectoryCipher alloc] initWithKey:[MBSRandom generateBytes:32 error:nil]];
+    XCTAssertNil([other decryptDirectory:self.encryptedURL toDirectory:self.restoredURL error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorAuthenticationFailed);
+
+    NSURL *manifestURL = [self.encryptedURL URLByAppendingPathComponent:kMBSDirectoryManifestName];
+    NSMutableData *manifest = [NSMutableData dataWithContentsOfURL:manifestURL];
+    ((uint8_t *)manifest.mutableBytes)[manifest.length - 1] ^= 0x01;
+    XCTAssertTrue([manifest writeToURL:manifestURL atomically:NO]);
+
+    error = nil;
+    MBSDirectoryCipher *cipher = [[MBSDirectoryCipher alloc] initWithKey:self.key];
+    XCTAssertNil([cipher encryptDirectory:self.sourceURL toDirectory:self.encryptedURL error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorAuthenticationFailed);
+
+    error = nil;
+    XCTAssertNil([cipher decryptDirectory:self.encryptedURL toDirectory:self.restoredURL error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorAuthenticationFailed);
+}
+
+- (void)testSwappedObjectsAreDetectedOnRestore {
+    [[NSFileManager defaultManager] removeItemAtURL:[self.sourceURL URLByAppendingPathComponent:@"nested"] error:nil];
+    [self encrypt];
+
+    NSArray<NSString *> *objects = [self objectPaths];
+    XCTAssertEqual(objects.count, 2);
+    NSData *first = [NSData dataWithContentsOfFile:objects[0]];
+    NSData *second = [NSData dataWithContentsOfFile:objects[1]];
+    XCTAssertTrue([second writeToFile:objects[0] atomically:NO]);
+    XCTAssertTrue([first writeToFile:objects[1] atomically:NO]);
+
+    NSError *error = nil;
+    MBSDirectoryCipher *cipher = [[MBSDirectoryCipher alloc] initWithKey:self.key];
+    MBSDirectoryCipherReport *report = [cipher decryptDirectory:self.encryptedURL toDirectory:self.restoredURL error:&error];
+    XCTAssertNotNil(report, @"%@", error);
+    XCTAssertEqual(report.writtenCount, 0);
+    XCTAssertEqual(report.failures.count, 2);
+    for (NSString *path in report.failures) {
+        XCTAssertEqual(report.failures[path].code, MBSCipherErrorAuthenticationFailed);
+        XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:[self.restoredURL URLByAppendingPathComponent:path].path]);
+    }
+}
+
+- (void)testFailedRestoreKeepsExistingFiles {
+    [[NSFileManager defaultManager] removeItemAtURL:[self.sourceURL URLByAppendingPathComponent:@"nested"] error:nil];
+    [self encrypt];
+
+    NSArray<NSString *> *objects = [self objectPaths];
+    XCTAssertEqual(objects.count, 2);
+    NSData *first = [NSData dataWithContentsOfFile:objects[0]];
+    XCTAssertTrue([[NSData dataWithContentsOfFile:objects[1]] writeToFile:objects[0] atomically:NO]);
+    XCTAssertTrue([first writeToFile:objects[1] atomically:NO]);
+
+    // Files already at the destination survive a restore whose content does not match the manifest
+    NSData *existing = [@"existing" dataUsingEncoding:NSUTF8StringEncoding];
+    [[NSFileManager defaultManager] createDirectoryAtURL:self.restoredURL withIntermediateDirectories:YES attributes:nil error:nil];
+    XCTAssertTrue([existing writeToURL:[self.restoredURL URLByAppendingPathComponent:@"a.txt"] atomically:NO]);
+    XCTAssertTrue([existing writeToURL:[self.restoredURL URLByAppendingPathComponent:@"empty"] atomically:NO]);
+
+    NSError *error = nil;
+    MBSDirectoryCipher *cipher = [[MBSDirectoryCipher alloc] initWithKey:self.key];
+    MBSDirectoryCipherReport *report = [cipher decryptDirectory:self.encryptedURL toDirectory:self.restoredURL error:&error];
+    XCTAssertNotNil(report, @"%@", error);
+    XCTAssertEqual(report.writtenCount, 0);
+    XCTAssertEqual(report.failures.count, 2);
+    for (NSString *path in @[@"a.txt", @"empty"]) {
+        XCTAssertEqual(report.failures[path].code, MBSCipherErrorAuthenticationFailed);
+        XCTAssertEqualObjects([NSData dataWithContentsOfURL:[self.restoredURL URLByAppendingPathComponent:path]], existing);
+    }
+
+    // No staged copies are left behind
+    NSArray<NSString *> *contents = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:self.restoredURL.path error:nil];
+    XCTAssertEqualObjects([contents sortedArrayUsingSelector:@selector(compare:)], (@[@"a.txt", @"empty"]));
+}
+
+- (void)testInvalidRequests {
+    NSError *error = nil;
+    MBSDirectoryCipher *cipher = [[MBSDirectoryCipher alloc] initWithKey:[NSData dataWithBytes:"short" length:5]];
+    XCTAssertNil([cipher encryptDirectory:self.sourceURL toDirectory:self.encryptedURL error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidKey);
+
+    error = nil;
+    cipher = [[MBSDirectoryCipher alloc] initWithKey:self.key];
+    XCTAssertNil([cipher encryptDirectory:[self.sourceURL URLByAppendingPathComponent:@"a.txt"]
+                              toDirectory:self.encryptedURL
+                                    error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+
+    error = nil;
+    XCTAssertNil([cipher decryptDirectory:self.sourceURL toDirectory:self.restoredURL error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorIOFailure);
+}
+
+@end
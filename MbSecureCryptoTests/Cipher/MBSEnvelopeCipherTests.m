@@ -0,0 +1,242 @@
+//
+//  MBSEnvelopeCipherTests.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+#import <XCTest/XCTest.h>
+#import "MbSecureCrypto.h"
+
+/// Forwards to a file provider and counts unwrap calls
+@interface MBSCountingKeyProvider : NSObject <MBSKeyProvider>
+@property (nonatomic, strong) MBSFileKeyProvider *provider;
+@property (atomic, assign) NSUInteger unwrapCount;
+@end
+
+@implementation MBSCountingKeyProvider
+
+- (NSString *)currentKeyIdentifier {
+    return self.provider.currentKeyIdentifier;
+}
+
+- (NSData *)wrapDataKey:(NSData *)dataKey withKeyIdentifier:(NSString *)keyIdentifier error:(NSError **)error {
+    return [self.provider wrapDataKey:dataKey withKeyIdentifier:keyIdentifier error:error];
+}
+
+- (NSData *)unwrapDataKey:(NSData *)wrappedKey withKeyIdentifier:(NSString *)keyIdentifier error:(NSError **)error {
+    self.unwrapCount++;
+    return [self.provider unwrapDataKey:wrappedKey withKeyIdentifier:keyIdentifier error:error];
+}
+
+@end
+
+@interface MBSEnvelopeCipherTests : XCTestCase
+@property (nonatomic, strong) NSURL *directory;
+@property (nonatomic, strong) MBSFileKeyProvider *provider;
+@end
+
+@implementation MBSEnvelopeCipherTests
+
+- (void)setUp {
+    [super setUp];
+    self.directory = [[NSURL fileURLWithPath:NSTemporaryDirectory()]
+                      URLByAppendingPathComponent:[NSString stringWithFormat:@"envelope-%@", NSUUID.UUID.UUIDString]];
+    [[NSFileManager defaultManager] createDirectoryAtURL:self.directory withIntermediateDirectories:YES attributes:nil error:nil];
+
+    self.provider = [[MBSFileKeyProvider alloc] initWithDirectoryURL:self.directory currentKeyIdentifier:@"kek-a"];
+    XCTAssertTrue([self.provider generateKeyWithIdentifier:@"kek-a" error:nil]);
+    XCTAssertTrue([self.provider generateKeyWithIdentifier:@"kek-b" error:nil]);
+    XCTAssertTrue([self.provider generateKeyWithIdentifier:@"kek-rotated" error:nil]);
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtURL:self.directory error:nil];
+    [super tearDown];
+}
+
+#pragma mark - Round Trip Tests
+
+- (void)testEnvelopeRoundTrip {
+    MBSEnvelopeCipher *cipher = [[MBSEnvelopeCipher alloc] initWithKeyProvider:self.provider];
+    NSData *plaintext = [@"Envelope payload" dataUsingEncoding:NSUTF8StringEncoding];
+
+    for (NSData *data in @[plaintext, [NSData data]]) {
+        NSError *error = nil;
+        NSData *encrypted = [cipher encryptData:data error:&error];
+        XCTAssertNotNil(encrypted, @"%@", error);
+        XCTAssertEqualObjects([MBSEnvelopeCipher keyIdentifierForData:encrypted error:&error], @"kek-a");
+
+        // A fresh instance has nothing cached and unwraps through the provider
+        MBSEnvelopeCipher *reader = [[MBSEnvelopeCipher alloc] initWithKeyProvider:self.provider];
+        XCTAssertEqualObjects([reader decryptData:encrypted error:&error], data, @"%@", error);
+    }
+}
+
+- (void)testEnvelopeIsNotReadableWithMBSCipher {
+    MBSEnvelopeCipher *cipher = [[MBSEnvelopeCipher alloc] initWithKeyProvider:self.provider];
+    NSData *encrypted = [cipher encryptData:[@"Envelope" dataUsingEncoding:NSUTF8StringEncoding] error:nil];
+
+    NSError *error = nil;
+    XCTAssertNil([MBSCipher decryptData:encrypted
+                          withAlgorithm:MBSCipherAlgorithmAESGCM
+                             withFormat:nil
+                                withKey:[MBSRandom generateBytes:32 error:nil]
+                                  error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorFormatMismatch);
+
+    // And plain V1 data is not an envelope
+    NSData *plain = [MBSCipher encryptData:[@"Plain" dataUsingEncoding:NSUTF8StringEncoding]
+                             withAlgorithm:MBSCipherAlgorithmAESGCM
+                                withFormat:@(MBSCipherFormatV1)
+                                   withKey:[MBSRandom generateBytes:32 error:nil]
+                                     error:nil];
+    error = nil;
+    XCTAssertNil([cipher decryptData:plain error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorFormatMismatch);
+}
+
+#pragma mark - Rotation Tests
+
+- (void)testRewrapChangesOnlyTheHeader {
+    MBSEnvelopeCipher *cipher = [[MBSEnvelopeCipher alloc] initWithKeyProvider:self.provider];
+    NSData *plaintext = [@"Rotate me" dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *encrypted = [cipher encryptData:plaintext error:nil];
+
+    self.provider.currentKeyIdentifier = @"kek-rotated";
+    NSError *error = nil;
+    NSData *rewrapped = [cipher rewrapData:encrypted error:&error];
+    XCTAssertNotNil(rewrapped, @"%@", error);
+    XCTAssertEqualObjects([MBSEnvelopeCipher keyIdentifierForData:rewrapped error:nil], @"kek-rotated");
+
+    // Payload bytes are carried over untouched
+    NSUInteger payloadLength = plaintext.length + 16;
+    XCTAssertEqualObjects([rewrapped subdataWithRange:NSMakeRange(rewrapped.length - payloadLength, payloadLength)],
+                          [encrypted subdataWithRange:NSMakeRange(encrypted.length - payloadLength, payloadLength)]);
+
+    // The retired KEK is no longer needed
+    XCTAssertTrue([[NSFileManager defaultManager] removeItemAtURL:[self.directory URLByAppendingPathComponent:@"kek-a.key"]
+                                                            error:nil]);
+    MBSFileKeyProvider *provider = [[MBSFileKeyProvider alloc] initWithDirectoryURL:self.directory
+                                                               currentKeyIdentifier:@"kek-rotated"];
+    MBSEnvelopeCipher *reader = [[MBSEnvelopeCipher alloc] initWithKeyProvider:provider];
+    XCTAssertEqualObjects([reader decryptData:rewrapped error:&error], plaintext, @"%@", error);
+
+    error = nil;
+    XCTAssertNil([reader decryptData:encrypted error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidKey);
+}
+
+- (void)testRewrapFileWithSameAndResizedHeader {
+    MBSEnvelopeCipher *cipher = [[MBSEnvelopeCipher alloc] initWithKeyProvider:self.provider];
+    NSData *plaintext = [MBSRandom generateBytes:200 * 1024 error:nil];
+    NSURL *fileURL = [self.directory URLByAppendingPathComponent:@"object.secb"];
+    XCTAssertTrue([[cipher encryptData:plaintext error:nil] writeToURL:fileURL atomically:NO]);
+    NSUInteger originalSize = [NSData dataWithContentsOfURL:fileURL].length;
+
+    // Same identifier length: still replaced through a temporary copy
+    self.provider.currentKeyIdentifier = @"kek-b";
+    NSError *error = nil;
+    XCTAssertTrue([cipher rewrapFile:fileURL error:&error], @"%@", error);
+    NSData *contents = [NSData dataWithContentsOfURL:fileURL];
+    XCTAssertEqual(contents.length, originalSize);
+    XCTAssertEqualObjects([MBSEnvelopeCipher keyIdentifierForData:contents error:nil], @"kek-b");
+
+    // Longer identifier: file rewritten through a temporary copy
+    self.provider.currentKeyIdentifier = @"kek-rotated";
+    XCTAssertTrue([cipher rewrapFile:fileURL error:&error], @"%@", error);
+    contents = [NSData dataWithContentsOfURL:fileURL];
+    XCTAssertEqual(contents.length, originalSize + 6);
+    XCTAssertEqualObjects([MBSEnvelopeCipher keyIdentifierForData:contents error:nil], @"kek-rotated");
+
+    MBSEnvelopeCipher *reader = [[MBSEnvelopeCipher alloc] initWithKeyProvider:self.provider];
+    XCTAssertEqualObjects([reader decryptData:contents error:&error], plaintext, @"%@", error);
+
+    // No temporary files are left behind
+    NSArray<NSString *> *names = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:self.directory.path error:nil];
+    XCTAssertEqual([names filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"SELF ENDSWITH '.tmp'"]].count, 0);
+}
+
+#pragma mark - Cache Tests
+
+- (void)testDataKeyCacheAvoidsUnwrapping {
+    MBSCountingKeyProvider *provider = [[MBSCountingKeyProvider alloc] init];
+    provider.provider = self.provider;
+    NSData *first = [[[MBSEnvelopeCipher alloc] initWithKeyProvider:provider] encryptData:[NSData dataWithBytes:"1" length:1] error:nil];
+    NSData *second = [[[MBSEnvelopeCipher alloc] initWithKeyProvider:provider] encryptData:[NSData dataWithBytes:"2" length:1] error:nil];
+
+    MBSEnvelopeCipher *cipher = [[MBSEnvelopeCipher alloc] initWithKeyProvider:provider dataKeyCacheCapacity:1];
+    for (NSUInteger i = 0; i < 5; i++) {
+        XCTAssertNotNil([cipher decryptData:first error:nil]);
+    }
+    XCTAssertEqual(provider.unwrapCount, 1);
+
+    // Capacity 1: the second object evicts the first
+    XCTAssertNotNil([cipher decryptData:second error:nil]);
+    XCTAssertNotNil([cipher decryptData:first error:nil]);
+    XCTAssertEqual(provider.unwrapCount, 3);
+
+    [cipher removeCachedDataKeys];
+    XCTAssertNotNil([cipher decryptData:first error:nil]);
+    XCTAssertEqual(provider.unwrapCount, 4);
+}
+
+#pragma mark - Failure Tests
+
+- (void)testTamperedEnvelopeFailsAuthentication {
+    MBSEnvelopeCipher *cipher = [[MBSEnvelopeCipher alloc] initWithKeyProvider:self.provider];
+    NSData *encrypted = [cipher encryptData:[@"Tamper" dataUsingEncoding:NSUTF8StringEncoding] error:nil];
+
+    // Last byte of the wrapped key, then last byte of the tag
+    NSUInteger headerLength = 8 + (((const uint8_t *)encrypted.bytes)[6] << 8 | ((const uint8_t *)encrypted.bytes)[7]);
+    for (NSNumber *offset in @[@(headerLength - 1), @(encrypted.length - 1)]) {
+        NSMutableData *tampered = [encrypted mutableCopy];
+        ((uint8_t *)tampered.mutableBytes)[offset.unsignedIntegerValue] ^= 0x01;
+
+        NSError *error = nil;
+        MBSEnvelopeCipher *reader = [[MBSEnvelopeCipher alloc] initWithKeyProvider:self.provider];
+        XCTAssertNil([reader decryptData:tampered error:&error]);
+        XCTAssertEqual(error.code, MBSCipherErrorAuthenticationFailed, @"offset %@", offset);
+    }
+}
+
+- (void)testFileKeyProviderRejectsBadIdentifiers {
+    NSError *error = nil;
+    XCTAssertFalse([self.provider generateKeyWithIdentifier:@"../escape" error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+
+    error = nil;
+    XCTAssertFalse([self.provider generateKeyWithIdentifier:@"kek-a" error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorIOFailure);
+
+    error = nil;
+    XCTAssertNil([self.provider wrapDataKey:[NSMutableData dataWithLength:32] withKeyIdentifier:@"missing" error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidKey);
+}
+
+- (void)testKeyFilesDecodeOnlyFullLengthHex {
+    uint8_t bytes[32];
+    for (int i = 0; i < 32; i++) {
+        bytes[i] = (uint8_t)(i * 7);
+    }
+    NSMutableString *hex = [NSMutableString string];
+    for (int i = 0; i < 32; i++) {
+        [hex appendFormat:@"%02x", bytes[i]];
+    }
+    [hex appendString:@"\n"];
+    NSURL *hexURL = [self.directory URLByAppendingPathComponent:@"hex.key"];
+    XCTAssertTrue([hex writeToURL:hexURL atomically:NO encoding:NSASCIIStringEncoding error:nil]);
+    XCTAssertEqualObjects([MBSFileKeyProvider keyFromFileAtURL:hexURL error:nil], [NSData dataWithBytes:bytes length:32]);
+
+    // Shorter hex text is not a 32-byte key and is returned as the raw bytes it is
+    NSData *shortHex = [@"00112233445566778899aabbccddeeff" dataUsingEncoding:NSASCIIStringEncoding];
+    NSURL *shortURL = [self.directory URLByAppendingPathComponent:@"short.key"];
+    XCTAssertTrue([shortHex writeToURL:shortURL atomically:NO]);
+    XCTAssertEqualObjects([MBSFileKeyProvider keyFromFileAtURL:shortURL error:nil], shortHex);
+
+    NSError *error = nil;
+    XCTAssertNil([MBSFileKeyProvider keyFromFileAtURL:[self.directory URLByAppendingPathComponent:@"missing.key"] error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorIOFailure);
+}
+
+@end
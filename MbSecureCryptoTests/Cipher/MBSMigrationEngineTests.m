@@ -0,0 +1,317 @@
+//
+//  MBSMigrationEngineTests.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+#import <XCTest/XCTest.h>
+#import "MbSecureCrypto.h"
+
+@interface MBSMigrationEngineTests : XCTestCase
+@property (nonatomic, strong) NSURL *directory;
+@property (nonatomic, strong) NSData *oldKey;
+@property (nonatomic, strong) NSData *newKey;
+@end
+
+@implementation MBSMigrationEngineTests
+
+- (void)setUp {
+    [super setUp];
+    self.directory = [[NSURL fileURLWithPath:NSTemporaryDirectory()]
+                      URLByAppendingPathComponent:[NSString stringWithFormat:@"migration-%@", NSUUID.UUID.UUIDString]];
+    [[NSFileManager defaultManager] createDirectoryAtURL:self.directory withIntermediateDirectories:YES attributes:nil error:nil];
+    self.oldKey = [MBSRandom generateBytes:32 error:nil];
+    self.newKey = [MBSRandom generateBytes:32 error:nil];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtURL:self.directory error:nil];
+    [super tearDown];
+}
+
+#pragma mark - Helpers
+
+- (NSData *)encrypt:(NSData *)plaintext format:(MBSCipherFormat)format {
+    return [MBSCipher encryptData:plaintext
+                    withAlgorithm:MBSCipherAlgorithmAESGCM
+                       withFormat:@(format)
+                          withKey:self.oldKey
+                            error:nil];
+}
+
+- (nullable NSData *)decryptChunked:(NSData *)ciphertext error:(NSError **)error {
+    NSInputStream *input = [NSInputStream inputStreamWithData:ciphertext];
+    NSOutputStream *output = [NSOutputStream outputStreamToMemory];
+    BOOL success = [MBSCipherStream decryptStream:input
+                                         toStream:output
+                                    withAlgorithm:MBSCipherAlgorithmAESGCM
+                                       withFormat:@(MBSCipherFormatV1)
+                                          withKey:self.newKey
+                                            error:error];
+    [input close];
+    [output close];
+    return success ? [output propertyForKey:NSStreamDataWrittenToMemoryStreamKey] : nil;
+}
+
+- (NSURL *)fileNamed:(NSString *)name {
+    return [self.directory URLByAppendingPathComponent:name];
+}
+
+- (NSData *)packedStoreWithBlobs:(NSArray<NSData *> *)blobs {
+    NSMutableData *store = [NSMutableData data];
+    for (NSData *blob in blobs) {
+        uint64_t lengthBE = CFSwapInt64HostToBig(blob.length);
+        [store appendBytes:&lengthBE length:sizeof(lengthBE)];
+        [store appendData:blob];
+    }
+    return store;
+}
+
+/// Splits a packed store into entries, keeping each raw length field
+- (NSArray<NSArray *> *)entriesOfPackedStore:(NSData *)store {
+    NSMutableArray<NSArray *> *entries = [NSMutableArray array];
+    NSUInteger offset = 0;
+    while (offset + 8 <= store.length) {
+        uint64_t lengthBE = 0;
+        [store getBytes:&lengthBE range:NSMakeRange(offset, 8)];
+        uint64_t field = CFSwapInt64BigToHost(lengthBE);
+        NSUInteger length = (NSUInteger)(field & ~kMBSPackedStoreFailedEntryFlag);
+        [entries addObject:@[@(field), [store subdataWithRange:NSMakeRange(offset + 8, length)]]];
+        offset += 8 + length;
+    }
+    XCTAssertEqual(offset, store.length);
+    return entries;
+}
+
+#pragma mark - File Tests
+
+- (void)testMigratesV0AndV1FilesUnderNewKey {
+    NSMutableArray<NSData *> *plaintexts = [NSMutableArray array];
+    for (NSNumber *length in @[@0, @100, @4096, @(4096 * 3 + 17)]) {
+        [plaintexts addObject:[MBSRandom generateBytes:length.unsignedIntegerValue error:nil] ?: [NSData data]];
+    }
+
+    NSMutableArray<NSURL *> *sources = [NSMutableArray array];
+    NSMutableArray<NSURL *> *destinations = [NSMutableArray array];
+    for (NSUInteger i = 0; i < plaintexts.count * 2; i++) {
+        MBSCipherFormat format = i < plaintexts.count ? MBSCipherFormatV0 : MBSCipherFormatV1;
+        NSURL *source = [self fileNamed:[NSString stringWithFormat:@"blob-%lu.v%ld", (unsigned long)i, (long)format]];
+        XCTAssertTrue([[self encrypt:plaintexts[i % plaintexts.count] format:format] writeToURL:source atomically:NO]);
+        [sources addObject:source];
+        [destinations addObject:[self fileNamed:[NSString stringWithFormat:@"blob-%lu.secb", (unsigned long)i]]];
+    }
+
+    MBSMigrationEngine *engine = [[MBSMigrationEngine alloc] initWithSourceKey:self.oldKey destinationKey:self.newKey];
+    engine.chunkSize = 4096;
+    NSError *error = nil;
+    MBSMigrationReport *report = [engine migrateFiles:sources toOutputs:destinations error:&error];
+    XCTAssertNotNil(report, @"%@", error);
+    XCTAssertTrue(report.isFinished);
+    XCTAssertEqual(report.migratedCount, sources.count);
+    XCTAssertEqual(report.failedCount, 0, @"%@", report.failures);
+
+    for (NSUInteger i = 0; i < destinations.count; i++) {
+        NSData *decrypted = [self decryptChunked:[NSData dataWithContentsOfURL:destinations[i]] error:&error];
+        XCTAssertEqualObjects(decrypted, plaintexts[i % plaintexts.count], @"blob %lu: %@", (unsigned long)i, error);
+    }
+}
+
+- (void)testFailuresAreCountedByCode {
+    NSData *plaintext = [MBSRandom generateBytes:10000 error:nil];
+    NSMutableData *tampered = [[self encrypt:plaintext format:MBSCipherFormatV0] mutableCopy];
+    ((uint8_t *)tampered.mutableBytes)[tampered.length - 1] ^= 0x01;
+    NSData *compressed = [MBSCipher encryptData:[NSMutableData dataWithLength:8192]
+                                  withAlgorithm:MBSCipherAlgorithmAESGCM
+                                withCompression:MBSCompressionCodecLZ4
+                                        withKey:self.oldKey
+                                          error:nil];
+
+    NSArray<NSData *> *blobs = @[[self encrypt:plaintext format:MBSCipherFormatV0], tampered, tampered, compressed];
+    NSMutableArray<NSURL *> *sources = [NSMutableArray array];
+    NSMutableArray<NSURL *> *destinations = [NSMutableArray array];
+    for (NSUInteger i = 0; i < blobs.count; i++) {
+        [sources addObject:[self fileNamed:[NSString stringWithFormat:@"in-%lu", (unsigned long)i]]];
+        [destinations addObject:[self fileNamed:[NSString stringWithFormat:@"out-%lu", (unsigned long)i]]];
+        XCTAssertTrue([blobs[i] writeToURL:sources[i] atomically:NO]);
+    }
+    [sources addObject:[self fileNamed:@"missing"]];
+    [destinations addObject:[self fileNamed:@"out-missing"]];
+
+    MBSMigrationEngine *engine = [[MBSMigrationEngine alloc] initWithSourceKey:self.oldKey destinationKey:self.newKey];
+    engine.chunkSize = 4096;
+    MBSMigrationReport *report = [engine migrateFiles:sources toOutputs:destinations error:nil];
+    XCTAssertEqual(report.migratedCount, 1);
+    XCTAssertEqual(report.failedCount, 4);
+    XCTAssertEqualObjects(report.failureCounts[@(MBSCipherErrorAuthenticationFailed)], @2);
+    XCTAssertEqualObjects(report.failureCounts[@(MBSCipherErrorUnsupportedFormat)], @1);
+    XCTAssertEqualObjects(report.failureCounts[@(MBSCipherErrorIOFailure)], @1);
+    XCTAssertEqual(report.failures[@1].code, MBSCipherErrorAuthenticationFailed);
+
+    // Nothing resealed from the tampered blobs is left behind
+    NSArray *contents = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:self.directory.path error:nil];
+    XCTAssertEqual(contents.count, blobs.count + 1, @"%@", contents);
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:destinations[1].path]);
+}
+
+#pragma mark - Packed Store Tests
+
+- (void)testMigratesPackedStore {
+    NSMutableArray<NSData *> *plaintexts = [NSMutableArray array];
+    NSMutableArray<NSData *> *blobs = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 40; i++) {
+        NSData *plaintext = [MBSRandom generateBytes:1 + i * 311 error:nil];
+        [plaintexts addObject:plaintext];
+        [blobs addObject:[self encrypt:plaintext format:i % 3 ? MBSCipherFormatV0 : MBSCipherFormatV1]];
+    }
+    NSMutableData *tampered = [blobs[7] mutableCopy];
+    ((uint8_t *)tampered.mutableBytes)[20] ^= 0x01;
+    blobs[7] = tampered;
+    blobs[8] = [NSData dataWithBytes:"short" length:5];
+
+    NSURL *source = [self fileNamed:@"legacy.pack"];
+    NSURL *destination = [self fileNamed:@"migrated.pack"];
+    XCTAssertTrue([[self packedStoreWithBlobs:blobs] writeToURL:source atomically:NO]);
+
+    MBSMigrationEngine *engine = [[MBSMigrationEngine alloc] initWithSourceKey:self.oldKey destinationKey:self.newKey];
+    engine.chunkSize = 4096;
+    engine.batchSize = 16;
+    NSError *error = nil;
+    MBSMigrationReport *report = [engine migratePackedStore:source toPackedStore:destination error:&error];
+    XCTAssertNotNil(report, @"%@", error);
+    XCTAssertEqual(report.totalCount, 40);
+    XCTAssertEqual(report.migratedCount, 38);
+    XCTAssertEqualObjects(report.failureCounts[@(MBSCipherErrorAuthenticationFailed)], @1);
+    XCTAssertEqualObjects(report.failureCounts[@(MBSCipherErrorInvalidInput)], @1);
+
+    NSArray<NSArray *> *entries = [self entriesOfPackedStore:[NSData dataWithContentsOfURL:destination]];
+    XCTAssertEqual(entries.count, 40);
+    for (NSUInteger i = 0; i < entries.count; i++) {
+        uint64_t field = [entries[i][0] unsignedLongLongValue];
+        NSData *payload = entries[i][1];
+        if (i == 7 || i == 8) {
+            XCTAssertNotEqual(field & kMBSPackedStoreFailedEntryFlag, 0);
+            XCTAssertEqualObjects(payload, [NSMutableData dataWithLength:payload.length]);
+            continue;
+        }
+        XCTAssertEqual(field & kMBSPackedStoreFailedEntryFlag, 0);
+        XCTAssertEqualObjects([self decryptChunked:payload error:&error], plaintexts[i], @"entry %lu: %@", (unsigned long)i, error);
+    }
+}
+
+- (void)testTruncatedPackedStoreIsRejected {
+    NSMutableData *store = [[self packedStoreWithBlobs:@[[self encrypt:[NSData dataWithBytes:"x" length:1] format:MBSCipherFormatV0]]] mutableCopy];
+    store.length -= 1;
+    NSURL *source = [self fileNamed:@"truncated.pack"];
+    XCTAssertTrue([store writeToURL:source atomically:NO]);
+
+    MBSMigrationEngine *engine = [[MBSMigrationEngine alloc] initWithSourceKey:self.oldKey destinationKey:self.newKey];
+    NSError *error = nil;
+    XCTAssertNil([engine migratePackedStore:source toPackedStore:[self fileNamed:@"out.pack"] error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+}
+
+#pragma mark - Checkpoint Tests
+
+- (void)testResumesFromCheckpoint {
+    NSMutableArray<NSData *> *plaintexts = [NSMutableArray array];
+    NSMutableArray<NSData *> *blobs = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 10; i++) {
+        [plaintexts addObject:[MBSRandom generateBytes:500 + i error:nil]];
+        [blobs addObject:[self encrypt:plaintexts[i] format:MBSCipherFormatV0]];
+    }
+    NSURL *source = [self fileNamed:@"legacy.pack"];
+    NSURL *destination = [self fileNamed:@"migrated.pack"];
+    NSURL *checkpoint = [self fileNamed:@"migration.checkpoint"];
+    XCTAssertTrue([[self packedStoreWithBlobs:blobs] writeToURL:source atomically:NO]);
+
+    // First run stops after its first batch
+    MBSMigrationEngine *engine = [[MBSMigrationEngine alloc] initWithSourceKey:self.oldKey destinationKey:self.newKey];
+    engine.batchSize = 4;
+    engine.checkpointURL = checkpoint;
+    __weak MBSMigrationEngine *weakEngine = engine;
+    engine.progressHandler = ^(MBSMigrationReport *progress) {
+        [weakEngine cancel];
+    };
+    NSError *error = nil;
+    MBSMigrationReport *report = [engine migratePackedStore:source toPackedStore:destination error:&error];
+    XCTAssertNotNil(report, @"%@", error);
+    XCTAssertFalse(report.isFinished);
+    XCTAssertEqual(report.completedCount, 4);
+
+    // Second run picks up at the watermark
+    MBSMigrationEngine *resumed = [[MBSMigrationEngine alloc] initWithSourceKey:self.oldKey destinationKey:self.newKey];
+    resumed.batchSize = 4;
+    resumed.checkpointURL = checkpoint;
+    report = [resumed migratePackedStore:source toPackedStore:destination error:&error];
+    XCTAssertTrue(report.isFinished);
+    XCTAssertEqual(report.migratedCount, 10);
+    XCTAssertLessThan(report.bytesRead, [NSData dataWithContentsOfURL:source].length);
+
+    NSArray<NSArray *> *entries = [self entriesOfPackedStore:[NSData dataWithContentsOfURL:destination]];
+    XCTAssertEqual(entries.count, 10);
+    for (NSUInteger i = 0; i < entries.count; i++) {
+        XCTAssertEqualObjects([self decryptChunked:entries[i][1] error:nil], plaintexts[i], @"entry %lu", (unsigned long)i);
+    }
+
+    // The checkpoint belongs to this store only
+    XCTAssertTrue([[self packedStoreWithBlobs:[blobs subarrayWithRange:NSMakeRange(0, 5)]] writeToURL:source atomically:NO]);
+    error = nil;
+    XCTAssertNil([resumed migratePackedStore:source toPackedStore:destination error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+}
+
+- (void)testFileCheckpointBelongsToItsFileList {
+    NSMutableArray<NSURL *> *sources = [NSMutableArray array];
+    NSMutableArray<NSURL *> *destinations = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 6; i++) {
+        NSURL *source = [self fileNamed:[NSString stringWithFormat:@"file-%lu.v0", (unsigned long)i]];
+        NSData *plaintext = [MBSRandom generateBytes:300 + i error:nil];
+        XCTAssertTrue([[self encrypt:plaintext format:MBSCipherFormatV0] writeToURL:source atomically:NO]);
+        [sources addObject:source];
+        [destinations addObject:[self fileNamed:[NSString stringWithFormat:@"file-%lu.secb", (unsigned long)i]]];
+    }
+    NSURL *checkpoint = [self fileNamed:@"files.checkpoint"];
+
+    MBSMigrationEngine *engine = [[MBSMigrationEngine alloc] initWithSourceKey:self.oldKey destinationKey:self.newKey];
+    engine.batchSize = 2;
+    engine.checkpointURL = checkpoint;
+    __weak MBSMigrationEngine *weakEngine = engine;
+    engine.progressHandler = ^(MBSMigrationReport *progress) {
+        [weakEngine cancel];
+    };
+    NSError *error = nil;
+    MBSMigrationReport *report = [engine migrateFiles:sources toOutputs:destinations error:&error];
+    XCTAssertEqual(report.completedCount, 2, @"%@", error);
+
+    // Same count, different order: the watermark would skip files that were never migrated
+    NSArray<NSURL *> *reordered = [[sources reverseObjectEnumerator] allObjects];
+    MBSMigrationEngine *resumed = [[MBSMigrationEngine alloc] initWithSourceKey:self.oldKey destinationKey:self.newKey];
+    resumed.batchSize = 2;
+    resumed.checkpointURL = checkpoint;
+    XCTAssertNil([resumed migrateFiles:reordered toOutputs:destinations error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+
+    // Same files under another destination key
+    error = nil;
+    MBSMigrationEngine *rekeyed = [[MBSMigrationEngine alloc] initWithSourceKey:self.oldKey destinationKey:self.oldKey];
+    rekeyed.checkpointURL = checkpoint;
+    XCTAssertNil([rekeyed migrateFiles:sources toOutputs:destinations error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+
+    // The original job still resumes
+    error = nil;
+    report = [resumed migrateFiles:sources toOutputs:destinations error:&error];
+    XCTAssertTrue(report.isFinished, @"%@", error);
+    XCTAssertEqual(report.migratedCount, sources.count);
+}
+
+- (void)testRejectsInvalidKeys {
+    MBSMigrationEngine *engine = [[MBSMigrationEngine alloc] initWithSourceKey:[NSData dataWithBytes:"short" length:5]
+                                                                destinationKey:self.newKey];
+    NSError *error = nil;
+    XCTAssertNil([engine migrateFiles:@[] toOutputs:@[] error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidKey);
+}
+
+@end
@@ -0,0 +1,231 @@
+//
+//  MBSMultiRecipientCipherTests.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+#import <XCTest/XCTest.h>
+#import "MbSecureCrypto.h"
+#import <CommonCrypto/CommonHMAC.h>
+
+@interface MBSMultiRecipientCipherTests : XCTestCase
+@property (nonatomic, strong) NSURL *directory;
+@property (nonatomic, strong) NSArray<NSData *> *keys;
+@end
+
+@implementation MBSMultiRecipientCipherTests
+
+- (void)setUp {
+    [super setUp];
+    self.directory = [[NSURL fileURLWithPath:NSTemporaryDirectory()]
+                      URLByAppendingPathComponent:[NSString stringWithFormat:@"recipients-%@", NSUUID.UUID.UUIDString]];
+    [[NSFileManager defaultManager] createDirectoryAtURL:self.directory withIntermediateDirectories:YES attributes:nil error:nil];
+
+    NSMutableArray<NSData *> *keys = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 4; i++) {
+        [keys addObject:[MBSRandom generateBytes:32 error:nil]];
+    }
+    self.keys = keys;
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtURL:self.directory error:nil];
+    [super tearDown];
+}
+
+- (NSData *)identifierForKeyAtIndex:(NSUInteger)index {
+    return [MBSMultiRecipientCipher recipientIdentifierForKey:self.keys[index] error:nil];
+}
+
+#pragma mark - Round Trip Tests
+
+- (void)testEveryRecipientDecrypts {
+    NSArray<NSData *> *recipients = [self.keys subarrayWithRange:NSMakeRange(0, 3)];
+    NSData *plaintext = [@"Shared payload" dataUsingEncoding:NSUTF8StringEncoding];
+
+    for (NSData *data in @[plaintext, [NSData data]]) {
+        NSError *error = nil;
+        NSData *encrypted = [MBSMultiRecipientCipher encryptData:data forRecipients:recipients error:&error];
+        XCTAssertNotNil(encrypted, @"%@", error);
+
+        // One payload plus a 48-byte entry per recipient
+        XCTAssertEqual(encrypted.length, 8 + 16 + 3 + 3 * 48 + data.length + 16);
+
+        for (NSData *key in recipients) {
+            XCTAssertEqualObjects([MBSMultiRecipientCipher decryptData:encrypted withRecipientKey:key error:&error], data,
+                                  @"%@", error);
+        }
+
+        error = nil;
+        XCTAssertNil([MBSMultiRecipientCipher decryptData:encrypted withRecipientKey:self.keys[3] error:&error]);
+        XCTAssertEqual(error.code, MBSCipherErrorInvalidKey);
+    }
+}
+
+- (void)testRecipientIdentifiers {
+    NSData *identifier = [self identifierForKeyAtIndex:0];
+    XCTAssertEqual(identifier.length, 8);
+    XCTAssertEqualObjects([MBSMultiRecipientCipher recipientIdentifierForKey:self.keys[0] error:nil], identifier);
+    XCTAssertNotEqualObjects([self identifierForKeyAtIndex:1], identifier);
+
+    // KEY_ID is keyed with its own subkey, never with the recipient key that also wraps content keys
+    static const char label[] = "MbSecureCrypto.recipient";
+    uint8_t mac[CC_SHA256_DIGEST_LENGTH];
+    NSData *subkey = [MBSKeyDerivation deriveKey:self.keys[0] domain:@"MbSecureCrypto.recipient" context:@"identifier" error:nil];
+    CCHmac(kCCHmacAlgSHA256, subkey.bytes, subkey.length, label, sizeof(label) - 1, mac);
+    XCTAssertEqualObjects(identifier, [NSData dataWithBytes:mac length:8]);
+    CCHmac(kCCHmacAlgSHA256, self.keys[0].bytes, self.keys[0].length, label, sizeof(label) - 1, mac);
+    XCTAssertNotEqualObjects(identifier, [NSData dataWithBytes:mac length:8]);
+
+    NSData *encrypted = [MBSMultiRecipientCipher encryptData:[NSData dataWithBytes:"x" length:1]
+                                               forRecipients:self.keys
+                                                       error:nil];
+    NSArray<NSData *> *identifiers = [MBSMultiRecipientCipher recipientIdentifiersForData:encrypted error:nil];
+    XCTAssertEqual(identifiers.count, 4);
+    XCTAssertTrue([identifiers containsObject:identifier]);
+}
+
+- (void)testFileRoundTrip {
+    NSData *plaintext = [MBSRandom generateBytes:3 * kMBSCipherStreamDefaultChunkSize + 123 error:nil];
+    NSURL *inputURL = [self.directory URLByAppendingPathComponent:@"plain.bin"];
+    NSURL *encryptedURL = [self.directory URLByAppendingPathComponent:@"shared.secb"];
+    NSURL *outputURL = [self.directory URLByAppendingPathComponent:@"restored.bin"];
+    XCTAssertTrue([plaintext writeToURL:inputURL atomically:NO]);
+
+    NSError *error = nil;
+    NSArray<NSData *> *recipients = [self.keys subarrayWithRange:NSMakeRange(0, 2)];
+    XCTAssertTrue([MBSMultiRecipientCipher encryptFile:inputURL toOutput:encryptedURL forRecipients:recipients error:&error],
+                  @"%@", error);
+
+    for (NSData *key in recipients) {
+        XCTAssertTrue([MBSMultiRecipientCipher decryptFile:encryptedURL toOutput:outputURL withRecipientKey:key error:&error],
+                      @"%@", error);
+        XCTAssertEqualObjects([NSData dataWithContentsOfURL:outputURL], plaintext);
+    }
+
+    // Read into memory, the chunked file decrypts as data too
+    NSData *encrypted = [NSData dataWithContentsOfURL:encryptedURL];
+    XCTAssertEqualObjects([MBSMultiRecipientCipher decryptData:encrypted withRecipientKey:recipients[1] error:&error], plaintext);
+}
+
+#pragma mark - Recipient Change Tests
+
+- (void)testAddAndRemoveRewriteOnlyTheHeader {
+    NSData *plaintext = [@"Rotate recipients" dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *encrypted = [MBSMultiRecipientCipher encryptData:plaintext forRecipients:@[self.keys[0]] error:nil];
+    NSUInteger payloadLength = plaintext.length + 16;
+    NSData *payload = [encrypted subdataWithRange:NSMakeRange(encrypted.length - payloadLength, payloadLength)];
+
+    NSError *error = nil;
+    NSData *added = [MBSMultiRecipientCipher addRecipient:self.keys[1] toData:encrypted withRecipientKey:self.keys[0] error:&error];
+    XCTAssertNotNil(added, @"%@", error);
+    XCTAssertEqual(added.length, encrypted.length + 48);
+    XCTAssertEqualObjects([added subdataWithRange:NSMakeRange(added.length - payloadLength, payloadLength)], payload);
+    XCTAssertEqualObjects([MBSMultiRecipientCipher decryptData:added withRecipientKey:self.keys[1] error:&error], plaintext);
+
+    NSData *removed = [MBSMultiRecipientCipher removeRecipient:[self identifierForKeyAtIndex:0] fromData:added error:&error];
+    XCTAssertNotNil(removed, @"%@", error);
+    XCTAssertEqualObjects([removed subdataWithRange:NSMakeRange(removed.length - payloadLength, payloadLength)], payload);
+    XCTAssertEqualObjects([MBSMultiRecipientCipher decryptData:removed withRecipientKey:self.keys[1] error:&error], plaintext);
+
+    error = nil;
+    XCTAssertNil([MBSMultiRecipientCipher decryptData:removed withRecipientKey:self.keys[0] error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidKey);
+
+    // Duplicates, strangers and the last recipient are refused
+    error = nil;
+    XCTAssertNil([MBSMultiRecipientCipher addRecipient:self.keys[1] toData:removed withRecipientKey:self.keys[1] error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+
+    error = nil;
+    XCTAssertNil([MBSMultiRecipientCipher addRecipient:self.keys[2] toData:removed withRecipientKey:self.keys[3] error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidKey);
+
+    error = nil;
+    XCTAssertNil([MBSMultiRecipientCipher removeRecipient:[self identifierForKeyAtIndex:1] fromData:removed error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+}
+
+- (void)testAddAndRemoveRecipientsOfFile {
+    NSData *plaintext = [MBSRandom generateBytes:200 * 1024 error:nil];
+    NSURL *inputURL = [self.directory URLByAppendingPathComponent:@"plain.bin"];
+    NSURL *encryptedURL = [self.directory URLByAppendingPathComponent:@"shared.secb"];
+    NSURL *outputURL = [self.directory URLByAppendingPathComponent:@"restored.bin"];
+    XCTAssertTrue([plaintext writeToURL:inputURL atomically:NO]);
+    XCTAssertTrue([MBSMultiRecipientCipher encryptFile:inputURL toOutput:encryptedURL forRecipients:@[self.keys[0]] error:nil]);
+    NSUInteger originalSize = [NSData dataWithContentsOfURL:encryptedURL].length;
+
+    NSError *error = nil;
+    XCTAssertTrue([MBSMultiRecipientCipher addRecipient:self.keys[2] toFile:encryptedURL withRecipientKey:self.keys[0] error:&error],
+                  @"%@", error);
+    XCTAssertTrue([MBSMultiRecipientCipher removeRecipient:[self identifierForKeyAtIndex:0] fromFile:encryptedURL error:&error],
+                  @"%@", error);
+    XCTAssertEqual([NSData dataWithContentsOfURL:encryptedURL].length, originalSize);
+
+    XCTAssertTrue([MBSMultiRecipientCipher decryptFile:encryptedURL toOutput:outputURL withRecipientKey:self.keys[2] error:&error],
+                  @"%@", error);
+    XCTAssertEqualObjects([NSData dataWithContentsOfURL:outputURL], plaintext);
+
+    error = nil;
+    XCTAssertFalse([MBSMultiRecipientCipher decryptFile:encryptedURL toOutput:outputURL withRecipientKey:self.keys[0] error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidKey);
+}
+
+#pragma mark - Failure Tests
+
+- (void)testTamperingIsDetected {
+    NSData *encrypted = [MBSMultiRecipientCipher encryptData:[@"Tamper" dataUsingEncoding:NSUTF8StringEncoding]
+                                               forRecipients:@[self.keys[0]]
+                                                       error:nil];
+
+    // Last byte of the wrapped key, then last byte of the tag
+    NSUInteger headerLength = 8 + (((const uint8_t *)encrypted.bytes)[6] << 8 | ((const uint8_t *)encrypted.bytes)[7]);
+    for (NSNumber *offset in @[@(headerLength - 1), @(encrypted.length - 1)]) {
+        NSMutableData *tampered = [encrypted mutableCopy];
+        ((uint8_t *)tampered.mutableBytes)[offset.unsignedIntegerValue] ^= 0x01;
+
+        NSError *error = nil;
+        XCTAssertNil([MBSMultiRecipientCipher decryptData:tampered withRecipientKey:self.keys[0] error:&error]);
+        XCTAssertEqual(error.code, MBSCipherErrorAuthenticationFailed, @"offset %@", offset);
+    }
+}
+
+- (void)testFormatsAreKeptApart {
+    NSError *error = nil;
+    NSData *encrypted = [MBSMultiRecipientCipher encryptData:[@"Shared" dataUsingEncoding:NSUTF8StringEncoding]
+                                               forRecipients:@[self.keys[0]]
+                                                       error:&error];
+    XCTAssertNil([MBSCipher decryptData:encrypted
+                          withAlgorithm:MBSCipherAlgorithmAESGCM
+                             withFormat:nil
+                                withKey:self.keys[0]
+                                  error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorFormatMismatch);
+
+    NSData *plain = [MBSCipher encryptData:[@"Plain" dataUsingEncoding:NSUTF8StringEncoding]
+                             withAlgorithm:MBSCipherAlgorithmAESGCM
+                                withFormat:@(MBSCipherFormatV1)
+                                   withKey:self.keys[0]
+                                     error:nil];
+    error = nil;
+    XCTAssertNil([MBSMultiRecipientCipher decryptData:plain withRecipientKey:self.keys[0] error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorFormatMismatch);
+}
+
+- (void)testInvalidRecipientLists {
+    NSData *data = [NSData dataWithBytes:"x" length:1];
+    NSError *error = nil;
+    XCTAssertNil([MBSMultiRecipientCipher encryptData:data forRecipients:@[] error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+
+    error = nil;
+    XCTAssertNil([MBSMultiRecipientCipher encryptData:data forRecipients:@[self.keys[0], self.keys[0]] error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+
+    error = nil;
+    XCTAssertNil([MBSMultiRecipientCipher encryptData:data forRecipients:@[[NSData dataWithBytes:"short" length:5]] error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidKey);
+}
+
+@end
@@ -0,0 +1,183 @@
+//
+//  MBSArgon2Tests.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+#import <XCTest/XCTest.h>
+#import "MbSecureCrypto.h"
+
+@interface MBSArgon2Tests : XCTestCase
+@end
+
+@implementation MBSArgon2Tests
+
+#pragma mark - Helpers
+
+- (NSData *)dataFromHex:(NSString *)hex {
+    NSMutableData *data = [NSMutableData dataWithCapacity:hex.length / 2];
+    for (NSUInteger i = 0; i + 1 < hex.length; i += 2) {
+        uint8_t byte = (uint8_t)strtoul([[hex substringWithRange:NSMakeRange(i, 2)] UTF8String], NULL, 16);
+        [data appendBytes:&byte length:1];
+    }
+    return data;
+}
+
+- (NSData *)utf8:(NSString *)string {
+    return [string dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+#pragma mark - Known Answer Tests
+
+- (void)testKnownAnswerVectors {
+    // From the Argon2 reference implementation: password "password", salt "somesalt", 32-byte output
+    NSArray<NSArray *> *vectors = @[
+        @[@64, @2, @1, @"16a1a498734609dd01456da406de9f3d9da93e6c86c300a12fc1465214ce4922"],
+        @[@256, @3, @2, @"a3161de99d0e7c0762364b2c4b3ea2b950005973f8879d54287fd8bd56921f36"],
+        @[@1024, @1, @4, @"c93a35dd35a0f4c5b2656292950cdb764733275b5d1eb95a434b242455a63f0d"],
+    ];
+
+    for (NSArray *vector in vectors) {
+        MBSArgon2Parameters *parameters = [[MBSArgon2Parameters alloc] initWithMemoryKiB:[vector[0] unsignedIntValue]
+                                                                              iterations:[vector[1] unsignedIntValue]
+                                                                             parallelism:[vector[2] unsignedIntValue]
+                                                                                    salt:[self utf8:@"somesalt"]];
+        NSError *error = nil;
+        NSData *key = [MBSKeyDerivation deriveKeyFromPassword:[self utf8:@"password"]
+                                                   parameters:parameters
+                                                      keySize:32
+                                                        error:&error];
+        XCTAssertEqualObjects(key, [self dataFromHex:vector[3]], @"%@: %@", parameters, error);
+    }
+}
+
+- (void)testParallelLanesMatchSequentialResult {
+    // The result depends on the lane count, never on how many threads fill the lanes
+    MBSArgon2Parameters *parameters = [[MBSArgon2Parameters alloc] initWithMemoryKiB:1024
+                                                                          iterations:2
+                                                                         parallelism:4
+                                                                                salt:[self utf8:@"somesalt"]];
+    NSData *first = [MBSKeyDerivation deriveKeyFromPassword:[self utf8:@"password"] parameters:parameters keySize:32 error:nil];
+    for (NSUInteger i = 0; i < 4; i++) {
+        XCTAssertEqualObjects([MBSKeyDerivation deriveKeyFromPassword:[self utf8:@"password"]
+                                                           parameters:parameters
+                                                              keySize:32
+                                                                error:nil], first);
+    }
+}
+
+#pragma mark - PHC String Tests
+
+- (void)testEncodedStringRoundTrip {
+    MBSArgon2Parameters *parameters = [[MBSArgon2Parameters alloc] initWithMemoryKiB:65536
+                                                                          iterations:3
+                                                                         parallelism:4
+                                                                                salt:[self utf8:@"somesalt"]];
+    XCTAssertEqualObjects(parameters.encodedString, @"$argon2id$v=19$m=65536,t=3,p=4$c29tZXNhbHQ");
+
+    NSError *error = nil;
+    XCTAssertEqualObjects([MBSArgon2Parameters parametersFromEncodedString:parameters.encodedString error:&error],
+                          parameters, @"%@", error);
+}
+
+- (void)testMalformedEncodedStrings {
+    NSDictionary<NSString *, NSNumber *> *cases = @{
+        @"$argon2i$v=19$m=64,t=2,p=1$c29tZXNhbHQ": @(MBSCipherErrorUnsupportedAlgorithm),
+        @"$argon2id$v=16$m=64,t=2,p=1$c29tZXNhbHQ": @(MBSCipherErrorUnsupportedFormat),
+        @"$argon2id$v=19$m=64,t=2$c29tZXNhbHQ": @(MBSCipherErrorInvalidInput),
+        @"$argon2id$v=19$m=64,t=0,p=1$c29tZXNhbHQ": @(MBSCipherErrorInvalidInput),
+        @"$argon2id$v=19$m=4,t=2,p=1$c29tZXNhbHQ": @(MBSCipherErrorInvalidInput),
+        @"$argon2id$v=19$m=2097153,t=1,p=1$c29tZXNhbHQ": @(MBSCipherErrorInvalidInput),
+        @"$argon2id$v=19$m=65536,t=1,p=256$c29tZXNhbHQ": @(MBSCipherErrorInvalidInput),
+        @"$argon2id$v=19$m=8,t=4294967295,p=1$c29tZXNhbHQ": @(MBSCipherErrorInvalidInput),
+        @"$argon2id$v=19$m=8,t=1025,p=1$c29tZXNhbHQ": @(MBSCipherErrorInvalidInput),
+        @"$argon2id$v=19$m=64,t=1\u0661,p=1$c29tZXNhbHQ": @(MBSCipherErrorInvalidInput),
+        @"$argon2id$v=19$m=6\uFF14,t=2,p=1$c29tZXNhbHQ": @(MBSCipherErrorInvalidInput),
+        @"$argon2id$v=19$m=64,t=2,p=1$c29tZXNhbHQ=": @(MBSCipherErrorInvalidInput),
+        @"$argon2id$v=19$m=64,t=2,p=1$c2FsdA": @(MBSCipherErrorInvalidInput),
+    };
+
+    [cases enumerateKeysAndObjectsUsingBlock:^(NSString *encoded, NSNumber *code, BOOL *stop) {
+        NSError *error = nil;
+        XCTAssertNil([MBSArgon2Parameters parametersFromEncodedString:encoded error:&error], @"%@", encoded);
+        XCTAssertEqual(error.code, code.integerValue, @"%@", encoded);
+    }];
+}
+
+#pragma mark - Password Hash Tests
+
+- (void)testHashAndVerifyPassword {
+    MBSArgon2Parameters *parameters = [MBSArgon2Parameters parametersWithMemoryKiB:256 iterations:2 parallelism:2];
+    NSError *error = nil;
+    NSString *hash = [MBSKeyDerivation hashPassword:[self utf8:@"correct horse"] parameters:parameters error:&error];
+    XCTAssertNotNil(hash, @"%@", error);
+    XCTAssertTrue([hash hasPrefix:[parameters.encodedString stringByAppendingString:@"$"]]);
+
+    XCTAssertTrue([MBSKeyDerivation verifyPassword:[self utf8:@"correct horse"] againstHash:hash error:&error], @"%@", error);
+
+    error = nil;
+    XCTAssertFalse([MBSKeyDerivation verifyPassword:[self utf8:@"correct horsf"] againstHash:hash error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorAuthenticationFailed);
+
+    // A parameter string without a hash cannot be verified against
+    error = nil;
+    XCTAssertFalse([MBSKeyDerivation verifyPassword:[self utf8:@"correct horse"] againstHash:parameters.encodedString error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+
+    // Costs past the limits are rejected rather than allocated
+    error = nil;
+    NSString *oversized = [hash stringByReplacingOccurrencesOfString:@"m=256," withString:@"m=4294967295,"];
+    XCTAssertFalse([MBSKeyDerivation verifyPassword:[self utf8:@"correct horse"] againstHash:oversized error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+}
+
+- (void)testFreshSaltsGiveDifferentKeys {
+    MBSArgon2Parameters *parameters = [MBSArgon2Parameters parametersWithMemoryKiB:64 iterations:1 parallelism:1];
+    MBSArgon2Parameters *resalted = [parameters parametersWithNewSalt];
+    XCTAssertNotNil(resalted);
+    XCTAssertNotEqualObjects(parameters.salt, resalted.salt);
+    XCTAssertEqual(resalted.memoryKiB, parameters.memoryKiB);
+
+    NSData *password = [self utf8:@"password"];
+    XCTAssertNotEqualObjects([MBSKeyDerivation deriveKeyFromPassword:password parameters:parameters keySize:32 error:nil],
+                             [MBSKeyDerivation deriveKeyFromPassword:password parameters:resalted keySize:32 error:nil]);
+}
+
+#pragma mark - Calibration Tests
+
+- (void)testCalibrationStaysWithinBudget {
+    NSError *error = nil;
+    MBSArgon2Parameters *parameters = [MBSKeyDerivation calibrateForTargetLatency:0.05
+                                                                     memoryBudget:8 * 1024 * 1024
+                                                                            error:&error];
+    XCTAssertNotNil(parameters, @"%@", error);
+    XCTAssertLessThanOrEqual(parameters.memoryKiB, 8 * 1024);
+    XCTAssertGreaterThanOrEqual(parameters.memoryKiB, 8 * parameters.parallelism);
+    XCTAssertGreaterThanOrEqual(parameters.iterations, 1);
+    XCTAssertLessThanOrEqual(parameters.parallelism, 8);
+    XCTAssertEqual(parameters.salt.length, 16);
+}
+
+#pragma mark - Failure Tests
+
+- (void)testInvalidRequests {
+    XCTAssertNil([[MBSArgon2Parameters alloc] initWithMemoryKiB:64 iterations:1 parallelism:1 salt:[self utf8:@"short"]]);
+    XCTAssertNil([MBSArgon2Parameters parametersWithMemoryKiB:15 iterations:1 parallelism:2]);
+    XCTAssertNil([MBSArgon2Parameters parametersWithMemoryKiB:4096 iterations:1 parallelism:256]);
+    XCTAssertNil([MBSArgon2Parameters parametersWithMemoryKiB:64 iterations:kMBSArgon2MaxIterations + 1 parallelism:1]);
+    XCTAssertNotNil([MBSArgon2Parameters parametersWithMemoryKiB:64 iterations:kMBSArgon2MaxIterations parallelism:1]);
+
+    NSError *error = nil;
+    XCTAssertNil([MBSKeyDerivation deriveKeyFromPassword:[self utf8:@"password"]
+                                              parameters:[MBSArgon2Parameters defaultParameters]
+                                                 keySize:3
+                                                   error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+
+    error = nil;
+    XCTAssertNil([MBSKeyDerivation calibrateForTargetLatency:0.1 memoryBudget:1024 error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+}
+
+@end
@@ -0,0 +1,292 @@
+//
+//  MBSCryptoServiceTests.m
+//  MbSecureCrypto
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+
+#import <XCTest/XCTest.h>
+#import "MbSecureCrypto.h"
+#import <sys/socket.h>
+#import <sys/un.h>
+#import <unistd.h>
+
+@interface MBSCryptoServiceTests : XCTestCase
+@property (nonatomic, strong) NSURL *socketURL;
+@property (nonatomic, strong) NSData *key;
+@property (nonatomic, strong) MBSCryptoService *service;
+@property (nonatomic, strong) MBSCryptoServiceClient *client;
+@end
+
+@implementation MBSCryptoServiceTests
+
+- (void)setUp {
+    [super setUp];
+    // sun_path holds 104 bytes, which NSTemporaryDirectory() can nearly fill on its own
+    self.socketURL = [NSURL fileURLWithPath:[NSString stringWithFormat:@"/tmp/mbs-%@.sock",
+                                             [NSUUID.UUID.UUIDString substringToIndex:8]]];
+    self.key = [MBSRandom generateBytes:32 error:nil];
+
+    NSError *error = nil;
+    self.service = [[MBSCryptoService alloc] initWithSocketURL:self.socketURL];
+    XCTAssertTrue([self.service registerKey:self.key withIdentifier:@"orders" error:&error], @"%@", error);
+    XCTAssertTrue([self.service startWithError:&error], @"%@", error);
+    self.client = [[MBSCryptoServiceClient alloc] initWithSocketURL:self.socketURL];
+}
+
+- (void)tearDown {
+    [self.client close];
+    [self.service stop];
+    [[NSFileManager defaultManager] removeItemAtURL:self.socketURL error:nil];
+    [super tearDown];
+}
+
+- (NSData *)derivedKeyForContext:(NSString *)context {
+    return [MBSKeyDerivation deriveKey:self.key domain:kMBSCryptoServiceKeyDomain context:context error:nil];
+}
+
+- (NSData *)returnedKeyForContext:(NSString *)context {
+    return [MBSKeyDerivation deriveKey:self.key domain:kMBSCryptoServiceDeriveDomain context:context error:nil];
+}
+
+#pragma mark - Request Tests
+
+- (void)testSealAndOpenRoundTrip {
+    NSError *error = nil;
+    NSData *plaintext = [@"order #1001" dataUsingEncoding:NSUTF8StringEncoding];
+
+    NSData *sealed = [self.client sealData:plaintext withKeyIdentifier:@"orders" context:@"tenant-42" error:&error];
+    XCTAssertNotNil(sealed, @"%@", error);
+    XCTAssertEqualObjects([self.client openData:sealed withKeyIdentifier:@"orders" context:@"tenant-42" error:&error],
+                          plaintext, @"%@", error);
+
+    // Opens without the service given the registered key
+    XCTAssertEqualObjects([MBSCipher decryptData:sealed
+                                   withAlgorithm:MBSCipherAlgorithmAESGCM
+                                      withFormat:@(MBSCipherFormatV1)
+                                         withKey:[self derivedKeyForContext:@"tenant-42"]
+                                           error:&error], plaintext, @"%@", error);
+
+    // An empty context uses the registered key itself
+    sealed = [self.client sealData:plaintext withKeyIdentifier:@"orders" context:@"" error:&error];
+    XCTAssertEqualObjects([MBSCipher decryptData:sealed
+                                   withAlgorithm:MBSCipherAlgorithmAESGCM
+                                      withFormat:@(MBSCipherFormatV1)
+                                         withKey:self.key
+                                           error:&error], plaintext, @"%@", error);
+    XCTAssertTrue(self.client.isConnected);
+}
+
+- (void)testBatchReportsErrorsPerRequest {
+    NSError *error = nil;
+    NSData *plaintext = [MBSRandom generateBytes:4096 error:nil];
+    NSMutableData *tampered = [[MBSCipher encryptData:plaintext
+                                        withAlgorithm:MBSCipherAlgorithmAESGCM
+                                           withFormat:@(MBSCipherFormatV1)
+                                              withKey:[self derivedKeyForContext:@"a"]
+                                                error:nil] mutableCopy];
+    ((uint8_t *)tampered.mutableBytes)[tampered.length - 1] ^= 0x01;
+
+    NSArray<MBSCryptoServiceResult *> *results = [self.client performRequests:@[
+        [MBSCryptoServiceRequest sealRequestWithData:plaintext keyIdentifier:@"orders" context:@"a"],
+        [MBSCryptoServiceRequest openRequestWithData:tampered keyIdentifier:@"orders" context:@"a"],
+        [MBSCryptoServiceRequest sealRequestWithData:plaintext keyIdentifier:@"unknown" context:@"a"],
+        [MBSCryptoServiceRequest deriveRequestWithKeyIdentifier:@"orders" context:@""],
+        [MBSCryptoServiceRequest deriveRequestWithKeyIdentifier:@"orders" context:@"a"],
+    ] error:&error];
+    XCTAssertEqual(results.count, 5, @"%@", error);
+
+    XCTAssertNil(results[0].error);
+    XCTAssertNotNil(results[0].data);
+    XCTAssertEqual(results[1].error.code, MBSCipherErrorAuthenticationFailed);
+    XCTAssertEqual(results[2].error.code, MBSCipherErrorInvalidKey);
+    XCTAssertEqual(results[3].error.code, MBSCipherErrorInvalidInput);
+    XCTAssertEqualObjects(results[4].data, [self returnedKeyForContext:@"a"]);
+
+    // Failed requests leave the connection usable
+    XCTAssertNotNil([self.client deriveKeyWithIdentifier:@"orders" context:@"b" error:&error], @"%@", error);
+}
+
+- (void)testDerivedKeysDoNotOpenSealedData {
+    NSError *error = nil;
+    NSData *plaintext = [@"order #1002" dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *sealed = [self.client sealData:plaintext withKeyIdentifier:@"orders" context:@"tenant-42" error:&error];
+    XCTAssertNotNil(sealed, @"%@", error);
+
+    NSData *derived = [self.client deriveKeyWithIdentifier:@"orders" context:@"tenant-42" error:&error];
+    XCTAssertEqual(derived.length, 32, @"%@", error);
+    XCTAssertNotEqualObjects(derived, [self derivedKeyForContext:@"tenant-42"]);
+
+    error = nil;
+    XCTAssertNil([MBSCipher decryptData:sealed
+                          withAlgorithm:MBSCipherAlgorithmAESGCM
+                             withFormat:@(MBSCipherFormatV1)
+                                withKey:derived
+                                  error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorAuthenticationFailed);
+
+    // Deriving first does not change the key the service seals with
+    XCTAssertEqualObjects([self.client openData:sealed withKeyIdentifier:@"orders" context:@"tenant-42" error:&error],
+                          plaintext, @"%@", error);
+}
+
+- (void)testRemovedAndReplacedKeys {
+    NSError *error = nil;
+    XCTAssertEqualObjects([self.client deriveKeyWithIdentifier:@"orders" context:@"a" error:&error],
+                          [self returnedKeyForContext:@"a"]);
+
+    [self.service removeKeyWithIdentifier:@"orders"];
+    XCTAssertNil([self.client deriveKeyWithIdentifier:@"orders" context:@"a" error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidKey);
+    XCTAssertEqualObjects(self.service.keyIdentifiers, @[]);
+
+    // Keys cached for the old key are not served for the new one
+    self.key = [MBSRandom generateBytes:32 error:nil];
+    XCTAssertTrue([self.service registerKey:self.key withIdentifier:@"orders" error:nil]);
+    error = nil;
+    XCTAssertEqualObjects([self.client deriveKeyWithIdentifier:@"orders" context:@"a" error:&error],
+                          [self returnedKeyForContext:@"a"], @"%@", error);
+}
+
+- (void)testConcurrentClients {
+    NSUInteger clientCount = 8;
+    NSUInteger batchCount = 20;
+    __block NSUInteger failures = 0;
+
+    dispatch_apply(clientCount, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t index) {
+        MBSCryptoServiceClient *client = [[MBSCryptoServiceClient alloc] initWithSocketURL:self.socketURL];
+        NSString *context = [NSString stringWithFormat:@"client-%zu", index];
+        for (NSUInteger batch = 0; batch < batchCount; batch++) {
+            NSMutableArray<MBSCryptoServiceRequest *> *requests = [NSMutableArray array];
+            NSMutableArray<NSData *> *payloads = [NSMutableArray array];
+            for (NSUInteger i = 0; i < 16; i++) {
+                NSData *payload = [MBSRandom generateBytes:64 + i error:nil];
+                [payloads addObject:payload];
+                [requests addObject:[MBSCryptoServiceRequest sealRequestWithData:payload keyIdentifier:@"orders" context:context]];
+            }
+
+            NSArray<MBSCryptoServiceResult *> *sealed = [client performRequests:requests error:nil];
+            NSMutableArray<MBSCryptoServiceRequest *> *opens = [NSMutableArray array];
+            for (MBSCryptoServiceResult *result in sealed) {
+                [opens addObject:[MBSCryptoServiceRequest openRequestWithData:result.data ?: [NSData data]
+                                                                keyIdentifier:@"orders"
+                                                                      context:context]];
+            }
+            NSArray<MBSCryptoServiceResult *> *opened = opens.count ? [client performRequests:opens error:nil] : nil;
+
+            BOOL matches = opened.count == payloads.count;
+            for (NSUInteger i = 0; matches && i < payloads.count; i++) {
+                matches = [opened[i].data isEqualToData:payloads[i]];
+            }
+            if (!matches) {
+                @synchronized (self) {
+                    failures++;
+                }
+            }
+        }
+        [client close];
+    });
+
+    XCTAssertEqual(failures, 0);
+}
+
+#pragma mark - Lifecycle Tests
+
+- (void)testClientReconnectsAfterRestart {
+    NSError *error = nil;
+    NSData *plaintext = [@"restart" dataUsingEncoding:NSUTF8StringEncoding];
+    XCTAssertNotNil([self.client sealData:plaintext withKeyIdentifier:@"orders" context:@"a" error:&error], @"%@", error);
+
+    [self.service stop];
+    XCTAssertFalse(self.service.isRunning);
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:self.socketURL.path]);
+
+    self.service = [[MBSCryptoService alloc] initWithSocketURL:self.socketURL];
+    XCTAssertTrue([self.service registerKey:self.key withIdentifier:@"orders" error:nil]);
+    XCTAssertTrue([self.service startWithError:&error], @"%@", error);
+
+    NSData *sealed = [self.client sealData:plaintext withKeyIdentifier:@"orders" context:@"a" error:&error];
+    XCTAssertNotNil(sealed, @"%@", error);
+    XCTAssertEqualObjects([self.client openData:sealed withKeyIdentifier:@"orders" context:@"a" error:&error], plaintext);
+}
+
+- (void)testConnectionsBeyondTheLimitAreClosed {
+    self.service.maximumConnectionCount = 1;
+    NSError *error = nil;
+    XCTAssertNotNil([self.client deriveKeyWithIdentifier:@"orders" context:@"a" error:&error], @"%@", error);
+
+    MBSCryptoServiceClient *other = [[MBSCryptoServiceClient alloc] initWithSocketURL:self.socketURL];
+    XCTAssertNil([other deriveKeyWithIdentifier:@"orders" context:@"a" error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorIOFailure);
+
+    // A slot frees up once the first client leaves
+    [self.client close];
+    NSData *derived = nil;
+    for (NSUInteger attempt = 0; attempt < 50 && !derived; attempt++) {
+        derived = [other deriveKeyWithIdentifier:@"orders" context:@"a" error:nil];
+        if (!derived) {
+            [NSThread sleepForTimeInterval:0.05];
+        }
+    }
+    XCTAssertNotNil(derived);
+    [other close];
+}
+
+- (void)testClientTimesOutOnStalledService {
+    // A listener that accepts and never answers
+    NSURL *stalledURL = [NSURL fileURLWithPath:[NSString stringWithFormat:@"/tmp/mbs-%@.sock",
+                                                [NSUUID.UUID.UUIDString substringToIndex:8]]];
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    strlcpy(address.sun_path, stalledURL.fileSystemRepresentation, sizeof(address.sun_path));
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    XCTAssertEqual(bind(listener, (const struct sockaddr *)&address, sizeof(address)), 0);
+    XCTAssertEqual(listen(listener, 1), 0);
+
+    MBSCryptoServiceClient *client = [[MBSCryptoServiceClient alloc] initWithSocketURL:stalledURL];
+    client.timeout = 0.2;
+    NSError *error = nil;
+    NSDate *start = [NSDate date];
+    XCTAssertNil([client deriveKeyWithIdentifier:@"orders" context:@"a" error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorIOFailure);
+    XCTAssertLessThan([[NSDate date] timeIntervalSinceDate:start], 5);
+    XCTAssertFalse(client.isConnected);
+
+    close(listener);
+    unlink(address.sun_path);
+}
+
+- (void)testInvalidRequests {
+    NSError *error = nil;
+    XCTAssertFalse([self.service registerKey:[NSData dataWithBytes:"short" length:5] withIdentifier:@"short" error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidKey);
+
+    error = nil;
+    XCTAssertFalse([self.service registerKey:self.key withIdentifier:@"" error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+
+    error = nil;
+    XCTAssertFalse([self.service startWithError:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+
+    // A live socket is not taken over
+    error = nil;
+    MBSCryptoService *other = [[MBSCryptoService alloc] initWithSocketURL:self.socketURL];
+    XCTAssertFalse([other startWithError:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+
+    error = nil;
+    XCTAssertNil([self.client performRequests:@[] error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+
+    error = nil;
+    XCTAssertNil([self.client sealData:[NSData data] withKeyIdentifier:@"" context:@"" error:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorInvalidInput);
+
+    error = nil;
+    MBSCryptoServiceClient *missing = [[MBSCryptoServiceClient alloc] initWithSocketURL:
+                                       [NSURL fileURLWithPath:@"/tmp/mbs-missing.sock"]];
+    XCTAssertFalse([missing connectWithError:&error]);
+    XCTAssertEqual(error.code, MBSCipherErrorIOFailure);
+}
+
+@end
@@ -0,0 +1,6 @@
+//
+//  SwiftSupport.swift
+//  mbscrypt
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
@@ -0,0 +1,715 @@
+//
+//  main.m
+//  mbscrypt
+//
+//  Created by Maverick Bozo on 18/10/26.
+//
+//  Command-line front end for MbSecureCrypto.
+//
+//  mbscrypt encrypt [options] [FILE...]   Encrypt stdin to stdout, or each FILE to FILE.secb
+//  mbscrypt decrypt [options] [FILE...]   Decrypt stdin to stdout, or each FILE.secb to FILE
+//  mbscrypt keygen                        Write a random 32-byte key to stdout
+//  mbscrypt bench [options]               Print throughput for this machine
+//  mbscrypt serve [options]               Run a crypto service for the keys in a directory
+//
+
+#import <Foundation/Foundation.h>
+#import <errno.h>
+#import <fcntl.h>
+#import <getopt.h>
+#import <signal.h>
+#import <stdio.h>
+#import <time.h>
+#import <unistd.h>
+#import "MbSecureCrypto.h"
+
+static const char *kMBSToolName = "mbscrypt";
+static NSString *const kMBSEncryptedExtension = @"secb";
+
+typedef NS_ENUM(int, MBSExitCode) {
+    MBSExitCodeSuccess = 0,
+    MBSExitCodeFailure = 1,
+    MBSExitCodeUsage = 2
+};
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Options shared by encrypt and decrypt
+@interface MBSToolOptions : NSObject
+@property (nonatomic, strong, nullable) NSNumber *format;   // nil: V1 on encrypt, auto-detect on decrypt
+@property (nonatomic, copy, nullable) NSString *keyPath;
+@property (nonatomic, copy, nullable) NSString *masterKeyPath;
+@property (nonatomic, copy, nullable) NSString *domain;
+@property (nonatomic, copy, nullable) NSString *context;
+@property (nonatomic, copy, nullable) NSString *outputDirectory;
+@property (nonatomic, assign) NSUInteger chunkSize;
+@property (nonatomic, assign) MBSCompressionCodec compression;
+@property (nonatomic, assign) NSUInteger jobs;
+@property (nonatomic, assign) BOOL synchronize;
+@property (nonatomic, assign) BOOL bypassCache;
+@property (nonatomic, copy) NSArray<NSString *> *files;
+@end
+
+@implementation MBSToolOptions
+@end
+
+NS_ASSUME_NONNULL_END
+
+#pragma mark - Output
+
+static void MBSPrintError(NSError *error) {
+    fprintf(stderr, "%s: %s (code %ld)\n", kMBSToolName,
+            error.localizedDescription.UTF8String, (long)error.code);
+}
+
+static void MBSPrintUsage(FILE *stream) {
+    fprintf(stream,
+            "usage: %s encrypt [-f v0|v1] [-c BYTES] [-z CODEC] [-j N] [-o DIR] [--sync] [--nocache] KEY-OPTIONS [FILE...]\n"
+            "       %s decrypt [-f v0|v1|auto] [-j N] [-o DIR] [--sync] [--nocache] KEY-OPTIONS [FILE...]\n"
+            "       %s keygen\n"
+            "       %s bench [-s MIB] [-c BYTES]\n"
+            "       %s serve -s SOCKET -K DIR [-j N]\n"
+            "\n"
+            "Key options:\n"
+            "  -k, --key FILE          32-byte key, raw or as 64 hex characters\n"
+            "  -m, --master-key FILE   Master key (same encoding); the working key is derived with HKDF-SHA256\n"
+            "  -d, --domain DOMAIN     HKDF domain (required with --master-key)\n"
+            "  -x, --context CONTEXT   HKDF context (required with --master-key)\n"
+            "\n"
+            "Compression (V1 only; recorded in the header and undone on decrypt):\n"
+            "  -z, --compress CODEC    lz4 (fastest), zlib, or lzfse (best ratio)\n"
+            "\n"
+            "File options:\n"
+            "  -j, --jobs N            Parallel workers (default: one per core for chunked V1, else 1)\n"
+            "      --sync              Flush each output to stable storage before renaming it into place\n"
+            "      --nocache           Bypass the buffer cache for file reads and writes\n"
+            "\n"
+            "Without FILE operands, input is read from stdin and written to stdout.\n"
+            "V1 output is chunked and streamed in constant memory; V0 output is limited to 10MB.\n"
+            "\n"
+            "Service options:\n"
+            "  -s, --socket PATH       Unix socket to listen on\n"
+            "  -K, --key-dir DIR       Serve each DIR/ID.key (read like --key) as key ID\n"
+            "  -j, --jobs N            Crypto workers (default: one per core)\n",
+            kMBSToolName, kMBSToolName, kMBSToolName, kMBSToolName, kMBSToolName);
+}
+
+static uint64_t MBSNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+#pragma mark - Keys
+
+/// Key files are read as MBSFileKeyProvider reads them: 64 hex characters, or raw bytes
+static NSData *MBSResolveKey(MBSToolOptions *options, NSError **error) {
+    if (options.masterKeyPath) {
+        NSData *masterKey = [MBSFileKeyProvider keyFromFileAtURL:[NSURL fileURLWithPath:options.masterKeyPath] error:error];
+        if (!masterKey) {
+            return nil;
+        }
+        return [MBSKeyDerivation deriveKey:masterKey
+                                    domain:options.domain
+                                   context:options.context
+                                     error:error];
+    }
+
+    return [MBSFileKeyProvider keyFromFileAtURL:[NSURL fileURLWithPath:options.keyPath] error:error];
+}
+
+#pragma mark - Cipher Operations
+
+static NSData *MBSReadAll(NSInputStream *stream, NSUInteger limit, NSError **error) {
+    NSMutableData *data = [NSMutableData data];
+    uint8_t buffer[64 * 1024];
+    NSInteger count;
+    while ((count = [stream read:buffer maxLength:sizeof(buffer)]) > 0) {
+        [data appendBytes:buffer length:(NSUInteger)count];
+        if (data.length > limit) {
+            if (error) {
+                *error = [NSError errorWithDomain:MBSErrorDomain
+                                             code:MBSCipherErrorFileTooLarge
+                                         userInfo:@{NSLocalizedDescriptionKey: @"V0 input exceeds the 10MB limit; use -f v1 to stream"}];
+            }
+            return nil;
+        }
+    }
+    if (count < 0) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorIOFailure
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Failed to read input"}];
+        }
+        return nil;
+    }
+    return data;
+}
+
+static BOOL MBSWriteAll(NSOutputStream *stream, NSData *data) {
+    NSUInteger total = 0;
+    while (total < data.length) {
+        NSInteger count = [stream write:(const uint8_t *)data.bytes + total maxLength:data.length - total];
+        if (count <= 0) {
+            return NO;
+        }
+        total += (NSUInteger)count;
+    }
+    return YES;
+}
+
+/// Maps a codec name to its MBSCompressionCodec; returns NO for unknown names
+static BOOL MBSParseCodec(NSString *name, MBSCompressionCodec *codec) {
+    NSDictionary<NSString *, NSNumber *> *codecs = @{
+        @"none": @(MBSCompressionCodecNone),
+        @"lz4": @(MBSCompressionCodecLZ4),
+        @"zlib": @(MBSCompressionCodecZlib),
+        @"lzfse": @(MBSCompressionCodecLZFSE),
+    };
+    NSNumber *value = codecs[name.lowercaseString];
+    if (!value) {
+        return NO;
+    }
+    *codec = (MBSCompressionCodec)value.unsignedCharValue;
+    return YES;
+}
+
+static BOOL MBSRunCipher(BOOL encrypt,
+                         NSInputStream *input,
+                         NSOutputStream *output,
+                         MBSToolOptions *options,
+                         NSData *key,
+                         NSError **error) {
+    [input open];
+    [output open];
+
+    BOOL success;
+    if (!encrypt) {
+        success = [MBSCipherStream decryptStream:input
+                                        toStream:output
+                                   withAlgorithm:MBSCipherAlgorithmAESGCM
+                                      withFormat:options.format
+                                         withKey:key
+                                           error:error];
+    } else if (options.format && options.format.unsignedIntValue == MBSCipherFormatV0) {
+        // V0 has no header to carry chunking, so it stays single-shot
+        NSData *plaintext = MBSReadAll(input, kMBSCipherMaxFileSize, error);
+        NSData *encrypted = plaintext ? [MBSCipher encryptData:plaintext
+                                                 withAlgorithm:MBSCipherAlgorithmAESGCM
+                                                    withFormat:@(MBSCipherFormatV0)
+                                                       withKey:key
+                                                         error:error] : nil;
+        success = encrypted != nil && MBSWriteAll(output, encrypted);
+        if (encrypted && !success && error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorIOFailure
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Failed to write output"}];
+        }
+    } else {
+        success = [MBSCipherStream encryptStream:input
+                                        toStream:output
+                                   withAlgorithm:MBSCipherAlgorithmAESGCM
+                                       chunkSize:options.chunkSize
+                                 withCompression:options.compression
+                                         withKey:key
+                                           error:error];
+    }
+
+    [input close];
+    [output close];
+    return success;
+}
+
+static NSString *MBSOutputPath(NSString *path, BOOL encrypt, MBSToolOptions *options) {
+    NSString *name = path.lastPathComponent;
+    if (encrypt) {
+        name = [name stringByAppendingPathExtension:kMBSEncryptedExtension];
+    } else if ([name.pathExtension isEqualToString:kMBSEncryptedExtension]) {
+        name = name.stringByDeletingPathExtension;
+    } else {
+        name = [name stringByAppendingPathExtension:@"dec"];
+    }
+
+    NSString *directory = options.outputDirectory ?: path.stringByDeletingLastPathComponent;
+    return [directory stringByAppendingPathComponent:name];
+}
+
+/// Processes one file through a temporary sibling that is renamed into place on success
+static BOOL MBSProcessFile(NSString *path, BOOL encrypt, MBSToolOptions *options, NSData *key, NSError **error) {
+    NSString *destination = MBSOutputPath(path, encrypt, options);
+    NSString *temporary = [destination.stringByDeletingLastPathComponent stringByAppendingPathComponent:
+                           [NSString stringWithFormat:@".%@.%@.tmp", destination.lastPathComponent, NSUUID.UUID.UUIDString]];
+
+    NSInputStream *input = [NSInputStream inputStreamWithFileAtPath:path];
+    NSOutputStream *output = [NSOutputStream outputStreamToFileAtPath:temporary append:NO];
+    if (!input || !output) {
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:MBSCipherErrorIOFailure
+                                     userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Cannot open %@", path]}];
+        }
+        return NO;
+    }
+
+    NSFileManager *fileManager = [[NSFileManager alloc] init];
+    if (!MBSRunCipher(encrypt, input, output, options, key, error)) {
+        [fileManager removeItemAtPath:temporary error:nil];
+        return NO;
+    }
+
+    // rename(2) replaces the destination atomically, so it never goes missing and survives a failure
+    BOOL success = YES;
+    if (options.synchronize) {
+        int fd = open(temporary.fileSystemRepresentation, O_RDONLY | O_CLOEXEC);
+        success = fd >= 0 && (fcntl(fd, F_FULLFSYNC) == 0 || fsync(fd) == 0);
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    success = success && rename(temporary.fileSystemRepresentation, destination.fileSystemRepresentation) == 0;
+    if (!success) {
+        int renameError = errno;
+        [fileManager removeItemAtPath:temporary error:nil];
+        if (error) {
+            *error = [NSError errorWithDomain:MBSErrorDomain
+                                         code:(renameError == EACCES || renameError == EPERM) ? MBSCipherErrorFilePermission
+                                                                                              : MBSCipherErrorIOFailure
+                                     userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Cannot write %@", destination],
+                                                NSUnderlyingErrorKey: [NSError errorWithDomain:NSPOSIXErrorDomain
+                                                                                          code:renameError
+                                                                                      userInfo:nil]}];
+        }
+        return NO;
+    }
+    return YES;
+}
+
+/// Chunked V1 files go through MBSBulkFileCipher, which overlaps reads, crypto and writes across files
+static int MBSRunBulkFiles(BOOL encrypt, MBSToolOptions *options, NSData *key) {
+    NSMutableArray<NSURL *> *sources = [NSMutableArray arrayWithCapacity:options.files.count];
+    NSMutableArray<NSURL *> *destinations = [NSMutableArray arrayWithCapacity:options.files.count];
+    for (NSString *path in options.files) {
+        [sources addObject:[NSURL fileURLWithPath:path]];
+        [destinations addObject:[NSURL fileURLWithPath:MBSOutputPath(path, encrypt, options)]];
+    }
+
+    MBSBulkFileCipher *cipher = [[MBSBulkFileCipher alloc] initWithKey:key];
+    cipher.chunkSize = options.chunkSize;
+    cipher.synchronizeWrites = options.synchronize;
+    cipher.bypassCache = options.bypassCache;
+    if (options.jobs > 0) {
+        cipher.workerCount = options.jobs;
+    }
+
+    NSError *error = nil;
+    NSDictionary<NSURL *, NSError *> *failures = encrypt
+        ? [cipher encryptFiles:sources toOutputs:destinations error:&error]
+        : [cipher decryptFiles:sources toOutputs:destinations error:&error];
+    if (!failures) {
+        MBSPrintError(error);
+        return MBSExitCodeFailure;
+    }
+
+    for (NSURL *source in sources) {
+        NSError *failure = failures[source];
+        if (failure) {
+            fprintf(stderr, "%s: %s: ", kMBSToolName, source.path.fileSystemRepresentation);
+            MBSPrintError(failure);
+        }
+    }
+    return failures.count > 0 ? MBSExitCodeFailure : MBSExitCodeSuccess;
+}
+
+static int MBSRunFiles(BOOL encrypt, MBSToolOptions *options, NSData *key) {
+    // An explicit decrypt format is checked per file by MBSCipherStream; V0 output is single-shot,
+    // and compressed records vary in size so they are written in order
+    BOOL chunked = encrypt ? !(options.format && options.format.unsignedIntValue == MBSCipherFormatV0) : options.format == nil;
+    if (chunked && options.compression == MBSCompressionCodecNone) {
+        return MBSRunBulkFiles(encrypt, options, key);
+    }
+
+    dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+    dispatch_semaphore_t slots = dispatch_semaphore_create((long)MAX(options.jobs, (NSUInteger)1));
+    dispatch_group_t group = dispatch_group_create();
+    NSLock *outputLock = [[NSLock alloc] init];
+    __block int exitCode = MBSExitCodeSuccess;
+
+    for (NSString *path in options.files) {
+        dispatch_semaphore_wait(slots, DISPATCH_TIME_FOREVER);
+        dispatch_group_async(group, queue, ^{
+            @autoreleasepool {
+                NSError *error = nil;
+                if (!MBSProcessFile(path, encrypt, options, key, &error)) {
+                    [outputLock lock];
+                    fprintf(stderr, "%s: %s: ", kMBSToolName, path.fileSystemRepresentation);
+                    MBSPrintError(error);
+                    exitCode = MBSExitCodeFailure;
+                    [outputLock unlock];
+                }
+            }
+            dispatch_semaphore_signal(slots);
+        });
+    }
+
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    return exitCode;
+}
+
+#pragma mark - Commands
+
+static int MBSCommandCipher(BOOL encrypt, int argc, char *argv[]) {
+    MBSToolOptions *options = [[MBSToolOptions alloc] init];
+    options.chunkSize = kMBSCipherStreamDefaultChunkSize;
+    options.jobs = 0;
+
+    static struct option longOptions[] = {
+        {"format", required_argument, NULL, 'f'},
+        {"key", required_argument, NULL, 'k'},
+        {"master-key", required_argument, NULL, 'm'},
+        {"domain", required_argument, NULL, 'd'},
+        {"context", required_argument, NULL, 'x'},
+        {"chunk-size", required_argument, NULL, 'c'},
+        {"jobs", required_argument, NULL, 'j'},
+        {"output-dir", required_argument, NULL, 'o'},
+        {"compress", required_argument, NULL, 'z'},
+        {"sync", no_argument, NULL, 'S'},
+        {"nocache", no_argument, NULL, 'N'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int option;
+    while ((option = getopt_long(argc, argv, "f:k:m:d:x:c:z:j:o:", longOptions, NULL)) != -1) {
+        NSString *value = optarg ? @(optarg) : nil;
+        switch (option) {
+            case 'f':
+                if ([value isEqualToString:@"v0"]) {
+                    options.format = @(MBSCipherFormatV0);
+                } else if ([value isEqualToString:@"v1"]) {
+                    options.format = @(MBSCipherFormatV1);
+                } else if (![value isEqualToString:@"auto"] || encrypt) {
+                    fprintf(stderr, "%s: unknown format '%s'\n", kMBSToolName, optarg);
+                    return MBSExitCodeUsage;
+                }
+                break;
+            case 'k': options.keyPath = value; break;
+            case 'm': options.masterKeyPath = value; break;
+            case 'd': options.domain = value; break;
+            case 'x': options.context = value; break;
+            case 'c': options.chunkSize = (NSUInteger)strtoull(optarg, NULL, 10); break;
+            case 'z': {
+                MBSCompressionCodec codec = MBSCompressionCodecNone;
+                if (!encrypt || !MBSParseCodec(value, &codec)) {
+                    fprintf(stderr, "%s: unknown or misplaced compression '%s'\n", kMBSToolName, optarg);
+                    return MBSExitCodeUsage;
+                }
+                options.compression = codec;
+                break;
+            }
+            case 'j': options.jobs = MAX((NSUInteger)1, (NSUInteger)strtoull(optarg, NULL, 10)); break;
+            case 'o': options.outputDirectory = value; break;
+            case 'S': options.synchronize = YES; break;
+            case 'N': options.bypassCache = YES; break;
+            default:
+                MBSPrintUsage(stderr);
+                return MBSExitCodeUsage;
+        }
+    }
+
+    NSMutableArray<NSString *> *files = [NSMutableArray array];
+    for (int i = optind; i < argc; i++) {
+        [files addObject:@(argv[i])];
+    }
+    options.files = files;
+
+    if (options.compression != MBSCompressionCodecNone && options.format &&
+        options.format.unsignedIntValue == MBSCipherFormatV0) {
+        fprintf(stderr, "%s: compression requires the V1 format\n", kMBSToolName);
+        return MBSExitCodeUsage;
+    }
+
+    if ((options.keyPath == nil) == (options.masterKeyPath == nil)) {
+        fprintf(stderr, "%s: exactly one of --key or --master-key is required\n", kMBSToolName);
+        return MBSExitCodeUsage;
+    }
+
+    if (options.masterKeyPath && (options.domain == nil || options.context == nil)) {
+        fprintf(stderr, "%s: --master-key requires --domain and --context\n", kMBSToolName);
+        return MBSExitCodeUsage;
+    }
+
+    NSError *error = nil;
+    NSData *key = MBSResolveKey(options, &error);
+    if (!key) {
+        MBSPrintError(error);
+        return MBSExitCodeFailure;
+    }
+
+    if (files.count > 0) {
+        return MBSRunFiles(encrypt, options, key);
+    }
+
+    NSInputStream *input = [NSInputStream inputStreamWithFileAtPath:@"/dev/stdin"];
+    NSOutputStream *output = [NSOutputStream outputStreamToFileAtPath:@"/dev/stdout" append:YES];
+    if (!MBSRunCipher(encrypt, input, output, options, key, &error)) {
+        MBSPrintError(error);
+        return MBSExitCodeFailure;
+    }
+    return MBSExitCodeSuccess;
+}
+
+static int MBSCommandKeygen(void) {
+    NSError *error = nil;
+    NSString *hex = [MBSRandom generateBytesAsHex:32 error:&error];
+    if (!hex) {
+        MBSPrintError(error);
+        return MBSExitCodeFailure;
+    }
+    printf("%s\n", hex.UTF8String);
+    return MBSExitCodeSuccess;
+}
+
+static void MBSPrintThroughput(const char *label, NSUInteger bytes, uint64_t elapsed) {
+    double seconds = (double)elapsed / NSEC_PER_SEC;
+    printf("%-28s %10.1f MB/s\n", label, (double)bytes / (1024.0 * 1024.0) / seconds);
+}
+
+static int MBSCommandBench(int argc, char *argv[]) {
+    NSUInteger sizeMiB = 64;
+    NSUInteger chunkSize = kMBSCipherStreamDefaultChunkSize;
+
+    int option;
+    while ((option = getopt(argc, argv, "s:c:")) != -1) {
+        switch (option) {
+            case 's': sizeMiB = MAX((NSUInteger)1, (NSUInteger)strtoull(optarg, NULL, 10)); break;
+            case 'c': chunkSize = (NSUInteger)strtoull(optarg, NULL, 10); break;
+            default:
+                MBSPrintUsage(stderr);
+                return MBSExitCodeUsage;
+        }
+    }
+
+    NSError *error = nil;
+    NSData *key = [MBSRandom generateBytes:32 error:&error];
+    NSData *block = [MBSRandom generateBytes:1024 * 1024 error:&error];
+    if (!key || !block) {
+        MBSPrintError(error);
+        return MBSExitCodeFailure;
+    }
+
+    NSMutableData *plaintext = [NSMutableData dataWithCapacity:sizeMiB * block.length];
+    for (NSUInteger i = 0; i < sizeMiB; i++) {
+        [plaintext appendData:block];
+    }
+
+    printf("%s bench: %lu MiB, %lu byte chunks, %ld CPUs\n", kMBSToolName,
+           (unsigned long)sizeMiB, (unsigned long)chunkSize, (long)NSProcessInfo.processInfo.activeProcessorCount);
+
+    // Streamed V1
+    NSOutputStream *sink = [NSOutputStream outputStreamToMemory];
+    uint64_t start = MBSNow();
+    BOOL success = [MBSCipherStream encryptStream:[NSInputStream inputStreamWithData:plaintext]
+                                         toStream:sink
+                                    withAlgorithm:MBSCipherAlgorithmAESGCM
+                                        chunkSize:chunkSize
+                                          withKey:key
+                                            error:&error];
+    if (!success) {
+        MBSPrintError(error);
+        return MBSExitCodeFailure;
+    }
+    MBSPrintThroughput("stream encrypt (V1)", plaintext.length, MBSNow() - start);
+
+    NSData *encrypted = [sink propertyForKey:NSStreamDataWrittenToMemoryStreamKey];
+    start = MBSNow();
+    success = [MBSCipherStream decryptStream:[NSInputStream inputStreamWithData:encrypted]
+                                    toStream:[NSOutputStream outputStreamToMemory]
+                               withAlgorithm:MBSCipherAlgorithmAESGCM
+                                  withFormat:nil
+                                     withKey:key
+                                       error:&error];
+    if (!success) {
+        MBSPrintError(error);
+        return MBSExitCodeFailure;
+    }
+    MBSPrintThroughput("stream decrypt (V1)", plaintext.length, MBSNow() - start);
+
+    // Single-shot within the file size limit
+    NSData *single = [plaintext subdataWithRange:NSMakeRange(0, MIN(plaintext.length, kMBSCipherMaxFileSize))];
+    start = MBSNow();
+    NSData *sealed = [MBSCipher encryptData:single
+                              withAlgorithm:MBSCipherAlgorithmAESGCM
+                                 withFormat:@(MBSCipherFormatV1)
+                                    withKey:key
+                                      error:&error];
+    if (!sealed) {
+        MBSPrintError(error);
+        return MBSExitCodeFailure;
+    }
+    MBSPrintThroughput("single-shot encrypt (V1)", single.length, MBSNow() - start);
+
+    // Compress-then-encrypt on log-like JSON, end to end (encrypt + decrypt)
+    NSMutableData *logs = [NSMutableData dataWithCapacity:plaintext.length];
+    for (NSUInteger i = 0; logs.length < plaintext.length; i++) {
+        @autoreleasepool {
+            NSString *line = [NSString stringWithFormat:
+                              @"{\"ts\":%lu,\"level\":\"%@\",\"msg\":\"request served\",\"path\":\"/api/v1/items/%lu\",\"status\":200,\"ms\":%lu}\n",
+                              (unsigned long)(1700000000 + i), (i % 10) ? @"info" : @"warn",
+                              (unsigned long)(i % 977), (unsigned long)(i % 53)];
+            [logs appendData:[line dataUsingEncoding:NSUTF8StringEncoding]];
+        }
+    }
+
+    NSArray<NSArray *> *codecs = @[@[@"none", @(MBSCompressionCodecNone)],
+                                   @[@"lz4", @(MBSCompressionCodecLZ4)],
+                                   @[@"zlib", @(MBSCompressionCodecZlib)],
+                                   @[@"lzfse", @(MBSCompressionCodecLZFSE)]];
+    for (NSArray *codec in codecs) {
+        NSOutputStream *compressedSink = [NSOutputStream outputStreamToMemory];
+        start = MBSNow();
+        success = [MBSCipherStream encryptStream:[NSInputStream inputStreamWithData:logs]
+                                        toStream:compressedSink
+                                   withAlgorithm:MBSCipherAlgorithmAESGCM
+                                       chunkSize:chunkSize
+                                 withCompression:(MBSCompressionCodec)[codec[1] unsignedCharValue]
+                                         withKey:key
+                                           error:&error];
+        NSData *stored = [compressedSink propertyForKey:NSStreamDataWrittenToMemoryStreamKey];
+        success = success && [MBSCipherStream decryptStream:[NSInputStream inputStreamWithData:stored]
+                                                   toStream:[NSOutputStream outputStreamToMemory]
+                                              withAlgorithm:MBSCipherAlgorithmAESGCM
+                                                 withFormat:nil
+                                                    withKey:key
+                                                      error:&error];
+        if (!success) {
+            MBSPrintError(error);
+            return MBSExitCodeFailure;
+        }
+
+        double seconds = (double)(MBSNow() - start) / NSEC_PER_SEC;
+        NSString *label = [NSString stringWithFormat:@"logs round trip (%@)", codec[0]];
+        printf("%-28s %10.1f MB/s %7.1f%% saved\n", label.UTF8String,
+               (double)logs.length / (1024.0 * 1024.0) / seconds,
+               100.0 * (1.0 - (double)stored.length / (double)logs.length));
+    }
+
+    // Key derivation
+    NSUInteger derivations = 10000;
+    start = MBSNow();
+    for (NSUInteger i = 0; i < derivations; i++) {
+        @autoreleasepool {
+            [MBSKeyDerivation deriveKey:key domain:@"bench" context:@"derive" error:nil];
+        }
+    }
+    printf("%-28s %10.0f keys/s\n", "HKDF-SHA256 derive",
+           (double)derivations / ((double)(MBSNow() - start) / NSEC_PER_SEC));
+
+    return MBSExitCodeSuccess;
+}
+
+static int MBSCommandServe(int argc, char *argv[]) {
+    NSString *socketPath = nil;
+    NSString *keyDirectory = nil;
+    NSUInteger jobs = 0;
+
+    static struct option longOptions[] = {
+        {"socket", required_argument, NULL, 's'},
+        {"key-dir", required_argument, NULL, 'K'},
+        {"jobs", required_argument, NULL, 'j'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int option;
+    while ((option = getopt_long(argc, argv, "s:K:j:", longOptions, NULL)) != -1) {
+        switch (option) {
+            case 's': socketPath = @(optarg); break;
+            case 'K': keyDirectory = @(optarg); break;
+            case 'j': jobs = MAX((NSUInteger)1, (NSUInteger)strtoull(optarg, NULL, 10)); break;
+            default:
+                MBSPrintUsage(stderr);
+                return MBSExitCodeUsage;
+        }
+    }
+
+    if (!socketPath || !keyDirectory) {
+        fprintf(stderr, "%s: serve requires --socket and --key-dir\n", kMBSToolName);
+        return MBSExitCodeUsage;
+    }
+
+    MBSCryptoService *service = [[MBSCryptoService alloc] initWithSocketURL:[NSURL fileURLWithPath:socketPath]];
+    if (jobs > 0) {
+        service.workerCount = jobs;
+    }
+
+    // Same layout as MBSFileKeyProvider: DIR/<id>.key is served as key <id>
+    NSError *error = nil;
+    NSArray<NSString *> *names = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:keyDirectory error:&error];
+    if (!names) {
+        MBSPrintError(error);
+        return MBSExitCodeFailure;
+    }
+    for (NSString *name in [names sortedArrayUsingSelector:@selector(compare:)]) {
+        if (![name.pathExtension isEqualToString:@"key"]) {
+            continue;
+        }
+        NSURL *keyURL = [NSURL fileURLWithPath:[keyDirectory stringByAppendingPathComponent:name]];
+        NSData *key = [MBSFileKeyProvider keyFromFileAtURL:keyURL error:&error];
+        if (!key || ![service registerKey:key withIdentifier:name.stringByDeletingPathExtension error:&error]) {
+            fprintf(stderr, "%s: %s: ", kMBSToolName, name.UTF8String);
+            MBSPrintError(error);
+            return MBSExitCodeFailure;
+        }
+    }
+    if (service.keyIdentifiers.count == 0) {
+        fprintf(stderr, "%s: no .key files in %s\n", kMBSToolName, keyDirectory.UTF8String);
+        return MBSExitCodeFailure;
+    }
+
+    if (![service startWithError:&error]) {
+        MBSPrintError(error);
+        return MBSExitCodeFailure;
+    }
+    fprintf(stderr, "%s: serving %lu keys on %s\n", kMBSToolName,
+            (unsigned long)service.keyIdentifiers.count, socketPath.UTF8String);
+
+    // Stop on SIGINT or SIGTERM so the socket is removed
+    static dispatch_source_t signalSources[2];
+    int signals[] = {SIGINT, SIGTERM};
+    for (int i = 0; i < 2; i++) {
+        signal(signals[i], SIG_IGN);
+        signalSources[i] = dispatch_source_create(DISPATCH_SOURCE_TYPE_SIGNAL, (uintptr_t)signals[i], 0,
+                                                  dispatch_get_main_queue());
+        dispatch_source_set_event_handler(signalSources[i], ^{
+            [service stop];
+            exit(MBSExitCodeSuccess);
+        });
+        dispatch_resume(signalSources[i]);
+    }
+    dispatch_main();
+}
+
+int main(int argc, char *argv[]) {
+    @autoreleasepool {
+        if (argc < 2) {
+            MBSPrintUsage(stderr);
+            return MBSExitCodeUsage;
+        }
+
+        // Each subcommand parses its own options with argv[1] as its name
+        NSString *command = @(argv[1]);
+        if ([command isEqualToString:@"encrypt"] || [command isEqualToString:@"decrypt"]) {
+            return MBSCommandCipher([command isEqualToString:@"encrypt"], argc - 1, argv + 1);
+        } else if ([command isEqualToString:@"keygen"]) {
+            return MBSCommandKeygen();
+        } else if ([command isEqualToString:@"bench"]) {
+            return MBSCommandBench(argc - 1, argv + 1);
+        } else if ([command isEqualToString:@"serve"]) {
+            return MBSCommandServe(argc - 1, argv + 1);
+        } else if ([command isEqualToString:@"help"] || [command isEqualToString:@"-h"]) {
+            MBSPrintUsage(stdout);
+            return MBSExitCodeSuccess;
+        }
+
+        MBSPrintUsage(stderr);
+        return MBSExitCodeUsage;
+    }
+}